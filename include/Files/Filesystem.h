@@ -23,6 +23,7 @@
 #define __FILESYSTEM_H__
 
 #include "Globals/Include.h"
+#include <vector>
 
 
 namespace MultiKinect
@@ -42,6 +43,7 @@ namespace MultiKinect
 			static bool			fileExists(const std::string& path);
 			static bool			directoryExists(const std::string& path);
 			static void			createDirectory(const std::string& path);
+			static std::vector<std::string> listFiles(const std::string& path, const std::string& extension);
 			static std::string	getLocalDataPath();
 			static std::string	getExecutablePath();
 		};
@@ -25,7 +25,6 @@
 #include "Globals/Include.h"
 #include <wx/wx.h>
 #include <string>
-#include <vector>
 
 
 namespace MultiKinect
@@ -34,9 +33,6 @@ namespace MultiKinect
 	{
 		class App : public wxApp
 		{
-		private:
-			std::vector<std::string> slavesIDs;
-
 		public:
 			virtual bool OnInit();
 			virtual int OnExit(); 
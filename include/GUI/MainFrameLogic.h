@@ -24,6 +24,7 @@
 
 #include "Globals/Include.h"
 #include "GUI/MainFrame.h"
+#include <wx/timer.h>
 
 
 namespace MultiKinect
@@ -35,14 +36,19 @@ namespace MultiKinect
 		private:
 			uint32 appFrames_;
 			float64 appFPS_;
+			CommandChannel* commands_;
+			wxTimer* commandTimer_;
 
 			void setFPS();
+			void runCommands();
+			bool setStreams(int32 streams);
 
 		protected:
 			void onClose(wxCloseEvent& event);
 			void onExit(wxCommandEvent& event);
 			void onRestart(wxCommandEvent& event);
 			void onIdle(wxIdleEvent& event);
+			void onCommandTimer(wxTimerEvent& event);
 			void onOptionsPanel(wxCommandEvent& event);
 			void onViewLog(wxCommandEvent& event);
 			void onViewREADME(wxCommandEvent& event);
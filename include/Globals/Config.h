@@ -53,12 +53,26 @@ namespace MultiKinect
 				IDLE_EVENTS,
 				RENDER_THREAD
 			};
+
+			enum CaptureMode
+			{
+				CAPTURE_PROCESSES = 0,
+				CAPTURE_THREADS
+			};
+
+			enum SmoothingStage
+			{
+				SMOOTHING_OFF = 0,
+				SMOOTHING_SENSORS,
+				SMOOTHING_FUSION
+			};
 			
 			static const ApplicationMode	DEFAULT_APP_MODE;
 			static const std::string		DEFAULT_APPDATA_PATH;
 			static const std::string		DEFAULT_CONFIG_PATH;
 			static const std::string		DEFAULT_LOG_PATH;
 			static const RenderLoopMode		DEFAULT_RENDER_LOOP_MODE;
+			static const CaptureMode		DEFAULT_CAPTURE_MODE;
 			static const uint32				DEFAULT_CANVAS_WIDTH;
 			static const uint32				DEFAULT_CANVAS_HEIGHT;
 			static const bool				DEFAULT_SHOW_RGB_IMAGE;
@@ -70,6 +84,8 @@ namespace MultiKinect
 			static const bool				DEFAULT_ENABLED_RGB_IMAGE;
 			static const bool				DEFAULT_ENABLED_DEPTH_MAP;
 			static const bool				DEFAULT_ENABLED_SKELETON_TRACKING;
+			static const bool				DEFAULT_ENABLED_RAW_DEPTH;
+			static const bool				DEFAULT_ENABLED_PLAYER_MASKS;
 			static const bool				DEFAULT_ENABLED_NEAR_MODE;
 			static const bool				DEFAULT_ENABLED_SEATED_MODE;
 			static const bool				DEFAULT_ENABLED_HIERARCHICAL_ORI;
@@ -79,14 +95,37 @@ namespace MultiKinect
 			static const float32			DEFAULT_KINECT_ROTATION_X;
 			static const float32			DEFAULT_KINECT_ROTATION_Y;
 			static const float32			DEFAULT_KINECT_ROTATION_Z;
+			static const float32			DEFAULT_KINECT_MEASUREMENT_NOISE;
 			static const float32			DEFAULT_ROOM_ORIGIN_X;
 			static const float32			DEFAULT_ROOM_ORIGIN_Y;
 			static const float32			DEFAULT_ROOM_ORIGIN_Z;
 			static const float32			DEFAULT_ROOM_WIDTH;
 			static const float32			DEFAULT_ROOM_HEIGHT;
 			static const float32			DEFAULT_ROOM_DEPTH;
+			static const float32			DEFAULT_FUSION_ASSOCIATION_GATE;
+			static const uint32				DEFAULT_FUSION_TRACK_TIMEOUT;
+			static const uint32				DEFAULT_FUSION_JOINT_TIMEOUT;
+			static const float32			DEFAULT_FUSION_PROCESS_NOISE;
+			static const uint32				DEFAULT_FUSION_ALIGNMENT_WINDOW;
+			static const bool				DEFAULT_FUSION_SOLVE_ORIENTATIONS;
+			static const bool				DEFAULT_FUSION_HIERARCHICAL_ORI;
 			static const std::string		DEFAULT_VRPN_SKELETON_BASE_ADDR;
 			static const bool				DEFAULT_VRPN_SEND_ORIENTATIONS;
+			static const bool				DEFAULT_VRPN_PREDICTION;
+			static const uint32				DEFAULT_VRPN_PREDICTION_HORIZON;
+			static const float32			DEFAULT_VRPN_PREDICTION_DAMPING;
+			static const std::string		DEFAULT_RECORDING_PATH;
+			static const std::string		DEFAULT_REPLAY_PATH;
+			static const float32			DEFAULT_REPLAY_SPEED;
+			static const uint32				DEFAULT_REPLAY_START;
+			static const bool				DEFAULT_REPLAY_LOOP;
+			static const int32				DEFAULT_CAPTURE_PRIORITY;
+			static const int32				DEFAULT_SKELETON_CAPTURE_PRIORITY;
+			static const uint32				DEFAULT_CAPTURE_AFFINITY;
+			static const SmoothingStage		DEFAULT_SMOOTHING_STAGE;
+			static const float32			DEFAULT_SMOOTHING_MIN_CUTOFF;
+			static const float32			DEFAULT_SMOOTHING_BETA;
+			static const float32			DEFAULT_SMOOTHING_DERIVATIVE_CUTOFF;
 
 #ifdef _WIIMOTE_SUPPORT_
 			static const std::string		DEFAULT_VRPN_WIIMOTE_BASE_ADDR;
@@ -108,6 +147,7 @@ namespace MultiKinect
 				std::string		configPath;
 				std::string		logPath;
 				RenderLoopMode	renderMode;
+				CaptureMode		captureMode;
 				bool			restartApp;
 
 				SystemSettings();
@@ -134,6 +174,8 @@ namespace MultiKinect
 				bool			rgbImage;
 				bool			depthMap;
 				bool			skeletonTracking;
+				bool			rawDepth;
+				bool			playerMasks;
 				bool			nearMode;
 				bool			seatedMode;
 				bool            hierarchicalOri;
@@ -141,6 +183,7 @@ namespace MultiKinect
 				Vector			rotation;
 				int32			minElevationAngle;
 				int32			maxElevationAngle;
+				float32			measurementNoise;
 
 				KinectSettings();
 			};
@@ -155,6 +198,19 @@ namespace MultiKinect
 				VirtualRoomSettings();
 			};
 
+			struct FusionSettings
+			{
+				float32		associationGate;
+				uint32		trackTimeout;
+				uint32		jointTimeout;
+				float32		processNoise;
+				uint32		alignmentWindow;
+				bool		solveOrientations;
+				bool		hierarchicalOri;
+
+				FusionSettings();
+			};
+
 			struct VRPNSkeletonSettings
 			{
 				bool		enabled;
@@ -162,6 +218,9 @@ namespace MultiKinect
 				std::string	serverAddress;
 				bool		sendOrientations;
 				bool		sendOriginalSkeletons;
+				bool		prediction;
+				uint32		predictionHorizon;
+				float32		predictionDamping;
 
 				VRPNSkeletonSettings();
 			};
@@ -177,6 +236,47 @@ namespace MultiKinect
 			};
 #endif
 
+			struct RecordingSettings
+			{
+				bool		enabled;
+				std::string	path;
+
+				RecordingSettings();
+			};
+
+			struct ReplaySettings
+			{
+				bool		enabled;
+				std::string	path;
+				float32		speed;
+				uint32		start;
+				bool		loop;
+
+				ReplaySettings();
+			};
+
+			struct CaptureThreadsSettings
+			{
+				int32		colorPriority;
+				int32		depthPriority;
+				int32		skeletonPriority;
+				uint32		colorAffinity;
+				uint32		depthAffinity;
+				uint32		skeletonAffinity;
+
+				CaptureThreadsSettings();
+			};
+
+			struct JointSmoothingSettings
+			{
+				SmoothingStage	stage;
+				float32			minCutoff;
+				float32			beta;
+				float32			derivativeCutoff;
+
+				JointSmoothingSettings();
+			};
+
 			struct OtherSettings
 			{
 				float32	confidenceMargin;
@@ -197,8 +297,13 @@ namespace MultiKinect
 			static void loadCanvasSettings(const tinyxml2::XMLElement* parentElement);
 			static void loadKinectSettings(const tinyxml2::XMLElement* parentElement);
 			static void loadRoomSettings(const tinyxml2::XMLElement* parentElement);
+			static void loadFusionSettings(const tinyxml2::XMLElement* parentElement);
 			static void loadLocalVRPNSkeletonsSettings(const tinyxml2::XMLElement* parentElement);
 			static void loadRemoteVRPNSkeletonsSettings(const tinyxml2::XMLElement* parentElement);
+			static void loadRecordingSettings(const tinyxml2::XMLElement* parentElement);
+			static void loadReplaySettings(const tinyxml2::XMLElement* parentElement);
+			static void loadCaptureThreadsSettings(const tinyxml2::XMLElement* parentElement);
+			static void loadJointSmoothingSettings(const tinyxml2::XMLElement* parentElement);
 
 #ifdef _WIIMOTE_SUPPORT_
 			static void loadLocalVRPNWiimotesSettings(const tinyxml2::XMLElement* parentElement);
@@ -209,8 +314,13 @@ namespace MultiKinect
 			static void saveCanvasSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
 			static void saveKinectSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
 			static void saveRoomSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
+			static void saveFusionSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
 			static void saveLocalVRPNSkeletonsSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
 			static void saveRemoteVRPNSkeletonsSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
+			static void saveRecordingSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
+			static void saveReplaySettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
+			static void saveCaptureThreadsSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
+			static void saveJointSmoothingSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
 
 #ifdef _WIIMOTE_SUPPORT_
 			static void saveLocalVRPNWiimotesSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement);
@@ -225,6 +335,7 @@ namespace MultiKinect
 			static CanvasSettingsMap		canvas;
 			static KinectSettingsMap		kinect;
 			static VirtualRoomSettings		room;
+			static FusionSettings			fusion;
 			static VRPNSkeletonSettings		localVRPNSkeletons[KINECT_SKELETON_COUNT];
 			static VRPNSkeletonSettings		remoteVRPNSkeletons[KINECT_SKELETON_COUNT];
 
@@ -233,6 +344,10 @@ namespace MultiKinect
 			static VRPNWiimoteSettings		remoteVRPNWiimotes[WIIMOTE_COUNT];
 #endif
 
+			static RecordingSettings		recording;
+			static ReplaySettings			replay;
+			static CaptureThreadsSettings	captureThreads;
+			static JointSmoothingSettings	jointSmoothing;
 			static OtherSettings			other;
 
 			static void initialize();
@@ -38,9 +38,44 @@
 */
 #define KINECT_SKELETON_COUNT		6	/* NUI_SKELETON_COUNT */
 #define KINECT_SKELETON_JOINT_COUNT	20	/* NUI_SKELETON_POSITION_COUNT */
+#define KINECT_CAPTURE_STREAMS		3	/* KinectDevice::K_CAPTURE_STREAMS */
+#define KINECT_SKELETON_STREAM		2	/* KinectDevice::K_SKELETON_CAPTURE */
 #define KINECT_MAX_TILT_ANGLE		27
 #define KINECT_MIN_TILT_ANGLE		-27
 
+/*
+** Interprocess definitions
+*/
+#define SHARED_FRAME_SLOTS		64		/* One slot in writing, the rest readable as history (about two seconds at 30 fps) */
+#define DEPTH_PREVIEW_TIMEOUT	1000	/* Milliseconds a slave keeps colorizing depth after a viewer asked for it */
+#define SHARED_COMMAND_SLOTS	16		/* Commands the master may queue to a slave before it runs any */
+#define SLAVE_COMMAND_TIMEOUT	1000	/* Milliseconds the master waits for the slaves to acknowledge a command */
+#define SLAVE_COMMAND_PERIOD	33		/* Milliseconds between two polls of the command queue on the slave GUI thread */
+#define SLAVE_STARTUP_TIMEOUT	15000	/* Milliseconds a slave may take to report its device ready before it is launched again */
+#define SLAVE_WATCHDOG_PERIOD	33		/* Milliseconds between two liveness checks of the slaves, one frame at 30 fps */
+#define SLAVE_STALE_TIMEOUT		66		/* Milliseconds without new skeletons before a slave is left out of the fusion */
+#define SLAVE_HANG_TIMEOUT		5000	/* Milliseconds without heartbeat before a slave is killed and launched again */
+#define SLAVE_RESTART_BACKOFF	1000	/* Milliseconds before relaunching a dead slave, doubled on every consecutive restart */
+#define SLAVE_RESTART_MAX_BACKOFF	30000	/* Upper bound of the relaunch backoff */
+#define SLAVE_STABLE_TIME		10000	/* Milliseconds a slave must stay alive before its backoff is reset */
+
+/*
+** Capture definitions
+*/
+#define CAPTURE_WARMUP_FRAMES	30		/* Frames each capture thread may allocate in before the path must be allocation free */
+
+/*
+** Recording definitions
+*/
+#define RECORDING_BUFFER_SLOTS	8					/* Preallocated records per stream waiting to be written */
+#define RECORDING_VIEW_SIZE		(64*1024*1024)		/* Bytes of a recording mapped at once while reading it */
+
+/*
+** VRPN definitions
+*/
+#define VRPN_IDLE_TIMEOUT		100		/* Milliseconds the server waits for a new frame before servicing connections anyway */
+#define VRPN_STATUS_ADDRESS		"KinectStatus"	/* Analog device reporting the liveness of every slave */
+
 /*
 ** Wiimote definitions
 */
@@ -59,28 +59,55 @@ namespace MultiKinect
 
 	namespace Kinect
 	{
+		class BoneOrientationSolver;
 		class KinectDevice;
 		class KinectManager;
+		class KinectNuiSource;
+		class KinectRecorder;
+		class KinectRecording;
+		class KinectRecordingReader;
+		class KinectReplaySource;
 		class KinectSkeleton;
+		class KinectSource;
 	}
 
 	namespace Interprocess
 	{
+		class CommandChannel;
+		class FrameNotifier;
+		template <typename T> class SharedChannel;
+		struct SharedCommand;
+		class SharedCommandQueue;
+		template <typename T> class SharedFrameCursor;
+		template <typename T> class SharedFrameSlots;
+		struct SharedImageNoHeader;
+		template <typename P, typename H = SharedImageNoHeader> class SharedImageBuffers;
 		class SharedMemoryManager;
+		struct SharedSlaveState;
+		class SlaveManager;
 	}
 
 	namespace Render
 	{
+		class JointKalmanFilter;
 		class RenderSystem;
 		class RenderSystemInterprocess;
 		class RenderSystemLocal;
+		class RenderSystemMulti;
 		class RenderSystemRemote;
 		class RenderThread;
 		class RenderTimer;
+		class SkeletonFusion;
+		class SkeletonPredictor;
 	}
 
 	namespace Tools
 	{
+		class AllocationCounter;
+		class AssignmentSolver;
+		class Clock;
+		class ImageConversion;
+		class JointOneEuroFilter;
 		class Log;
 		class Timer;
 	}
@@ -88,6 +115,7 @@ namespace MultiKinect
 	namespace VRPN
 	{
 		class VRPNClient;
+		class VRPNDeviceStatus;
 		class VRPNServer;
 		class VRPNSkeletonTracker;
 		class VRPNSkeletonTrackerRemote;
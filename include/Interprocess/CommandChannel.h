@@ -0,0 +1,81 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __COMMANDCHANNEL_H__
+#define __COMMANDCHANNEL_H__
+
+#include "Globals/Include.h"
+#include "Interprocess/SharedCommandQueue.h"
+#include "Interprocess/SharedSlaveState.h"
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		/*
+		** One end of the command queue of a slave segment. The master creates
+		** the queue and sends commands, the slave opens it, runs them and
+		** acknowledges each one. The slave also publishes its startup state
+		** here. Both signal a named event the master can block on while it
+		** waits for several slaves at once.
+		*/
+		class CommandChannel
+		{
+		private:
+			std::string segmentID_;
+			SharedCommandQueue* queue_;
+			SharedSlaveState* state_;
+			HANDLE event_;
+
+			bool openEvent(const std::string& segmentID);
+
+		public:
+			CommandChannel();
+			virtual ~CommandChannel();
+
+			bool create(const std::string& segmentID);
+			bool open(const std::string& segmentID);
+			void close();
+
+			bool isOpen() const;
+			const std::string& getSegmentID() const;
+			HANDLE getEvent() const;
+
+			uint32 send(SharedCommand::CommandType type, int32 argument = 0, int32 value = 0);
+			bool receive(SharedCommand& command);
+			void acknowledge(uint32 ticket, bool succeeded);
+			bool isAcknowledged(uint32 ticket, bool* succeeded = 0) const;
+
+			void publishState(SharedSlaveState::State state, int32 streams, uint32 canvasWidth, uint32 canvasHeight);
+			void resetState();
+			void beat();
+			SharedSlaveState::State getState() const;
+			bool getSlaveState(SharedSlaveState& state) const;
+
+			static int32 getConfiguredStreams(const std::string& deviceID);
+			static int32 getConfiguredElevation(const std::string& deviceID);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __FRAMENOTIFIER_H__
+#define __FRAMENOTIFIER_H__
+
+#include "Globals/Include.h"
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		/*
+		** Named auto-reset event tied to a device segment. The device signals it
+		** every time it publishes a skeletons frame, and the process consuming
+		** that segment waits on it instead of polling the frame slots. Either
+		** side may open it first, the event is created by whoever comes first.
+		*/
+		class FrameNotifier
+		{
+		private:
+			std::string segmentID_;
+			HANDLE event_;
+
+		public:
+			FrameNotifier();
+			virtual ~FrameNotifier();
+
+			bool open(const std::string& segmentID);
+			void close();
+
+			bool isOpen() const;
+			const std::string& getSegmentID() const;
+			HANDLE getEvent() const;
+
+			void signal();
+		};
+	}
+}
+
+#endif
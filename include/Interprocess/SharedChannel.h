@@ -0,0 +1,97 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SHAREDCHANNEL_H__
+#define __SHAREDCHANNEL_H__
+
+#include "Globals/Include.h"
+#include "Interprocess/SharedMemoryManager.h"
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		/*
+		** Typed handle to a named shared object. The object is looked up once
+		** and only looked up again when the segment generation changes, which
+		** happens whenever an object is created or removed in that segment.
+		** Removing bumps the generation before the memory is released, so a
+		** reader that copies out of the object and then finds it still current
+		** knows the copy did not come from released memory.
+		*/
+		template <typename T> class SharedChannel
+		{
+		private:
+			std::string segmentID_;
+			std::string objectID_;
+			T* object_;
+			volatile LONG* generation_;
+			LONG resolvedGeneration_;
+
+			T* resolve()
+			{
+				object_ = 0;
+				if (segmentID_ != "" && objectID_ != "")
+				{
+					if (!generation_) generation_ = SharedMemoryManager::getSegmentGeneration(segmentID_);
+					if (generation_)
+					{
+						resolvedGeneration_ = *generation_;
+						object_ = SharedMemoryManager::getSharedObject<T>(segmentID_, objectID_);
+					}
+				}
+				return object_;
+			}
+
+		public:
+			SharedChannel() : segmentID_(""), objectID_(""), object_(0), generation_(0), resolvedGeneration_(0) {}
+			SharedChannel(const std::string& segmentID, const std::string& objectID) : segmentID_(segmentID), objectID_(objectID), object_(0), generation_(0), resolvedGeneration_(0) {}
+
+			void bind(const std::string& segmentID, const std::string& objectID)
+			{
+				segmentID_ = segmentID;
+				objectID_ = objectID;
+				object_ = 0;
+				generation_ = 0;
+			}
+
+			const std::string& getSegmentID() const
+			{
+				return segmentID_;
+			}
+
+			T* get()
+			{
+				if (object_ && *generation_ == resolvedGeneration_) return object_;
+				else return resolve();
+			}
+
+			bool isCurrent() const
+			{
+				return object_ && *generation_ == resolvedGeneration_;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SHAREDCOMMANDQUEUE_H__
+#define __SHAREDCOMMANDQUEUE_H__
+
+#include "Globals/Include.h"
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		struct SharedCommand
+		{
+			enum CommandType
+			{
+				K_COMMAND_SHUTDOWN = 0,
+				K_COMMAND_SET_ELEVATION,
+				K_COMMAND_SET_MODE,
+				K_COMMAND_SET_STREAMS
+			};
+
+			enum DeviceMode
+			{
+				K_MODE_NEAR = 0,
+				K_MODE_SEATED,
+				K_MODE_HIERARCHICAL_ORI
+			};
+
+			enum DeviceStream
+			{
+				K_STREAM_COLOR			=	0x01,
+				K_STREAM_DEPTH			=	0x02,
+				K_STREAM_SKELETON		=	0x04,
+				K_STREAM_RAW_DEPTH		=	0x08,
+				K_STREAM_PLAYER_MASKS	=	0x10
+			};
+
+			uint32 ticket;
+			CommandType type;
+			int32 argument;
+			int32 value;
+		};
+
+		/*
+		** Bounded command queue living in a slave segment. Any number of
+		** producers claim cells with a compare and swap on the head, and the
+		** slave is the only consumer. Each cell sequence tells whether it is
+		** free for the ticket a producer holds or filled for the one the
+		** consumer expects, so nobody ever waits on a lock. Tickets start at 1
+		** and the consumer acknowledges them in order, along with whether the
+		** command succeeded.
+		*/
+		class SharedCommandQueue
+		{
+		private:
+			struct Cell
+			{
+				volatile LONG sequence;
+				SharedCommand command;
+			};
+
+			struct Result
+			{
+				volatile LONG ticket;
+				volatile LONG succeeded;
+			};
+
+			volatile LONG head_;
+			volatile LONG tail_;
+			volatile LONG acknowledged_;
+			Cell cells_[SHARED_COMMAND_SLOTS];
+			Result results_[SHARED_COMMAND_SLOTS];
+
+		public:
+			SharedCommandQueue() : head_(0), tail_(0), acknowledged_(0)
+			{
+				for (LONG i = 0; i < SHARED_COMMAND_SLOTS; i++)
+				{
+					cells_[i].sequence = i;
+					results_[i].ticket = 0;
+					results_[i].succeeded = 0;
+				}
+			}
+
+			uint32 push(SharedCommand::CommandType type, int32 argument, int32 value)
+			{
+				LONG position = head_;
+				for (;;)
+				{
+					LONG sequence = cells_[position%SHARED_COMMAND_SLOTS].sequence;
+					MemoryBarrier();
+					if (sequence == position)
+					{
+						LONG previous = InterlockedCompareExchange(&head_, position + 1, position);
+						if (previous == position) break;
+						position = previous;
+					}
+					else if (sequence < position) return 0;
+					else position = head_;
+				}
+
+				Cell& cell = cells_[position%SHARED_COMMAND_SLOTS];
+				cell.command.ticket = basic_cast<uint32>(position + 1);
+				cell.command.type = type;
+				cell.command.argument = argument;
+				cell.command.value = value;
+				MemoryBarrier();
+				InterlockedExchange(&cell.sequence, position + 1);
+				return cell.command.ticket;
+			}
+
+			bool pop(SharedCommand& command)
+			{
+				LONG position = tail_;
+				Cell& cell = cells_[position%SHARED_COMMAND_SLOTS];
+				LONG sequence = cell.sequence;
+				MemoryBarrier();
+				if (sequence != position + 1) return false;
+
+				command = cell.command;
+				MemoryBarrier();
+				InterlockedExchange(&cell.sequence, position + SHARED_COMMAND_SLOTS);
+				InterlockedExchange(&tail_, position + 1);
+				return true;
+			}
+
+			void acknowledge(uint32 ticket, bool succeeded)
+			{
+				Result& result = results_[ticket%SHARED_COMMAND_SLOTS];
+				result.succeeded = (succeeded)?1:0;
+				MemoryBarrier();
+				InterlockedExchange(&result.ticket, basic_cast<LONG>(ticket));
+				InterlockedExchange(&acknowledged_, basic_cast<LONG>(ticket));
+			}
+
+			bool isAcknowledged(uint32 ticket, bool* succeeded = 0) const
+			{
+				if (basic_cast<uint32>(acknowledged_) < ticket) return false;
+
+				// Results older than the queue length are gone, they are reported as succeeded
+				if (succeeded)
+				{
+					const Result& result = results_[ticket%SHARED_COMMAND_SLOTS];
+					LONG value = result.succeeded;
+					MemoryBarrier();
+					*succeeded = (basic_cast<uint32>(result.ticket) != ticket || value != 0);
+				}
+				return true;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,271 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SHAREDFRAMESLOTS_H__
+#define __SHAREDFRAMESLOTS_H__
+
+#include "Globals/Include.h"
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		/*
+		** Single writer, multiple reader frame publishing. Each slot carries a
+		** sequence counter that is odd while the writer is filling it. Readers
+		** copy the latest slot and retry if the sequence changed meanwhile.
+		** Older slots stay readable as a short history until the writer wraps
+		** around to them.
+		**
+		** Frames are numbered from 1 in publishing order, so readers that need
+		** every frame can ask for all frames since a given number. A number
+		** older than the history means the writer overran that reader.
+		*/
+		template <typename T> class SharedFrameSlots
+		{
+		private:
+			struct Slot
+			{
+				volatile LONG sequence;
+				volatile LONG number;
+				T frame;
+
+				Slot() : sequence(0), number(0) {}
+			};
+
+			volatile LONG latest_;
+			volatile LONG published_;
+			LONG writing_;
+			Slot slots_[SHARED_FRAME_SLOTS];
+
+		public:
+			SharedFrameSlots() : latest_(-1), published_(0), writing_(0) {}
+
+			T& beginWrite()
+			{
+				writing_ = (latest_ + 1)%SHARED_FRAME_SLOTS;
+				InterlockedIncrement(&slots_[writing_].sequence);
+				slots_[writing_].number = published_ + 1;
+				return slots_[writing_].frame;
+			}
+
+			void endWrite()
+			{
+				InterlockedIncrement(&slots_[writing_].sequence);
+				InterlockedExchange(&latest_, writing_);
+				InterlockedIncrement(&published_);
+			}
+
+			bool read(T& frame, uint32 maxAttempts = 4) const
+			{
+				return readHistory(frame, 0, maxAttempts);
+			}
+
+			bool readHistory(T& frame, uint32 age, uint32 maxAttempts = 4) const
+			{
+				// Asking for the frame number, a slot the writer reuses during the copy fails the read instead of giving a newer frame
+				for (uint32 i = 0; i < maxAttempts; i++)
+				{
+					if (age >= getHistorySize()) return false;
+					if (readNumber(frame, getPublished() - age, 1)) return true;
+				}
+
+				return false;
+			}
+
+			bool readNumber(T& frame, uint32 number, uint32 maxAttempts = 4) const
+			{
+				if (number == 0) return false;
+
+				const Slot& slot = slots_[(number - 1)%SHARED_FRAME_SLOTS];
+				for (uint32 i = 0; i < maxAttempts; i++)
+				{
+					LONG sequence = slot.sequence;
+					MemoryBarrier();
+					if (sequence&1) continue;
+					if (basic_cast<uint32>(slot.number) != number) return false;
+
+					frame = slot.frame;
+					MemoryBarrier();
+					if (slot.sequence == sequence) return true;
+				}
+
+				return false;
+			}
+
+			/*
+			** Copies a single member of the latest frame, for readers that do not
+			** need the whole frame, such as one asking only for its timestamp.
+			*/
+			template <typename M> bool readField(M T::* field, M& value, uint32 maxAttempts = 4) const
+			{
+				for (uint32 i = 0; i < maxAttempts; i++)
+				{
+					uint32 number = getPublished();
+					if (number == 0) return false;
+
+					const Slot& slot = slots_[(number - 1)%SHARED_FRAME_SLOTS];
+					LONG sequence = slot.sequence;
+					MemoryBarrier();
+					if (sequence&1 || basic_cast<uint32>(slot.number) != number) continue;
+
+					value = slot.frame.*field;
+					MemoryBarrier();
+					if (slot.sequence == sequence) return true;
+				}
+
+				return false;
+			}
+
+			/*
+			** Copies up to maxFrames frames, oldest first, starting at the given
+			** frame number. next receives the number to ask for on the following
+			** call and lost how many frames were overwritten before being read.
+			*/
+			uint32 readSince(uint32 number, T* frames, uint32 maxFrames, uint32& next, uint32& lost, uint32 maxAttempts = 4) const
+			{
+				uint32 nFrames = 0;
+				uint32 failures = 0;
+				lost = 0;
+				if (number == 0) number = 1;
+
+				while (nFrames < maxFrames)
+				{
+					uint32 published = getPublished();
+					uint32 oldest = published - getHistorySize() + 1;
+
+					// A number past the end means the writer started over
+					if (number > published + 1) number = oldest;
+					if (number > published) break;
+					if (number < oldest)
+					{
+						lost += oldest - number;
+						number = oldest;
+					}
+
+					// A read that only raced the writer is tried again, frames it overwrote are counted above
+					if (readNumber(frames[nFrames], number, maxAttempts))
+					{
+						nFrames++;
+						failures = 0;
+					}
+					else if (++failures < maxAttempts) continue;
+					else
+					{
+						lost++;
+						failures = 0;
+					}
+					number++;
+				}
+
+				next = number;
+				return nFrames;
+			}
+
+			/*
+			** Drops the history in place, for a new writer taking over slots a
+			** writer that died may have left in the middle of a frame. Every
+			** sequence moves on to an even value, so a reader copying meanwhile
+			** retries, and no slot answers to its old number any more. Frame
+			** numbers go on from where the previous writer stopped.
+			*/
+			void reset()
+			{
+				for (uint32 i = 0; i < SHARED_FRAME_SLOTS; i++)
+				{
+					InterlockedExchange(&slots_[i].number, 0);
+					InterlockedExchangeAdd(&slots_[i].sequence, (slots_[i].sequence&1)?1:2);
+				}
+			}
+
+			uint32 getPublished() const
+			{
+				return basic_cast<uint32>(published_);
+			}
+
+			uint32 getHistorySize() const
+			{
+				uint32 published = getPublished();
+				return (published < SHARED_FRAME_SLOTS - 1)?published:SHARED_FRAME_SLOTS - 1;
+			}
+		};
+
+		/*
+		** Reader side position in a SharedFrameSlots history. Every reader keeps
+		** its own cursor, so each one gets every frame once no matter how often
+		** it polls, as long as it keeps up with the history length.
+		*/
+		template <typename T> class SharedFrameCursor
+		{
+		private:
+			uint32 next_;
+			uint32 lost_;
+			uint32 totalLost_;
+
+		public:
+			SharedFrameCursor() : next_(1), lost_(0), totalLost_(0) {}
+
+			void seek(uint32 number)
+			{
+				next_ = number;
+			}
+
+			void seekLatest(const SharedFrameSlots<T>* slots)
+			{
+				next_ = (slots)?slots->getPublished() + 1:1;
+			}
+
+			uint32 read(const SharedFrameSlots<T>* slots, T* frames, uint32 maxFrames)
+			{
+				lost_ = 0;
+				if (!slots) return 0;
+
+				uint32 nFrames = slots->readSince(next_, frames, maxFrames, next_, lost_);
+				totalLost_ += lost_;
+				return nFrames;
+			}
+
+			uint32 getNext() const
+			{
+				return next_;
+			}
+
+			bool hasOverrun() const
+			{
+				return (lost_ != 0);
+			}
+
+			uint32 getLost() const
+			{
+				return lost_;
+			}
+
+			uint32 getTotalLost() const
+			{
+				return totalLost_;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,153 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SHAREDIMAGEBUFFERS_H__
+#define __SHAREDIMAGEBUFFERS_H__
+
+#include "Globals/Include.h"
+#include <cstring>
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		/*
+		** Per image metadata for buffers that only need timestamps and frame
+		** numbers.
+		*/
+		struct SharedImageNoHeader
+		{
+		};
+
+		/*
+		** Double buffered publishing of images too large for SharedFrameSlots.
+		** This header only holds the bookkeeping and an optional per image
+		** header; the pixels live in a separate shared array of two images,
+		** passed in by both sides since pointers differ between processes.
+		** Each buffer carries a sequence counter that is odd while the writer
+		** is filling it, as in SharedFrameSlots.
+		*/
+		template <typename P, typename H> class SharedImageBuffers
+		{
+		private:
+			struct Buffer
+			{
+				volatile LONG sequence;
+				uint64 timestamp;
+				uint32 frameNumber;
+				H header;
+
+				Buffer() : sequence(0), timestamp(0), frameNumber(0) {}
+			};
+
+			volatile LONG latest_;
+			volatile LONG published_;
+			LONG writing_;
+			uint32 width_;
+			uint32 height_;
+			Buffer buffers_[2];
+
+		public:
+			SharedImageBuffers() : latest_(-1), published_(0), writing_(0), width_(0), height_(0) {}
+
+			void setSize(uint32 width, uint32 height)
+			{
+				width_ = width;
+				height_ = height;
+			}
+
+			uint32 getWidth() const
+			{
+				return width_;
+			}
+
+			uint32 getHeight() const
+			{
+				return height_;
+			}
+
+			uint32 getPixelCount() const
+			{
+				return width_*height_;
+			}
+
+			P* beginWrite(P* pixels)
+			{
+				writing_ = (latest_ + 1)%2;
+				InterlockedIncrement(&buffers_[writing_].sequence);
+				return pixels + getPixelCount()*writing_;
+			}
+
+			void endWrite(uint64 timestamp, const H& header = H())
+			{
+				buffers_[writing_].header = header;
+				buffers_[writing_].timestamp = timestamp;
+				buffers_[writing_].frameNumber = basic_cast<uint32>(published_) + 1;
+				InterlockedIncrement(&buffers_[writing_].sequence);
+				InterlockedExchange(&latest_, writing_);
+				InterlockedIncrement(&published_);
+			}
+
+			bool read(const P* pixels, P* target, uint64& timestamp, uint32& frameNumber, H* header = 0, uint32 maxAttempts = 4) const
+			{
+				for (uint32 i = 0; i < maxAttempts; i++)
+				{
+					LONG index = latest_;
+					if (index < 0) return false;
+
+					const Buffer& buffer = buffers_[index];
+					LONG sequence = buffer.sequence;
+					MemoryBarrier();
+					if (sequence&1) continue;
+
+					std::memcpy(target, pixels + getPixelCount()*index, getPixelCount()*sizeof(P));
+					timestamp = buffer.timestamp;
+					frameNumber = buffer.frameNumber;
+					if (header) *header = buffer.header;
+					MemoryBarrier();
+					if (buffer.sequence == sequence) return true;
+				}
+
+				return false;
+			}
+
+			/*
+			** Drops both images in place, for a new writer taking over buffers a
+			** writer that died may have left half written. Reads fail until the
+			** next image is published, as before the first one.
+			*/
+			void reset()
+			{
+				InterlockedExchange(&latest_, -1);
+				for (uint32 i = 0; i < 2; i++) InterlockedExchangeAdd(&buffers_[i].sequence, (buffers_[i].sequence&1)?1:2);
+			}
+
+			uint32 getPublished() const
+			{
+				return basic_cast<uint32>(published_);
+			}
+		};
+	}
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include "Globals/Include.h"
 #include <vector>
 #include <utility>
+#include <Windows.h>
 #include <boost/interprocess/managed_shared_memory.hpp>
 
 
@@ -42,6 +43,7 @@ namespace MultiKinect
 			static std::vector< std::pair<std::string, boost::interprocess::managed_shared_memory*> > openedSegments_;
 
 			static boost::interprocess::managed_shared_memory* openSegmentIfNeeded(const std::string& segmentID);
+			static void increaseGeneration(boost::interprocess::managed_shared_memory* segment);
 
 		public:
 			static void initialize();
@@ -51,12 +53,28 @@ namespace MultiKinect
 
 			static void createSharedSegment(const std::string& segmentID, uint32 segmentSize = 5242880);
 			static void removeSharedSegment(const std::string& segmentID);
+			static volatile LONG* getSegmentGeneration(const std::string& segmentID);
 
 			template <typename T> static T* createSharedObject(const std::string& segmentID, const std::string& objectID, uint32 numElements = 1)
 			{
 				boost::interprocess::managed_shared_memory* segment = openSegmentIfNeeded(segmentID);
-				if (numElements > 1) return segment->construct<T>(objectID.c_str())[numElements]();
-				else return segment->construct<T>(objectID.c_str())();
+
+				// Readers keep the address of an object, so one left behind by a slave that died is taken over as it is
+				std::pair<T*, std::size_t> existing = segment->find<T>(objectID.c_str());
+				if (existing.first && existing.second == numElements) return existing.first;
+
+				// One of another size cannot be, readers learn it is going before it goes and check again after reading
+				if (existing.first)
+				{
+					increaseGeneration(segment);
+					segment->destroy<T>(objectID.c_str());
+				}
+
+				T* object = 0;
+				if (numElements > 1) object = segment->construct<T>(objectID.c_str())[numElements]();
+				else object = segment->construct<T>(objectID.c_str())();
+				increaseGeneration(segment);
+				return object;
 			}
 
 			template <typename T> static T* getSharedObject(const std::string& segmentID, const std::string& objectID)
@@ -69,7 +87,9 @@ namespace MultiKinect
 			template <typename T> static void removeSharedObject(const std::string& segmentID, const std::string& objectID)
 			{
 				boost::interprocess::managed_shared_memory* segment = openSegmentIfNeeded(segmentID);
+				increaseGeneration(segment);
 				segment->destroy<T>(objectID.c_str());
+				increaseGeneration(segment);
 			}
 		};
 	}
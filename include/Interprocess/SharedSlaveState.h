@@ -0,0 +1,66 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SHAREDSLAVESTATE_H__
+#define __SHAREDSLAVESTATE_H__
+
+#include "Globals/Include.h"
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		/*
+		** Startup state a slave publishes in its segment once its device is
+		** (or failed to be) initialized, along with the streams it opened.
+		** Times come from the master clock, whose epoch slaves adopt. Once
+		** running, the slave window bumps the heartbeat every frame it renders
+		** and each capture thread counts the frames of its stream, which is
+		** what the master watchdog looks at.
+		*/
+		struct SharedSlaveState
+		{
+			enum State
+			{
+				K_SLAVE_STARTING = 0,
+				K_SLAVE_READY,
+				K_SLAVE_FAILED
+			};
+
+			volatile LONG state;
+			int32 streams;
+			uint32 canvasWidth;
+			uint32 canvasHeight;
+			uint64 stateTime;
+			volatile LONG heartbeat;
+			volatile LONG frames[KINECT_CAPTURE_STREAMS];
+
+			SharedSlaveState() : state(K_SLAVE_STARTING), streams(0), canvasWidth(0), canvasHeight(0), stateTime(0), heartbeat(0)
+			{
+				for (uint32 i = 0; i < KINECT_CAPTURE_STREAMS; i++) frames[i] = 0;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SLAVEMANAGER_H__
+#define __SLAVEMANAGER_H__
+
+#include "Globals/Include.h"
+#include "Interprocess/SharedCommandQueue.h"
+#include <vector>
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Interprocess
+	{
+		class SlaveManager
+		{
+		public:
+			enum SlaveLiveness
+			{
+				K_SLAVE_ALIVE = 0,
+				K_SLAVE_STARTING,
+				K_SLAVE_STALE,
+				K_SLAVE_HUNG,
+				K_SLAVE_DEAD,
+				K_SLAVE_FAILED
+			};
+
+			struct SlaveEntry
+			{
+				std::string deviceID;
+				std::string segmentID;
+				CommandChannel* commands;
+				HANDLE process;
+				uint64 launchTime;
+
+				volatile LONG liveness;
+				LONG lastHeartbeat;
+				uint64 heartbeatTime;
+				LONG lastFrames;
+				uint64 framesTime;
+				uint64 aliveSince;
+				uint64 restartTime;
+				uint32 backoff;
+			};
+
+		private:
+			static bool						initialized_;
+			static std::vector<SlaveEntry>	slaves_;
+			static HANDLE					supervisorStopEvent_;
+			static HANDLE					supervisorThread_;
+
+			static DWORD WINAPI	supervisorThread(LPVOID param);
+			static void			superviseSlave(SlaveEntry& slave, uint32 index, uint64 now);
+			static void			setLiveness(SlaveEntry& slave, SlaveLiveness liveness);
+			static void			resetSlaveObjects(SlaveEntry& slave);
+			static void			scheduleRestart(SlaveEntry& slave, uint64 now);
+
+		public:
+			static void initialize();
+			static void destroy();
+
+			static bool			isInitialized();
+			static void			addSlave(const std::string& deviceID, const std::string& segmentID);
+			static uint32		getNumberOfSlaves();
+			static std::string	getSegmentID(uint32 index);
+
+			static bool		launchSlave(uint32 index);
+			static bool		startSlaves();
+			static void		startSupervisor();
+			static void		stopSupervisor();
+
+			static SlaveLiveness	getLiveness(uint32 index);
+			static bool				isAlive(uint32 index);
+			static std::string		getLivenessName(SlaveLiveness liveness);
+
+			static uint32	sendCommand(uint32 index, SharedCommand::CommandType type, int32 argument = 0, int32 value = 0);
+			static void		broadcastCommand(std::vector<uint32>& tickets, SharedCommand::CommandType type, int32 argument = 0, int32 value = 0);
+			static bool		waitAcknowledged(const std::vector<uint32>& tickets, uint32 timeout);
+			static void		sendConfiguration();
+			static void		shutDownSlaves(uint32 timeout = SLAVE_COMMAND_TIMEOUT);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __BONEORIENTATIONSOLVER_H__
+#define __BONEORIENTATIONSOLVER_H__
+
+#include "Globals/Include.h"
+#include "Geom/Point.h"
+#include "Geom/Quaternion.h"
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		/*
+		** Derives joint orientations from the 20 joint positions of a batch of
+		** skeletons, without the Kinect SDK. Joints are indexed as in
+		** KinectSkeleton::KinectJoint and stored skeleton after skeleton.
+		**
+		** Like the SDK, every orientation belongs to the bone ending at the
+		** joint, with Y along the bone. The hip center frame has Y up the
+		** spine and X from the left hip to the right one. Every other bone
+		** turns its parent frame along the shortest arc onto its own
+		** direction. Absolute orientations are in the joints space and
+		** hierarchical ones relative to the parent bone. A bone with an
+		** invalid end keeps the orientation of its parent.
+		**
+		** Skeletons are solved four at a time in SSE lanes where available.
+		** The conversions work on one skeleton, in any frame applied to all
+		** of its absolute orientations, and toAbsolute() only composes
+		** joints whose whole chain up to the root is valid.
+		*/
+		class BoneOrientationSolver
+		{
+		public:
+			static void solve(const Point* joints, const bool* validity, uint32 nSkeletons, Quaternion* absolute, Quaternion* hierarchical = 0);
+			static void toHierarchical(const Quaternion* absolute, Quaternion* hierarchical);
+			static void toAbsolute(const Quaternion* hierarchical, const bool* validity, Quaternion* absolute, bool* composed);
+		};
+	}
+}
+
+#endif
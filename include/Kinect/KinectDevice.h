@@ -24,6 +24,8 @@
 
 #include "Globals/Include.h"
 #include "Geom/Color.h"
+#include "Geom/Vector.h"
+#include "Kinect/KinectSkeleton.h"
 #include <vector>
 #include <Windows.h>
 #include <NuiApi.h>
@@ -58,6 +60,14 @@ namespace MultiKinect
 				K_DEVICE_UNKNOWN
 			};
 
+			enum CaptureStream
+			{
+				K_COLOR_CAPTURE = 0,
+				K_DEPTH_CAPTURE,
+				K_SKELETON_CAPTURE,
+				K_CAPTURE_STREAMS
+			};
+
 			enum KinectError
 			{
 				K_ERROR_SKELETON_IN_USE = 0x0FFFFFFF,
@@ -68,27 +78,128 @@ namespace MultiKinect
 				K_ERROR_UNKNOWN = 0xFFFFFFFF
 			};
 
+			struct SkeletonsFrame
+			{
+				uint64 timestamp;
+				uint64 publishTimestamp;
+				uint32 nSkeletons;
+				float32 confidenceValue;
+				KinectSkeleton skeletons[KINECT_SKELETON_COUNT];
+				uint32 trackingIDs[KINECT_SKELETON_COUNT];
+
+				SkeletonsFrame();
+			};
+
+			struct RawDepthFrame
+			{
+				uint64 timestamp;
+				uint32 frameNumber;
+				uint32 width;
+				uint32 height;
+				std::vector<uint16> pixels;
+
+				RawDepthFrame();
+			};
+
+			struct PlayerBox
+			{
+				uint16 minX;
+				uint16 minY;
+				uint16 maxX;
+				uint16 maxY;
+			};
+
+			/*
+			** Published with every set of player masks. Bit i of players is set
+			** when depth player index i + 1 covers any pixel, and playerIndices
+			** maps it to the player index of the published skeletons (0 when
+			** that player has no tracked skeleton).
+			*/
+			struct PlayerMasksInfo
+			{
+				uint32 width;
+				uint32 players;
+				uint32 playerIndices[KINECT_SKELETON_COUNT];
+				PlayerBox boxes[KINECT_SKELETON_COUNT];
+
+				PlayerMasksInfo();
+			};
+
+			/*
+			** One bit plane of stride*height bytes per depth player index, in
+			** order. Bit k of byte x/8 in a row is set when pixel x, with
+			** k = x%8, belongs to that player.
+			*/
+			struct PlayerMasksFrame
+			{
+				uint64 timestamp;
+				uint32 frameNumber;
+				uint32 width;
+				uint32 height;
+				uint32 stride;
+				PlayerMasksInfo info;
+				std::vector<uint8> masks;
+
+				PlayerMasksFrame();
+			};
+
 		private:
+			/*
+			** Each enabled stream is captured by a thread of its own. The
+			** statistics are written by that thread once per second, and
+			** allocating is raised by debug builds when a warmed up capture
+			** touched the heap.
+			*/
+			struct CaptureWorker
+			{
+				KinectDevice* device;
+				CaptureStream stream;
+				HANDLE thread;
+				float32 fps;
+				float32 latency;
+				bool allocating;
+			};
+
 			bool valid_;
 			bool initialized_;
-			INuiSensor* instance_;
+			KinectSource* source_;
+			KinectRecorder* recorder_;
+			std::string id_;
+			uint32 canvasWidth_;
+			uint32 canvasHeight_;
 			bool colorStreamOpened_;
 			bool depthStreamOpened_;
 			int32 depthFlags_;
 			bool skeletonEnabled_;
 			int32 skeletonFlags_;
-			HANDLE colorStreamHandle_;
-			HANDLE depthStreamHandle_;
 			HANDLE colorFrameEvent_;
 			HANDLE depthFrameEvent_;
 			HANDLE skeletonFrameEvent_;
 			HANDLE processStopEvent_;
-			HANDLE processThread_;
+			CaptureWorker workers_[K_CAPTURE_STREAMS];
+			CaptureStream poseStream_;
 			uint8* colorFrame_;
 			uint8* depthFrame_;
-			uint32* nSkeletons_;
+			uint32* depthColors_;
+			bool depthColorsDirty_;
+			SharedImageBuffers<uint16>* rawDepthBuffers_;
+			uint16* rawDepthPixels_;
+			volatile LONG* depthPreviewRequests_;
+			LONG depthPreviewSeen_;
+			uint64 depthPreviewTime_;
+			SharedImageBuffers<uint8, PlayerMasksInfo>* playerMasksBuffers_;
+			uint8* playerMasksPixels_;
+			uint32 nSkeletons_;
 			std::vector<int32> skeletonMap_;
+			CRITICAL_SECTION playerMapLock_;
+			bool playerMapDirty_;
+			int32 depthPlayerMap_[KINECT_SKELETON_COUNT];
 			KinectSkeleton* skeletons_;
+			JointOneEuroFilter* smoothingFilter_;
+			float32* confidenceValue_;
+			SharedFrameSlots<SkeletonsFrame>* skeletonsSlots_;
+			FrameNotifier* frameNotifier_;
+			SharedSlaveState* slaveState_;
 			int32 elevationAngle_;
 			float32* rotationX_;
 			float32* rotationY_;
@@ -96,20 +207,35 @@ namespace MultiKinect
 			float32* translationX_;
 			float32* translationY_;
 			float32* translationZ_;
-			float32 colorFPS_;
-			float32 depthFPS_;
-			float32 skeletonFPS_;
+			CRITICAL_SECTION poseLock_;
+			Vector rotation_;
+			Vector translation_;
 			bool hierarchicalOri_;
 
 			void create();
+			void startRecording(_NUI_IMAGE_RESOLUTION colorResolution, _NUI_IMAGE_RESOLUTION depthResolution);
 			void obtainColorFrame();
 			void obtainDepthFrame();
 			void obtainSkeletonsFrame();
 			Color depthToColor(uint16 depthValue, bool usesPlayer);
+			void buildDepthColors(bool usesPlayer);
+			void publishRawDepth(const uint8* data, uint32 pitch, uint64 timestamp);
+			bool isDepthPreviewRequested();
+			void publishPlayerMasks(const uint8* data, uint32 pitch, uint64 timestamp);
+			void smoothSkeletons(NUI_SKELETON_FRAME& frame, uint64 timestamp);
+			bool refreshPlayerMap();
+			void updatePose();
+			void startCaptureWorkers();
+			void captureThread(CaptureWorker& worker);
+
+			// The source reference and the locks are owned, so devices are never copied
+			KinectDevice(const KinectDevice& device);
+			KinectDevice& operator=(const KinectDevice& device);
 
 		public:
 			KinectDevice(uint32 index);
 			KinectDevice(const std::string& deviceID);
+			KinectDevice(KinectSource* source);
 			virtual ~KinectDevice();
 
 			bool isValid();
@@ -121,10 +247,18 @@ namespace MultiKinect
 			void setSeatedMode(bool seated);
 			void setNearMode(bool nearMode);
 			void setHierarchicalOri(bool hierarchical);
+			void reloadPose();
 			uint8* getColorFrame();
 			uint8* getDepthFrame();
+			void requestDepthPreview();
+			bool getRawDepthFrame(RawDepthFrame& frame);
+			bool getPlayerMasksFrame(PlayerMasksFrame& frame);
 			uint32 getNumberOfSkeletons();
 			KinectSkeleton* getSkeletons();
+			bool getSkeletonsFrame(SkeletonsFrame& frame);
+			const SharedFrameSlots<SkeletonsFrame>* getSkeletonsSlots();
+			float32 getConfidenceValue();
+			uint32 getSkeletonsFrameID();
 			bool getRotation(float32& rotationX, float32& rotationY, float32& rotationZ);
 			bool getTranslation(float32& translationX, float32& translationY, float32& translationZ);
 			int32 getElevationAngle();
@@ -133,9 +267,14 @@ namespace MultiKinect
 			void recomputeElevationAngleLimits();
 			void setElevationAngle(int32 angle);
 			float32 getFPS();
+			float32 getFPS(CaptureStream stream);
+			float32 getLatency(CaptureStream stream);
+			bool hasCaptureAllocations(CaptureStream stream);
+			float32 getSmoothingLatency();
 
-			static DWORD WINAPI processThread(LPVOID param);
-			void processThread();
+			static bool readRawDepthFrame(const SharedImageBuffers<uint16>* buffers, const uint16* pixels, RawDepthFrame& frame);
+			static bool readPlayerMasksFrame(const SharedImageBuffers<uint8, PlayerMasksInfo>* buffers, const uint8* pixels, PlayerMasksFrame& frame);
+			static DWORD WINAPI captureThread(LPVOID param);
 		};
 	}
 }
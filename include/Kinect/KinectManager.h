@@ -33,10 +33,21 @@ namespace MultiKinect
 	{
 		class KinectManager
 		{
+		public:
+			struct DeviceEntry
+			{
+				std::string deviceID;
+				std::string segmentID;
+				std::string replayFile;
+				volatile LONG connected;
+			};
+
 		private:
 			static bool						initialized_;
 			static uint32					nDevices_;
-			static std::vector<std::string>	devicesIDs_;
+			static std::vector<DeviceEntry>	devices_;
+
+			static void initializeReplay();
 
 		public:
 			static void initialize();
@@ -46,10 +57,12 @@ namespace MultiKinect
 			static uint32			getNumberOfDevices();
 			static KinectDevice*	getDevicePointer(uint32 index);
 			static KinectDevice*	getDevicePointer(const std::string& deviceID);
-			static KinectDevice		getDeviceObject(uint32 index);
-			static KinectDevice		getDeviceObject(const std::string& deviceID);
+			static std::string		getDeviceID(uint32 index);
+			static std::string		getSegmentID(uint32 index);
+			static bool				isDeviceConnected(uint32 index);
 			static bool				isValidDeviceID(const std::string& deviceID);
 			static std::string		reformatDeviceID(const std::string& deviceID);
+			static KinectSource*	createSource(const std::string& deviceID);
 
 			static void CALLBACK deviceStatusCallback(HRESULT hrStatus, const OLECHAR* instanceName, const OLECHAR* uniqueDeviceName, void* pUserData);
 		};
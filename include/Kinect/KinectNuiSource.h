@@ -0,0 +1,68 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __KINECTNUISOURCE_H__
+#define __KINECTNUISOURCE_H__
+
+#include "Globals/Include.h"
+#include "Kinect/KinectSource.h"
+#include <Windows.h>
+#include <NuiApi.h>
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		class KinectNuiSource : public KinectSource
+		{
+		private:
+			INuiSensor* instance_;
+			HANDLE streamHandles_[2];
+			NUI_IMAGE_FRAME imageFrames_[2];
+			bool lockedFrames_[2];
+
+			void create();
+
+		public:
+			KinectNuiSource(uint32 index);
+			KinectNuiSource(const std::string& deviceID);
+			virtual ~KinectNuiSource();
+
+			bool isValid();
+			std::string getID();
+			KinectDevice::KinectStatusCode getStatus();
+			int32 initialize(int32 flags);
+			void shutDown();
+			bool hasSkeletalEngine();
+			bool enableSkeletonTracking(HANDLE frameEvent, int32 flags);
+			bool openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent);
+			void setImageStreamFlags(ImageStream stream, int32 flags);
+			bool lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame);
+			void releaseImageFrame(ImageStream stream);
+			bool getSkeletonFrame(uint32 timeout, SkeletonFrame& frame);
+			bool getElevationAngle(int32& angle);
+			bool setElevationAngle(int32 angle);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __KINECTRECORDER_H__
+#define __KINECTRECORDER_H__
+
+#include "Globals/Include.h"
+#include "Globals/Definitions.h"
+#include "Kinect/KinectRecording.h"
+#include <vector>
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		/*
+		** Appends the frames of one device to a recording file. The capture
+		** thread only copies each frame into a preallocated buffer and queues
+		** it, a writer thread does the disk work. When every buffer of a
+		** stream is still queued the frame is dropped instead of waiting.
+		*/
+		class KinectRecorder
+		{
+		private:
+			struct PendingRecord
+			{
+				KinectRecording::RecordHeader header;
+				uint8* data;
+			};
+
+			static const uint32 RECORD_TYPES = 3;
+			static const uint32 PENDING_RECORDS = RECORD_TYPES*RECORDING_BUFFER_SLOTS;
+
+			std::string								filename_;
+			HANDLE									file_;
+			KinectRecording::FileHeader				header_;
+			uint64									fileOffset_;
+			uint8*									buffers_;
+			uint32									bufferSizes_[RECORD_TYPES];
+			std::vector<uint8*>						freeBuffers_[RECORD_TYPES];
+			PendingRecord							pendingRecords_[PENDING_RECORDS];
+			uint32									pendingHead_;
+			uint32									pendingCount_;
+			CRITICAL_SECTION						queueLock_;
+			HANDLE									pendingEvent_;
+			HANDLE									writerStopEvent_;
+			HANDLE									writerThread_;
+			std::vector<KinectRecording::IndexEntry>	index_;
+			volatile LONG							droppedRecords_;
+
+			bool popRecord(PendingRecord& record);
+			bool writeData(const void* data, uint32 size);
+			void writeRecord(const PendingRecord& record);
+
+		public:
+			KinectRecorder(const std::string& filename, const KinectRecording::FileHeader& header);
+			virtual ~KinectRecorder();
+
+			bool isOpen();
+			bool record(KinectRecording::RecordType type, uint64 timestamp, const uint8* data, uint32 size);
+			uint32 getDroppedRecords();
+
+			static DWORD WINAPI writerThread(LPVOID param);
+			void writerThread();
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __KINECTRECORDING_H__
+#define __KINECTRECORDING_H__
+
+#include "Globals/Include.h"
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		/*
+		** On-disk layout of a recorded session, one file per device. The file
+		** header is followed by records in capture order, each one a record
+		** header plus its payload: BGRA pixels for color, raw 16-bit values
+		** for depth and a NUI_SKELETON_FRAME for skeletons. Timestamps are
+		** session clock nanoseconds, shared by every device of the session.
+		** Closing a recording appends an index of every record sorted by
+		** timestamp and stores its position in the file header, so readers
+		** can seek without parsing the records. Files without an index (an
+		** interrupted recording) are still readable by scanning them.
+		*/
+		class KinectRecording
+		{
+		public:
+			enum RecordType
+			{
+				K_RECORD_COLOR = 1,
+				K_RECORD_DEPTH,
+				K_RECORD_SKELETON
+			};
+
+			enum RecordingFormat
+			{
+				K_RECORDING_MAGIC = 0x43524B4D, /*"MKRC"*/
+				K_RECORDING_VERSION = 1,
+				K_RECORDING_ID_LENGTH = 128
+			};
+
+			struct FileHeader
+			{
+				uint32 magic;
+				uint32 version;
+				char deviceID[K_RECORDING_ID_LENGTH];
+				uint32 colorWidth;
+				uint32 colorHeight;
+				uint32 depthWidth;
+				uint32 depthHeight;
+				uint32 streams;
+				int32 elevationAngle;
+				uint64 indexOffset;
+				uint32 indexCount;
+				uint32 reserved;
+			};
+
+			struct RecordHeader
+			{
+				uint32 type;
+				uint32 size;
+				uint64 timestamp;
+			};
+
+			struct IndexEntry
+			{
+				uint64 timestamp;
+				uint64 offset;
+				uint32 type;
+				uint32 size;
+			};
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __KINECTRECORDINGREADER_H__
+#define __KINECTRECORDINGREADER_H__
+
+#include "Globals/Include.h"
+#include "Kinect/KinectRecording.h"
+#include <vector>
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		/*
+		** Memory mapped access to a recording file. Only a window of the file
+		** is mapped at a time, so recordings larger than the address space
+		** can be read; a payload pointer stays valid until the next call.
+		*/
+		class KinectRecordingReader
+		{
+		private:
+			HANDLE										file_;
+			HANDLE										mapping_;
+			uint64										fileSize_;
+			uint32										granularity_;
+			const uint8*								view_;
+			uint64										viewOffset_;
+			uint64										viewSize_;
+			KinectRecording::FileHeader					header_;
+			std::vector<KinectRecording::IndexEntry>	index_;
+
+			const uint8* map(uint64 offset, uint64 size);
+			bool readIndex();
+			void buildIndex();
+
+		public:
+			KinectRecordingReader();
+			virtual ~KinectRecordingReader();
+
+			bool open(const std::string& filename);
+			void close();
+			bool isOpen();
+			const KinectRecording::FileHeader& getHeader();
+			uint32 getNumberOfRecords();
+			const KinectRecording::IndexEntry& getEntry(uint32 index);
+			const uint8* getPayload(uint32 index);
+			uint32 seek(uint64 timestamp);
+
+			static bool readHeader(const std::string& filename, KinectRecording::FileHeader& header);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __KINECTREPLAYSOURCE_H__
+#define __KINECTREPLAYSOURCE_H__
+
+#include "Globals/Include.h"
+#include "Kinect/KinectRecording.h"
+#include "Kinect/KinectRecordingReader.h"
+#include "Kinect/KinectSource.h"
+#include <vector>
+#include <Windows.h>
+#include <NuiApi.h>
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		/*
+		** Plays a recorded session file back as if it came from a sensor. A
+		** replay thread paces the records by their timestamps and signals the
+		** same frame events a sensor would. Every replay source in the process
+		** shares one origin, so devices recorded together stay aligned.
+		*/
+		class KinectReplaySource : public KinectSource
+		{
+		private:
+			static const int64		UNSET_ORIGIN = -0x7FFFFFFFFFFFFFFFLL - 1;
+			static volatile LONGLONG	replayOrigin_;
+			static volatile LONG		activeSources_;
+
+			std::string						filename_;
+			KinectRecordingReader			reader_;
+			KinectRecording::FileHeader		header_;
+			bool							valid_;
+			bool							initialized_;
+			CRITICAL_SECTION				framesLock_;
+			CRITICAL_SECTION				imageLocks_[2];
+			HANDLE							streamEvents_[2];
+			bool							streamsOpened_[2];
+			std::vector<uint8>				imageBuffers_[2];
+			uint64							imageTimestamps_[2];
+			bool							imageReady_[2];
+			bool							lockedFrames_[2];
+			HANDLE							skeletonEvent_;
+			bool							skeletonEnabled_;
+			SkeletonFrame					skeletonFrame_;
+			bool							skeletonReady_;
+			HANDLE							consumedEvent_;
+			HANDLE							replayStopEvent_;
+			HANDLE							replayThread_;
+
+			bool isPending(uint32 type);
+			void deliver(uint32 type, const uint8* data, uint32 size, uint64 timestamp);
+
+		public:
+			KinectReplaySource(const std::string& filename);
+			virtual ~KinectReplaySource();
+
+			bool isValid();
+			std::string getID();
+			KinectDevice::KinectStatusCode getStatus();
+			int32 initialize(int32 flags);
+			void shutDown();
+			bool hasSkeletalEngine();
+			bool enableSkeletonTracking(HANDLE frameEvent, int32 flags);
+			bool openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent);
+			void setImageStreamFlags(ImageStream stream, int32 flags);
+			bool lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame);
+			void releaseImageFrame(ImageStream stream);
+			bool getSkeletonFrame(uint32 timeout, SkeletonFrame& frame);
+			bool getElevationAngle(int32& angle);
+			bool setElevationAngle(int32 angle);
+
+			static DWORD WINAPI replayThread(LPVOID param);
+			void replayThread();
+		};
+	}
+}
+
+#endif
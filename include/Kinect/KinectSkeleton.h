@@ -80,7 +80,7 @@ namespace MultiKinect
 			bool validJoints_[KINECT_SKELETON_JOINT_COUNT];
 			bool lastValidJoints_[KINECT_SKELETON_JOINT_COUNT];
 			float32 confidenceValue_;
-			float32 lastJointsTimestamps_[KINECT_SKELETON_JOINT_COUNT];
+			uint64 lastJointsTimestamps_[KINECT_SKELETON_JOINT_COUNT];
 
 		public:
 			KinectSkeleton();
@@ -0,0 +1,92 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __KINECTSOURCE_H__
+#define __KINECTSOURCE_H__
+
+#include "Globals/Include.h"
+#include "Kinect/KinectDevice.h"
+#include <Windows.h>
+#include <NuiApi.h>
+
+
+namespace MultiKinect
+{
+	namespace Kinect
+	{
+		/*
+		** Frame provider behind a KinectDevice. It mirrors the subset of the
+		** NUI sensor interface the device uses, so the device processing is
+		** the same whether frames come from a live sensor or a recording.
+		** Sources are reference counted like the NUI sensors they wrap.
+		*/
+		class KinectSource
+		{
+		public:
+			enum ImageStream
+			{
+				K_COLOR_STREAM = 0,
+				K_DEPTH_STREAM
+			};
+
+			struct ImageFrame
+			{
+				uint64 timestamp;
+				uint32 pitch;
+				uint32 size;
+				const uint8* data;
+			};
+
+			struct SkeletonFrame
+			{
+				uint64 timestamp;
+				NUI_SKELETON_FRAME data;
+			};
+
+		private:
+			volatile LONG references_;
+
+		public:
+			KinectSource();
+			virtual ~KinectSource();
+
+			void addRef();
+			void release();
+
+			virtual bool isValid() = 0;
+			virtual std::string getID() = 0;
+			virtual KinectDevice::KinectStatusCode getStatus() = 0;
+			virtual int32 initialize(int32 flags) = 0;
+			virtual void shutDown() = 0;
+			virtual bool hasSkeletalEngine() = 0;
+			virtual bool enableSkeletonTracking(HANDLE frameEvent, int32 flags) = 0;
+			virtual bool openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent) = 0;
+			virtual void setImageStreamFlags(ImageStream stream, int32 flags) = 0;
+			virtual bool lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame) = 0;
+			virtual void releaseImageFrame(ImageStream stream) = 0;
+			virtual bool getSkeletonFrame(uint32 timeout, SkeletonFrame& frame) = 0;
+			virtual bool getElevationAngle(int32& angle) = 0;
+			virtual bool setElevationAngle(int32 angle) = 0;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __JOINTKALMANFILTER_H__
+#define __JOINTKALMANFILTER_H__
+
+#include "Globals/Include.h"
+#include "Geom/Point.h"
+#include "Geom/Vector.h"
+
+
+namespace MultiKinect
+{
+	namespace Render
+	{
+		/*
+		** Constant velocity Kalman filters for every joint of every fused
+		** skeleton slot. State is stored per axis as flat arrays so the
+		** prediction of all joints runs as a single loop. Measurement noise is
+		** isotropic, so the three axes of a joint share one covariance.
+		*/
+		class JointKalmanFilter
+		{
+		public:
+			static const uint32 N_CELLS = KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT;
+
+		private:
+			float32	position_[3][N_CELLS];
+			float32	velocity_[3][N_CELLS];
+			float32	p00_[N_CELLS];
+			float32	p01_[N_CELLS];
+			float32	p11_[N_CELLS];
+			uint64	lastMeasurement_[N_CELLS];
+			bool	validCells_[N_CELLS];
+			uint64	lastTime_;
+
+		public:
+			JointKalmanFilter();
+			virtual ~JointKalmanFilter();
+
+			void reset(uint32 slot);
+			void predict(uint64 time, float32 processNoise);
+			void update(uint32 slot, uint32 joint, const Point& measurement, float32 measurementNoise, uint64 time);
+
+			bool	isValid(uint32 slot, uint32 joint) const;
+			Point	getPosition(uint32 slot, uint32 joint) const;
+			Vector	getVelocity(uint32 slot, uint32 joint) const;
+			uint64	getLastMeasurement(uint32 slot, uint32 joint) const;
+		};
+	}
+}
+
+#endif
@@ -23,6 +23,9 @@
 #define __RENDERSYSTEM_H__
 
 #include "Globals/Include.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include "Kinect/KinectDevice.h"
+#include "Render/SkeletonFusion.h"
 
 
 namespace MultiKinect
@@ -36,12 +39,19 @@ namespace MultiKinect
 			{
 				RS_LOCAL_DEVICE = 0,
 				RS_INTERPROCESS,
-				RS_REMOTE_DEVICE
+				RS_REMOTE_DEVICE,
+				RS_MULTI_DEVICE
 			};
 
 		private:
 			static RenderSystem* instance_;
 
+		protected:
+			static bool initializeDevice(KinectDevice* device);
+			static bool readSkeletonsFrameAt(const SharedFrameSlots<KinectDevice::SkeletonsFrame>* slots, uint64 timestamp, KinectDevice::SkeletonsFrame& frame);
+			static void interpolateSkeletonsFrames(const KinectDevice::SkeletonsFrame& frame1, const KinectDevice::SkeletonsFrame& frame2, uint64 timestamp, KinectDevice::SkeletonsFrame& frame);
+			void transformSkeletons(const KinectDevice::SkeletonsFrame& frame, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx);
+
 		public:
 			static void initialize(RenderSystemMode mode, KinectDevice* device = 0);
 			static void destroy();
@@ -51,11 +61,15 @@ namespace MultiKinect
 			static KinectDevice* getDevice();
 			static uint8* getKinectColorFrame(int32 deviceIdx = -1);
 			static uint8* getKinectDepthFrame(int32 deviceIdx = -1);
-			static KinectSkeleton* getKinectSkeleton(uint32 i, int32 deviceIdx = -1);
-			static void getKinectSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx = -1);
+			static bool getKinectRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx = -1);
+			static bool getKinectPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx = -1);
+			static bool getKinectSkeleton(KinectSkeleton& skeleton, uint32 i, int32 deviceIdx = -1);
+			static bool getKinectSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
 			static bool getKinectMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx = -1);
 			static bool getTransformedKinectSkeleton(KinectSkeleton& skeleton, uint32 i, int32 deviceIdx = -1);
 			static void getTransformedKinectSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			static bool getFusedKinectFrame(SkeletonFusion::FusedFrame& frame);
+			static uint32 getKinectFrameID(int32 deviceIdx = -1);
 			static float32 getKinectFPS();
 
 			RenderSystem();
@@ -63,9 +77,18 @@ namespace MultiKinect
 
 			virtual uint8* getKColorFrame(int32 deviceIdx = -1) = 0;
 			virtual uint8* getKDepthFrame(int32 deviceIdx = -1) = 0;
-			virtual void getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx = -1) = 0;
+			virtual bool getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1) = 0;
 			virtual bool getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx = -1);
 			virtual void getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual uint32 getKFrameID(int32 deviceIdx = -1);
+			virtual bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx = -1);
+			virtual bool isKDeviceLive(int32 deviceIdx = -1);
+			virtual float32 getKMeasurementNoise(int32 deviceIdx = -1);
+			virtual bool isKHierarchicalOri(int32 deviceIdx = -1);
+			virtual bool getFusedKFrame(SkeletonFusion::FusedFrame& frame);
 		};
 	}
 }
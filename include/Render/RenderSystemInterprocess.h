@@ -24,6 +24,11 @@
 
 #include "Globals/Include.h"
 #include "Render/RenderSystem.h"
+#include "Interprocess/SharedChannel.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include "Interprocess/SharedImageBuffers.h"
+#include "Kinect/KinectDevice.h"
+#include <vector>
 
 
 namespace MultiKinect
@@ -33,9 +38,34 @@ namespace MultiKinect
 		class RenderSystemInterprocess : public RenderSystem
 		{
 		private:
-			std::string currentSharedSegment_;
+			struct SegmentChannels
+			{
+				SharedChannel<uint8> colorFrame;
+				SharedChannel<uint8> depthFrame;
+				SharedChannel< SharedImageBuffers<uint16> > rawDepthBuffers;
+				SharedChannel<uint16> rawDepthPixels;
+				SharedChannel<LONG> depthPreviewRequests;
+				SharedChannel< SharedImageBuffers<uint8, KinectDevice::PlayerMasksInfo> > playerMasksBuffers;
+				SharedChannel<uint8> playerMasksPixels;
+				SharedChannel< SharedFrameSlots<KinectDevice::SkeletonsFrame> > skeletonsSlots;
+				SharedChannel<float32> confidenceValue;
+				SharedChannel<float32> rotationX;
+				SharedChannel<float32> rotationY;
+				SharedChannel<float32> rotationZ;
+				SharedChannel<float32> translationX;
+				SharedChannel<float32> translationY;
+				SharedChannel<float32> translationZ;
+
+				SegmentChannels(const std::string& segmentID = "");
+			};
+
+			int32 currentDevice_;
+			SkeletonFusion fusion_;
+			std::vector<SegmentChannels> channels_;
 
 			void searchBestSharedSegment();
+			SegmentChannels* getChannels(int32 deviceIdx);
+			bool readSkeletonsFrame(SegmentChannels* channels, KinectDevice::SkeletonsFrame& frame);
 
 		public:
 			RenderSystemInterprocess();
@@ -43,9 +73,16 @@ namespace MultiKinect
 
 			virtual uint8* getKColorFrame(int32 deviceIdx = -1);
 			virtual uint8* getKDepthFrame(int32 deviceIdx = -1);
-			virtual void getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx = -1);
+			virtual bool getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
 			virtual bool getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx = -1);
 			virtual void getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual uint32 getKFrameID(int32 deviceIdx = -1);
+			virtual bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx = -1);
+			virtual bool isKDeviceLive(int32 deviceIdx = -1);
+			virtual bool getFusedKFrame(SkeletonFusion::FusedFrame& frame);
 		};
 	}
 }
@@ -43,9 +43,12 @@ namespace MultiKinect
 
 			virtual uint8* getKColorFrame(int32 deviceIdx = -1);
 			virtual uint8* getKDepthFrame(int32 deviceIdx = -1);
-			virtual void getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx = -1);
+			virtual bool getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
 			virtual bool getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx = -1);
 			virtual void getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual uint32 getKFrameID(int32 deviceIdx = -1);
 		};
 	}
 }
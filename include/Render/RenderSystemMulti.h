@@ -0,0 +1,69 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __RENDERSYSTEMMULTI_H__
+#define __RENDERSYSTEMMULTI_H__
+
+#include "Globals/Include.h"
+#include "Render/RenderSystem.h"
+#include "Kinect/KinectDevice.h"
+#include <vector>
+
+
+namespace MultiKinect
+{
+	namespace Render
+	{
+		/*
+		** Captures every available device from the master process itself.
+		** Each device runs its own capture thread and publishes its skeletons
+		** through its frame slots, which fusion reads without locking.
+		*/
+		class RenderSystemMulti : public RenderSystem
+		{
+		private:
+			int32 currentDevice_;
+			SkeletonFusion fusion_;
+			std::vector<KinectDevice*> devices_;
+
+			void searchBestDevice();
+			int32 getDeviceIndex(int32 deviceIdx);
+
+		public:
+			RenderSystemMulti();
+			virtual ~RenderSystemMulti();
+
+			virtual uint8* getKColorFrame(int32 deviceIdx = -1);
+			virtual uint8* getKDepthFrame(int32 deviceIdx = -1);
+			virtual bool getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx = -1);
+			virtual bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual bool getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx = -1);
+			virtual void getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
+			virtual uint32 getKFrameID(int32 deviceIdx = -1);
+			virtual bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx = -1);
+			virtual bool getFusedKFrame(SkeletonFusion::FusedFrame& frame);
+		};
+	}
+}
+
+#endif
@@ -41,7 +41,7 @@ namespace MultiKinect
 
 			virtual uint8* getKColorFrame(int32 deviceIdx = -1);
 			virtual uint8* getKDepthFrame(int32 deviceIdx = -1);
-			virtual void getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx = -1);
+			virtual bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx = -1);
 		};
 	}
 }
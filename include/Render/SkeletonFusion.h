@@ -0,0 +1,120 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SKELETONFUSION_H__
+#define __SKELETONFUSION_H__
+
+#include "Globals/Include.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Render/JointKalmanFilter.h"
+#include "Tools/JointOneEuroFilter.h"
+#include <vector>
+#include <Windows.h>
+
+
+namespace MultiKinect
+{
+	namespace Render
+	{
+		class SkeletonFusion
+		{
+		public:
+			/*
+			** The first nSkeletons entries hold the live tracks, packed in the
+			** order of their internal slots, and trackIDs tells which track
+			** each entry holds. Joint orientations are absolute, or
+			** hierarchical with Config::fusion.hierarchicalOri, whatever mode
+			** each sensor reports in. Angular velocities are always those of
+			** the absolute orientations.
+			*/
+			struct FusedFrame
+			{
+				uint64			frameID;
+				uint64			timestamp;
+				uint64			fusedTimestamp;
+				uint32			nSkeletons;
+				KinectSkeleton	skeletons[KINECT_SKELETON_COUNT];
+				uint32			trackIDs[KINECT_SKELETON_COUNT];
+				Vector			velocities[KINECT_SKELETON_COUNT][KINECT_SKELETON_JOINT_COUNT];
+				Vector			accelerations[KINECT_SKELETON_COUNT][KINECT_SKELETON_JOINT_COUNT];
+				Vector			angularVelocities[KINECT_SKELETON_COUNT][KINECT_SKELETON_JOINT_COUNT];
+
+				FusedFrame();
+			};
+
+		private:
+			struct Track
+			{
+				uint32						id;
+				uint32						slot;
+				uint64						lastSeen;
+				KinectSkeleton				reference;
+				Quaternion					orientations[KINECT_SKELETON_JOINT_COUNT];
+				uint64						lastEstimate;
+				Vector						lastVelocities[KINECT_SKELETON_JOINT_COUNT];
+				Quaternion					lastOrientations[KINECT_SKELETON_JOINT_COUNT];
+				Vector						accelerations[KINECT_SKELETON_JOINT_COUNT];
+				Vector						angularVelocities[KINECT_SKELETON_JOINT_COUNT];
+				std::vector<KinectSkeleton>	candidates;
+				std::vector<float32>		candidatesNoise;
+				std::vector<bool>			candidatesHierarchical;
+				uint32						nCorrected;
+			};
+
+			CRITICAL_SECTION	updateLock_;
+			CRITICAL_SECTION	frameLock_;
+			std::vector<uint32>	lastFrameIDs_;
+			std::vector<uint64>	captureTimes_;
+			std::vector<uint64>	fusedTimes_;
+			uint64				lastCaptureTime_;
+			FusedFrame			frames_[2];
+			FusedFrame*			currentFrame_;
+			std::vector<Track>	tracks_;
+			uint32				nextTrackID_;
+			JointKalmanFilter	filter_;
+			JointOneEuroFilter	smoothing_;
+
+			bool hasNewData(RenderSystem* source, uint32 nDevices);
+			bool align(RenderSystem* source, uint32 nDevices, uint64& captureTime);
+			void associate(const KinectSkeleton* skeletons, uint32 nSkeletons, float32 noise, bool hierarchical, uint64 time);
+			void correct(Track& track, uint64 time);
+			void averageOrientations(Track& track);
+			KinectSkeleton estimate(const Track& track, uint64 time);
+			void solveOrientations(uint64 time);
+			void makeHierarchical(const Track& track, KinectSkeleton& skeleton);
+			void differentiate(Track& track, uint64 time);
+			void smooth(FusedFrame& frame, const uint32* slots, uint64 time);
+			void fuse(RenderSystem* source, uint32 nDevices, uint64 captureTime, FusedFrame& frame);
+			static float32 distance(const KinectSkeleton& skeleton1, const KinectSkeleton& skeleton2);
+
+		public:
+			SkeletonFusion();
+			virtual ~SkeletonFusion();
+
+			bool update(RenderSystem* source, uint32 nDevices);
+			void getFrame(FusedFrame& frame);
+			uint64 getFrameID();
+			float32 getSmoothingLatency();
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SKELETONPREDICTOR_H__
+#define __SKELETONPREDICTOR_H__
+
+#include "Globals/Include.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Render/SkeletonFusion.h"
+#include <deque>
+#include <vector>
+
+
+namespace MultiKinect
+{
+	namespace Render
+	{
+		class SkeletonPredictor
+		{
+		public:
+			/*
+			** Prediction error at one horizon over a replayed session. Errors
+			** are summed over the samples, each sample being the mean joint
+			** distance of one prediction; the held error is that of sending the
+			** last estimate as is, without any prediction.
+			*/
+			struct HorizonError
+			{
+				uint32	horizon;		/* Milliseconds */
+				float64	predictedErrorSum;
+				float64	heldErrorSum;
+				uint32	nSamples;
+
+				HorizonError(uint32 milliseconds = 0);
+			};
+
+		private:
+			std::string		name_;
+			bool			hasPending_;
+			uint64			pendingTime_;
+			uint64			pendingHorizon_;
+			uint32			pendingTrackID_;
+			KinectSkeleton	pending_;
+			float64			errorSum_;
+			float64			horizonSum_;
+			uint32			nSamples_;
+			uint64			lastReport_;
+
+			void evaluate(const SkeletonFusion::FusedFrame& frame, uint32 slot);
+
+		public:
+			SkeletonPredictor(const std::string& name);
+			virtual ~SkeletonPredictor();
+
+			KinectSkeleton predict(const SkeletonFusion::FusedFrame& frame, uint32 slot, uint64 time, uint32 maxHorizon, float32 damping);
+
+			static KinectSkeleton extrapolate(const SkeletonFusion::FusedFrame& frame, uint32 slot, float32 horizon, float32 damping);
+			static void evaluateHistory(const std::deque<SkeletonFusion::FusedFrame>& frames, uint32 index, float32 damping, std::vector<HorizonError>& errors);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ALLOCATIONCOUNTER_H__
+#define __ALLOCATIONCOUNTER_H__
+
+#include "Globals/Include.h"
+
+
+namespace MultiKinect
+{
+	namespace Tools
+	{
+		/*
+		** Counts the heap allocations made by the calling thread through a CRT
+		** allocation hook. Only debug builds have the hook, release builds
+		** report zero allocations and isEnabled() returns false.
+		*/
+		class AllocationCounter
+		{
+		private:
+			static bool	installed_;
+
+		public:
+			static void		install();
+			static void		uninstall();
+
+			static bool		isEnabled();
+			static uint32	getCount();
+		};
+	}
+}
+
+#endif
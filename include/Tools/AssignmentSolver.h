@@ -0,0 +1,46 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ASSIGNMENTSOLVER_H__
+#define __ASSIGNMENTSOLVER_H__
+
+#include "Globals/Include.h"
+#include <vector>
+
+
+namespace MultiKinect
+{
+	namespace Tools
+	{
+		class AssignmentSolver
+		{
+		public:
+			/*
+			** Minimum cost assignment (Hungarian method) over a row-major
+			** nRows x nCols cost matrix. assignment[row] receives the column
+			** assigned to that row, or -1 if it has none.
+			*/
+			static float32 solve(const std::vector<float32>& costs, uint32 nRows, uint32 nCols, std::vector<int32>& assignment);
+		};
+	}
+}
+
+#endif
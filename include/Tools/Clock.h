@@ -0,0 +1,57 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include "Globals/Include.h"
+
+
+namespace MultiKinect
+{
+	namespace Tools
+	{
+		/*
+		** Monotonic nanosecond clock shared by every process of a session. It
+		** counts from an epoch taken by the master, which slaves adopt at
+		** startup, so their timestamps can be compared directly.
+		*/
+		class Clock
+		{
+		private:
+			static int64	frequency_;
+			static int64	epoch_;
+
+			static int64	getTicks();
+
+		public:
+			static void		initialize();
+			static void		setEpoch(int64 epoch);
+			static int64	getEpoch();
+			static uint64	getTime();
+			static uint64	fromMilliseconds(uint64 milliseconds);
+			static float64	toMilliseconds(uint64 nanoseconds);
+			static float32	toSeconds(uint64 nanoseconds);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __IMAGECONVERSION_H__
+#define __IMAGECONVERSION_H__
+
+#include "Globals/Include.h"
+
+
+namespace MultiKinect
+{
+	namespace Tools
+	{
+		/*
+		** Row kernels turning camera frames into the packed RGB canvases shown
+		** by the viewer and into per player masks. SSSE3 paths are chosen at
+		** runtime, with scalar fallbacks for older processors and for the
+		** tail of each row.
+		*/
+		class ImageConversion
+		{
+		private:
+			static int32	ssse3_;
+
+		public:
+			static bool		hasSSSE3();
+			static void		convertBGRAToRGB(const uint8* bgra, uint8* rgb, uint32 width);
+			static void		downscaleBGRAToRGB(const uint8* bgra, uint32 pitch, uint32 factorX, uint32 factorY, uint8* rgb, uint32 width);
+			static void		colorizeDepthRow(const uint16* depth, const uint32* colors, uint8* rgb, uint32 width);
+			static uint32	extractPlayerMasksRow(const uint16* depth, uint32 width, uint8* masks, uint32 planeSize, uint32* minX, uint32* maxX);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __JOINTONEEUROFILTER_H__
+#define __JOINTONEEUROFILTER_H__
+
+#include "Globals/Include.h"
+#include "Geom/Point.h"
+
+
+namespace MultiKinect
+{
+	namespace Tools
+	{
+		/*
+		** One Euro low pass filters for every joint of every skeleton slot.
+		** The cutoff frequency of each joint rises with its filtered speed, so
+		** slow joints are smoothed hard and fast ones follow closely.
+		** Measurements are staged with set() and filter() then runs every
+		** cell at once over flat per axis arrays, four cells per SSE lane.
+		*/
+		class JointOneEuroFilter
+		{
+		public:
+			static const uint32 N_CELLS = KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT;
+
+		private:
+			float32	position_[3][N_CELLS];
+			float32	velocity_[3][N_CELLS];
+			float32	measurement_[3][N_CELLS];
+			float32	dt_[N_CELLS];
+			float32	updating_[N_CELLS];
+			float32	lag_[N_CELLS];
+			uint64	lastMeasurement_[N_CELLS];
+			bool	measuredCells_[N_CELLS];
+			bool	validCells_[N_CELLS];
+			float32	minCutoff_;
+			float32	beta_;
+			float32	derivativeCutoff_;
+			float32	latency_;
+
+		public:
+			JointOneEuroFilter();
+			virtual ~JointOneEuroFilter();
+
+			void setParameters(float32 minCutoff, float32 beta, float32 derivativeCutoff);
+			void reset(uint32 slot);
+			void set(uint32 slot, uint32 joint, const Point& measurement);
+			void filter(uint64 time);
+
+			bool	isValid(uint32 slot, uint32 joint) const;
+			Point	getPosition(uint32 slot, uint32 joint) const;
+			float32	getLatency() const;
+		};
+	}
+}
+
+#endif
@@ -25,6 +25,7 @@
 
 #include "Globals/Include.h"
 #include "Tools/Timer.h"
+#include <Windows.h>
 #include <iostream>
 #include <fstream>
 
@@ -39,6 +40,7 @@ namespace MultiKinect
 			static bool			initialized_;
 			static std::string	logFilename_;
 			static std::fstream	logFile_;
+			static CRITICAL_SECTION	lock_;
 
 		public:
 			static void initialize(const std::string& logID = "");
@@ -55,14 +57,13 @@ namespace MultiKinect
 			{
 				if (initialized_)
 				{
-					logFile_.open(logFilename_, std::fstream::out|std::fstream::app);
-
 					std::stringstream stream;
 					stream << Timer::getCountStrHMS("executionStart") << " -> " << message << ": " << var << std::endl;
-					logFile_.write(stream.str().c_str(), stream.str().length());
 
-					logFile_.close();
-					logFile_.clear();
+					EnterCriticalSection(&lock_);
+					logFile_.write(stream.str().c_str(), stream.str().length());
+					logFile_.flush();
+					LeaveCriticalSection(&lock_);
 				}
 				else std::cout << "[Log] write(): ERROR: Log not initialized." << std::endl;
 			}
@@ -0,0 +1,49 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __VRPNDEVICESTATUS_H__
+#define __VRPNDEVICESTATUS_H__
+
+#include "Globals/Include.h"
+#include <vrpn/vrpn_Analog.h>
+
+
+namespace MultiKinect
+{
+	namespace VRPN
+	{
+		/*
+		** Reports the liveness of every slave as one analog channel, in
+		** device order, holding a SlaveManager::SlaveLiveness code. Clients
+		** only get a report when some slave changes.
+		*/
+		class VRPNDeviceStatus : public vrpn_Analog
+		{
+		public:
+			VRPNDeviceStatus(const std::string& name, vrpn_Connection* c = 0);
+			virtual ~VRPNDeviceStatus();
+
+			virtual void mainloop();
+		};
+	}
+}
+
+#endif
@@ -23,6 +23,7 @@
 #define __VRPNSERVER_H__
 
 #include "Globals/Include.h"
+#include <vector>
 #include <vrpn/vrpn_Connection.h>
 
 
@@ -36,11 +37,13 @@ namespace MultiKinect
 			static bool initialized_;
 			static vrpn_Connection_IP* conn_;
 			static VRPNSkeletonTracker* trackers_[KINECT_SKELETON_COUNT];
+			static VRPNDeviceStatus* deviceStatus_;
 
 #ifdef _WIIMOTE_SUPPORT_
 			static VRPNWiimote* wiimotes_[WIIMOTE_COUNT];
 #endif
 
+			static std::vector<FrameNotifier*> frameNotifiers_;
 			static HANDLE processStopEvent_;
 			static HANDLE processThread_;
 			static float32 vrpnFPS_;
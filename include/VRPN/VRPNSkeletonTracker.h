@@ -36,6 +36,8 @@ namespace MultiKinect
 			uint32								skeletonID_;
 			int32								kinectID_;
 			std::vector<VRPNSkeletonTracker*>	subtrackers_;
+			SkeletonPredictor*					predictor_;
+			uint64								lastFrameNumber_;
 
 			VRPNSkeletonTracker(const std::string& name, vrpn_Connection* c = 0);
 
@@ -0,0 +1,368 @@
+/*
+** Checks and benchmark of Kinect::BoneOrientationSolver.
+**
+** Random poses around a standing skeleton are solved in batches of every size
+** up to two SSE groups plus one, some with invalid joints, and every
+** orientation is checked on its own: unit length, Y along its bone, the hip
+** frame X across the hips, hierarchical orientations composing back into the
+** absolute ones and bones with an invalid end keeping their parent
+** orientation. A batch must also give the same results as its skeletons
+** solved one at a time. Bone directions are compared with the ones of
+** NuiSkeletonCalculateBoneOrientations() when the SDK can compute them. Then
+** frames of six skeletons are timed, solved in one batch, one skeleton at a
+** time and through the SDK.
+**
+**     BoneOrientationSolverTest.exe [-I<frames>]
+**
+** The exit code is 0 when every check passes.
+*/
+
+#include "Globals/Include.h"
+#include "Kinect/BoneOrientationSolver.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Tools/Clock.h"
+#include <Windows.h>
+#include <NuiApi.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Geom;
+using namespace Kinect;
+using namespace Tools;
+
+
+#define TEST_MAX_BATCH		9
+#define TEST_POSES			200
+#define TEST_TOLERANCE		0.0005f
+#define TEST_SDK_ANGLE		3.0f	/* Degrees */
+
+// A standing pose in meters, relative to the point between the feet, in KinectJoint order
+static const float32 pose[KINECT_SKELETON_JOINT_COUNT][3] =
+{
+	{ 0.00f, 1.65f, 0.00f},	// K_HEAD
+	{-0.18f, 1.42f, 0.00f},	// K_SHOULDER_LEFT
+	{ 0.00f, 1.45f, 0.00f},	// K_SHOULDER_CENTER
+	{ 0.18f, 1.42f, 0.00f},	// K_SHOULDER_RIGHT
+	{-0.25f, 1.15f, 0.02f},	// K_ELBOW_LEFT
+	{ 0.25f, 1.15f, 0.02f},	// K_ELBOW_RIGHT
+	{-0.27f, 0.90f, 0.05f},	// K_WRIST_LEFT
+	{ 0.27f, 0.90f, 0.05f},	// K_WRIST_RIGHT
+	{-0.28f, 0.82f, 0.06f},	// K_HAND_LEFT
+	{ 0.28f, 0.82f, 0.06f},	// K_HAND_RIGHT
+	{ 0.00f, 1.10f, 0.00f},	// K_SPINE
+	{-0.10f, 0.92f, 0.00f},	// K_HIP_LEFT
+	{ 0.00f, 0.95f, 0.00f},	// K_HIP_CENTER
+	{ 0.10f, 0.92f, 0.00f},	// K_HIP_RIGHT
+	{-0.11f, 0.50f, 0.02f},	// K_KNEE_LEFT
+	{ 0.11f, 0.50f, 0.02f},	// K_KNEE_RIGHT
+	{-0.12f, 0.08f, 0.00f},	// K_ANKLE_LEFT
+	{ 0.12f, 0.08f, 0.00f},	// K_ANKLE_RIGHT
+	{-0.12f, 0.02f, 0.08f},	// K_FOOT_LEFT
+	{ 0.12f, 0.02f, 0.08f}	// K_FOOT_RIGHT
+};
+
+// Bones as {joint, parent} in KinectJoint indices, the same hierarchy the solver follows
+static const int32 bones[KINECT_SKELETON_JOINT_COUNT][2] =
+{
+	{12, -1}, {10, 12}, {2, 10}, {0, 2}, {1, 2}, {4, 1}, {6, 4}, {8, 6}, {3, 2}, {5, 3},
+	{7, 5}, {9, 7}, {11, 12}, {14, 11}, {16, 14}, {18, 16}, {13, 12}, {15, 13}, {17, 15}, {19, 17}
+};
+
+// KinectJoint of every NUI_SKELETON_POSITION_INDEX, as KinectDevice maps them
+static const uint32 nuiJoints[KINECT_SKELETON_JOINT_COUNT] = {12, 10, 2, 0, 1, 4, 6, 8, 3, 5, 7, 9, 11, 14, 16, 18, 13, 15, 17, 19};
+
+static const uint32 hipCenter = 12;
+static const uint32 spine = 10;
+static const uint32 hipLeft = 11;
+static const uint32 hipRight = 13;
+
+static uint32 seed = 12345;
+
+static float32 nextRandom()
+{
+	// Uniform in [-1, 1)
+	seed = seed*1664525u + 1013904223u;
+	return basic_cast<float32>(seed >> 8)/basic_cast<float32>(1u << 23) - 1.0f;
+}
+
+static void makePose(Point* joints, bool* validity, float32 invalidRatio)
+{
+	// The standing pose turned, moved and bent a few centimeters on every joint
+	Quaternion turn(0.0f, PI32*nextRandom(), 0.2f*nextRandom());
+	Point center(nextRandom(), 0.0f, 2.5f + nextRandom());
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		Vector offset(pose[j][0] + 0.05f*nextRandom(), pose[j][1] + 0.05f*nextRandom(), pose[j][2] + 0.05f*nextRandom());
+		Vector turned = turn*offset;
+		joints[j] = Point(center.x + turned.x, center.y + turned.y, center.z + turned.z);
+		validity[j] = (nextRandom()*0.5f + 0.5f >= invalidRatio);
+	}
+}
+
+static bool isUnit(const Quaternion& q)
+{
+	return std::fabs(q.length() - 1.0f) < TEST_TOLERANCE;
+}
+
+static bool isSameRotation(const Quaternion& a, const Quaternion& b)
+{
+	// q and -q are the same rotation
+	return std::fabs(a.dot(b)) > 1.0f - TEST_TOLERANCE;
+}
+
+static bool isIdentical(const Quaternion& a, const Quaternion& b)
+{
+	// Component by component, Vector::operator==() compares directions only
+	Vector u = a.imaginary();
+	Vector v = b.imaginary();
+	return (a.real() == b.real() && u.x == v.x && u.y == v.y && u.z == v.z);
+}
+
+static Vector getDirection(const Point& start, const Point& end, float32& length)
+{
+	Vector direction(start, end);
+	length = direction.length();
+	if (length > 0.0f) direction /= length;
+	return direction;
+}
+
+static bool checkSkeleton(const Point* joints, const bool* validity, const Quaternion* absolute, const Quaternion* hierarchical, const char* name)
+{
+	uint32 failures = 0;
+
+	// The root frame, Y up the spine and X across the hips
+	float32 upLength, acrossLength;
+	Vector up = getDirection(joints[hipCenter], joints[spine], upLength);
+	Vector across = getDirection(joints[hipLeft], joints[hipRight], acrossLength);
+	if (!isUnit(absolute[hipCenter]) || !isSameRotation(absolute[hipCenter], hierarchical[hipCenter])) failures++;
+	else if (validity[hipCenter] && validity[spine] && validity[hipLeft] && validity[hipRight] && upLength > 0.0f && acrossLength > 0.0f)
+	{
+		Vector axisX = absolute[hipCenter]*Vector(1.0f, 0.0f, 0.0f);
+		Vector axisY = absolute[hipCenter]*Vector(0.0f, 1.0f, 0.0f);
+		if (axisY*up < 1.0f - TEST_TOLERANCE || std::fabs(axisX*axisY) > TEST_TOLERANCE || axisX*across <= 0.0f) failures++;
+	}
+
+	for (uint32 b = 1; b < KINECT_SKELETON_JOINT_COUNT; b++)
+	{
+		uint32 joint = basic_cast<uint32>(bones[b][0]);
+		uint32 parent = basic_cast<uint32>(bones[b][1]);
+		if (!isUnit(absolute[joint]) || !isUnit(hierarchical[joint]) || !isSameRotation(absolute[parent]*hierarchical[joint], absolute[joint]))
+		{
+			failures++;
+			continue;
+		}
+
+		float32 length;
+		Vector direction = getDirection(joints[parent], joints[joint], length);
+		if (validity[joint] && validity[parent] && length > 0.001f)
+		{
+			if ((absolute[joint]*Vector(0.0f, 1.0f, 0.0f))*direction < 1.0f - TEST_TOLERANCE) failures++;
+		}
+		else if (!isSameRotation(absolute[joint], absolute[parent])) failures++;
+	}
+
+	if (failures) std::printf("%s: %u bones wrong\n", name, failures);
+	return (failures == 0);
+}
+
+static bool checkBatches()
+{
+	// Every batch size up to two SSE groups plus one, so full groups and partial ones are both covered
+	uint32 failures = 0;
+	for (uint32 pass = 0; pass < TEST_POSES/TEST_MAX_BATCH; pass++)
+	{
+		for (uint32 nSkeletons = 1; nSkeletons <= TEST_MAX_BATCH; nSkeletons++)
+		{
+			Point joints[TEST_MAX_BATCH*KINECT_SKELETON_JOINT_COUNT];
+			bool validity[TEST_MAX_BATCH*KINECT_SKELETON_JOINT_COUNT];
+			Quaternion absolute[TEST_MAX_BATCH*KINECT_SKELETON_JOINT_COUNT];
+			Quaternion hierarchical[TEST_MAX_BATCH*KINECT_SKELETON_JOINT_COUNT];
+			for (uint32 s = 0; s < nSkeletons; s++)
+				makePose(&joints[s*KINECT_SKELETON_JOINT_COUNT], &validity[s*KINECT_SKELETON_JOINT_COUNT], (s%2)?0.1f:0.0f);
+			BoneOrientationSolver::solve(joints, validity, nSkeletons, absolute, hierarchical);
+
+			for (uint32 s = 0; s < nSkeletons; s++)
+			{
+				uint32 first = s*KINECT_SKELETON_JOINT_COUNT;
+				std::string name = "Batch of " + basic_cast<std::string>(nSkeletons) + ", skeleton " + basic_cast<std::string>(s);
+				if (!checkSkeleton(&joints[first], &validity[first], &absolute[first], &hierarchical[first], name.c_str())) failures++;
+
+				// Lanes never mix, so a skeleton solved alone must come out the same
+				Quaternion aloneAbsolute[KINECT_SKELETON_JOINT_COUNT];
+				Quaternion aloneHierarchical[KINECT_SKELETON_JOINT_COUNT];
+				BoneOrientationSolver::solve(&joints[first], &validity[first], 1, aloneAbsolute, aloneHierarchical);
+				for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+				{
+					if (!isIdentical(aloneAbsolute[j], absolute[first + j]) || !isIdentical(aloneHierarchical[j], hierarchical[first + j]))
+					{
+						std::printf("%s: differs from the skeleton solved alone at joint %u\n", name.c_str(), j);
+						failures++;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	return (failures == 0);
+}
+
+static bool checkDegenerate()
+{
+	Point joints[2*KINECT_SKELETON_JOINT_COUNT];
+	bool validity[2*KINECT_SKELETON_JOINT_COUNT];
+	Quaternion absolute[2*KINECT_SKELETON_JOINT_COUNT];
+	Quaternion hierarchical[2*KINECT_SKELETON_JOINT_COUNT];
+
+	// A hand folded straight back onto its forearm needs the half turn
+	makePose(joints, validity, 0.0f);
+	Vector forearm(joints[KinectSkeleton::K_ELBOW_LEFT], joints[KinectSkeleton::K_WRIST_LEFT]);
+	joints[KinectSkeleton::K_HAND_LEFT] = joints[KinectSkeleton::K_WRIST_LEFT] - Point(forearm.x*0.3f, forearm.y*0.3f, forearm.z*0.3f);
+
+	// Every joint on the same point, as when tracking is lost, has no bone at all
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		joints[KINECT_SKELETON_JOINT_COUNT + j] = Point(0.0f, 0.0f, 2.0f);
+		validity[KINECT_SKELETON_JOINT_COUNT + j] = true;
+	}
+
+	BoneOrientationSolver::solve(joints, validity, 2, absolute, hierarchical);
+	bool passed = checkSkeleton(joints, validity, absolute, hierarchical, "Folded hand");
+	passed = checkSkeleton(&joints[KINECT_SKELETON_JOINT_COUNT], &validity[KINECT_SKELETON_JOINT_COUNT],
+		&absolute[KINECT_SKELETON_JOINT_COUNT], &hierarchical[KINECT_SKELETON_JOINT_COUNT], "Collapsed skeleton") && passed;
+	return passed;
+}
+
+static void toSkeletonData(const Point* joints, NUI_SKELETON_DATA& data)
+{
+	std::memset(&data, 0, sizeof(data));
+	data.eTrackingState = NUI_SKELETON_TRACKED;
+	data.Position.x = joints[hipCenter].x;
+	data.Position.y = joints[hipCenter].y;
+	data.Position.z = joints[hipCenter].z;
+	data.Position.w = 1.0f;
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		const Point& p = joints[nuiJoints[j]];
+		data.SkeletonPositions[j].x = p.x;
+		data.SkeletonPositions[j].y = p.y;
+		data.SkeletonPositions[j].z = p.z;
+		data.SkeletonPositions[j].w = 1.0f;
+		data.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_TRACKED;
+	}
+}
+
+static bool checkAgainstSDK(bool& available)
+{
+	// The SDK picks its own twist around every bone, so only bone directions are compared
+	float32 worst = 0.0f;
+	available = true;
+	for (uint32 p = 0; p < TEST_POSES && available; p++)
+	{
+		Point joints[KINECT_SKELETON_JOINT_COUNT];
+		bool validity[KINECT_SKELETON_JOINT_COUNT];
+		Quaternion absolute[KINECT_SKELETON_JOINT_COUNT];
+		makePose(joints, validity, 0.0f);
+		BoneOrientationSolver::solve(joints, 0, 1, absolute);
+
+		NUI_SKELETON_DATA data;
+		NUI_SKELETON_BONE_ORIENTATION orientations[NUI_SKELETON_POSITION_COUNT];
+		toSkeletonData(joints, data);
+		if (FAILED(NuiSkeletonCalculateBoneOrientations(&data, orientations)))
+		{
+			available = false;
+			break;
+		}
+
+		for (uint32 i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+		{
+			if (orientations[i].endJoint == NUI_SKELETON_POSITION_HIP_CENTER) continue;
+
+			const Vector4& q = orientations[i].absoluteRotation.rotationQuaternion;
+			Vector sdkY = Quaternion(q.w, q.x, q.y, q.z).normalized()*Vector(0.0f, 1.0f, 0.0f);
+			Vector solverY = absolute[nuiJoints[orientations[i].endJoint]]*Vector(0.0f, 1.0f, 0.0f);
+			float32 cosine = sdkY*solverY;
+			if (cosine > 1.0f) cosine = 1.0f;
+			if (cosine < -1.0f) cosine = -1.0f;
+			float32 angle = std::acos(cosine)*180.0f/PI32;
+			if (angle > worst) worst = angle;
+		}
+	}
+
+	if (!available)
+	{
+		std::printf("SDK comparison skipped, NuiSkeletonCalculateBoneOrientations() is not available\n");
+		return true;
+	}
+	std::printf("Largest bone direction difference with the SDK: %.3f degrees\n", worst);
+	return (worst <= TEST_SDK_ANGLE);
+}
+
+static void bench(uint32 nFrames, bool sdkAvailable)
+{
+	// A full frame of tracked skeletons, the most obtainSkeletonsFrame() solves at once
+	Point joints[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	bool validity[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	Quaternion absolute[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	Quaternion hierarchical[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	NUI_SKELETON_DATA data[KINECT_SKELETON_COUNT];
+	NUI_SKELETON_BONE_ORIENTATION orientations[NUI_SKELETON_POSITION_COUNT];
+	for (uint32 s = 0; s < KINECT_SKELETON_COUNT; s++)
+	{
+		makePose(&joints[s*KINECT_SKELETON_JOINT_COUNT], &validity[s*KINECT_SKELETON_JOINT_COUNT], 0.0f);
+		toSkeletonData(&joints[s*KINECT_SKELETON_JOINT_COUNT], data[s]);
+	}
+
+	uint64 start = Clock::getTime();
+	for (uint32 f = 0; f < nFrames; f++)
+		BoneOrientationSolver::solve(joints, validity, KINECT_SKELETON_COUNT, absolute, hierarchical);
+	float64 batched = Clock::toMilliseconds(Clock::getTime() - start)*1000.0/nFrames;
+
+	start = Clock::getTime();
+	for (uint32 f = 0; f < nFrames; f++)
+		for (uint32 s = 0; s < KINECT_SKELETON_COUNT; s++)
+			BoneOrientationSolver::solve(&joints[s*KINECT_SKELETON_JOINT_COUNT], &validity[s*KINECT_SKELETON_JOINT_COUNT], 1,
+				&absolute[s*KINECT_SKELETON_JOINT_COUNT], &hierarchical[s*KINECT_SKELETON_JOINT_COUNT]);
+	float64 single = Clock::toMilliseconds(Clock::getTime() - start)*1000.0/nFrames;
+
+	std::printf("%u skeletons per frame, %u frames\n", KINECT_SKELETON_COUNT, nFrames);
+	std::printf("Solver, one batch        %8.2f us per frame\n", batched);
+	std::printf("Solver, one at a time    %8.2f us per frame\n", single);
+
+	if (sdkAvailable)
+	{
+		start = Clock::getTime();
+		for (uint32 f = 0; f < nFrames; f++)
+			for (uint32 s = 0; s < KINECT_SKELETON_COUNT; s++) NuiSkeletonCalculateBoneOrientations(&data[s], orientations);
+		float64 sdk = Clock::toMilliseconds(Clock::getTime() - start)*1000.0/nFrames;
+		std::printf("SDK, one at a time       %8.2f us per frame\n", sdk);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 nFrames = 20000;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg.find("-I") == 0) nFrames = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nFrames < 1) nFrames = 1;
+
+	Clock::initialize();
+
+	bool sdkAvailable;
+	bool passed = checkBatches();
+	passed = checkDegenerate() && passed;
+	passed = checkAgainstSDK(sdkAvailable) && passed;
+	bench(nFrames, sdkAvailable);
+
+	std::printf("%s\n", (passed)?"All orientations check":"FAILED");
+	return (passed)?0:1;
+}
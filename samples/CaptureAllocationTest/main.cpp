@@ -0,0 +1,322 @@
+/*
+** Checks the capture path of Kinect::KinectDevice leaves the heap alone.
+**
+** A synthetic source stands in for a sensor and produces color, depth with
+** player indices and skeleton frames at 30 fps, with players coming and going
+** so the player map and the depth colors are rebuilt along the way. The device
+** captures them on its own threads, which count their allocations per frame
+** through Tools::AllocationCounter once past CAPTURE_WARMUP_FRAMES.
+**
+**     CaptureAllocationTest.exe [-S<seconds>] [-W<canvas width>]
+**
+** The allocation hook only exists in debug builds, so the test has to run
+** the Debug configuration. The exit code is 0 when every stream captured
+** frames without allocating.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Kinect/KinectDevice.h"
+#include "Kinect/KinectSource.h"
+#include "Tools/AllocationCounter.h"
+#include "Tools/Clock.h"
+#include <Windows.h>
+#include <NuiApi.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Tools;
+
+
+#define TEST_SOURCE_ID		"SyntheticKinect"
+#define TEST_FRAME_PERIOD	33		/* Milliseconds */
+#define TEST_PLAYER_PERIOD	45		/* Frames between a second player entering or leaving */
+
+class SyntheticSource : public KinectSource
+{
+private:
+	CRITICAL_SECTION	imageLocks_[2];
+	CRITICAL_SECTION	skeletonLock_;
+	HANDLE				streamEvents_[2];
+	bool				streamsOpened_[2];
+	uint32				widths_[2];
+	uint32				heights_[2];
+	std::vector<uint8>	imageBuffers_[2];
+	uint64				imageTimestamps_[2];
+	HANDLE				skeletonEvent_;
+	bool				skeletonEnabled_;
+	SkeletonFrame		skeletonFrame_;
+	HANDLE				stopEvent_;
+	HANDLE				thread_;
+	uint32				frameNumber_;
+
+	static void getSize(_NUI_IMAGE_RESOLUTION resolution, uint32& width, uint32& height)
+	{
+		switch (resolution)
+		{
+		case NUI_IMAGE_RESOLUTION_80x60:	width = 80;		height = 60;	break;
+		case NUI_IMAGE_RESOLUTION_320x240:	width = 320;	height = 240;	break;
+		case NUI_IMAGE_RESOLUTION_640x480:	width = 640;	height = 480;	break;
+		default:							width = 0;		height = 0;		break;
+		}
+	}
+
+	void produceColor(uint64 timestamp)
+	{
+		EnterCriticalSection(&imageLocks_[K_COLOR_STREAM]);
+		uint8* pixels = &imageBuffers_[K_COLOR_STREAM][0];
+		uint32 nPixels = widths_[K_COLOR_STREAM]*heights_[K_COLOR_STREAM];
+		for (uint32 i = 0; i < nPixels; i++)
+		{
+			pixels[i*4 + 0] = basic_cast<uint8>(i + frameNumber_);
+			pixels[i*4 + 1] = basic_cast<uint8>(i >> 8);
+			pixels[i*4 + 2] = basic_cast<uint8>(frameNumber_);
+			pixels[i*4 + 3] = 255;
+		}
+		imageTimestamps_[K_COLOR_STREAM] = timestamp;
+		LeaveCriticalSection(&imageLocks_[K_COLOR_STREAM]);
+		SetEvent(streamEvents_[K_COLOR_STREAM]);
+	}
+
+	void produceDepth(uint64 timestamp, uint32 nPlayers)
+	{
+		// Depth in millimeters shifted over the three player index bits, players stand in vertical bands
+		EnterCriticalSection(&imageLocks_[K_DEPTH_STREAM]);
+		uint16* pixels = reinterpret_cast<uint16*>(&imageBuffers_[K_DEPTH_STREAM][0]);
+		uint32 width = widths_[K_DEPTH_STREAM];
+		uint32 height = heights_[K_DEPTH_STREAM];
+		for (uint32 y = 0; y < height; y++)
+		{
+			for (uint32 x = 0; x < width; x++)
+			{
+				uint32 band = x*4/width;
+				uint32 player = (band == 1 || (band == 2 && nPlayers > 1))?band:0;
+				uint32 depth = (player)?2000 + y:4000 - x;
+				pixels[y*width + x] = basic_cast<uint16>((depth << 3) | player);
+			}
+		}
+		imageTimestamps_[K_DEPTH_STREAM] = timestamp;
+		LeaveCriticalSection(&imageLocks_[K_DEPTH_STREAM]);
+		SetEvent(streamEvents_[K_DEPTH_STREAM]);
+	}
+
+	void produceSkeletons(uint64 timestamp, uint32 nPlayers)
+	{
+		EnterCriticalSection(&skeletonLock_);
+		std::memset(&skeletonFrame_.data, 0, sizeof(skeletonFrame_.data));
+		skeletonFrame_.timestamp = timestamp;
+		skeletonFrame_.data.dwFrameNumber = frameNumber_;
+		for (uint32 i = 0; i < nPlayers; i++)
+		{
+			NUI_SKELETON_DATA& skeleton = skeletonFrame_.data.SkeletonData[i];
+			skeleton.eTrackingState = NUI_SKELETON_TRACKED;
+			skeleton.dwTrackingID = i + 1;
+			float32 sway = 0.05f*basic_cast<float32>(frameNumber_%30)/30.0f;
+			for (uint32 j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+			{
+				skeleton.SkeletonPositions[j].x = -0.5f + basic_cast<float32>(i) + 0.03f*basic_cast<float32>(j%4) + sway;
+				skeleton.SkeletonPositions[j].y = 0.9f - 0.08f*basic_cast<float32>(j);
+				skeleton.SkeletonPositions[j].z = 2.5f + 0.01f*basic_cast<float32>(j%3);
+				skeleton.SkeletonPositions[j].w = 1.0f;
+				skeleton.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_TRACKED;
+			}
+		}
+		LeaveCriticalSection(&skeletonLock_);
+		if (skeletonEnabled_) SetEvent(skeletonEvent_);
+	}
+
+public:
+	SyntheticSource() : skeletonEvent_(0), skeletonEnabled_(false), stopEvent_(0), thread_(0), frameNumber_(0)
+	{
+		for (uint32 i = 0; i < 2; i++)
+		{
+			InitializeCriticalSection(&imageLocks_[i]);
+			streamEvents_[i] = 0;
+			streamsOpened_[i] = false;
+			widths_[i] = heights_[i] = 0;
+			imageTimestamps_[i] = 0;
+		}
+		InitializeCriticalSection(&skeletonLock_);
+		std::memset(&skeletonFrame_, 0, sizeof(skeletonFrame_));
+	}
+
+	virtual ~SyntheticSource()
+	{
+		shutDown();
+		DeleteCriticalSection(&skeletonLock_);
+		for (uint32 i = 0; i < 2; i++) DeleteCriticalSection(&imageLocks_[i]);
+	}
+
+	bool isValid() { return true; }
+	std::string getID() { return TEST_SOURCE_ID; }
+	KinectDevice::KinectStatusCode getStatus() { return KinectDevice::K_DEVICE_OK; }
+	bool hasSkeletalEngine() { return true; }
+	void setImageStreamFlags(ImageStream stream, int32 flags) {}
+	bool getElevationAngle(int32& angle) { angle = 0; return true; }
+	bool setElevationAngle(int32 angle) { return true; }
+
+	int32 initialize(int32 flags)
+	{
+		stopEvent_ = CreateEvent(0, true, false, 0);
+		thread_ = CreateThread(0, 0, frameThread, this, 0, 0);
+		return 0;
+	}
+
+	void shutDown()
+	{
+		if (thread_)
+		{
+			SetEvent(stopEvent_);
+			WaitForSingleObject(thread_, INFINITE);
+			CloseHandle(thread_);
+			CloseHandle(stopEvent_);
+			thread_ = stopEvent_ = 0;
+		}
+	}
+
+	bool enableSkeletonTracking(HANDLE frameEvent, int32 flags)
+	{
+		skeletonEvent_ = frameEvent;
+		skeletonEnabled_ = true;
+		return true;
+	}
+
+	bool openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent)
+	{
+		getSize(resolution, widths_[stream], heights_[stream]);
+		if (!widths_[stream]) return false;
+
+		imageBuffers_[stream] = std::vector<uint8>(widths_[stream]*heights_[stream]*((stream == K_COLOR_STREAM)?4:2), 0);
+		streamEvents_[stream] = frameEvent;
+		streamsOpened_[stream] = true;
+		return true;
+	}
+
+	bool lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame)
+	{
+		if (!streamsOpened_[stream]) return false;
+		if (WaitForSingleObject(streamEvents_[stream], timeout) != WAIT_OBJECT_0) return false;
+
+		// Held until releaseImageFrame() so the frame thread cannot overwrite the buffer in use
+		EnterCriticalSection(&imageLocks_[stream]);
+		ResetEvent(streamEvents_[stream]);
+		frame.timestamp = imageTimestamps_[stream];
+		frame.pitch = widths_[stream]*((stream == K_COLOR_STREAM)?4:2);
+		frame.size = basic_cast<uint32>(imageBuffers_[stream].size());
+		frame.data = &imageBuffers_[stream][0];
+		return true;
+	}
+
+	void releaseImageFrame(ImageStream stream)
+	{
+		LeaveCriticalSection(&imageLocks_[stream]);
+	}
+
+	bool getSkeletonFrame(uint32 timeout, SkeletonFrame& frame)
+	{
+		if (!skeletonEnabled_) return false;
+		if (WaitForSingleObject(skeletonEvent_, timeout) != WAIT_OBJECT_0) return false;
+
+		EnterCriticalSection(&skeletonLock_);
+		ResetEvent(skeletonEvent_);
+		frame = skeletonFrame_;
+		LeaveCriticalSection(&skeletonLock_);
+		return true;
+	}
+
+	static DWORD WINAPI frameThread(LPVOID param)
+	{
+		reinterpret_cast<SyntheticSource*>(param)->frameThread();
+		return 0;
+	}
+
+	void frameThread()
+	{
+		while (WaitForSingleObject(stopEvent_, TEST_FRAME_PERIOD) == WAIT_TIMEOUT)
+		{
+			uint64 timestamp = Clock::getTime();
+			uint32 nPlayers = ((frameNumber_/TEST_PLAYER_PERIOD)%2)?2:1;
+			if (streamsOpened_[K_COLOR_STREAM]) produceColor(timestamp);
+			if (streamsOpened_[K_DEPTH_STREAM]) produceDepth(timestamp, nPlayers);
+			produceSkeletons(timestamp, nPlayers);
+			frameNumber_++;
+		}
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	uint32 seconds = 5;
+	uint32 canvasWidth = 640;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-S") == 0)	seconds = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-W") == 0)	canvasWidth = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (canvasWidth != 80 && canvasWidth != 320) canvasWidth = 640;
+	if (seconds < 2) seconds = 2;
+
+	Clock::initialize();
+
+	// A counter that never moves would pass everything, so it has to see this allocation first
+	AllocationCounter::install();
+	uint32 allocations = AllocationCounter::getCount();
+	int32* volatile probe = new int32(0);
+	delete probe;
+	if (!AllocationCounter::isEnabled() || AllocationCounter::getCount() == allocations)
+	{
+		std::printf("FAILED: AllocationCounter does not count allocations, run the Debug configuration\n");
+		return 1;
+	}
+
+	Config::system.currentMode = Config::KINECT_MASTER;
+	Config::canvas[TEST_SOURCE_ID].width = canvasWidth;
+	Config::canvas[TEST_SOURCE_ID].height = canvasWidth*3/4;
+	Config::kinect[TEST_SOURCE_ID].rgbImage = true;
+	Config::kinect[TEST_SOURCE_ID].depthMap = true;
+	Config::kinect[TEST_SOURCE_ID].rawDepth = true;
+	Config::kinect[TEST_SOURCE_ID].playerMasks = true;
+	Config::kinect[TEST_SOURCE_ID].skeletonTracking = true;
+
+	KinectDevice* device = new KinectDevice(new SyntheticSource());
+	int32 result = device->initialize(KinectDevice::K_USE_COLOR|KinectDevice::K_USE_DEPTH_AND_PLAYER|KinectDevice::K_USE_SKELETON);
+	if (result != 0)
+	{
+		std::printf("FAILED: Unable to initialize the device (%d)\n", result);
+		delete device;
+		return 1;
+	}
+
+	// Keep the depth preview requested so the colorizing path runs too
+	uint64 end = Clock::getTime() + Clock::fromMilliseconds(seconds*1000);
+	while (Clock::getTime() < end)
+	{
+		device->requestDepthPreview();
+		Sleep(100);
+	}
+
+	const char* names[KinectDevice::K_CAPTURE_STREAMS] = {"Color", "Depth", "Skeleton"};
+	bool passed = true;
+	for (uint32 i = 0; i < KinectDevice::K_CAPTURE_STREAMS; i++)
+	{
+		KinectDevice::CaptureStream stream = basic_cast<KinectDevice::CaptureStream>(i);
+		float32 fps = device->getFPS(stream);
+		bool allocating = device->hasCaptureAllocations(stream);
+		std::printf("%-8s %5.1f fps, %s\n", names[i], fps, (allocating)?"ALLOCATES per frame":"no allocations per frame");
+		if (fps <= 0.0f || allocating) passed = false;
+	}
+
+	device->shutDown();
+	delete device;
+
+	std::printf("%ux%u canvas, %u seconds: %s\n", canvasWidth, canvasWidth*3/4, seconds, (passed)?"passed":"FAILED");
+	return (passed)?0:1;
+}
@@ -0,0 +1,509 @@
+/*
+** Checks the depth outputs of Kinect::KinectDevice against plain per pixel
+** references.
+**
+** A synthetic source stands in for a sensor and produces a different depth
+** scene on every frame, with two tracked players and an untracked player
+** index moving in vertical bands over the background. Every raw depth frame
+** the device publishes must match the scene it was captured from, value for
+** value, and so must every set of player masks, bounding boxes and player
+** indices included. The colorized preview must stay untouched until a
+** viewer asks for it, match the colorized scene while asked for, and stop
+** changing once nobody asked for DEPTH_PREVIEW_TIMEOUT.
+**
+**     DepthOutputsTest.exe [-S<seconds>] [-W<canvas width>]
+**
+** The exit code is 0 when every output matched its reference.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Kinect/KinectDevice.h"
+#include "Kinect/KinectSource.h"
+#include "Tools/Clock.h"
+#include <Windows.h>
+#include <NuiApi.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Tools;
+
+
+#define TEST_SOURCE_ID		"SyntheticKinect"
+#define TEST_FRAME_PERIOD	33			/* Milliseconds */
+#define TEST_START_TIME		1000000000	/* Nanoseconds, first synthetic timestamp */
+#define TEST_SCENE_HISTORY	64			/* Frames whose scene can still be looked up */
+#define TEST_SETTLE_FRAMES	3			/* Frames until an output reflects a change */
+
+// Player index of each vertical band: background, a tracked player, an untracked index and another tracked player
+static const uint32 bandPlayers[4] = {0, 2, 1, 4};
+
+// Skeleton slots the sensor tracks, and the device player of every sensor player index that follows from them
+static const uint32 trackedSlots[2] = {1, 3};
+static const int32 playerMap[KINECT_SKELETON_COUNT] = {-1, 0, -1, 1, -1, -1};
+
+static uint16 getDepthValue(uint32 scene, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	// Players cover half the height of their band with a ragged left edge, moving down as the scene changes
+	uint32 band = x*4/width;
+	uint32 top = (scene*3)%(height/2);
+	bool inside = (y >= top && y < top + height/2 && x >= band*width/4 + (y + scene)%5);
+	uint32 player = (inside)?bandPlayers[band]:0;
+	uint32 depth = (player)?1500 + (y + scene*7)%500:4000 - (x + scene*13)%3000;
+	return basic_cast<uint16>((depth << 3) | player);
+}
+
+// The colorized preview pixel of a depth value, computed the way KinectDevice::depthToColor() defines it
+static void getPreviewPixel(uint16 value, uint8* rgb)
+{
+	uint32 level = 255 - 256*((value & 0xFFF8) >> 3)/4095;
+	uint32 player = value & 0x0007;
+	player = (player && playerMap[player - 1] != -1)?basic_cast<uint32>(playerMap[player - 1] + 1):0x0007;
+	uint8 channel = basic_cast<uint8>((basic_cast<float32>(level)/255.0f)*255.0f);
+	rgb[0] = (player & 0x0001)?channel:0;
+	rgb[1] = (player & 0x0002)?channel:0;
+	rgb[2] = (player & 0x0004)?channel:0;
+}
+
+class SyntheticSource : public KinectSource
+{
+private:
+	CRITICAL_SECTION	depthLock_;
+	CRITICAL_SECTION	skeletonLock_;
+	CRITICAL_SECTION	sceneLock_;
+	HANDLE				depthEvent_;
+	bool				depthOpened_;
+	uint32				width_;
+	uint32				height_;
+	std::vector<uint16>	depthBuffer_;
+	uint64				depthTimestamp_;
+	HANDLE				skeletonEvent_;
+	bool				skeletonEnabled_;
+	SkeletonFrame		skeletonFrame_;
+	HANDLE				stopEvent_;
+	HANDLE				thread_;
+	uint32				frameNumber_;
+	uint32				scenes_[TEST_SCENE_HISTORY];
+	int32				heldScene_;
+	volatile bool		paused_;
+
+	static uint64 getTimestamp(uint32 frameNumber)
+	{
+		return TEST_START_TIME + Clock::fromMilliseconds(TEST_FRAME_PERIOD)*frameNumber;
+	}
+
+	void produceDepth(uint32 scene)
+	{
+		EnterCriticalSection(&depthLock_);
+		for (uint32 y = 0; y < height_; y++)
+			for (uint32 x = 0; x < width_; x++) depthBuffer_[y*width_ + x] = getDepthValue(scene, x, y, width_, height_);
+		depthTimestamp_ = getTimestamp(frameNumber_);
+		LeaveCriticalSection(&depthLock_);
+		SetEvent(depthEvent_);
+	}
+
+	void produceSkeletons()
+	{
+		EnterCriticalSection(&skeletonLock_);
+		std::memset(&skeletonFrame_.data, 0, sizeof(skeletonFrame_.data));
+		skeletonFrame_.timestamp = getTimestamp(frameNumber_);
+		skeletonFrame_.data.dwFrameNumber = frameNumber_;
+		for (uint32 k = 0; k < 2; k++)
+		{
+			uint32 i = trackedSlots[k];
+			NUI_SKELETON_DATA& skeleton = skeletonFrame_.data.SkeletonData[i];
+			skeleton.eTrackingState = NUI_SKELETON_TRACKED;
+			skeleton.dwTrackingID = i + 1;
+			for (uint32 j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+			{
+				skeleton.SkeletonPositions[j].x = -1.0f + 0.5f*basic_cast<float32>(i) + 0.03f*basic_cast<float32>(j%4);
+				skeleton.SkeletonPositions[j].y = 0.9f - 0.08f*basic_cast<float32>(j);
+				skeleton.SkeletonPositions[j].z = 2.5f;
+				skeleton.SkeletonPositions[j].w = 1.0f;
+				skeleton.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_TRACKED;
+			}
+		}
+		LeaveCriticalSection(&skeletonLock_);
+		if (skeletonEnabled_) SetEvent(skeletonEvent_);
+	}
+
+public:
+	SyntheticSource() : depthEvent_(0), depthOpened_(false), width_(0), height_(0), depthTimestamp_(0),
+		skeletonEvent_(0), skeletonEnabled_(false), stopEvent_(0), thread_(0), frameNumber_(0), heldScene_(-1), paused_(false)
+	{
+		InitializeCriticalSection(&depthLock_);
+		InitializeCriticalSection(&skeletonLock_);
+		InitializeCriticalSection(&sceneLock_);
+		std::memset(&skeletonFrame_, 0, sizeof(skeletonFrame_));
+		for (uint32 i = 0; i < TEST_SCENE_HISTORY; i++) scenes_[i] = 0;
+	}
+
+	virtual ~SyntheticSource()
+	{
+		shutDown();
+		DeleteCriticalSection(&sceneLock_);
+		DeleteCriticalSection(&skeletonLock_);
+		DeleteCriticalSection(&depthLock_);
+	}
+
+	bool isValid() { return true; }
+	std::string getID() { return TEST_SOURCE_ID; }
+	KinectDevice::KinectStatusCode getStatus() { return KinectDevice::K_DEVICE_OK; }
+	bool hasSkeletalEngine() { return true; }
+	void setImageStreamFlags(ImageStream stream, int32 flags) {}
+	bool getElevationAngle(int32& angle) { angle = 0; return true; }
+	bool setElevationAngle(int32 angle) { return true; }
+
+	int32 initialize(int32 flags)
+	{
+		stopEvent_ = CreateEvent(0, true, false, 0);
+		thread_ = CreateThread(0, 0, frameThread, this, 0, 0);
+		return 0;
+	}
+
+	void shutDown()
+	{
+		if (thread_)
+		{
+			SetEvent(stopEvent_);
+			WaitForSingleObject(thread_, INFINITE);
+			CloseHandle(thread_);
+			CloseHandle(stopEvent_);
+			thread_ = stopEvent_ = 0;
+		}
+	}
+
+	bool enableSkeletonTracking(HANDLE frameEvent, int32 flags)
+	{
+		skeletonEvent_ = frameEvent;
+		skeletonEnabled_ = true;
+		return true;
+	}
+
+	bool openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent)
+	{
+		if (stream != K_DEPTH_STREAM) return false;
+		switch (resolution)
+		{
+		case NUI_IMAGE_RESOLUTION_80x60:	width_ = 80;	height_ = 60;	break;
+		case NUI_IMAGE_RESOLUTION_320x240:	width_ = 320;	height_ = 240;	break;
+		case NUI_IMAGE_RESOLUTION_640x480:	width_ = 640;	height_ = 480;	break;
+		default:							return false;
+		}
+
+		depthBuffer_ = std::vector<uint16>(width_*height_, 0);
+		depthEvent_ = frameEvent;
+		depthOpened_ = true;
+		return true;
+	}
+
+	bool lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame)
+	{
+		if (stream != K_DEPTH_STREAM || !depthOpened_) return false;
+		if (WaitForSingleObject(depthEvent_, timeout) != WAIT_OBJECT_0) return false;
+
+		EnterCriticalSection(&depthLock_);
+		ResetEvent(depthEvent_);
+		frame.timestamp = depthTimestamp_;
+		frame.pitch = width_*sizeof(uint16);
+		frame.size = basic_cast<uint32>(depthBuffer_.size()*sizeof(uint16));
+		frame.data = reinterpret_cast<uint8*>(&depthBuffer_[0]);
+		return true;
+	}
+
+	void releaseImageFrame(ImageStream stream)
+	{
+		LeaveCriticalSection(&depthLock_);
+	}
+
+	bool getSkeletonFrame(uint32 timeout, SkeletonFrame& frame)
+	{
+		if (!skeletonEnabled_) return false;
+		if (WaitForSingleObject(skeletonEvent_, timeout) != WAIT_OBJECT_0) return false;
+
+		EnterCriticalSection(&skeletonLock_);
+		ResetEvent(skeletonEvent_);
+		frame = skeletonFrame_;
+		LeaveCriticalSection(&skeletonLock_);
+		return true;
+	}
+
+	// Scene a depth frame was produced from, known for the last TEST_SCENE_HISTORY frames
+	bool getScene(uint64 timestamp, uint32& scene)
+	{
+		uint64 period = Clock::fromMilliseconds(TEST_FRAME_PERIOD);
+		if (timestamp < TEST_START_TIME || (timestamp - TEST_START_TIME)%period) return false;
+		uint32 frameNumber = basic_cast<uint32>((timestamp - TEST_START_TIME)/period);
+
+		EnterCriticalSection(&sceneLock_);
+		bool known = (frameNumber < frameNumber_ && frameNumber_ - frameNumber <= TEST_SCENE_HISTORY);
+		if (known) scene = scenes_[frameNumber%TEST_SCENE_HISTORY];
+		LeaveCriticalSection(&sceneLock_);
+		return known;
+	}
+
+	// Keeps producing frames of the current scene, or changing scenes again
+	uint32 holdScene(bool hold)
+	{
+		EnterCriticalSection(&sceneLock_);
+		heldScene_ = (hold)?basic_cast<int32>(frameNumber_):-1;
+		uint32 scene = frameNumber_;
+		LeaveCriticalSection(&sceneLock_);
+		return scene;
+	}
+
+	void pause(bool paused)
+	{
+		paused_ = paused;
+	}
+
+	static DWORD WINAPI frameThread(LPVOID param)
+	{
+		reinterpret_cast<SyntheticSource*>(param)->frameThread();
+		return 0;
+	}
+
+	void frameThread()
+	{
+		while (WaitForSingleObject(stopEvent_, TEST_FRAME_PERIOD) == WAIT_TIMEOUT)
+		{
+			if (paused_) continue;
+
+			EnterCriticalSection(&sceneLock_);
+			uint32 scene = (heldScene_ != -1)?basic_cast<uint32>(heldScene_):frameNumber_;
+			scenes_[frameNumber_%TEST_SCENE_HISTORY] = scene;
+			LeaveCriticalSection(&sceneLock_);
+
+			produceSkeletons();
+			if (depthOpened_) produceDepth(scene);
+
+			EnterCriticalSection(&sceneLock_);
+			frameNumber_++;
+			LeaveCriticalSection(&sceneLock_);
+		}
+	}
+};
+
+// Raw frames published over the given time, each one against the scene it came from
+static bool checkRawDepth(KinectDevice* device, SyntheticSource* source, uint32 milliseconds, uint32 width, uint32 height, uint32& nChecked)
+{
+	KinectDevice::RawDepthFrame frame;
+	uint32 lastFrameNumber = 0;
+	bool passed = true;
+	uint64 end = Clock::getTime() + Clock::fromMilliseconds(milliseconds);
+	while (Clock::getTime() < end)
+	{
+		Sleep(2);
+		if (!device->getRawDepthFrame(frame) || frame.frameNumber == lastFrameNumber) continue;
+
+		uint32 scene = 0;
+		if (frame.frameNumber < lastFrameNumber || frame.width != width || frame.height != height || !source->getScene(frame.timestamp, scene))
+		{
+			std::printf("Raw depth frame %u: %ux%u at %llu, not a frame of the source\n", frame.frameNumber, frame.width, frame.height, frame.timestamp);
+			passed = false;
+		}
+		else
+		{
+			uint32 nDiffering = 0;
+			for (uint32 y = 0; y < height; y++)
+				for (uint32 x = 0; x < width; x++)
+					if (frame.pixels[y*width + x] != getDepthValue(scene, x, y, width, height)) nDiffering++;
+			if (nDiffering)
+			{
+				std::printf("Raw depth frame %u: %u values differ from scene %u\n", frame.frameNumber, nDiffering, scene);
+				passed = false;
+			}
+		}
+		lastFrameNumber = frame.frameNumber;
+		nChecked++;
+	}
+	return passed && nChecked > 0;
+}
+
+// Player masks published over the given time, each set against the masks and boxes of the scene it came from
+static bool checkPlayerMasks(KinectDevice* device, SyntheticSource* source, uint32 milliseconds, uint32 width, uint32 height, uint32& nChecked)
+{
+	KinectDevice::PlayerMasksFrame frame;
+	uint32 stride = ((width + 15)/16)*2;
+	std::vector<uint8> masks(stride*height*KINECT_SKELETON_COUNT);
+	uint32 lastFrameNumber = 0;
+	bool passed = true;
+	uint64 end = Clock::getTime() + Clock::fromMilliseconds(milliseconds);
+	while (Clock::getTime() < end)
+	{
+		Sleep(2);
+		if (!device->getPlayerMasksFrame(frame) || frame.frameNumber == lastFrameNumber) continue;
+		lastFrameNumber = frame.frameNumber;
+		nChecked++;
+
+		uint32 scene = 0;
+		if (frame.width != width || frame.height != height || frame.stride != stride || !source->getScene(frame.timestamp, scene))
+		{
+			std::printf("Player masks frame %u: %ux%u at %llu, not a frame of the source\n", frame.frameNumber, frame.width, frame.height, frame.timestamp);
+			passed = false;
+			continue;
+		}
+
+		// Plain per pixel masks and boxes of the scene
+		KinectDevice::PlayerMasksInfo info;
+		info.width = width;
+		std::memset(&masks[0], 0, masks.size());
+		for (uint32 y = 0; y < height; y++)
+		{
+			for (uint32 x = 0; x < width; x++)
+			{
+				uint32 player = getDepthValue(scene, x, y, width, height) & 0x0007;
+				if (!player) continue;
+
+				uint32 p = player - 1;
+				masks[stride*height*p + stride*y + x/8] |= basic_cast<uint8>(1 << (x%8));
+				KinectDevice::PlayerBox& box = info.boxes[p];
+				if (!(info.players&(1 << p)))
+				{
+					box.minX = box.maxX = basic_cast<uint16>(x);
+					box.minY = box.maxY = basic_cast<uint16>(y);
+				}
+				if (x < box.minX) box.minX = basic_cast<uint16>(x);
+				if (x > box.maxX) box.maxX = basic_cast<uint16>(x);
+				box.maxY = basic_cast<uint16>(y);
+				info.players |= 1 << p;
+			}
+		}
+		for (uint32 p = 0; p < KINECT_SKELETON_COUNT; p++)
+			if (playerMap[p] != -1) info.playerIndices[p] = basic_cast<uint32>(playerMap[p] + 1);
+
+		bool boxesMatch = (frame.info.width == info.width && frame.info.players == info.players);
+		for (uint32 p = 0; p < KINECT_SKELETON_COUNT && boxesMatch; p++)
+		{
+			boxesMatch = (frame.info.playerIndices[p] == info.playerIndices[p]);
+			if (boxesMatch && (info.players&(1 << p)))
+			{
+				const KinectDevice::PlayerBox& box = frame.info.boxes[p];
+				boxesMatch = (box.minX == info.boxes[p].minX && box.minY == info.boxes[p].minY && box.maxX == info.boxes[p].maxX && box.maxY == info.boxes[p].maxY);
+			}
+		}
+		bool masksMatch = (frame.masks.size() >= masks.size() && std::memcmp(&frame.masks[0], &masks[0], masks.size()) == 0);
+		if (!boxesMatch || !masksMatch)
+		{
+			std::printf("Player masks frame %u: %s differ from scene %u\n", frame.frameNumber, (masksMatch)?"players or boxes":"masks", scene);
+			passed = false;
+		}
+	}
+	return passed && nChecked > 0;
+}
+
+// Waits until the device published the given number of raw frames more
+static bool waitRawFrames(KinectDevice* device, uint32 nFrames)
+{
+	KinectDevice::RawDepthFrame frame;
+	bool started = false;
+	uint32 first = 0;
+	uint64 end = Clock::getTime() + Clock::fromMilliseconds((nFrames + 10)*TEST_FRAME_PERIOD);
+	while (Clock::getTime() < end)
+	{
+		if (device->getRawDepthFrame(frame))
+		{
+			if (!started)
+			{
+				first = frame.frameNumber;
+				started = true;
+			}
+			else if (frame.frameNumber >= first + nFrames) return true;
+		}
+		Sleep(2);
+	}
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 seconds = 3;
+	uint32 canvasWidth = 320;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-S") == 0)	seconds = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-W") == 0)	canvasWidth = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (canvasWidth != 80 && canvasWidth != 640) canvasWidth = 320;
+	if (seconds < 1) seconds = 1;
+	uint32 canvasHeight = canvasWidth*3/4;
+
+	Clock::initialize();
+
+	Config::system.currentMode = Config::KINECT_MASTER;
+	Config::canvas[TEST_SOURCE_ID].width = canvasWidth;
+	Config::canvas[TEST_SOURCE_ID].height = canvasHeight;
+	Config::kinect[TEST_SOURCE_ID].rgbImage = false;
+	Config::kinect[TEST_SOURCE_ID].depthMap = true;
+	Config::kinect[TEST_SOURCE_ID].rawDepth = true;
+	Config::kinect[TEST_SOURCE_ID].playerMasks = true;
+	Config::kinect[TEST_SOURCE_ID].skeletonTracking = true;
+
+	SyntheticSource* source = new SyntheticSource();
+	KinectDevice* device = new KinectDevice(source);
+	int32 result = device->initialize(KinectDevice::K_USE_DEPTH_AND_PLAYER|KinectDevice::K_USE_SKELETON);
+	if (result != 0)
+	{
+		std::printf("FAILED: Unable to initialize the device (%d)\n", result);
+		delete device;
+		return 1;
+	}
+
+	// Raw depth is published on every frame whether or not anybody looks at the preview
+	uint32 nRaw = 0;
+	bool rawPassed = checkRawDepth(device, source, seconds*1000, canvasWidth, canvasHeight, nRaw);
+	std::printf("Raw depth: %u frames checked, %s\n", nRaw, (rawPassed)?"all match":"MISMATCH");
+	uint32 nMasks = 0;
+	bool masksPassed = checkPlayerMasks(device, source, seconds*1000, canvasWidth, canvasHeight, nMasks);
+	std::printf("Player masks: %u frames checked, %s\n", nMasks, (masksPassed)?"all match":"MISMATCH");
+
+	// Nobody asked for the preview yet, so it must still hold what the device initialized it with
+	source->pause(true);
+	Sleep(4*TEST_FRAME_PERIOD);
+	uint32 previewSize = canvasWidth*canvasHeight*3;
+	const uint8* preview = device->getDepthFrame();
+	std::vector<uint8> snapshot(preview, preview + previewSize);
+	bool idlePassed = true;
+	for (uint32 i = 0; i < previewSize && idlePassed; i++) idlePassed = (snapshot[i] == 255);
+	std::printf("Preview before any request: %s\n", (idlePassed)?"untouched":"COLORIZED");
+
+	// Asked for, the preview follows the scene, held still so it can be compared
+	uint32 scene = source->holdScene(true);
+	source->pause(false);
+	std::vector<uint8> reference(previewSize);
+	for (uint32 y = 0; y < canvasHeight; y++)
+		for (uint32 x = 0; x < canvasWidth; x++) getPreviewPixel(getDepthValue(scene, x, y, canvasWidth, canvasHeight), &reference[(y*canvasWidth + x)*3]);
+	bool requestedPassed = waitRawFrames(device, TEST_SETTLE_FRAMES);
+	uint32 nCompared = 0;
+	uint64 end = Clock::getTime() + Clock::fromMilliseconds(1000);
+	while (requestedPassed && Clock::getTime() < end)
+	{
+		preview = device->getDepthFrame();
+		requestedPassed = (std::memcmp(preview, &reference[0], previewSize) == 0);
+		nCompared++;
+		Sleep(50);
+	}
+	std::printf("Preview while requested: %u comparisons, %s\n", nCompared, (requestedPassed)?"all match":"MISMATCH");
+
+	// Once nobody asked for a while the preview stops changing, though the scene does
+	source->holdScene(false);
+	Sleep(DEPTH_PREVIEW_TIMEOUT + TEST_SETTLE_FRAMES*TEST_FRAME_PERIOD);
+	snapshot.assign(preview, preview + previewSize);
+	bool timeoutPassed = waitRawFrames(device, 2*TEST_SETTLE_FRAMES) && std::memcmp(preview, &snapshot[0], previewSize) == 0;
+	std::printf("Preview after the request timed out: %s\n", (timeoutPassed)?"unchanged":"STILL COLORIZED");
+
+	device->shutDown();
+	delete device;
+
+	bool passed = rawPassed && masksPassed && idlePassed && requestedPassed && timeoutPassed;
+	std::printf("%ux%u canvas, %u seconds: %s\n", canvasWidth, canvasHeight, seconds, (passed)?"passed":"FAILED");
+	return (passed)?0:1;
+}
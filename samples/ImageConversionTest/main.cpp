@@ -0,0 +1,254 @@
+/*
+** Checks and benchmark of the Tools::ImageConversion row kernels.
+**
+** Every kernel is run on random rows of many widths, so both the vectorized
+** body and the scalar tail are covered, and its output is compared byte by
+** byte with a plain per pixel implementation. Then whole frames are converted
+** at each canvas resolution and the time per frame is printed for both.
+**
+**     ImageConversionTest.exe [-I<frames>]
+**
+** The exit code is 0 when every kernel matches the per pixel implementation.
+*/
+
+#include "Globals/Include.h"
+#include "Tools/Clock.h"
+#include "Tools/ImageConversion.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Tools;
+
+
+#define TEST_MAX_WIDTH		67
+#define TEST_DEPTH_VALUES	65536
+#define TEST_COLOR_WIDTH	640
+#define TEST_COLOR_HEIGHT	480
+
+struct Resolution
+{
+	const char* name;
+	uint32 width;
+	uint32 height;
+};
+
+static const Resolution resolutions[] = {{"640x480", 640, 480}, {"320x240", 320, 240}, {"80x60", 80, 60}};
+static const uint32 nResolutions = sizeof(resolutions)/sizeof(resolutions[0]);
+
+static uint32 seed = 12345;
+
+static uint32 nextRandom()
+{
+	seed = seed*1664525u + 1013904223u;
+	return seed >> 8;
+}
+
+static std::vector<uint32> getTestWidths()
+{
+	// Every width up to a few vector bodies plus a tail, then the canvas widths
+	std::vector<uint32> widths;
+	for (uint32 width = 0; width <= TEST_MAX_WIDTH; width++) widths.push_back(width);
+	for (uint32 r = 0; r < nResolutions; r++) widths.push_back(resolutions[r].width);
+	return widths;
+}
+
+static void colorizeDepthRowReference(const uint16* depth, const uint32* colors, uint8* rgb, uint32 width)
+{
+	for (uint32 x = 0; x < width; x++)
+	{
+		uint32 c = colors[depth[x]];
+		rgb[x*3 + 0] = basic_cast<uint8>(c);
+		rgb[x*3 + 1] = basic_cast<uint8>(c >> 8);
+		rgb[x*3 + 2] = basic_cast<uint8>(c >> 16);
+	}
+}
+
+static void downscaleBGRAToRGBReference(const uint8* bgra, uint32 pitch, uint32 factorX, uint32 factorY, uint8* rgb, uint32 width)
+{
+	uint32 area = factorX*factorY;
+	for (uint32 x = 0; x < width; x++)
+	{
+		for (uint32 c = 0; c < 3; c++)
+		{
+			uint32 sum = area/2;
+			for (uint32 y = 0; y < factorY; y++)
+				for (uint32 i = 0; i < factorX; i++) sum += bgra[pitch*y + (x*factorX + i)*4 + 2 - c];
+			rgb[x*3 + c] = basic_cast<uint8>(sum/area);
+		}
+	}
+}
+
+static bool checkConvertColor()
+{
+	std::vector<uint8> bgra(TEST_COLOR_WIDTH*4);
+	std::vector<uint8> rgb(TEST_COLOR_WIDTH*3 + 16), expected(TEST_COLOR_WIDTH*3 + 16);
+	std::vector<uint32> widths = getTestWidths();
+	uint32 failures = 0;
+	for (uint32 w = 0; w < widths.size(); w++)
+	{
+		uint32 width = widths[w];
+		for (uint32 i = 0; i < width*4; i++) bgra[i] = basic_cast<uint8>(nextRandom());
+		std::memset(&rgb[0], 0xCD, rgb.size());
+		std::memset(&expected[0], 0xCD, expected.size());
+
+		ImageConversion::convertBGRAToRGB(&bgra[0], &rgb[0], width);
+		downscaleBGRAToRGBReference(&bgra[0], width*4, 1, 1, &expected[0], width);
+		if (rgb != expected)
+		{
+			std::printf("convertBGRAToRGB() differs at width %u\n", width);
+			failures++;
+		}
+	}
+
+	return (failures == 0);
+}
+
+static bool checkDownscaleColor()
+{
+	// The SSSE3 2x2 path averages rows and then columns, rounding up twice, so it may be one above the box filter
+	const uint32 factors[][2] = {{1, 1}, {2, 2}, {4, 4}, {8, 8}, {4, 2}, {3, 3}};
+	const uint32 nFactors = sizeof(factors)/sizeof(factors[0]);
+	std::vector<uint32> widths = getTestWidths();
+	uint32 failures = 0;
+	for (uint32 f = 0; f < nFactors; f++)
+	{
+		uint32 factorX = factors[f][0];
+		uint32 factorY = factors[f][1];
+		for (uint32 w = 0; w < widths.size(); w++)
+		{
+			uint32 width = widths[w];
+			uint32 pitch = width*factorX*4 + 64;
+			std::vector<uint8> bgra(pitch*factorY);
+			for (uint32 i = 0; i < bgra.size(); i++) bgra[i] = basic_cast<uint8>(nextRandom());
+			std::vector<uint8> rgb(width*3 + 16, 0xCD), expected(width*3 + 16, 0xCD);
+
+			ImageConversion::downscaleBGRAToRGB(&bgra[0], pitch, factorX, factorY, &rgb[0], width);
+			downscaleBGRAToRGBReference(&bgra[0], pitch, factorX, factorY, &expected[0], width);
+			uint32 roundedUp = (factorX == 2 && factorY == 2 && ImageConversion::hasSSSE3())?(width - width%4)*3:0;
+			bool matches = true;
+			for (uint32 i = 0; i < rgb.size(); i++)
+			{
+				int32 difference = basic_cast<int32>(rgb[i]) - basic_cast<int32>(expected[i]);
+				if (difference < 0 || difference > ((i < roundedUp)?1:0)) matches = false;
+			}
+			if (!matches)
+			{
+				std::printf("downscaleBGRAToRGB() differs at width %u, factor %ux%u\n", width, factorX, factorY);
+				failures++;
+			}
+		}
+	}
+
+	return (failures == 0);
+}
+
+static bool checkColorizeDepth(const std::vector<uint32>& colors)
+{
+	// Guard bytes past the row catch kernels writing more than width pixels
+	std::vector<uint16> depth(640);
+	std::vector<uint8> rgb(640*3 + 16), expected(640*3 + 16);
+	std::vector<uint32> widths = getTestWidths();
+	uint32 failures = 0;
+	for (uint32 w = 0; w < widths.size(); w++)
+	{
+		uint32 width = widths[w];
+		for (uint32 x = 0; x < width; x++) depth[x] = basic_cast<uint16>(nextRandom());
+		std::memset(&rgb[0], 0xCD, rgb.size());
+		std::memset(&expected[0], 0xCD, expected.size());
+
+		ImageConversion::colorizeDepthRow(&depth[0], &colors[0], &rgb[0], width);
+		colorizeDepthRowReference(&depth[0], &colors[0], &expected[0], width);
+		if (rgb != expected)
+		{
+			std::printf("colorizeDepthRow() differs at width %u\n", width);
+			failures++;
+		}
+	}
+
+	return (failures == 0);
+}
+
+static void benchColorizeDepth(const std::vector<uint32>& colors, uint32 nFrames)
+{
+	for (uint32 r = 0; r < nResolutions; r++)
+	{
+		uint32 width = resolutions[r].width;
+		uint32 height = resolutions[r].height;
+		std::vector<uint16> depth(width*height);
+		std::vector<uint8> rgb(width*height*3);
+		for (uint32 i = 0; i < depth.size(); i++) depth[i] = basic_cast<uint16>(nextRandom());
+
+		uint64 start = Clock::getTime();
+		for (uint32 f = 0; f < nFrames; f++)
+			for (uint32 y = 0; y < height; y++) colorizeDepthRowReference(&depth[y*width], &colors[0], &rgb[y*width*3], width);
+		float64 reference = Clock::toMilliseconds(Clock::getTime() - start)/nFrames;
+
+		start = Clock::getTime();
+		for (uint32 f = 0; f < nFrames; f++)
+			for (uint32 y = 0; y < height; y++) ImageConversion::colorizeDepthRow(&depth[y*width], &colors[0], &rgb[y*width*3], width);
+		float64 kernel = Clock::toMilliseconds(Clock::getTime() - start)/nFrames;
+
+		std::printf("Depth colorize %-8s reference %7.3f ms, kernel %7.3f ms per frame\n", resolutions[r].name, reference, kernel);
+	}
+}
+
+static void benchDownscaleColor(uint32 nFrames)
+{
+	// Every canvas is filled from a full color frame, the way obtainColorFrame() does
+	uint32 pitch = TEST_COLOR_WIDTH*4;
+	std::vector<uint8> bgra(pitch*TEST_COLOR_HEIGHT);
+	for (uint32 i = 0; i < bgra.size(); i++) bgra[i] = basic_cast<uint8>(nextRandom());
+
+	for (uint32 r = 0; r < nResolutions; r++)
+	{
+		uint32 width = resolutions[r].width;
+		uint32 height = resolutions[r].height;
+		uint32 factorX = TEST_COLOR_WIDTH/width;
+		uint32 factorY = TEST_COLOR_HEIGHT/height;
+		std::vector<uint8> rgb(width*height*3);
+
+		uint64 start = Clock::getTime();
+		for (uint32 f = 0; f < nFrames; f++)
+			for (uint32 y = 0; y < height; y++) downscaleBGRAToRGBReference(&bgra[pitch*factorY*y], pitch, factorX, factorY, &rgb[y*width*3], width);
+		float64 reference = Clock::toMilliseconds(Clock::getTime() - start)/nFrames;
+
+		start = Clock::getTime();
+		for (uint32 f = 0; f < nFrames; f++)
+			for (uint32 y = 0; y < height; y++) ImageConversion::downscaleBGRAToRGB(&bgra[pitch*factorY*y], pitch, factorX, factorY, &rgb[y*width*3], width);
+		float64 kernel = Clock::toMilliseconds(Clock::getTime() - start)/nFrames;
+
+		std::printf("Color convert  %-8s reference %7.3f ms, kernel %7.3f ms per frame\n", resolutions[r].name, reference, kernel);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 nFrames = 200;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg.find("-I") == 0) nFrames = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nFrames < 1) nFrames = 1;
+
+	Clock::initialize();
+	std::printf("SSSE3: %s\n", (ImageConversion::hasSSSE3())?"yes":"no");
+
+	// Like the depth table, colors are packed RGB in the low three bytes
+	std::vector<uint32> colors(TEST_DEPTH_VALUES);
+	for (uint32 i = 0; i < TEST_DEPTH_VALUES; i++) colors[i] = nextRandom()&0x00FFFFFF;
+
+	bool passed = checkConvertColor();
+	passed = checkDownscaleColor() && passed;
+	passed = checkColorizeDepth(colors) && passed;
+	benchDownscaleColor(nFrames);
+	benchColorizeDepth(colors, nFrames);
+
+	std::printf("%s\n", (passed)?"All kernels match":"FAILED");
+	return (passed)?0:1;
+}
@@ -0,0 +1,216 @@
+/*
+** Checks of Tools::JointOneEuroFilter at the default smoothing parameters.
+**
+** Every joint of every slot is fed the same kind of signal at 30 Hz, each
+** one offset so a cell mixing up its neighbours shows: a step, a steady
+** movement and a noisy constant position. The step must be followed without
+** overshoot and within a bounded time. The steady movement must trail by the
+** latency the filter reports, which the VRPN prediction relies on. The
+** noisy position must come out with much less jitter than it went in, still
+** centered on the constant.
+**
+**     JointOneEuroFilterTest.exe
+**
+** The exit code is 0 when every check passes for every cell.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Tools/Clock.h"
+#include "Tools/JointOneEuroFilter.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Tools;
+
+
+#define TEST_FRAME_PERIOD	33333333	/* Nanoseconds, 30 Hz */
+#define TEST_STEP			0.3f		/* Meters */
+#define TEST_STEP_SETTLE	0.9f		/* Share of the step */
+#define TEST_MAX_STEP_LAG	200.0f		/* Milliseconds */
+#define TEST_SPEED			0.5f		/* Meters per second */
+#define TEST_LATENCY_ERROR	0.05f		/* Share of the reported latency */
+#define TEST_NOISE			0.02f		/* Meters, peak to peak */
+#define TEST_MAX_JITTER		0.5f		/* Share of the measured jitter */
+#define TEST_FRAMES			300
+
+static const uint32 nSlots = KINECT_SKELETON_COUNT;
+static const uint32 nJoints = KINECT_SKELETON_JOINT_COUNT;
+
+// Deterministic noise in [-0.5, 0.5] for a given frame, cell and axis
+static float32 getNoise(uint32 frame, uint32 cell, uint32 axis)
+{
+	uint32 seed = frame*2654435761u ^ cell*2246822519u ^ axis*3266489917u;
+	seed ^= seed>>15;
+	seed *= 2246822519u;
+	seed ^= seed>>13;
+	seed *= 3266489917u;
+	seed ^= seed>>16;
+	return basic_cast<float32>(seed>>8)/basic_cast<float32>(1u<<24) - 0.5f;
+}
+
+// Each cell starts somewhere of its own
+static Point getOrigin(uint32 cell)
+{
+	return Point(0.01f*basic_cast<float32>(cell), 1.0f + 0.005f*basic_cast<float32>(cell%7), 2.0f + 0.02f*basic_cast<float32>(cell%5));
+}
+
+static JointOneEuroFilter* createFilter()
+{
+	JointOneEuroFilter* filter = new JointOneEuroFilter();
+	filter->setParameters(Config::DEFAULT_SMOOTHING_MIN_CUTOFF, Config::DEFAULT_SMOOTHING_BETA, Config::DEFAULT_SMOOTHING_DERIVATIVE_CUTOFF);
+	return filter;
+}
+
+// Every cell jumps along X after a second at rest
+static bool checkStep()
+{
+	JointOneEuroFilter* filter = createFilter();
+	uint64 time = Clock::fromMilliseconds(1000);
+	uint32 stepFrame = 30;
+	float32 worstLag = 0.0f;
+	float32 worstOvershoot = 0.0f;
+	uint32 nUnsettled = 0;
+	uint32 settledFrames[nSlots*nJoints];
+	for (uint32 c = 0; c < nSlots*nJoints; c++) settledFrames[c] = 0;
+
+	for (uint32 f = 0; f < TEST_FRAMES; f++)
+	{
+		time += TEST_FRAME_PERIOD;
+		for (uint32 c = 0; c < nSlots*nJoints; c++)
+		{
+			Point measurement = getOrigin(c);
+			if (f >= stepFrame) measurement.x += TEST_STEP;
+			filter->set(c/nJoints, c%nJoints, measurement);
+		}
+		filter->filter(time);
+
+		for (uint32 c = 0; c < nSlots*nJoints; c++)
+		{
+			Point position = filter->getPosition(c/nJoints, c%nJoints);
+			float32 progress = (position.x - getOrigin(c).x)/TEST_STEP;
+			if (progress - 1.0f > worstOvershoot) worstOvershoot = progress - 1.0f;
+			if (!settledFrames[c] && progress >= TEST_STEP_SETTLE) settledFrames[c] = f - stepFrame + 1;
+		}
+	}
+
+	for (uint32 c = 0; c < nSlots*nJoints; c++)
+	{
+		if (!settledFrames[c])
+		{
+			nUnsettled++;
+			continue;
+		}
+		float32 lag = basic_cast<float32>(Clock::toMilliseconds(basic_cast<uint64>(settledFrames[c])*TEST_FRAME_PERIOD));
+		if (lag > worstLag) worstLag = lag;
+	}
+	delete filter;
+
+	bool passed = (nUnsettled == 0 && worstLag <= TEST_MAX_STEP_LAG && worstOvershoot <= 0.0001f);
+	std::printf("Step:   %.0f%% reached within %.0f ms, overshoot %.2f mm, %s\n", TEST_STEP_SETTLE*100.0f, worstLag, worstOvershoot*TEST_STEP*1000.0f, (passed)?"passed":"FAILED");
+	return passed;
+}
+
+// Every cell moves steadily along Z, and trails by the reported latency once the filter settled
+static bool checkSteadyMovement()
+{
+	JointOneEuroFilter* filter = createFilter();
+	uint64 start = Clock::fromMilliseconds(1000);
+	uint64 time = start;
+	float32 worstError = 0.0f;
+	float32 latency = 0.0f;
+	for (uint32 f = 0; f < TEST_FRAMES; f++)
+	{
+		time += TEST_FRAME_PERIOD;
+		float32 travelled = TEST_SPEED*Clock::toSeconds(time - start);
+		for (uint32 c = 0; c < nSlots*nJoints; c++)
+		{
+			Point measurement = getOrigin(c);
+			measurement.z += travelled;
+			filter->set(c/nJoints, c%nJoints, measurement);
+		}
+		filter->filter(time);
+		latency = filter->getLatency();
+
+		if (f < TEST_FRAMES/2) continue;
+		for (uint32 c = 0; c < nSlots*nJoints; c++)
+		{
+			Point position = filter->getPosition(c/nJoints, c%nJoints);
+			float32 lag = 1000.0f*(getOrigin(c).z + travelled - position.z)/TEST_SPEED;
+			float32 error = std::fabs(lag - latency)/latency;
+			if (error > worstError) worstError = error;
+		}
+	}
+	delete filter;
+
+	bool passed = (latency > 0.0f && worstError <= TEST_LATENCY_ERROR);
+	std::printf("Ramp:   reported latency %.1f ms, trailing off by at most %.1f%%, %s\n", latency, worstError*100.0f, (passed)?"passed":"FAILED");
+	return passed;
+}
+
+// Every cell holds still under measurement noise
+static bool checkJitter()
+{
+	JointOneEuroFilter* filter = createFilter();
+	uint64 time = Clock::fromMilliseconds(1000);
+	float64 measuredSum = 0.0;
+	float64 filteredSum = 0.0;
+	float64 biasSum[3] = {0.0, 0.0, 0.0};
+	uint32 nSamples = 0;
+	for (uint32 f = 0; f < TEST_FRAMES; f++)
+	{
+		time += TEST_FRAME_PERIOD;
+		for (uint32 c = 0; c < nSlots*nJoints; c++)
+		{
+			Point measurement = getOrigin(c);
+			measurement.x += TEST_NOISE*getNoise(f, c, 0);
+			measurement.y += TEST_NOISE*getNoise(f, c, 1);
+			measurement.z += TEST_NOISE*getNoise(f, c, 2);
+			filter->set(c/nJoints, c%nJoints, measurement);
+		}
+		filter->filter(time);
+
+		// The first second lets the filter forget its first measurement
+		if (f < 30) continue;
+		for (uint32 c = 0; c < nSlots*nJoints; c++)
+		{
+			Point origin = getOrigin(c);
+			Point position = filter->getPosition(c/nJoints, c%nJoints);
+			float32 offsets[3] = {position.x - origin.x, position.y - origin.y, position.z - origin.z};
+			for (uint32 a = 0; a < 3; a++)
+			{
+				float32 noise = TEST_NOISE*getNoise(f, c, a);
+				measuredSum += noise*noise;
+				filteredSum += offsets[a]*offsets[a];
+				biasSum[a] += offsets[a];
+			}
+			nSamples++;
+		}
+	}
+	delete filter;
+
+	float64 measured = sqrt(measuredSum/(3*nSamples));
+	float64 filtered = sqrt(filteredSum/(3*nSamples));
+	float64 bias = 0.0;
+	for (uint32 a = 0; a < 3; a++) bias = (fabs(biasSum[a]/nSamples) > bias)?fabs(biasSum[a]/nSamples):bias;
+
+	bool passed = (filtered <= TEST_MAX_JITTER*measured && bias <= 0.1*measured);
+	std::printf("Jitter: %.2f mm in, %.2f mm out, bias %.2f mm, %s\n", measured*1000.0, filtered*1000.0, bias*1000.0, (passed)?"passed":"FAILED");
+	return passed;
+}
+
+int main(int argc, char* argv[])
+{
+	Clock::initialize();
+
+	bool passed = true;
+	passed = checkStep() && passed;
+	passed = checkSteadyMovement() && passed;
+	passed = checkJitter() && passed;
+
+	if (!passed) std::printf("FAILED\n");
+	return (passed)?0:1;
+}
@@ -0,0 +1,233 @@
+/*
+** Checks a recording reads back exactly as Kinect::KinectRecorder wrote it.
+**
+** Color, depth and skeleton records of a synthetic session are recorded to
+** a temporary file, each with its own timestamp and a payload derived from
+** its stream and frame. Kinect::KinectRecordingReader then reads them back
+** in order, seeks to the middle of the session and reads on from there, and
+** does it all again on a copy without the index, as left by an interrupted
+** recording. Full resolution frames make the session larger than one
+** mapped view, so reading also crosses views.
+**
+**     RecordingRoundTripTest.exe [-F<frames>]
+**
+** The exit code is 0 when the header, every timestamp and every payload
+** match what was recorded, on both files.
+*/
+
+#include "Globals/Include.h"
+#include "Kinect/KinectDevice.h"
+#include "Kinect/KinectRecorder.h"
+#include "Kinect/KinectRecording.h"
+#include "Kinect/KinectRecordingReader.h"
+#include <Windows.h>
+#include <NuiApi.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Kinect;
+
+
+#define TEST_DEVICE_ID		"RoundTripKinect"
+#define TEST_FRAME_PERIOD	33333333	/* Nanoseconds, 30 Hz */
+#define TEST_START_TIME		1000000000	/* Nanoseconds */
+#define TEST_COLOR_WIDTH	640
+#define TEST_COLOR_HEIGHT	480
+#define TEST_DEPTH_WIDTH	320
+#define TEST_DEPTH_HEIGHT	240
+#define TEST_ELEVATION		7
+
+static uint32 getPayloadSize(uint32 type)
+{
+	switch (type)
+	{
+	case KinectRecording::K_RECORD_COLOR:		return TEST_COLOR_WIDTH*TEST_COLOR_HEIGHT*4;
+	case KinectRecording::K_RECORD_DEPTH:		return TEST_DEPTH_WIDTH*TEST_DEPTH_HEIGHT*2;
+	case KinectRecording::K_RECORD_SKELETON:	return sizeof(NUI_SKELETON_FRAME);
+	default:									return 0;
+	}
+}
+
+// Streams of a frame are a millisecond apart, so the index orders them by type within the frame
+static uint64 getTimestamp(uint32 frame, uint32 type)
+{
+	return TEST_START_TIME + basic_cast<uint64>(frame)*TEST_FRAME_PERIOD + basic_cast<uint64>(type - 1)*1000000;
+}
+
+static void fillPayload(uint32 frame, uint32 type, std::vector<uint8>& payload)
+{
+	payload.resize(getPayloadSize(type));
+	uint32 seed = frame*2654435761u + type*40503u + 1;
+	for (uint32 i = 0; i < payload.size(); i++)
+	{
+		seed = seed*1664525u + 1013904223u;
+		payload[i] = basic_cast<uint8>(seed >> 24);
+	}
+}
+
+static bool record(const std::string& filename, uint32 nFrames, uint32& nRetries)
+{
+	KinectRecording::FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::strncpy(header.deviceID, TEST_DEVICE_ID, KinectRecording::K_RECORDING_ID_LENGTH - 1);
+	header.colorWidth = TEST_COLOR_WIDTH;
+	header.colorHeight = TEST_COLOR_HEIGHT;
+	header.depthWidth = TEST_DEPTH_WIDTH;
+	header.depthHeight = TEST_DEPTH_HEIGHT;
+	header.streams = KinectDevice::K_USE_COLOR|KinectDevice::K_USE_DEPTH|KinectDevice::K_USE_SKELETON;
+	header.elevationAngle = TEST_ELEVATION;
+
+	// The recorder drops frames while its buffers are queued, a check can wait for the writer instead
+	KinectRecorder recorder(filename, header);
+	if (!recorder.isOpen()) return false;
+	std::vector<uint8> payload;
+	nRetries = 0;
+	for (uint32 f = 0; f < nFrames; f++)
+	{
+		for (uint32 type = KinectRecording::K_RECORD_COLOR; type <= KinectRecording::K_RECORD_SKELETON; type++)
+		{
+			fillPayload(f, type, payload);
+			while (!recorder.record(basic_cast<KinectRecording::RecordType>(type), getTimestamp(f, type), &payload[0], basic_cast<uint32>(payload.size())))
+			{
+				nRetries++;
+				Sleep(1);
+			}
+		}
+	}
+	return true;
+}
+
+// The recorded records from one on, in order, against what was recorded
+static uint32 checkRecords(KinectRecordingReader& reader, uint32 first, uint32 nFrames)
+{
+	std::vector<uint8> expected;
+	uint32 nErrors = 0;
+	for (uint32 i = first; i < reader.getNumberOfRecords(); i++)
+	{
+		uint32 frame = i/3;
+		uint32 type = KinectRecording::K_RECORD_COLOR + i%3;
+		const KinectRecording::IndexEntry& entry = reader.getEntry(i);
+		if (frame >= nFrames || entry.type != type || entry.timestamp != getTimestamp(frame, type) || entry.size != getPayloadSize(type))
+		{
+			std::printf("Record %u: type %u at %llu, expected type %u at %llu\n", i, entry.type, entry.timestamp, type, getTimestamp(frame, type));
+			nErrors++;
+			continue;
+		}
+
+		fillPayload(frame, type, expected);
+		const uint8* payload = reader.getPayload(i);
+		if (!payload || std::memcmp(payload, &expected[0], expected.size()) != 0)
+		{
+			std::printf("Record %u: payload differs\n", i);
+			nErrors++;
+		}
+	}
+	return nErrors;
+}
+
+static uint32 checkRecording(const std::string& filename, uint32 nFrames)
+{
+	KinectRecordingReader reader;
+	if (!reader.open(filename))
+	{
+		std::printf("Unable to open %s\n", filename.c_str());
+		return 1;
+	}
+
+	uint32 nErrors = 0;
+	const KinectRecording::FileHeader& header = reader.getHeader();
+	if (std::string(header.deviceID) != TEST_DEVICE_ID ||
+		header.colorWidth != TEST_COLOR_WIDTH || header.colorHeight != TEST_COLOR_HEIGHT ||
+		header.depthWidth != TEST_DEPTH_WIDTH || header.depthHeight != TEST_DEPTH_HEIGHT ||
+		header.elevationAngle != TEST_ELEVATION)
+	{
+		std::printf("Header differs\n");
+		nErrors++;
+	}
+	if (reader.getNumberOfRecords() != nFrames*3)
+	{
+		std::printf("%u records, expected %u\n", reader.getNumberOfRecords(), nFrames*3);
+		nErrors++;
+	}
+	nErrors += checkRecords(reader, 0, nFrames);
+
+	// Seeking lands on the first record at or after the time, both on a record and between two
+	uint32 middle = nFrames/2;
+	uint32 exact = reader.seek(getTimestamp(middle, KinectRecording::K_RECORD_COLOR));
+	uint32 between = reader.seek(getTimestamp(middle, KinectRecording::K_RECORD_SKELETON) + 1);
+	if (exact != middle*3 || between != (middle + 1)*3)
+	{
+		std::printf("Seek to frame %u gave records %u and %u, expected %u and %u\n", middle, exact, between, middle*3, (middle + 1)*3);
+		nErrors++;
+	}
+	else nErrors += checkRecords(reader, exact, nFrames);
+
+	return nErrors;
+}
+
+// What an interrupted recording leaves behind: the records without the index, and no index offset in the header
+static bool stripIndex(const std::string& filename, const std::string& stripped)
+{
+	std::ifstream in(filename.c_str(), std::ios::in|std::ios::binary);
+	KinectRecording::FileHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !header.indexOffset) return false;
+
+	std::vector<char> records(basic_cast<size_t>(header.indexOffset - sizeof(header)));
+	if (!records.empty() && !in.read(&records[0], records.size())) return false;
+	header.indexOffset = 0;
+	header.indexCount = 0;
+
+	std::ofstream out(stripped.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!records.empty()) out.write(&records[0], records.size());
+	return out.good();
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 nFrames = 90;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg.find("-F") == 0) nFrames = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nFrames < 2) nFrames = 2;
+
+	char tempPath[MAX_PATH];
+	if (!GetTempPathA(MAX_PATH, tempPath))
+	{
+		std::printf("No temporary directory\nFAILED\n");
+		return 1;
+	}
+	std::string filename = std::string(tempPath) + "RecordingRoundTripTest.mkrec";
+	std::string stripped = std::string(tempPath) + "RecordingRoundTripTest.noindex.mkrec";
+
+	uint32 nRetries = 0;
+	if (!record(filename, nFrames, nRetries))
+	{
+		std::printf("Unable to record %s\nFAILED\n", filename.c_str());
+		return 1;
+	}
+	std::printf("%u frames recorded, %u records waited for a buffer\n", nFrames, nRetries);
+
+	uint32 indexedErrors = checkRecording(filename, nFrames);
+	std::printf("Indexed:   %u errors\n", indexedErrors);
+
+	uint32 scannedErrors = 1;
+	if (stripIndex(filename, stripped)) scannedErrors = checkRecording(stripped, nFrames);
+	else std::printf("Unable to strip the index\n");
+	std::printf("Scanned:   %u errors\n", scannedErrors);
+
+	DeleteFileA(filename.c_str());
+	DeleteFileA(stripped.c_str());
+
+	bool passed = (indexedErrors == 0 && scannedErrors == 0);
+	if (!passed) std::printf("FAILED\n");
+	return (passed)?0:1;
+}
@@ -0,0 +1,126 @@
+/*
+** Microbenchmark of shared object lookups, per call through
+** SharedMemoryManager::getSharedObject() against resolved SharedChannel
+** handles.
+**
+** Several segments are laid out like slave segments, and each iteration reads
+** the six pose values of every segment the way getKMatrix() does. Lookups per
+** second are printed for both paths.
+**
+**     SharedChannelBench.exe [-S<segments>] [-I<iterations>]
+**
+** The exit code is 0 when both paths read the same values.
+*/
+
+#include "Globals/Include.h"
+#include "Interprocess/SharedChannel.h"
+#include "Interprocess/SharedMemoryManager.h"
+#include "Tools/Clock.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Interprocess;
+using namespace Tools;
+
+
+#define BENCH_MAX_SEGMENTS	8
+#define BENCH_POSE_VALUES	6
+
+static const char* poseNames[BENCH_POSE_VALUES] = {"rotationX", "rotationY", "rotationZ", "translationX", "translationY", "translationZ"};
+
+// Objects every slave segment holds besides the pose, so finds are not done on an empty index
+static const char* otherNames[] = {"colorFrame", "depthFrame", "rawDepthPixels", "playerMasksPixels", "confidenceValue", "clockEpoch"};
+
+static std::string getSegmentID(uint32 segment)
+{
+	return "MultiKinect_ChannelBench" + basic_cast<std::string>(segment);
+}
+
+static float32 readPerCall(uint32 nSegments, uint32 nIterations, uint64& elapsed)
+{
+	float32 sum = 0.0f;
+	uint64 start = Clock::getTime();
+	for (uint32 i = 0; i < nIterations; i++)
+	{
+		for (uint32 s = 0; s < nSegments; s++)
+		{
+			std::string segmentID = getSegmentID(s);
+			for (uint32 v = 0; v < BENCH_POSE_VALUES; v++)
+				sum += *SharedMemoryManager::getSharedObject<float32>(segmentID, poseNames[v]);
+		}
+	}
+	elapsed = Clock::getTime() - start;
+	return sum;
+}
+
+static float32 readChannels(uint32 nSegments, uint32 nIterations, uint64& elapsed)
+{
+	std::vector< SharedChannel<float32> > channels;
+	for (uint32 s = 0; s < nSegments; s++)
+		for (uint32 v = 0; v < BENCH_POSE_VALUES; v++)
+			channels.push_back(SharedChannel<float32>(getSegmentID(s), poseNames[v]));
+
+	float32 sum = 0.0f;
+	uint64 start = Clock::getTime();
+	for (uint32 i = 0; i < nIterations; i++)
+	{
+		for (uint32 c = 0; c < channels.size(); c++) sum += *channels[c].get();
+	}
+	elapsed = Clock::getTime() - start;
+	return sum;
+}
+
+static void report(const char* name, uint32 nLookups, uint64 elapsed)
+{
+	float64 seconds = Clock::toMilliseconds(elapsed)*0.001;
+	float64 perSecond = (seconds > 0.0)?basic_cast<float64>(nLookups)/seconds:0.0;
+	std::printf("%-12s %10u lookups in %9.3f ms: %14.0f lookups/s, %8.1f ns each\n", name, nLookups, seconds*1000.0, perSecond,
+		(nLookups)?(seconds*1000000000.0)/nLookups:0.0);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 nSegments = 4;
+	uint32 nIterations = 200000;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-S") == 0)	nSegments = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-I") == 0)	nIterations = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nSegments < 1) nSegments = 1;
+	if (nSegments > BENCH_MAX_SEGMENTS) nSegments = BENCH_MAX_SEGMENTS;
+
+	Clock::initialize();
+	SharedMemoryManager::initialize();
+	for (uint32 s = 0; s < nSegments; s++)
+	{
+		std::string segmentID = getSegmentID(s);
+		SharedMemoryManager::createSharedSegment(segmentID, 65536);
+		for (uint32 o = 0; o < sizeof(otherNames)/sizeof(otherNames[0]); o++)
+			SharedMemoryManager::createSharedObject<float32>(segmentID, otherNames[o]);
+		for (uint32 v = 0; v < BENCH_POSE_VALUES; v++)
+			*SharedMemoryManager::createSharedObject<float32>(segmentID, poseNames[v]) = basic_cast<float32>(s*BENCH_POSE_VALUES + v);
+	}
+
+	uint32 nLookups = nIterations*nSegments*BENCH_POSE_VALUES;
+	uint64 perCallTime, channelsTime;
+	float32 perCallSum = readPerCall(nSegments, nIterations, perCallTime);
+	float32 channelsSum = readChannels(nSegments, nIterations, channelsTime);
+
+	std::printf("%u segments, %u iterations of %u pose reads per segment\n", nSegments, nIterations, BENCH_POSE_VALUES);
+	report("Per call", nLookups, perCallTime);
+	report("Channels", nLookups, channelsTime);
+	if (channelsTime) std::printf("Speedup: %.1fx\n", basic_cast<float64>(perCallTime)/basic_cast<float64>(channelsTime));
+
+	for (uint32 s = 0; s < nSegments; s++) SharedMemoryManager::removeSharedSegment(getSegmentID(s));
+	SharedMemoryManager::destroy();
+
+	bool passed = (perCallSum == channelsSum);
+	if (!passed) std::printf("FAILED: both paths must read the same values\n");
+	return (passed)?0:1;
+}
@@ -0,0 +1,206 @@
+/*
+** Cross-process stress test for Interprocess::SharedFrameSlots.
+**
+** Run without arguments, it creates a shared segment, launches one reader
+** process per requested reader (-R<index>) and publishes frames as fast as it
+** can. Every frame is filled with a pattern derived from its number, so a
+** reader that gets a torn copy sees the pattern broken. Readers poll the
+** latest frame and also follow every frame through a SharedFrameCursor,
+** checking numbers only move forward and that gaps match the reported losses.
+**
+**     SharedFrameSlotsStress.exe [-N<readers>] [-F<frames>]
+**
+** The exit code is 0 when no reader saw a torn or out of order frame.
+*/
+
+#include "Globals/Include.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <Windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Interprocess;
+
+
+#define STRESS_SEGMENT			"MultiKinect_SharedFrameSlotsStress"
+#define STRESS_MAX_READERS		16
+#define STRESS_PAYLOAD			(KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT*8)	/* Floats, about the size of a skeletons frame */
+#define STRESS_CURSOR_BATCH		8
+
+struct StressFrame
+{
+	uint32 number;
+	float32 payload[STRESS_PAYLOAD];
+	uint32 check;
+};
+
+struct StressControl
+{
+	volatile LONG readersReady;
+	volatile LONG stop;
+	volatile LONG latestReads[STRESS_MAX_READERS];
+	volatile LONG cursorReads[STRESS_MAX_READERS];
+	volatile LONG lost[STRESS_MAX_READERS];
+
+	StressControl() : readersReady(0), stop(0)
+	{
+		for (uint32 i = 0; i < STRESS_MAX_READERS; i++) latestReads[i] = cursorReads[i] = lost[i] = 0;
+	}
+};
+
+static void fillFrame(StressFrame& frame, uint32 number)
+{
+	frame.number = number;
+	for (uint32 i = 0; i < STRESS_PAYLOAD; i++) frame.payload[i] = basic_cast<float32>((number*31 + i)%65536);
+	frame.check = ~number;
+}
+
+static bool isFrameIntact(const StressFrame& frame)
+{
+	if (frame.check != ~frame.number) return false;
+	for (uint32 i = 0; i < STRESS_PAYLOAD; i++)
+		if (frame.payload[i] != basic_cast<float32>((frame.number*31 + i)%65536)) return false;
+	return true;
+}
+
+static int runReader(uint32 index)
+{
+	boost::interprocess::managed_shared_memory segment(boost::interprocess::open_only, STRESS_SEGMENT);
+	SharedFrameSlots<StressFrame>* slots = segment.find< SharedFrameSlots<StressFrame> >("slots").first;
+	StressControl* control = segment.find<StressControl>("control").first;
+	if (!slots || !control)
+	{
+		std::printf("Reader %u: shared objects not found\n", index);
+		return 2;
+	}
+
+	static StressFrame latest;
+	static StressFrame batch[STRESS_CURSOR_BATCH];
+	SharedFrameCursor<StressFrame> cursor;
+	uint32 failures = 0;
+	uint32 lastLatest = 0;
+	uint32 lastCursor = 0;
+	LONG latestReads = 0;
+	LONG cursorReads = 0;
+
+	InterlockedIncrement(&control->readersReady);
+	bool exit = false;
+	while (!exit)
+	{
+		// Check the flag first so the final pass still drains the history
+		exit = (control->stop != 0);
+
+		if (slots->read(latest))
+		{
+			if (!isFrameIntact(latest) || latest.number < lastLatest)
+			{
+				std::printf("Reader %u: torn or old latest frame %u after %u\n", index, latest.number, lastLatest);
+				failures++;
+			}
+			lastLatest = latest.number;
+			latestReads++;
+		}
+
+		uint32 nFrames = cursor.read(slots, batch, STRESS_CURSOR_BATCH);
+		uint32 gaps = 0;
+		for (uint32 i = 0; i < nFrames; i++)
+		{
+			if (!isFrameIntact(batch[i]) || batch[i].number <= lastCursor)
+			{
+				std::printf("Reader %u: torn or repeated frame %u after %u\n", index, batch[i].number, lastCursor);
+				failures++;
+			}
+			else gaps += batch[i].number - lastCursor - 1;
+			lastCursor = batch[i].number;
+		}
+		if (nFrames && gaps != cursor.getLost())
+		{
+			std::printf("Reader %u: %u frames missing but %u reported lost\n", index, gaps, cursor.getLost());
+			failures++;
+		}
+		cursorReads += nFrames;
+	}
+
+	control->latestReads[index] = latestReads;
+	control->cursorReads[index] = cursorReads;
+	control->lost[index] = cursor.getTotalLost();
+	return (failures)?1:0;
+}
+
+static int runWriter(const std::string& executable, uint32 nReaders, uint32 nFrames)
+{
+	boost::interprocess::shared_memory_object::remove(STRESS_SEGMENT);
+	boost::interprocess::managed_shared_memory segment(boost::interprocess::create_only, STRESS_SEGMENT, sizeof(SharedFrameSlots<StressFrame>) + 65536);
+	SharedFrameSlots<StressFrame>* slots = segment.construct< SharedFrameSlots<StressFrame> >("slots")();
+	StressControl* control = segment.construct<StressControl>("control")();
+
+	std::vector<HANDLE> readers;
+	for (uint32 i = 0; i < nReaders; i++)
+	{
+		std::string command = "\"" + executable + "\" -R" + basic_cast<std::string>(i);
+		std::vector<char> commandLine(command.begin(), command.end());
+		commandLine.push_back(0);
+
+		STARTUPINFOA startupInfo;
+		std::memset(&startupInfo, 0, sizeof(startupInfo));
+		startupInfo.cb = sizeof(startupInfo);
+		PROCESS_INFORMATION processInfo;
+		if (!CreateProcessA(0, &commandLine[0], 0, 0, false, 0, 0, 0, &startupInfo, &processInfo))
+		{
+			std::printf("Unable to launch reader %u\n", i);
+			control->stop = 1;
+			break;
+		}
+		CloseHandle(processInfo.hThread);
+		readers.push_back(processInfo.hProcess);
+	}
+
+	while (!control->stop && control->readersReady < basic_cast<LONG>(readers.size())) Sleep(1);
+
+	// Publish back to back, the readers have to race the writer on every slot
+	for (uint32 i = 1; i <= nFrames && !control->stop; i++)
+	{
+		StressFrame& frame = slots->beginWrite();
+		fillFrame(frame, slots->getPublished() + 1);
+		slots->endWrite();
+	}
+	InterlockedExchange(&control->stop, 1);
+
+	int result = (readers.size() == nReaders)?0:1;
+	for (uint32 i = 0; i < readers.size(); i++)
+	{
+		WaitForSingleObject(readers[i], INFINITE);
+		DWORD exitCode = 1;
+		GetExitCodeProcess(readers[i], &exitCode);
+		CloseHandle(readers[i]);
+
+		std::printf("Reader %u: %s, %ld latest reads, %ld cursor frames, %ld lost\n", i, (exitCode == 0)?"passed":"FAILED",
+			control->latestReads[i], control->cursorReads[i], control->lost[i]);
+		if (exitCode != 0) result = 1;
+	}
+
+	boost::interprocess::shared_memory_object::remove(STRESS_SEGMENT);
+	std::printf("%u frames published to %u readers: %s\n", nFrames, nReaders, (result == 0)?"passed":"FAILED");
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 nReaders = 4;
+	uint32 nFrames = 200000;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-R") == 0)	return runReader(basic_cast<uint32>(std::atoi(arg.substr(2).c_str())));
+		else if	(arg.find("-N") == 0)	nReaders = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-F") == 0)	nFrames = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nReaders > STRESS_MAX_READERS) nReaders = STRESS_MAX_READERS;
+
+	return runWriter(argv[0], nReaders, nFrames);
+}
@@ -0,0 +1,216 @@
+/*
+** Benchmark of Render::SkeletonFusion with synthetic sensors.
+**
+** A fake RenderSystem feeds every sensor the same people walking around the
+** room, each sensor with its own capture phase, bias and jitter, the way
+** RenderSystemMulti and RenderSystemInterprocess feed the fusion. Every frame
+** is fused through SkeletonFusion::update() and timed on its own.
+**
+**     SkeletonFusionBench.exe [-D<sensors>] [-F<frames>]
+**
+** The exit code is 0 when every person keeps a single track and the mean
+** update time stays under one millisecond.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Render/RenderSystem.h"
+#include "Render/SkeletonFusion.h"
+#include "Tools/Clock.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+#define BENCH_MAX_SENSORS	16
+#define BENCH_FRAME_PERIOD	33		/* Milliseconds */
+#define BENCH_WARMUP_FRAMES	30
+#define BENCH_BUDGET		1.0		/* Milliseconds */
+
+// A standing pose in meters, relative to the point between the feet, in KinectJoint order
+static const float32 pose[KINECT_SKELETON_JOINT_COUNT][3] =
+{
+	{ 0.00f, 1.65f, 0.00f},	// K_HEAD
+	{-0.18f, 1.42f, 0.00f},	// K_SHOULDER_LEFT
+	{ 0.00f, 1.45f, 0.00f},	// K_SHOULDER_CENTER
+	{ 0.18f, 1.42f, 0.00f},	// K_SHOULDER_RIGHT
+	{-0.25f, 1.15f, 0.02f},	// K_ELBOW_LEFT
+	{ 0.25f, 1.15f, 0.02f},	// K_ELBOW_RIGHT
+	{-0.27f, 0.90f, 0.05f},	// K_WRIST_LEFT
+	{ 0.27f, 0.90f, 0.05f},	// K_WRIST_RIGHT
+	{-0.28f, 0.82f, 0.06f},	// K_HAND_LEFT
+	{ 0.28f, 0.82f, 0.06f},	// K_HAND_RIGHT
+	{ 0.00f, 1.10f, 0.00f},	// K_SPINE
+	{-0.10f, 0.92f, 0.00f},	// K_HIP_LEFT
+	{ 0.00f, 0.95f, 0.00f},	// K_HIP_CENTER
+	{ 0.10f, 0.92f, 0.00f},	// K_HIP_RIGHT
+	{-0.11f, 0.50f, 0.02f},	// K_KNEE_LEFT
+	{ 0.11f, 0.50f, 0.02f},	// K_KNEE_RIGHT
+	{-0.12f, 0.08f, 0.00f},	// K_ANKLE_LEFT
+	{ 0.12f, 0.08f, 0.00f},	// K_ANKLE_RIGHT
+	{-0.12f, 0.02f, 0.08f},	// K_FOOT_LEFT
+	{ 0.12f, 0.02f, 0.08f}	// K_FOOT_RIGHT
+};
+
+class FusionBenchSource : public RenderSystem
+{
+private:
+	uint32 nSensors_;
+	uint32 frameID_;
+	uint64 time_;
+	uint64 phases_[BENCH_MAX_SENSORS];
+	Vector biases_[BENCH_MAX_SENSORS];
+	uint32 seed_;
+
+	float32 jitter()
+	{
+		// Cheap deterministic noise of about a centimeter
+		seed_ = seed_*1664525u + 1013904223u;
+		return (basic_cast<float32>(seed_>>8)/basic_cast<float32>(1u<<24) - 0.5f)*0.02f;
+	}
+
+public:
+	FusionBenchSource(uint32 nSensors) : nSensors_(nSensors), frameID_(0), time_(Clock::getTime()), seed_(12345)
+	{
+		for (uint32 i = 0; i < nSensors_; i++)
+		{
+			phases_[i] = Clock::fromMilliseconds((i*7)%BENCH_FRAME_PERIOD);
+			biases_[i] = Vector(jitter(), jitter(), jitter());
+		}
+	}
+
+	void step()
+	{
+		time_ += Clock::fromMilliseconds(BENCH_FRAME_PERIOD);
+		frameID_++;
+	}
+
+	uint8* getKColorFrame(int32 deviceIdx) { return 0; }
+	uint8* getKDepthFrame(int32 deviceIdx) { return 0; }
+
+	bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		nSkeletons = 0;
+		return false;
+	}
+
+	void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		// People walk slowly on a circle, far enough apart for the association gate
+		float32 seconds = Clock::toSeconds(timestamp);
+		nSkeletons = KINECT_SKELETON_COUNT;
+		for (uint32 k = 0; k < nSkeletons; k++)
+		{
+			float32 angle = 2.0f*PI32*basic_cast<float32>(k)/basic_cast<float32>(KINECT_SKELETON_COUNT) + 0.2f*seconds;
+			Point center(2.0f*cosf(angle), 0.0f, 3.0f + 2.0f*sinf(angle));
+			Quaternion orientation(0.0f, angle, 0.0f);
+
+			skeletons[k] = KinectSkeleton();
+			skeletons[k].setPlayerIndex(k + 1);
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			{
+				Point position(
+					center.x + pose[j][0] + biases_[deviceIdx].x + jitter(),
+					center.y + pose[j][1] + biases_[deviceIdx].y + jitter(),
+					center.z + pose[j][2] + biases_[deviceIdx].z + jitter());
+				skeletons[k].setJoint(basic_cast<KinectSkeleton::KinectJoint>(j), position, orientation);
+			}
+		}
+	}
+
+	uint32 getKFrameID(int32 deviceIdx)
+	{
+		return frameID_;
+	}
+
+	bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+	{
+		timestamp = time_ - phases_[deviceIdx];
+		return true;
+	}
+
+	float32 getKMeasurementNoise(int32 deviceIdx)
+	{
+		return Config::DEFAULT_KINECT_MEASUREMENT_NOISE;
+	}
+
+	bool isKHierarchicalOri(int32 deviceIdx)
+	{
+		return false;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	uint32 nSensors = 8;
+	uint32 nFrames = 3000;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-D") == 0)	nSensors = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-F") == 0)	nFrames = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nSensors < 1) nSensors = 1;
+	if (nSensors > BENCH_MAX_SENSORS) nSensors = BENCH_MAX_SENSORS;
+	if (nFrames < 1) nFrames = 1;
+
+	Clock::initialize();
+	FusionBenchSource source(nSensors);
+	SkeletonFusion fusion;
+	SkeletonFusion::FusedFrame frame;
+
+	for (uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++)
+	{
+		source.step();
+		fusion.update(&source, nSensors);
+	}
+	fusion.getFrame(frame);
+	uint32 trackIDs[KINECT_SKELETON_COUNT];
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++) trackIDs[i] = frame.trackIDs[i];
+
+	std::vector<float64> times(nFrames);
+	uint32 nUpdated = 0;
+	for (uint32 i = 0; i < nFrames; i++)
+	{
+		source.step();
+		uint64 start = Clock::getTime();
+		if (fusion.update(&source, nSensors)) nUpdated++;
+		times[i] = Clock::toMilliseconds(Clock::getTime() - start);
+	}
+
+	// Tracks that split or swap while the people walk would change the IDs
+	fusion.getFrame(frame);
+	uint32 nTracked = 0;
+	bool stable = true;
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+	{
+		if (frame.trackIDs[i]) nTracked++;
+		if (frame.trackIDs[i] != trackIDs[i]) stable = false;
+	}
+
+	float64 total = 0.0;
+	for (uint32 i = 0; i < nFrames; i++) total += times[i];
+	float64 mean = total/nFrames;
+	std::sort(times.begin(), times.end());
+	float64 p99 = times[(nFrames - 1)*99/100];
+	float64 worst = times[nFrames - 1];
+
+	std::printf("%u sensors, %u people, %u frames (%u fused)\n", nSensors, KINECT_SKELETON_COUNT, nFrames, nUpdated);
+	std::printf("Update: mean %.3f ms, 99th percentile %.3f ms, max %.3f ms\n", mean, p99, worst);
+	std::printf("Tracks: %u of %u, %s\n", nTracked, KINECT_SKELETON_COUNT, (stable)?"stable":"CHANGED");
+
+	bool passed = (nUpdated == nFrames && nTracked == KINECT_SKELETON_COUNT && stable && mean < BENCH_BUDGET);
+	if (!passed) std::printf("FAILED\n");
+	return (passed)?0:1;
+}
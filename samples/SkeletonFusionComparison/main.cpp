@@ -0,0 +1,578 @@
+/*
+** Jitter and latency of Render::SkeletonFusion against the averaging fusion
+** it replaced, with synthetic sensors seeing a known ground truth.
+**
+** Every sensor captures the same person at 30 Hz, each one with its own
+** capture phase, calibration bias and per frame noise, and loses sight of
+** either arm for half a second every now and then. The baseline smooths every sensor
+** with the double exponential filter behind NuiTransformSmooth at its default
+** parameters and averages the latest frame of each sensor, the way the
+** render systems fused before. The tracked path smooths every sensor like
+** KinectDevice does and fuses through SkeletonFusion::update(). Both outputs
+** are sampled on the same render ticks.
+**
+** Jitter is the spread of a standing person around its own mean. Latency is
+** the delay that best fits the output for a walking person, waving both
+** hands, to the ground truth, and error the distance to the ground truth at
+** the moment of the output.
+**
+**     SkeletonFusionComparison.exe [-D<sensors>] [-S<seconds>]
+**
+** Smoothing trades one for the other, so the exit code is 0 unless the
+** baseline has both less jitter and less latency than fusion.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Render/RenderSystem.h"
+#include "Render/SkeletonFusion.h"
+#include "Tools/Clock.h"
+#include "Tools/JointOneEuroFilter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+#define COMPARISON_MAX_SENSORS		16
+#define COMPARISON_FRAME_PERIOD		33333333	/* Nanoseconds, 30 Hz */
+#define COMPARISON_RENDER_TICK		4			/* Milliseconds */
+#define COMPARISON_WARMUP			2			/* Seconds */
+#define COMPARISON_NOISE			0.03f		/* Meters, peak to peak */
+#define COMPARISON_BIAS				0.04f		/* Meters, peak to peak */
+#define COMPARISON_OCCLUSION		0.25f		/* Chance of an arm being hidden from a sensor */
+#define COMPARISON_OCCLUSION_TIME	500			/* Milliseconds */
+#define COMPARISON_MAX_LAG			250			/* Milliseconds */
+#define COMPARISON_HISTORY			8
+
+// A standing pose in meters, relative to the point between the feet, in KinectJoint order
+static const float32 pose[KINECT_SKELETON_JOINT_COUNT][3] =
+{
+	{ 0.00f, 1.65f, 0.00f},	// K_HEAD
+	{-0.18f, 1.42f, 0.00f},	// K_SHOULDER_LEFT
+	{ 0.00f, 1.45f, 0.00f},	// K_SHOULDER_CENTER
+	{ 0.18f, 1.42f, 0.00f},	// K_SHOULDER_RIGHT
+	{-0.25f, 1.15f, 0.02f},	// K_ELBOW_LEFT
+	{ 0.25f, 1.15f, 0.02f},	// K_ELBOW_RIGHT
+	{-0.27f, 0.90f, 0.05f},	// K_WRIST_LEFT
+	{ 0.27f, 0.90f, 0.05f},	// K_WRIST_RIGHT
+	{-0.28f, 0.82f, 0.06f},	// K_HAND_LEFT
+	{ 0.28f, 0.82f, 0.06f},	// K_HAND_RIGHT
+	{ 0.00f, 1.10f, 0.00f},	// K_SPINE
+	{-0.10f, 0.92f, 0.00f},	// K_HIP_LEFT
+	{ 0.00f, 0.95f, 0.00f},	// K_HIP_CENTER
+	{ 0.10f, 0.92f, 0.00f},	// K_HIP_RIGHT
+	{-0.11f, 0.50f, 0.02f},	// K_KNEE_LEFT
+	{ 0.11f, 0.50f, 0.02f},	// K_KNEE_RIGHT
+	{-0.12f, 0.08f, 0.00f},	// K_ANKLE_LEFT
+	{ 0.12f, 0.08f, 0.00f},	// K_ANKLE_RIGHT
+	{-0.12f, 0.02f, 0.08f},	// K_FOOT_LEFT
+	{ 0.12f, 0.02f, 0.08f}	// K_FOOT_RIGHT
+};
+
+static bool isHandJoint(uint32 joint)
+{
+	return	joint == KinectSkeleton::K_WRIST_LEFT	|| joint == KinectSkeleton::K_HAND_LEFT ||
+			joint == KinectSkeleton::K_WRIST_RIGHT	|| joint == KinectSkeleton::K_HAND_RIGHT;
+}
+
+// Ground truth of every joint at the given second of the run
+static void getTruth(float64 seconds, bool moving, float32 joints[KINECT_SKELETON_JOINT_COUNT][3])
+{
+	float32 center[3] = {0.0f, 0.0f, 3.0f};
+	float32 wave = 0.0f;
+	if (moving)
+	{
+		float32 angle = basic_cast<float32>(0.5*seconds);
+		center[0] = 1.5f*cosf(angle);
+		center[2] = 3.0f + 1.5f*sinf(angle);
+		wave = 0.2f*basic_cast<float32>(sin(2.0*PI64*0.8*seconds));
+	}
+
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		joints[j][0] = center[0] + pose[j][0];
+		joints[j][1] = center[1] + pose[j][1] + ((isHandJoint(j))?wave:0.0f);
+		joints[j][2] = center[2] + pose[j][2];
+	}
+}
+
+// Deterministic noise in [-0.5, 0.5] for a given sensor, frame, joint and axis
+static float32 getNoise(uint32 sensor, uint32 frame, uint32 joint, uint32 axis)
+{
+	uint32 seed = sensor*2654435761u ^ frame*2246822519u ^ joint*3266489917u ^ axis*668265263u;
+	seed ^= seed>>15;
+	seed *= 2246822519u;
+	seed ^= seed>>13;
+	seed *= 3266489917u;
+	seed ^= seed>>16;
+	return basic_cast<float32>(seed>>8)/basic_cast<float32>(1u<<24) - 0.5f;
+}
+
+// Either arm of the person may be hidden from a sensor for a while, as when the body stands in between
+static bool isOccluded(uint32 sensor, float64 seconds, uint32 joint)
+{
+	int32 side = -1;
+	if (joint == KinectSkeleton::K_ELBOW_LEFT || joint == KinectSkeleton::K_WRIST_LEFT || joint == KinectSkeleton::K_HAND_LEFT) side = 0;
+	if (joint == KinectSkeleton::K_ELBOW_RIGHT || joint == KinectSkeleton::K_WRIST_RIGHT || joint == KinectSkeleton::K_HAND_RIGHT) side = 1;
+	if (side == -1) return false;
+
+	uint32 period = basic_cast<uint32>(seconds*1000.0/COMPARISON_OCCLUSION_TIME);
+	return getNoise(sensor, period, 0xFFFF, basic_cast<uint32>(side)) + 0.5f < COMPARISON_OCCLUSION;
+}
+
+/*
+** Holt double exponential smoothing with the jitter and deviation clamps of
+** NuiTransformSmooth, at the parameters the SDK uses when given none.
+*/
+class SmoothTransformFilter
+{
+private:
+	float32 raw_[KINECT_SKELETON_JOINT_COUNT][3];
+	float32 filtered_[KINECT_SKELETON_JOINT_COUNT][3];
+	float32 trend_[KINECT_SKELETON_JOINT_COUNT][3];
+	uint32 nFrames_[KINECT_SKELETON_JOINT_COUNT];
+
+public:
+	SmoothTransformFilter()
+	{
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++) nFrames_[j] = 0;
+	}
+
+	// Joints that are not tracked start over, like the SDK does
+	void filter(const float32 measurements[KINECT_SKELETON_JOINT_COUNT][3], const bool validity[KINECT_SKELETON_JOINT_COUNT], float32 positions[KINECT_SKELETON_JOINT_COUNT][3])
+	{
+		const float32 smoothing = 0.5f;
+		const float32 correction = 0.5f;
+		const float32 prediction = 0.5f;
+		const float32 jitterRadius = 0.05f;
+		const float32 maxDeviationRadius = 0.04f;
+
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			if (!validity[j])
+			{
+				nFrames_[j] = 0;
+				continue;
+			}
+
+			float32 raw[3] = {measurements[j][0], measurements[j][1], measurements[j][2]};
+			float32 filtered[3];
+			float32 trend[3];
+			if (nFrames_[j] == 0)
+			{
+				for (uint32 a = 0; a < 3; a++)
+				{
+					filtered[a] = raw[a];
+					trend[a] = 0.0f;
+				}
+			}
+			else if (nFrames_[j] == 1)
+			{
+				for (uint32 a = 0; a < 3; a++)
+				{
+					filtered[a] = 0.5f*(raw[a] + raw_[j][a]);
+					trend[a] = correction*(filtered[a] - filtered_[j][a]) + (1.0f - correction)*trend_[j][a];
+				}
+			}
+			else
+			{
+				// Measurements inside the jitter radius are pulled towards the last filtered position
+				float32 distance = sqrtf(
+					(raw[0] - filtered_[j][0])*(raw[0] - filtered_[j][0]) +
+					(raw[1] - filtered_[j][1])*(raw[1] - filtered_[j][1]) +
+					(raw[2] - filtered_[j][2])*(raw[2] - filtered_[j][2]));
+				float32 pull = (distance <= jitterRadius)?distance/jitterRadius:1.0f;
+				for (uint32 a = 0; a < 3; a++)
+				{
+					filtered[a] = raw[a]*pull + filtered_[j][a]*(1.0f - pull);
+					filtered[a] = filtered[a]*(1.0f - smoothing) + (filtered_[j][a] + trend_[j][a])*smoothing;
+					trend[a] = correction*(filtered[a] - filtered_[j][a]) + (1.0f - correction)*trend_[j][a];
+				}
+			}
+
+			// The prediction may not run further than the deviation radius from the measurement
+			float32 predicted[3];
+			for (uint32 a = 0; a < 3; a++) predicted[a] = filtered[a] + prediction*trend[a];
+			float32 deviation = sqrtf(
+				(predicted[0] - raw[0])*(predicted[0] - raw[0]) +
+				(predicted[1] - raw[1])*(predicted[1] - raw[1]) +
+				(predicted[2] - raw[2])*(predicted[2] - raw[2]));
+			if (deviation > maxDeviationRadius)
+			{
+				for (uint32 a = 0; a < 3; a++) predicted[a] = predicted[a]*(maxDeviationRadius/deviation) + raw[a]*(1.0f - maxDeviationRadius/deviation);
+			}
+
+			for (uint32 a = 0; a < 3; a++)
+			{
+				raw_[j][a] = raw[a];
+				filtered_[j][a] = filtered[a];
+				trend_[j][a] = trend[a];
+				positions[j][a] = predicted[a];
+			}
+			nFrames_[j]++;
+		}
+	}
+};
+
+struct SensorFrame
+{
+	uint64 timestamp;
+	float32 joints[KINECT_SKELETON_JOINT_COUNT][3];
+	bool validity[KINECT_SKELETON_JOINT_COUNT];
+};
+
+struct Sensor
+{
+	uint64 phase;
+	float32 bias[3];
+	uint32 nFrames;
+	SensorFrame history[COMPARISON_HISTORY];
+	float32 averaged[KINECT_SKELETON_JOINT_COUNT][3];
+	uint64 validSince[KINECT_SKELETON_JOINT_COUNT];
+	SmoothTransformFilter transformSmooth;
+	JointOneEuroFilter smoothing;
+};
+
+class ComparisonSource : public RenderSystem
+{
+private:
+	uint32 nSensors_;
+	bool moving_;
+	uint64 start_;
+	std::vector<Sensor*> sensors_;
+
+	void capture(uint32 i)
+	{
+		Sensor& sensor = *sensors_[i];
+		uint64 timestamp = start_ + sensor.phase + basic_cast<uint64>(sensor.nFrames)*COMPARISON_FRAME_PERIOD;
+
+		float32 seconds = Clock::toSeconds(timestamp - start_);
+		float32 measurements[KINECT_SKELETON_JOINT_COUNT][3];
+		bool validity[KINECT_SKELETON_JOINT_COUNT];
+		getTruth(seconds, moving_, measurements);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			validity[j] = !isOccluded(i, seconds, j);
+			for (uint32 a = 0; a < 3; a++) measurements[j][a] += sensor.bias[a] + COMPARISON_NOISE*getNoise(i, sensor.nFrames, j, a);
+
+			// The baseline weighs each joint by how long it has been tracked
+			if (!validity[j]) sensor.validSince[j] = 0;
+			else if (!sensor.validSince[j]) sensor.validSince[j] = timestamp;
+		}
+
+		// The baseline path, smoothed on the sensor and averaged as it comes
+		sensor.transformSmooth.filter(measurements, validity, sensor.averaged);
+
+		// The tracked path, smoothed on the sensor like KinectDevice does and kept for interpolation
+		SensorFrame& frame = sensor.history[sensor.nFrames%COMPARISON_HISTORY];
+		frame.timestamp = timestamp;
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			if (validity[j]) sensor.smoothing.set(0, j, Point(measurements[j][0], measurements[j][1], measurements[j][2]));
+		sensor.smoothing.filter(timestamp);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			Point position = (sensor.smoothing.isValid(0, j))?sensor.smoothing.getPosition(0, j):Point(measurements[j][0], measurements[j][1], measurements[j][2]);
+			frame.joints[j][0] = position.x;
+			frame.joints[j][1] = position.y;
+			frame.joints[j][2] = position.z;
+			frame.validity[j] = validity[j];
+		}
+		sensor.nFrames++;
+	}
+
+public:
+	ComparisonSource(uint32 nSensors, bool moving) : nSensors_(nSensors), moving_(moving), start_(Clock::getTime())
+	{
+		for (uint32 i = 0; i < nSensors_; i++)
+		{
+			Sensor* sensor = new Sensor();
+			sensor->phase = Clock::fromMilliseconds((i*7)%33);
+			for (uint32 a = 0; a < 3; a++) sensor->bias[a] = COMPARISON_BIAS*getNoise(i, 0xFFFFFFFF, 0, a);
+			sensor->nFrames = 0;
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++) sensor->validSince[j] = 0;
+			sensor->smoothing.setParameters(Config::jointSmoothing.minCutoff, Config::jointSmoothing.beta, Config::jointSmoothing.derivativeCutoff);
+			sensors_.push_back(sensor);
+		}
+	}
+
+	~ComparisonSource()
+	{
+		for (uint32 i = 0; i < nSensors_; i++) delete sensors_[i];
+	}
+
+	uint64 getStart()
+	{
+		return start_;
+	}
+
+	// Captures every frame due by the given time, in capture order
+	void advance(uint64 time)
+	{
+		for (uint32 i = 0; i < nSensors_; i++)
+			while (start_ + sensors_[i]->phase + basic_cast<uint64>(sensors_[i]->nFrames)*COMPARISON_FRAME_PERIOD <= time) capture(i);
+	}
+
+	// The latest frame of every sensor, each joint weighted by the time it has been tracked and by the sensor confidence
+	bool getAverage(uint64 time, float32 joints[KINECT_SKELETON_JOINT_COUNT][3])
+	{
+		float32 weights[KINECT_SKELETON_JOINT_COUNT];
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			weights[j] = 0.0f;
+			for (uint32 a = 0; a < 3; a++) joints[j][a] = 0.0f;
+		}
+
+		for (uint32 i = 0; i < nSensors_; i++)
+		{
+			const Sensor& sensor = *sensors_[i];
+			float32 confidence = 0.0f;
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+				if (sensor.validSince[j]) confidence += Clock::toSeconds(time - sensor.validSince[j]);
+
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			{
+				if (!sensor.validSince[j]) continue;
+
+				float32 weight = Clock::toSeconds(time - sensor.validSince[j])*(1.0f + confidence);
+				weights[j] += weight;
+				for (uint32 a = 0; a < 3; a++) joints[j][a] += weight*sensor.averaged[j][a];
+			}
+		}
+
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			if (weights[j] <= 0.0f) return false;
+			for (uint32 a = 0; a < 3; a++) joints[j][a] /= weights[j];
+		}
+		return true;
+	}
+
+	uint8* getKColorFrame(int32 deviceIdx) { return 0; }
+	uint8* getKDepthFrame(int32 deviceIdx) { return 0; }
+
+	bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		nSkeletons = 0;
+		return false;
+	}
+
+	void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		// Interpolated between the two kept frames around the timestamp, like RenderSystem::readSkeletonsFrameAt()
+		const Sensor& sensor = *sensors_[deviceIdx];
+		nSkeletons = 0;
+		if (!sensor.nFrames) return;
+
+		uint32 newest = sensor.nFrames - 1;
+		uint32 oldest = (sensor.nFrames > COMPARISON_HISTORY)?sensor.nFrames - COMPARISON_HISTORY:0;
+		uint32 after = newest;
+		while (after > oldest && sensor.history[(after - 1)%COMPARISON_HISTORY].timestamp >= timestamp) after--;
+		const SensorFrame& frame2 = sensor.history[after%COMPARISON_HISTORY];
+		const SensorFrame& frame1 = sensor.history[((after > oldest)?after - 1:after)%COMPARISON_HISTORY];
+
+		float32 alpha = 1.0f;
+		if (frame2.timestamp > frame1.timestamp && timestamp < frame2.timestamp)
+			alpha = basic_cast<float32>(basic_cast<float64>(timestamp - frame1.timestamp)/basic_cast<float64>(frame2.timestamp - frame1.timestamp));
+
+		KinectSkeleton& skeleton = skeletons[nSkeletons++];
+		skeleton = KinectSkeleton();
+		skeleton.setPlayerIndex(1);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			// A joint tracked on one side only is taken from the nearest frame, as interpolateSkeletonsFrames() does
+			if (!frame1.validity[j] || !frame2.validity[j])
+			{
+				const SensorFrame& nearest = (alpha >= 0.5f)?frame2:frame1;
+				if (nearest.validity[j]) skeleton.setJoint(basic_cast<KinectSkeleton::KinectJoint>(j), Point(nearest.joints[j][0], nearest.joints[j][1], nearest.joints[j][2]), Quaternion(0.0f, 0.0f, 0.0f));
+				continue;
+			}
+
+			Point position(
+				frame1.joints[j][0] + alpha*(frame2.joints[j][0] - frame1.joints[j][0]),
+				frame1.joints[j][1] + alpha*(frame2.joints[j][1] - frame1.joints[j][1]),
+				frame1.joints[j][2] + alpha*(frame2.joints[j][2] - frame1.joints[j][2]));
+			skeleton.setJoint(basic_cast<KinectSkeleton::KinectJoint>(j), position, Quaternion(0.0f, 0.0f, 0.0f));
+		}
+	}
+
+	uint32 getKFrameID(int32 deviceIdx)
+	{
+		return sensors_[deviceIdx]->nFrames;
+	}
+
+	bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+	{
+		const Sensor& sensor = *sensors_[deviceIdx];
+		if (!sensor.nFrames) return false;
+
+		timestamp = sensor.history[(sensor.nFrames - 1)%COMPARISON_HISTORY].timestamp;
+		return true;
+	}
+
+	float32 getKMeasurementNoise(int32 deviceIdx)
+	{
+		return Config::DEFAULT_KINECT_MEASUREMENT_NOISE;
+	}
+
+	bool isKHierarchicalOri(int32 deviceIdx)
+	{
+		return false;
+	}
+};
+
+struct Outputs
+{
+	std::vector<float64> times;
+	std::vector<float32> baseline;
+	std::vector<float32> fusion;
+};
+
+// Both outputs of every render tick after the warm up, joints flattened
+static void run(uint32 nSensors, uint32 seconds, bool moving, Outputs& outputs)
+{
+	ComparisonSource source(nSensors, moving);
+	SkeletonFusion fusion;
+	SkeletonFusion::FusedFrame frame;
+
+	uint32 nTicks = seconds*1000/COMPARISON_RENDER_TICK;
+	uint32 nWarmupTicks = COMPARISON_WARMUP*1000/COMPARISON_RENDER_TICK;
+	for (uint32 t = 0; t < nTicks; t++)
+	{
+		uint64 time = source.getStart() + Clock::fromMilliseconds((t + 1)*COMPARISON_RENDER_TICK);
+		source.advance(time);
+		fusion.update(&source, nSensors);
+		fusion.getFrame(frame);
+
+		// Ticks where either output misses a joint are left out of both
+		float32 averaged[KINECT_SKELETON_JOINT_COUNT][3];
+		if (t < nWarmupTicks || !source.getAverage(time, averaged) || frame.nSkeletons != 1) continue;
+		bool complete = true;
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			if (!frame.skeletons[0].getJointValidity(basic_cast<KinectSkeleton::KinectJoint>(j))) complete = false;
+		if (!complete) continue;
+
+		outputs.times.push_back(Clock::toSeconds(time - source.getStart()));
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			Point position = frame.skeletons[0].getJointPosition(basic_cast<KinectSkeleton::KinectJoint>(j));
+			outputs.fusion.push_back(position.x);
+			outputs.fusion.push_back(position.y);
+			outputs.fusion.push_back(position.z);
+			for (uint32 a = 0; a < 3; a++) outputs.baseline.push_back(averaged[j][a]);
+		}
+	}
+}
+
+// Root mean square distance of every joint to its own mean, in millimeters
+static float64 getJitter(const std::vector<float32>& positions)
+{
+	uint32 nSamples = basic_cast<uint32>(positions.size()/(KINECT_SKELETON_JOINT_COUNT*3));
+	if (!nSamples) return 0.0;
+
+	float64 sum = 0.0;
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT*3; j++)
+	{
+		float64 mean = 0.0;
+		for (uint32 s = 0; s < nSamples; s++) mean += positions[s*KINECT_SKELETON_JOINT_COUNT*3 + j];
+		mean /= nSamples;
+		for (uint32 s = 0; s < nSamples; s++)
+		{
+			float64 deviation = positions[s*KINECT_SKELETON_JOINT_COUNT*3 + j] - mean;
+			sum += deviation*deviation;
+		}
+	}
+
+	return 1000.0*sqrt(sum/(nSamples*KINECT_SKELETON_JOINT_COUNT));
+}
+
+// Root mean square distance to the ground truth of lag milliseconds before, in millimeters
+static float64 getError(const std::vector<float64>& times, const std::vector<float32>& positions, uint32 lag)
+{
+	uint32 nSamples = basic_cast<uint32>(times.size());
+	if (!nSamples) return 0.0;
+
+	float64 sum = 0.0;
+	for (uint32 s = 0; s < nSamples; s++)
+	{
+		float32 truth[KINECT_SKELETON_JOINT_COUNT][3];
+		getTruth(times[s] - 0.001*lag, true, truth);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			for (uint32 a = 0; a < 3; a++)
+			{
+				float64 difference = positions[(s*KINECT_SKELETON_JOINT_COUNT + j)*3 + a] - truth[j][a];
+				sum += difference*difference;
+			}
+		}
+	}
+
+	return 1000.0*sqrt(sum/(nSamples*KINECT_SKELETON_JOINT_COUNT));
+}
+
+static uint32 getLatency(const std::vector<float64>& times, const std::vector<float32>& positions)
+{
+	uint32 bestLag = 0;
+	float64 bestError = getError(times, positions, 0);
+	for (uint32 lag = 1; lag <= COMPARISON_MAX_LAG; lag++)
+	{
+		float64 error = getError(times, positions, lag);
+		if (error < bestError)
+		{
+			bestLag = lag;
+			bestError = error;
+		}
+	}
+
+	return bestLag;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 nSensors = 4;
+	uint32 seconds = 20;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-D") == 0)	nSensors = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-S") == 0)	seconds = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (nSensors < 1) nSensors = 1;
+	if (nSensors > COMPARISON_MAX_SENSORS) nSensors = COMPARISON_MAX_SENSORS;
+	if (seconds < COMPARISON_WARMUP + 1) seconds = COMPARISON_WARMUP + 1;
+
+	Clock::initialize();
+	Outputs standing, walking;
+	run(nSensors, seconds, false, standing);
+	run(nSensors, seconds, true, walking);
+	if (standing.times.empty() || walking.times.empty())
+	{
+		std::printf("Fusion did not output a single skeleton\nFAILED\n");
+		return 1;
+	}
+
+	float64 baselineJitter = getJitter(standing.baseline);
+	float64 fusionJitter = getJitter(standing.fusion);
+	uint32 baselineLatency = getLatency(walking.times, walking.baseline);
+	uint32 fusionLatency = getLatency(walking.times, walking.fusion);
+	float64 baselineError = getError(walking.times, walking.baseline, 0);
+	float64 fusionError = getError(walking.times, walking.fusion, 0);
+
+	std::printf("%u sensors, %u s per run, rendered every %u ms\n", nSensors, seconds, COMPARISON_RENDER_TICK);
+	std::printf("            Jitter      Latency     Error\n");
+	std::printf("Baseline    %5.2f mm    %3u ms      %5.1f mm\n", baselineJitter, baselineLatency, baselineError);
+	std::printf("Fusion      %5.2f mm    %3u ms      %5.1f mm\n", fusionJitter, fusionLatency, fusionError);
+
+	bool passed = (fusionJitter <= baselineJitter || fusionLatency <= baselineLatency);
+	if (!passed) std::printf("FAILED\n");
+	return (passed)?0:1;
+}
@@ -0,0 +1,241 @@
+/*
+** Joint orientations of Render::SkeletonFusion in both orientation modes.
+**
+** Two synthetic sensors see the same person turning slowly in place, one
+** reporting absolute orientations and the other hierarchical ones, as they
+** reach the fusion from RenderSystem::transformSkeletons(). The hierarchical
+** sensor loses sight of the left elbow every other second, so the joints
+** below it cannot be chained up to the hip center meanwhile. The person is
+** fused with averaged and with solved orientations, each time published as
+** absolute and as hierarchical orientations, and every published orientation
+** is compared with the one solved from the true pose in that mode.
+**
+**     SkeletonFusionOrientationsTest.exe [-S<seconds>]
+**
+** The exit code is 0 when every orientation matches in all four runs.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Kinect/BoneOrientationSolver.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Render/RenderSystem.h"
+#include "Render/SkeletonFusion.h"
+#include "Tools/Clock.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+#define TEST_FRAME_PERIOD	33333333	/* Nanoseconds, 30 Hz */
+#define TEST_SENSOR_PHASE	10000000	/* Nanoseconds */
+#define TEST_TURN_RATE		0.3f		/* Radians per second */
+#define TEST_WARMUP_FRAMES	30
+#define TEST_TOLERANCE		3.0f		/* Degrees */
+
+// A standing pose in meters, relative to the point between the feet, in KinectJoint order
+static const float32 pose[KINECT_SKELETON_JOINT_COUNT][3] =
+{
+	{ 0.00f, 1.65f, 0.00f},	// K_HEAD
+	{-0.18f, 1.42f, 0.00f},	// K_SHOULDER_LEFT
+	{ 0.00f, 1.45f, 0.00f},	// K_SHOULDER_CENTER
+	{ 0.18f, 1.42f, 0.00f},	// K_SHOULDER_RIGHT
+	{-0.25f, 1.15f, 0.02f},	// K_ELBOW_LEFT
+	{ 0.25f, 1.15f, 0.02f},	// K_ELBOW_RIGHT
+	{-0.27f, 0.90f, 0.05f},	// K_WRIST_LEFT
+	{ 0.27f, 0.90f, 0.05f},	// K_WRIST_RIGHT
+	{-0.28f, 0.82f, 0.06f},	// K_HAND_LEFT
+	{ 0.28f, 0.82f, 0.06f},	// K_HAND_RIGHT
+	{ 0.00f, 1.10f, 0.00f},	// K_SPINE
+	{-0.10f, 0.92f, 0.00f},	// K_HIP_LEFT
+	{ 0.00f, 0.95f, 0.00f},	// K_HIP_CENTER
+	{ 0.10f, 0.92f, 0.00f},	// K_HIP_RIGHT
+	{-0.11f, 0.50f, 0.02f},	// K_KNEE_LEFT
+	{ 0.11f, 0.50f, 0.02f},	// K_KNEE_RIGHT
+	{-0.12f, 0.08f, 0.00f},	// K_ANKLE_LEFT
+	{ 0.12f, 0.08f, 0.00f},	// K_ANKLE_RIGHT
+	{-0.12f, 0.02f, 0.08f},	// K_FOOT_LEFT
+	{ 0.12f, 0.02f, 0.08f}	// K_FOOT_RIGHT
+};
+
+// The absolute orientations of the sensors are turned half a circle from the solver's
+static const Quaternion facing(0.0f, PI32, 0.0f);
+
+// True joint positions and orientations, the person turning in place 2.5 meters away
+static void getTruth(uint64 time, Point* joints, Quaternion* absolute, Quaternion* hierarchical)
+{
+	float32 angle = TEST_TURN_RATE*Clock::toSeconds(time);
+	float32 c = cosf(angle);
+	float32 s = sinf(angle);
+	bool validity[KINECT_SKELETON_JOINT_COUNT];
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		joints[j] = Point(c*pose[j][0] + s*pose[j][2], pose[j][1], 2.5f - s*pose[j][0] + c*pose[j][2]);
+		validity[j] = true;
+	}
+	BoneOrientationSolver::solve(joints, validity, 1, absolute, hierarchical);
+}
+
+class OrientationsSource : public RenderSystem
+{
+private:
+	uint32 frameID_;
+	uint64 time_;
+
+public:
+	OrientationsSource() : frameID_(0), time_(Clock::fromMilliseconds(1000)) {}
+
+	void step()
+	{
+		time_ += TEST_FRAME_PERIOD;
+		frameID_++;
+	}
+
+	uint64 getTime()
+	{
+		return time_;
+	}
+
+	// Sensor 1 loses the left elbow every other second
+	bool isElbowHidden(uint64 timestamp)
+	{
+		return basic_cast<uint32>(Clock::toSeconds(timestamp))%2 == 1;
+	}
+
+	uint8* getKColorFrame(int32 deviceIdx) { return 0; }
+	uint8* getKDepthFrame(int32 deviceIdx) { return 0; }
+
+	bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		nSkeletons = 0;
+		return false;
+	}
+
+	void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		Point joints[KINECT_SKELETON_JOINT_COUNT];
+		Quaternion absolute[KINECT_SKELETON_JOINT_COUNT];
+		Quaternion hierarchical[KINECT_SKELETON_JOINT_COUNT];
+		getTruth(timestamp, joints, absolute, hierarchical);
+
+		nSkeletons = 1;
+		skeletons[0] = KinectSkeleton();
+		skeletons[0].setPlayerIndex(1);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			if (!isKHierarchicalOri(deviceIdx)) skeletons[0].setJoint(joint, joints[j], absolute[j]*facing);
+			else if (joint != KinectSkeleton::K_ELBOW_LEFT || !isElbowHidden(timestamp)) skeletons[0].setJoint(joint, joints[j], hierarchical[j]);
+		}
+	}
+
+	uint32 getKFrameID(int32 deviceIdx)
+	{
+		return frameID_;
+	}
+
+	bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+	{
+		timestamp = time_ - basic_cast<uint64>(deviceIdx)*TEST_SENSOR_PHASE;
+		return true;
+	}
+
+	bool isKDeviceLive(int32 deviceIdx)
+	{
+		return true;
+	}
+
+	float32 getKMeasurementNoise(int32 deviceIdx)
+	{
+		return Config::DEFAULT_KINECT_MEASUREMENT_NOISE;
+	}
+
+	bool isKHierarchicalOri(int32 deviceIdx)
+	{
+		return deviceIdx == 1;
+	}
+};
+
+// Fuses the person for the given time and counts the published orientations off the truth
+static bool run(bool solve, bool hierarchical, uint32 nFrames)
+{
+	Config::fusion.solveOrientations = solve;
+	Config::fusion.hierarchicalOri = hierarchical;
+
+	OrientationsSource source;
+	SkeletonFusion fusion;
+	SkeletonFusion::FusedFrame frame;
+	float32 minDot = cosf(DEG2RAD32(TEST_TOLERANCE)*0.5f);
+	uint32 nChecked = 0;
+	uint32 nWrong = 0;
+	uint32 nHiddenChecked = 0;
+	float32 worst = 0.0f;
+	for (uint32 f = 0; f < TEST_WARMUP_FRAMES + nFrames; f++)
+	{
+		source.step();
+		if (!fusion.update(&source, 2) || f < TEST_WARMUP_FRAMES) continue;
+
+		fusion.getFrame(frame);
+		if (frame.nSkeletons != 1)
+		{
+			nWrong++;
+			continue;
+		}
+
+		Point joints[KINECT_SKELETON_JOINT_COUNT];
+		Quaternion absolute[KINECT_SKELETON_JOINT_COUNT];
+		Quaternion expected[KINECT_SKELETON_JOINT_COUNT];
+		getTruth(frame.timestamp, joints, absolute, expected);
+		if (!hierarchical)
+		{
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++) expected[j] = absolute[j]*facing;
+		}
+
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			if (!frame.skeletons[0].getJointValidity(joint)) continue;
+
+			float32 dot = std::fabs(frame.skeletons[0].getJointOrientationQuaternion(joint).dot(expected[j]));
+			float32 angle = RAD2DEG32(2.0f*acosf((dot < 1.0f)?dot:1.0f));
+			if (angle > worst) worst = angle;
+			if (dot < minDot) nWrong++;
+			nChecked++;
+			if (joint == KinectSkeleton::K_HAND_LEFT && source.isElbowHidden(frame.timestamp)) nHiddenChecked++;
+		}
+	}
+
+	std::printf("%s orientations, %s: %u checked, %u wrong, worst %.2f degrees\n",
+		(solve)?"Solved":"Averaged", (hierarchical)?"hierarchical":"absolute", nChecked, nWrong, worst);
+	return nChecked > 0 && nHiddenChecked > 0 && nWrong == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32 seconds = 10;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg.find("-S") == 0) seconds = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+	}
+	if (seconds < 2) seconds = 2;
+
+	Clock::initialize();
+	uint32 nFrames = seconds*30;
+	bool passed = true;
+	passed = run(false, false, nFrames) && passed;
+	passed = run(false, true, nFrames) && passed;
+	passed = run(true, false, nFrames) && passed;
+	passed = run(true, true, nFrames) && passed;
+
+	if (!passed) std::printf("FAILED\n");
+	return (passed)?0:1;
+}
@@ -0,0 +1,380 @@
+/*
+** Prediction error against latency of Render::SkeletonPredictor, replayed
+** from recorded sessions.
+**
+** The skeleton records of every recording are replayed in capture order,
+** smoothed like KinectDevice does, placed in the room with the calibration
+** of their device and fused through SkeletonFusion::update() after each one.
+** Predictions made from every fused frame are scored at every horizon
+** against the later estimates of the same track, along with the error of
+** sending the estimate as is. Nothing depends on the wall clock, so the same
+** recordings and configuration always give the same numbers.
+**
+**     SkeletonPredictorEvaluation.exe [-C<config>] [-H<max horizon>] [-S<step>] [-d<damping>] <recording>...
+**
+** Horizons are in milliseconds, 10 to 100 by default. The damping defaults
+** to that of the first local VRPN skeleton. Whether predicting pays off
+** depends on how much people move in the recordings, so the exit code is 0
+** whenever there was something to score.
+*/
+
+#include "Globals/Include.h"
+#include "Globals/Config.h"
+#include "Geom/Matrix4x4.h"
+#include "Kinect/KinectDevice.h"
+#include "Kinect/KinectRecording.h"
+#include "Kinect/KinectRecordingReader.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Render/RenderSystem.h"
+#include "Render/SkeletonFusion.h"
+#include "Render/SkeletonPredictor.h"
+#include "Tools/Clock.h"
+#include "Tools/JointOneEuroFilter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include <NuiApi.h>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+#define EVALUATION_MAX_DEVICES		16
+#define EVALUATION_MAX_HORIZON		100		/* Milliseconds */
+#define EVALUATION_HORIZON_STEP		10		/* Milliseconds */
+
+// KinectSkeleton joint of every NUI_SKELETON_POSITION_INDEX, as in KinectDevice
+static const KinectSkeleton::KinectJoint nuiJoints[KINECT_SKELETON_JOINT_COUNT] =
+{
+	KinectSkeleton::K_HIP_CENTER,
+	KinectSkeleton::K_SPINE,
+	KinectSkeleton::K_SHOULDER_CENTER,
+	KinectSkeleton::K_HEAD,
+	KinectSkeleton::K_SHOULDER_LEFT,
+	KinectSkeleton::K_ELBOW_LEFT,
+	KinectSkeleton::K_WRIST_LEFT,
+	KinectSkeleton::K_HAND_LEFT,
+	KinectSkeleton::K_SHOULDER_RIGHT,
+	KinectSkeleton::K_ELBOW_RIGHT,
+	KinectSkeleton::K_WRIST_RIGHT,
+	KinectSkeleton::K_HAND_RIGHT,
+	KinectSkeleton::K_HIP_LEFT,
+	KinectSkeleton::K_KNEE_LEFT,
+	KinectSkeleton::K_ANKLE_LEFT,
+	KinectSkeleton::K_FOOT_LEFT,
+	KinectSkeleton::K_HIP_RIGHT,
+	KinectSkeleton::K_KNEE_RIGHT,
+	KinectSkeleton::K_ANKLE_RIGHT,
+	KinectSkeleton::K_FOOT_RIGHT
+};
+
+class ReplayFusionSource : public RenderSystem
+{
+private:
+	struct Device
+	{
+		KinectRecordingReader*			reader;
+		std::string						deviceID;
+		uint32							nextRecord;
+		Matrix4x4						matrix;
+		JointOneEuroFilter*				smoothing;
+		bool							tracked[KINECT_SKELETON_COUNT];
+		uint32							frameID;
+		KinectDevice::SkeletonsFrame	frame;
+	};
+
+	std::vector<Device> devices_;
+
+	bool nextSkeletonRecord(Device& device)
+	{
+		while (device.nextRecord < device.reader->getNumberOfRecords())
+		{
+			const KinectRecording::IndexEntry& entry = device.reader->getEntry(device.nextRecord);
+			if (entry.type == KinectRecording::K_RECORD_SKELETON && entry.size == sizeof(NUI_SKELETON_FRAME)) return true;
+			device.nextRecord++;
+		}
+		return false;
+	}
+
+	void deliver(Device& device, NUI_SKELETON_FRAME& skeletonFrame, uint64 timestamp)
+	{
+		if (device.smoothing)
+		{
+			// Same filter slots as KinectDevice::smoothSkeletons(), reset when a sensor slot starts tracking
+			for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+			{
+				bool tracked = (skeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED);
+				if (tracked && !device.tracked[i]) device.smoothing->reset(i);
+				device.tracked[i] = tracked;
+				if (!tracked) continue;
+
+				for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+				{
+					if (skeletonFrame.SkeletonData[i].eSkeletonPositionTrackingState[j] != NUI_SKELETON_POSITION_NOT_TRACKED)
+					{
+						const Vector4& position = skeletonFrame.SkeletonData[i].SkeletonPositions[j];
+						device.smoothing->set(i, j, Point(position.x, position.y, position.z));
+					}
+				}
+			}
+			device.smoothing->filter(timestamp);
+		}
+
+		// Orientations are left to the fusion, only positions are scored
+		KinectDevice::SkeletonsFrame& frame = device.frame;
+		frame.timestamp = timestamp;
+		frame.nSkeletons = 0;
+		for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+		{
+			if (skeletonFrame.SkeletonData[i].eTrackingState != NUI_SKELETON_TRACKED) continue;
+
+			KinectSkeleton& skeleton = frame.skeletons[frame.nSkeletons];
+			skeleton = KinectSkeleton();
+			skeleton.setPlayerIndex(frame.nSkeletons + 1);
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			{
+				if (skeletonFrame.SkeletonData[i].eSkeletonPositionTrackingState[j] != NUI_SKELETON_POSITION_TRACKED) continue;
+
+				const Vector4& measured = skeletonFrame.SkeletonData[i].SkeletonPositions[j];
+				Point position(measured.x, measured.y, measured.z);
+				if (device.smoothing && device.smoothing->isValid(i, j)) position = device.smoothing->getPosition(i, j);
+				skeleton.setJoint(nuiJoints[j], device.matrix*position, Quaternion(0.0f, 0.0f, 0.0f));
+			}
+			frame.trackingIDs[frame.nSkeletons] = skeletonFrame.SkeletonData[i].dwTrackingID;
+			frame.nSkeletons++;
+		}
+		device.frameID++;
+	}
+
+public:
+	ReplayFusionSource() {}
+
+	virtual ~ReplayFusionSource()
+	{
+		for (uint32 i = 0; i < devices_.size(); i++)
+		{
+			delete devices_[i].reader;
+			if (devices_[i].smoothing) delete devices_[i].smoothing;
+		}
+	}
+
+	bool open(const std::string& filename)
+	{
+		Device device;
+		device.reader = new KinectRecordingReader();
+		if (!device.reader->open(filename))
+		{
+			delete device.reader;
+			return false;
+		}
+
+		// Placed like KinectDevice places a live sensor: tilt from the elevation angle, the rest from the configuration
+		const KinectRecording::FileHeader& header = device.reader->getHeader();
+		device.deviceID = std::string(header.deviceID);
+		const Config::KinectSettings& settings = Config::kinect[device.deviceID];
+		Matrix4x4 mRotationX = Matrix4x4().setRotation(DEG2RAD32(basic_cast<float32>(-header.elevationAngle)), Matrix4x4::X_AXIS);
+		Matrix4x4 mRotationY = Matrix4x4().setRotation(settings.rotation.y, Matrix4x4::Y_AXIS);
+		Matrix4x4 mRotationZ = Matrix4x4().setRotation(settings.rotation.z, Matrix4x4::Z_AXIS);
+		Matrix4x4 mTranslation = Matrix4x4().setTranslation(settings.translation);
+		device.matrix = mTranslation*mRotationZ*mRotationY*mRotationX;
+
+		device.nextRecord = 0;
+		device.smoothing = 0;
+		if (Config::jointSmoothing.stage == Config::SMOOTHING_SENSORS)
+		{
+			device.smoothing = new JointOneEuroFilter();
+			device.smoothing->setParameters(Config::jointSmoothing.minCutoff, Config::jointSmoothing.beta, Config::jointSmoothing.derivativeCutoff);
+		}
+		for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++) device.tracked[i] = false;
+		device.frameID = 0;
+		devices_.push_back(device);
+		return true;
+	}
+
+	uint32 getNumberOfDevices()
+	{
+		return basic_cast<uint32>(devices_.size());
+	}
+
+	// Delivers the next skeleton record of any recording in capture order, false once all of them are over
+	bool step()
+	{
+		int32 next = -1;
+		uint64 nextTime = 0;
+		for (uint32 i = 0; i < devices_.size(); i++)
+		{
+			if (!nextSkeletonRecord(devices_[i])) continue;
+			uint64 timestamp = devices_[i].reader->getEntry(devices_[i].nextRecord).timestamp;
+			if (next == -1 || timestamp < nextTime)
+			{
+				next = basic_cast<int32>(i);
+				nextTime = timestamp;
+			}
+		}
+		if (next == -1) return false;
+
+		Device& device = devices_[next];
+		NUI_SKELETON_FRAME skeletonFrame;
+		std::memcpy(&skeletonFrame, device.reader->getPayload(device.nextRecord), sizeof(NUI_SKELETON_FRAME));
+		device.nextRecord++;
+		deliver(device, skeletonFrame, nextTime);
+		return true;
+	}
+
+	uint8* getKColorFrame(int32 deviceIdx) { return 0; }
+	uint8* getKDepthFrame(int32 deviceIdx) { return 0; }
+
+	bool getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		nSkeletons = 0;
+		if (deviceIdx < 0 || deviceIdx >= basic_cast<int32>(devices_.size()) || !devices_[deviceIdx].frameID) return false;
+
+		const KinectDevice::SkeletonsFrame& frame = devices_[deviceIdx].frame;
+		nSkeletons = frame.nSkeletons;
+		for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = frame.skeletons[i];
+		return true;
+	}
+
+	bool getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
+	{
+		if (deviceIdx < 0 || deviceIdx >= basic_cast<int32>(devices_.size()))
+		{
+			kinectMatrix.setIdentity();
+			return false;
+		}
+		kinectMatrix = devices_[deviceIdx].matrix;
+		return true;
+	}
+
+	void getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+	{
+		// Frames are placed in the room as they are delivered, and fusion only asks for the latest one
+		getKSkeletons(nSkeletons, skeletons, deviceIdx);
+	}
+
+	uint32 getKFrameID(int32 deviceIdx)
+	{
+		return devices_[deviceIdx].frameID;
+	}
+
+	bool getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+	{
+		if (!devices_[deviceIdx].frameID) return false;
+		timestamp = devices_[deviceIdx].frame.timestamp;
+		return true;
+	}
+
+	float32 getKMeasurementNoise(int32 deviceIdx)
+	{
+		return Config::kinect[devices_[deviceIdx].deviceID].measurementNoise;
+	}
+
+	bool isKHierarchicalOri(int32 deviceIdx)
+	{
+		return false;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	std::string configFile = "";
+	uint32 maxHorizon = EVALUATION_MAX_HORIZON;
+	uint32 step = EVALUATION_HORIZON_STEP;
+	float32 damping = Config::DEFAULT_VRPN_PREDICTION_DAMPING;
+	bool hasDamping = false;
+	std::vector<std::string> recordings;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if		(arg.find("-C") == 0)	configFile = arg.substr(2);
+		else if	(arg.find("-H") == 0)	maxHorizon = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-S") == 0)	step = basic_cast<uint32>(std::atoi(arg.substr(2).c_str()));
+		else if	(arg.find("-d") == 0)
+		{
+			damping = basic_cast<float32>(std::atof(arg.substr(2).c_str()));
+			hasDamping = true;
+		}
+		else recordings.push_back(arg);
+	}
+	if (step < 1) step = 1;
+	if (maxHorizon < step) maxHorizon = step;
+	if (recordings.empty() || recordings.size() > EVALUATION_MAX_DEVICES)
+	{
+		std::printf("Usage: SkeletonPredictorEvaluation [-C<config>] [-H<max horizon>] [-S<step>] [-d<damping>] <recording>...\n");
+		return 1;
+	}
+
+	Clock::initialize();
+	Config::initialize();
+	if (configFile != "") Config::load(configFile);
+	if (!hasDamping) damping = Config::localVRPNSkeletons[0].predictionDamping;
+
+	ReplayFusionSource source;
+	for (uint32 i = 0; i < recordings.size(); i++)
+	{
+		if (!source.open(recordings[i]))
+		{
+			std::printf("Unable to open %s\nFAILED\n", recordings[i].c_str());
+			return 1;
+		}
+	}
+
+	std::vector<SkeletonPredictor::HorizonError> errors;
+	for (uint32 horizon = step; horizon <= maxHorizon; horizon += step) errors.push_back(SkeletonPredictor::HorizonError(horizon));
+
+	// A fused frame is scored once the history reaches the longest horizon past it
+	SkeletonFusion fusion;
+	SkeletonFusion::FusedFrame frame;
+	std::deque<SkeletonFusion::FusedFrame> history;
+	uint64 window = Clock::fromMilliseconds(maxHorizon);
+	uint32 nRecords = 0;
+	uint32 nFused = 0;
+	while (source.step())
+	{
+		nRecords++;
+		if (!fusion.update(&source, source.getNumberOfDevices())) continue;
+		fusion.getFrame(frame);
+		history.push_back(frame);
+		nFused++;
+		while (history.back().timestamp >= history.front().timestamp + window)
+		{
+			SkeletonPredictor::evaluateHistory(history, 0, damping, errors);
+			history.pop_front();
+		}
+	}
+	while (!history.empty())
+	{
+		SkeletonPredictor::evaluateHistory(history, 0, damping, errors);
+		history.pop_front();
+	}
+
+	std::printf("%u recordings, %u skeleton frames, %u fused frames, damping %.2f\n", basic_cast<uint32>(recordings.size()), nRecords, nFused, damping);
+	std::printf("Horizon     Predicted    Held         Samples\n");
+	for (uint32 i = 0; i < errors.size(); i++)
+	{
+		if (!errors[i].nSamples) continue;
+		std::printf("%4u ms     %6.1f mm    %6.1f mm    %u\n",
+			errors[i].horizon,
+			errors[i].predictedErrorSum*1000.0/errors[i].nSamples,
+			errors[i].heldErrorSum*1000.0/errors[i].nSamples,
+			errors[i].nSamples);
+	}
+
+	// Longest horizon up to which every prediction is closer than the held estimate
+	uint32 useful = 0;
+	for (uint32 i = 0; i < errors.size() && errors[i].nSamples && errors[i].predictedErrorSum < errors[i].heldErrorSum; i++) useful = errors[i].horizon;
+	if (useful) std::printf("Prediction pays off up to %u ms\n", useful);
+	else std::printf("Prediction does not pay off at any horizon\n");
+
+	bool passed = (errors[0].nSamples > 0);
+	if (!passed) std::printf("Nothing to score\nFAILED\n");
+	return (passed)?0:1;
+}
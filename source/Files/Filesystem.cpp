@@ -80,6 +80,26 @@ void Filesystem::createDirectory(const std::string& path)
 	}
 }
 
+std::vector<std::string> Filesystem::listFiles(const std::string& path, const std::string& extension)
+{
+	std::vector<std::string> files;
+
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((path + "/*." + extension).c_str(), &findData);
+	if (findHandle != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				files.push_back(path + "/" + findData.cFileName);
+		}
+		while (FindNextFileA(findHandle, &findData));
+		FindClose(findHandle);
+	}
+
+	return files;
+}
+
 std::string Filesystem::getLocalDataPath()
 {
 	TCHAR localAppDataPath[MAX_PATH];
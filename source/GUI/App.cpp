@@ -28,7 +28,9 @@
 #include "Kinect/KinectDevice.h"
 #include "Kinect/KinectManager.h"
 #include "Interprocess/SharedMemoryManager.h"
+#include "Interprocess/SlaveManager.h"
 #include "Render/RenderSystem.h"
+#include "Tools/Clock.h"
 #include "Tools/Log.h"
 #include "Tools/Timer.h"
 #include "VRPN/VRPNServer.h"
@@ -51,6 +53,7 @@ bool App::OnInit()
 {
 	srand(time(0));
 	Timer::startCount("executionStart");
+	Clock::initialize();
 
 	// Parse the arguments list
 	for (int32 i = 0; i < argc; i++)
@@ -71,28 +74,40 @@ bool App::OnInit()
 		Log::initialize();
 		KinectManager::initialize();
 		SharedMemoryManager::initialize();
+		SlaveManager::initialize();
 
-		if (KinectManager::getNumberOfDevices())
+		if (Config::system.captureMode == Config::CAPTURE_THREADS)
+		{
+			// Every device is captured by a thread of this process, no slaves are needed
+			if (!KinectManager::getNumberOfDevices()) Log::write("[App] onInit()", "ERROR: There are not available devices.");
+			RenderSystem::initialize(RenderSystem::RS_MULTI_DEVICE);
+		}
+		else
 		{
-			for (uint32 i = 0; i < KinectManager::getNumberOfDevices(); i++)
+			if (KinectManager::getNumberOfDevices())
 			{
-				KinectDevice	device			=	KinectManager::getDeviceObject(i);
-				std::string		slaveDeviceID	=	KinectManager::reformatDeviceID(device.getID());
-
-				SharedMemoryManager::createSharedSegment(slaveDeviceID);
-				slavesIDs.push_back(slaveDeviceID);
-
-				std::string command = "MultiKinect.exe -LC\"" + Globals::LAST_CONFIGURATION + "\" -D" + device.getID();
-				WinExec(command.c_str(), SW_SHOW);
-
-				Log::write("[App] onInit()", "Execute: " + command);
-
-				Timer::wait(1000);
+				for (uint32 i = 0; i < KinectManager::getNumberOfDevices(); i++)
+				{
+					std::string		deviceID		=	KinectManager::getDeviceID(i);
+					std::string		slaveDeviceID	=	KinectManager::getSegmentID(i);
+
+					SharedMemoryManager::createSharedSegment(slaveDeviceID);
+					SlaveManager::addSlave(deviceID, slaveDeviceID);
+
+					// Slaves adopt the master clock epoch so every timestamp shares one timeline
+					int64* clockEpoch = SharedMemoryManager::createSharedObject<int64>(slaveDeviceID, "clockEpoch");
+					*clockEpoch = Clock::getEpoch();
+				}
+
+				// All slaves are launched at once without waiting, the supervisor follows each one until its device is ready
+				SlaveManager::startSlaves();
+				SlaveManager::startSupervisor();
 			}
+			else Log::write("[App] onInit()", "ERROR: There are not available devices.");
+
+			RenderSystem::initialize(RenderSystem::RS_INTERPROCESS);
 		}
-		else Log::write("[App] onInit()", "ERROR: There are not available devices.");
 
-		RenderSystem::initialize(RenderSystem::RS_INTERPROCESS);
 		VRPNServer::initialize();
 		break;
 
@@ -113,6 +128,10 @@ bool App::OnInit()
 		Log::initialize(KinectManager::reformatDeviceID(Globals::INSTANCE_ID));
 		KinectManager::initialize();
 		SharedMemoryManager::initialize();
+		{
+			int64* clockEpoch = SharedMemoryManager::getSharedObject<int64>(KinectManager::reformatDeviceID(Globals::INSTANCE_ID), "clockEpoch");
+			if (clockEpoch) Clock::setEpoch(*clockEpoch);
+		}
 		if (KinectManager::isValidDeviceID(Globals::INSTANCE_ID))
 			RenderSystem::initialize(RenderSystem::RS_LOCAL_DEVICE, KinectManager::getDevicePointer(Globals::INSTANCE_ID));
 		else Log::write("[App] onInit()", "ERROR: Invalid device ID.");
@@ -152,32 +171,12 @@ bool App::OnInit()
 int App::OnExit()
 {
 	// In case of KINECT_MASTER mode, it must close the slave processes
-	if (Config::system.currentMode == Config::KINECT_MASTER)
-	{
-		// Send exit message to every slave process
-		uint32 nSlaves = basic_cast<uint32>(slavesIDs.size());
-		for (uint32 i = 0; i < nSlaves; i++)
-		{
-			SharedMemoryManager::createSharedObject<bool>(slavesIDs[i], "CLOSE_SIGNAL");
-
-			// Wait for slave exit
-			bool* flag = 0;
-			Timer::startCount("timeout");
-			do flag = SharedMemoryManager::getSharedObject<bool>(slavesIDs[i], "CLOSE_SIGNAL");
-			while (flag && Timer::getCountTime("timeout") <= 1000);
-
-			if (flag)
-			{
-				SharedMemoryManager::removeSharedObject<bool>(slavesIDs[i], "CLOSE_SIGNAL");
-				std::string message = "ERROR: Exit of slave process " + slavesIDs[i] + " timeout.";
-				Log::write("[App] OnExit()", message);
-			}
-		}
-	}
+	if (SlaveManager::isInitialized()) SlaveManager::shutDownSlaves();
 
 	// Destroy the application
 	if (VRPNServer::isInitialized())			VRPNServer::destroy();
 	if (RenderSystem::isInitialized())			RenderSystem::destroy();
+	if (SlaveManager::isInitialized())			SlaveManager::destroy();
 	if (SharedMemoryManager::isInitialized())	SharedMemoryManager::destroy();
 	if (KinectManager::isInitialized())			KinectManager::destroy();
 	if (Log::isInitialized())					Log::destroy();
@@ -92,7 +92,7 @@ void KinectCanvas::OnPaint(wxPaintEvent& event)
 	{
 		uint8*			bitmap		= 0;
 		uint32			nSkeletons	= 0;
-		KinectSkeleton*	skeletons	= 0;
+		KinectSkeleton	skeletons[KINECT_SKELETON_COUNT];
 		bool			isValidData	= false;
 
 		if (type_ == COLOR_CANVAS)
@@ -107,8 +107,7 @@ void KinectCanvas::OnPaint(wxPaintEvent& event)
 		}
 		else if (type_ == SKELETON_CANVAS)
 		{
-			if (RenderSystem::isInitialized()) RenderSystem::getKinectSkeletons(nSkeletons, skeletons);
-			isValidData = skeletons != 0;
+			if (RenderSystem::isInitialized()) isValidData = RenderSystem::getKinectSkeletons(nSkeletons, skeletons);
 		}
 
 		wxBitmap bmp;
@@ -29,7 +29,7 @@
 #include "GUI/TextFileDialog.h"
 #include "Kinect/KinectDevice.h"
 #include "Kinect/KinectManager.h"
-#include "Interprocess/SharedMemoryManager.h"
+#include "Interprocess/CommandChannel.h"
 #include "Render/RenderSystem.h"
 #include "Render/RenderThread.h"
 #include "Render/RenderTimer.h"
@@ -78,12 +78,47 @@ MainFrameLogic::MainFrameLogic(wxWindow* parent) : MainFrame(parent)
 		setElevationAngle(device->getElevationAngle(), device->getMinElevationAngle(), device->getMaxElevationAngle());
 	}
 	else setElevationAngle(0, 0, 0);
+
+	// Slaves take their orders from the master through the command queue of their segment
+	commands_ = 0;
+	commandTimer_ = 0;
+	if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
+	{
+		commands_ = new CommandChannel();
+		if (commands_->open(KinectManager::reformatDeviceID(Globals::INSTANCE_ID)))
+		{
+			// Tell the master whether the device came up and with which streams
+			bool ready = RenderSystem::isInitialized() && RenderSystem::hasDevice() && RenderSystem::getDevice()->isInitialized();
+			commands_->publishState(
+				(ready)?SharedSlaveState::K_SLAVE_READY:SharedSlaveState::K_SLAVE_FAILED,
+				CommandChannel::getConfiguredStreams(Globals::INSTANCE_ID),
+				Config::canvas[Globals::INSTANCE_ID].width,
+				Config::canvas[Globals::INSTANCE_ID].height);
+
+			// Commands restart the device and touch the widgets, so they run on the GUI thread whatever the render mode
+			commandTimer_ = new wxTimer(this);
+			Connect(commandTimer_->GetId(), wxEVT_TIMER, wxTimerEventHandler(MainFrameLogic::onCommandTimer));
+			commandTimer_->Start(SLAVE_COMMAND_PERIOD);
+		}
+		else
+		{
+			delete commands_;
+			commands_ = 0;
+		}
+	}
 }
 
 MainFrameLogic::~MainFrameLogic()
 {
 	if (Config::system.renderMode == Config::IDLE_EVENTS)
 		Disconnect(wxID_ANY, wxEVT_IDLE, wxIdleEventHandler(MainFrameLogic::onIdle));
+	if (commandTimer_)
+	{
+		commandTimer_->Stop();
+		Disconnect(commandTimer_->GetId(), wxEVT_TIMER, wxTimerEventHandler(MainFrameLogic::onCommandTimer));
+		delete commandTimer_;
+	}
+	delete commands_;
 }
 
 void MainFrameLogic::setFPS()
@@ -97,6 +132,97 @@ void MainFrameLogic::setFPS()
 	statusBar_->SetStatusText(wxString(text.c_str(), wxConvUTF8), 0);
 }
 
+void MainFrameLogic::runCommands()
+{
+	SharedCommand command;
+	while (commands_->receive(command))
+	{
+		bool succeeded = true;
+		KinectDevice* device = (RenderSystem::isInitialized() && RenderSystem::hasDevice())?RenderSystem::getDevice():0;
+		switch (command.type)
+		{
+		case SharedCommand::K_COMMAND_SHUTDOWN:
+			wxPostEvent(this, wxCloseEvent(wxEVT_CLOSE_WINDOW));
+			break;
+		case SharedCommand::K_COMMAND_SET_ELEVATION:
+			if (device)
+			{
+				device->setElevationAngle(command.value);
+				setElevationAngle(device->getElevationAngle(), device->getMinElevationAngle(), device->getMaxElevationAngle());
+			}
+			else succeeded = false;
+			break;
+		case SharedCommand::K_COMMAND_SET_MODE:
+			switch (command.argument)
+			{
+			case SharedCommand::K_MODE_NEAR:
+				Config::kinect[Globals::INSTANCE_ID].nearMode = (command.value != 0);
+				if (device) device->setNearMode(Config::kinect[Globals::INSTANCE_ID].nearMode);
+				break;
+			case SharedCommand::K_MODE_SEATED:
+				Config::kinect[Globals::INSTANCE_ID].seatedMode = (command.value != 0);
+				if (device) device->setSeatedMode(Config::kinect[Globals::INSTANCE_ID].seatedMode);
+				break;
+			case SharedCommand::K_MODE_HIERARCHICAL_ORI:
+				Config::kinect[Globals::INSTANCE_ID].hierarchicalOri = (command.value != 0);
+				if (device) device->setHierarchicalOri(Config::kinect[Globals::INSTANCE_ID].hierarchicalOri);
+				break;
+			default:
+				succeeded = false;
+				break;
+			}
+			updateCanvas();
+			break;
+		case SharedCommand::K_COMMAND_SET_STREAMS:
+			succeeded = setStreams(command.value);
+			break;
+		default:
+			succeeded = false;
+			break;
+		}
+		commands_->acknowledge(command.ticket, succeeded);
+	}
+}
+
+bool MainFrameLogic::setStreams(int32 streams)
+{
+	bool rgbImage = ((streams & SharedCommand::K_STREAM_COLOR) != 0);
+	bool depthMap = ((streams & SharedCommand::K_STREAM_DEPTH) != 0);
+	bool skeletonTracking = ((streams & SharedCommand::K_STREAM_SKELETON) != 0);
+	bool rawDepth = ((streams & SharedCommand::K_STREAM_RAW_DEPTH) != 0);
+	bool playerMasks = ((streams & SharedCommand::K_STREAM_PLAYER_MASKS) != 0);
+
+	// The device is only restarted when some stream actually changes
+	Config::KinectSettings& settings = Config::kinect[Globals::INSTANCE_ID];
+	if (settings.rgbImage == rgbImage && settings.depthMap == depthMap && settings.skeletonTracking == skeletonTracking &&
+		settings.rawDepth == rawDepth && settings.playerMasks == playerMasks)
+		return true;
+
+	bool restartDevice = false;
+	if (RenderSystem::isInitialized() && RenderSystem::hasDevice())
+	{
+		restartDevice = true;
+		RenderSystem::destroy();
+	}
+	settings.rgbImage = rgbImage;
+	settings.depthMap = depthMap;
+	settings.skeletonTracking = skeletonTracking;
+	settings.rawDepth = rawDepth;
+	settings.playerMasks = playerMasks;
+	if (restartDevice) RenderSystem::initialize(RenderSystem::RS_LOCAL_DEVICE, KinectManager::getDevicePointer(Globals::INSTANCE_ID));
+	reloadCanvas();
+
+	// The master watchdog decides which frame counters to watch from the published streams
+	bool ready = RenderSystem::isInitialized() && RenderSystem::hasDevice() && RenderSystem::getDevice()->isInitialized();
+	commands_->publishState(
+		(ready)?SharedSlaveState::K_SLAVE_READY:SharedSlaveState::K_SLAVE_FAILED,
+		streams,
+		Config::canvas[Globals::INSTANCE_ID].width,
+		Config::canvas[Globals::INSTANCE_ID].height);
+
+	return ready;
+}
+
 void MainFrameLogic::onClose(wxCloseEvent& WXUNUSED(event))
 {
 	renderTimer_->stop();
@@ -128,6 +254,11 @@ void MainFrameLogic::onIdle(wxIdleEvent& event)
 	event.RequestMore();
 }
 
+void MainFrameLogic::onCommandTimer(wxTimerEvent& WXUNUSED(event))
+{
+	runCommands();
+}
+
 void MainFrameLogic::onOptionsPanel(wxCommandEvent& event)
 {
 	updateCanvas();
@@ -271,6 +402,7 @@ void MainFrameLogic::onKinectMatrix(wxCommandEvent& event)
 		if (translationXCtrl_->GetValue().ToDouble(&aux)) Config::kinect[Globals::INSTANCE_ID].translation.x = basic_cast<float32>(aux*0.01);
 		if (translationYCtrl_->GetValue().ToDouble(&aux)) Config::kinect[Globals::INSTANCE_ID].translation.y = basic_cast<float32>(aux*0.01);
 		if (translationZCtrl_->GetValue().ToDouble(&aux)) Config::kinect[Globals::INSTANCE_ID].translation.z = basic_cast<float32>(aux*0.01);
+		RenderSystem::getDevice()->reloadPose();
 	}
 }
 
@@ -288,6 +420,7 @@ void MainFrameLogic::onLoad(wxCommandEvent& event)
 	if(!filename.empty())
 	{
 		Config::load(std::string(filename.mb_str()));
+		if (RenderSystem::isInitialized() && RenderSystem::hasDevice()) RenderSystem::getDevice()->reloadPose();
 		reloadCanvas();
 	}
 }
@@ -351,17 +484,8 @@ void MainFrameLogic::onEditConfigFile(wxCommandEvent& event)
 
 void MainFrameLogic::render()
 {
-	// Check if exit message has been received
-	if (RenderSystem::isInitialized() && RenderSystem::hasDevice() && (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE))
-	{
-		std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
-		bool* flag = SharedMemoryManager::getSharedObject<bool>(segmentID, "CLOSE_SIGNAL");
-		if (flag)
-		{
-			SharedMemoryManager::removeSharedObject<bool>(segmentID, "CLOSE_SIGNAL");
-			wxPostEvent(this, wxCloseEvent(wxEVT_CLOSE_WINDOW));
-		}
-	}
+	// Tell the master watchdog this window is not hung, the commands themselves run on onCommandTimer()
+	if (commands_) commands_->beat();
 
 	if (Config::canvas[Globals::INSTANCE_ID].rgbImage) colorCanvas_->render();
 	if (Config::canvas[Globals::INSTANCE_ID].depthMap) depthCanvas_->render();
@@ -29,6 +29,7 @@
 #include "Kinect/KinectManager.h"
 #include "Kinect/KinectSkeleton.h"
 #include "Interprocess/SharedMemoryManager.h"
+#include "Interprocess/SlaveManager.h"
 #include "Render/RenderSystem.h"
 #include "Render/RenderThread.h"
 #include "Render/RenderTimer.h"
@@ -83,6 +84,19 @@ void MasterFrameLogic::setFPS()
 	std::string text = "Application FPS: " + basic_cast<std::string>(appFPS_);
 	if (VRPNServer::isInitialized())
 		text += ("   VRPN FPS: " + basic_cast<std::string>(VRPNServer::getFPS()));
+	if (SlaveManager::isInitialized())
+	{
+		// Slaves start in the background, so the window shows how many are ready until they all are
+		uint32 nSlaves = SlaveManager::getNumberOfSlaves();
+		uint32 nStarting = 0;
+		for (uint32 i = 0; i < nSlaves; i++)
+			if (SlaveManager::getLiveness(i) == SlaveManager::K_SLAVE_STARTING) nStarting++;
+		if (nStarting)
+			text += ("   Slaves ready: " + basic_cast<std::string>(nSlaves - nStarting) + "/" + basic_cast<std::string>(nSlaves));
+
+		for (uint32 i = 0; i < nSlaves; i++)
+			text += ("   " + SlaveManager::getSegmentID(i) + ": " + SlaveManager::getLivenessName(SlaveManager::getLiveness(i)));
+	}
 
 	statusBar_->SetStatusText(wxString(text.c_str(), wxConvUTF8), 0);
 }
@@ -206,6 +220,7 @@ void MasterFrameLogic::onLoad(wxCommandEvent& event)
 	if(!filename.empty())
 	{
 		Config::load(std::string(filename.mb_str()));
+		if (SlaveManager::isInitialized()) SlaveManager::sendConfiguration();
 		updateCanvas();
 	}
 }
@@ -236,6 +251,7 @@ void MasterFrameLogic::onEditConfigFile(wxCommandEvent& event)
 		wxString configFilename = wxString(Globals::LAST_CONFIGURATION.c_str(), wxConvUTF8);
 		TextFileDialog* configFrame = new TextFileDialog(configFilename, this, wxID_ANY, wxT("MultiKinect Configuration file"), false);
 		configFrame->ShowModal();
+		if (SlaveManager::isInitialized()) SlaveManager::sendConfiguration();
 		updateCanvas();
 		delete configFrame;
 	}
@@ -30,6 +30,7 @@ const std::string				Config::DEFAULT_APPDATA_PATH				=	".";
 const std::string				Config::DEFAULT_CONFIG_PATH					=	"MultiKinect/Data/config";
 const std::string				Config::DEFAULT_LOG_PATH					=	"MultiKinect/Data/log";
 const Config::RenderLoopMode	Config::DEFAULT_RENDER_LOOP_MODE			=	RENDER_TIMER;
+const Config::CaptureMode		Config::DEFAULT_CAPTURE_MODE				=	CAPTURE_PROCESSES;
 const uint32					Config::DEFAULT_CANVAS_WIDTH				=	320;
 const uint32					Config::DEFAULT_CANVAS_HEIGHT				=	240;
 const bool						Config::DEFAULT_SHOW_RGB_IMAGE				=	true;
@@ -41,6 +42,8 @@ const bool						Config::DEFAULT_COMBINE_SKELETONS			=	true;
 const bool						Config::DEFAULT_ENABLED_RGB_IMAGE			=	true;
 const bool						Config::DEFAULT_ENABLED_DEPTH_MAP			=	true;
 const bool						Config::DEFAULT_ENABLED_SKELETON_TRACKING	=	true;
+const bool						Config::DEFAULT_ENABLED_RAW_DEPTH			=	false;
+const bool						Config::DEFAULT_ENABLED_PLAYER_MASKS		=	false;
 const bool						Config::DEFAULT_ENABLED_NEAR_MODE			=	false;
 const bool						Config::DEFAULT_ENABLED_SEATED_MODE			=	false;
 const bool						Config::DEFAULT_ENABLED_HIERARCHICAL_ORI	=	false;
@@ -50,14 +53,37 @@ const float32					Config::DEFAULT_KINECT_TRANSLATION_Z		=	0.0f;
 const float32					Config::DEFAULT_KINECT_ROTATION_X			=	0.0f;
 const float32					Config::DEFAULT_KINECT_ROTATION_Y			=	0.0f;
 const float32					Config::DEFAULT_KINECT_ROTATION_Z			=	0.0f;
+const float32					Config::DEFAULT_KINECT_MEASUREMENT_NOISE	=	0.02f;
 const float32					Config::DEFAULT_ROOM_ORIGIN_X				=	0.0f;
 const float32					Config::DEFAULT_ROOM_ORIGIN_Y				=	0.0f;
 const float32					Config::DEFAULT_ROOM_ORIGIN_Z				=	0.0f;
 const float32					Config::DEFAULT_ROOM_WIDTH					=	3.0f;
 const float32					Config::DEFAULT_ROOM_HEIGHT					=	3.0f;
 const float32					Config::DEFAULT_ROOM_DEPTH					=	3.0f;
+const float32					Config::DEFAULT_FUSION_ASSOCIATION_GATE		=	0.4f;
+const uint32					Config::DEFAULT_FUSION_TRACK_TIMEOUT		=	500;
+const uint32					Config::DEFAULT_FUSION_JOINT_TIMEOUT		=	100;
+const float32					Config::DEFAULT_FUSION_PROCESS_NOISE		=	8.0f;
+const uint32					Config::DEFAULT_FUSION_ALIGNMENT_WINDOW		=	100;
+const bool						Config::DEFAULT_FUSION_SOLVE_ORIENTATIONS	=	true;
+const bool						Config::DEFAULT_FUSION_HIERARCHICAL_ORI		=	false;
 const std::string				Config::DEFAULT_VRPN_SKELETON_BASE_ADDR		=	"KinectSkeleton";
 const bool						Config::DEFAULT_VRPN_SEND_ORIENTATIONS			=	true;
+const bool						Config::DEFAULT_VRPN_PREDICTION				=	false;
+const uint32					Config::DEFAULT_VRPN_PREDICTION_HORIZON		=	50;
+const float32					Config::DEFAULT_VRPN_PREDICTION_DAMPING		=	5.0f;
+const std::string				Config::DEFAULT_RECORDING_PATH				=	"MultiKinect/Data/recordings";
+const std::string				Config::DEFAULT_REPLAY_PATH					=	"MultiKinect/Data/recordings";
+const float32					Config::DEFAULT_REPLAY_SPEED				=	1.0f;
+const uint32					Config::DEFAULT_REPLAY_START				=	0;
+const bool						Config::DEFAULT_REPLAY_LOOP					=	false;
+const int32						Config::DEFAULT_CAPTURE_PRIORITY			=	0;
+const int32						Config::DEFAULT_SKELETON_CAPTURE_PRIORITY	=	1;
+const uint32					Config::DEFAULT_CAPTURE_AFFINITY			=	0;
+const Config::SmoothingStage	Config::DEFAULT_SMOOTHING_STAGE				=	SMOOTHING_SENSORS;
+const float32					Config::DEFAULT_SMOOTHING_MIN_CUTOFF		=	1.0f;
+const float32					Config::DEFAULT_SMOOTHING_BETA				=	1.0f;
+const float32					Config::DEFAULT_SMOOTHING_DERIVATIVE_CUTOFF	=	1.0f;
 
 #ifdef _WIIMOTE_SUPPORT_
 const std::string				Config::DEFAULT_VRPN_WIIMOTE_BASE_ADDR		=	"WiiMote";
@@ -72,6 +98,7 @@ Config::SystemSettings			Config::system;
 Config::CanvasSettingsMap		Config::canvas;
 Config::KinectSettingsMap		Config::kinect;
 Config::VirtualRoomSettings		Config::room;
+Config::FusionSettings			Config::fusion;
 Config::VRPNSkeletonSettings	Config::localVRPNSkeletons[KINECT_SKELETON_COUNT];
 Config::VRPNSkeletonSettings	Config::remoteVRPNSkeletons[KINECT_SKELETON_COUNT];
 
@@ -80,6 +107,10 @@ Config::VRPNWiimoteSettings		Config::localVRPNWiimotes[WIIMOTE_COUNT];
 Config::VRPNWiimoteSettings		Config::remoteVRPNWiimotes[WIIMOTE_COUNT];
 #endif
 
+Config::RecordingSettings		Config::recording;
+Config::ReplaySettings			Config::replay;
+Config::CaptureThreadsSettings	Config::captureThreads;
+Config::JointSmoothingSettings	Config::jointSmoothing;
 Config::OtherSettings			Config::other;
 
 void Config::initialize()
@@ -127,8 +158,13 @@ void Config::load(const std::string& filename)
 			loadCanvasSettings(rootElem);
 			loadKinectSettings(rootElem);
 			loadRoomSettings(rootElem);
+			loadFusionSettings(rootElem);
 			loadLocalVRPNSkeletonsSettings(rootElem);
 			loadRemoteVRPNSkeletonsSettings(rootElem);
+			loadRecordingSettings(rootElem);
+			loadReplaySettings(rootElem);
+			loadCaptureThreadsSettings(rootElem);
+			loadJointSmoothingSettings(rootElem);
 
 #ifdef _WIIMOTE_SUPPORT_
 			loadLocalVRPNWiimotesSettings(rootElem);
@@ -152,8 +188,13 @@ void Config::save(const std::string& filename)
 		saveCanvasSettings(&xmlDocument, rootElem);
 		saveKinectSettings(&xmlDocument, rootElem);
 		saveRoomSettings(&xmlDocument, rootElem);
+		saveFusionSettings(&xmlDocument, rootElem);
 		saveLocalVRPNSkeletonsSettings(&xmlDocument, rootElem);
 		saveRemoteVRPNSkeletonsSettings(&xmlDocument, rootElem);
+		saveRecordingSettings(&xmlDocument, rootElem);
+		saveReplaySettings(&xmlDocument, rootElem);
+		saveCaptureThreadsSettings(&xmlDocument, rootElem);
+		saveJointSmoothingSettings(&xmlDocument, rootElem);
 
 #ifdef _WIIMOTE_SUPPORT_
 		saveLocalVRPNWiimotesSettings(&xmlDocument, rootElem);
@@ -173,6 +214,9 @@ void Config::loadSystemSettings(const tinyxml2::XMLElement* parentElement)
 
 	const tinyxml2::XMLElement* renderModeElem = parentElement->FirstChildElement("render_loop_mode");
 	if (renderModeElem) system.renderMode = static_cast<RenderLoopMode>(string_cast<uint32>(renderModeElem->GetText()));
+
+	const tinyxml2::XMLElement* captureModeElem = parentElement->FirstChildElement("capture_mode");
+	if (captureModeElem) system.captureMode = static_cast<CaptureMode>(string_cast<uint32>(captureModeElem->GetText()));
 }
 
 void Config::loadCanvasSettings(const tinyxml2::XMLElement* parentElement)
@@ -237,6 +281,10 @@ void Config::loadKinectSettings(const tinyxml2::XMLElement* parentElement)
 				kinect[id].depthMap = string_cast<bool>(std::string(dataStreamElem->GetText()));
 			else if (dataStreamElem->Attribute("type", "skeleton_tracking"))
 				kinect[id].skeletonTracking = string_cast<bool>(std::string(dataStreamElem->GetText()));
+			else if (dataStreamElem->Attribute("type", "raw_depth"))
+				kinect[id].rawDepth = string_cast<bool>(std::string(dataStreamElem->GetText()));
+			else if (dataStreamElem->Attribute("type", "player_masks"))
+				kinect[id].playerMasks = string_cast<bool>(std::string(dataStreamElem->GetText()));
 			dataStreamElem = dataStreamElem->NextSiblingElement("enable_data_stream");
 		}
 
@@ -286,6 +334,9 @@ void Config::loadKinectSettings(const tinyxml2::XMLElement* parentElement)
 			angleElem = angleElem->NextSiblingElement("elevation_angle");
 		}
 
+		const tinyxml2::XMLElement* noiseElem = kinectElem->FirstChildElement("measurement_noise");
+		if (noiseElem) kinect[id].measurementNoise = string_cast<float32>(std::string(noiseElem->GetText()));
+
 		kinectElem = kinectElem->NextSiblingElement("kinect_device");
 	}
 }
@@ -321,6 +372,34 @@ void Config::loadRoomSettings(const tinyxml2::XMLElement* parentElement)
 	}
 }
 
+void Config::loadFusionSettings(const tinyxml2::XMLElement* parentElement)
+{
+	const tinyxml2::XMLElement* fusionElem = parentElement->FirstChildElement("skeleton_fusion");
+	if (fusionElem)
+	{
+		const tinyxml2::XMLElement* gateElem = fusionElem->FirstChildElement("association_gate");
+		if (gateElem) fusion.associationGate = string_cast<float32>(std::string(gateElem->GetText()));
+
+		const tinyxml2::XMLElement* timeoutElem = fusionElem->FirstChildElement("track_timeout");
+		if (timeoutElem) fusion.trackTimeout = string_cast<uint32>(std::string(timeoutElem->GetText()));
+
+		timeoutElem = fusionElem->FirstChildElement("joint_timeout");
+		if (timeoutElem) fusion.jointTimeout = string_cast<uint32>(std::string(timeoutElem->GetText()));
+
+		const tinyxml2::XMLElement* noiseElem = fusionElem->FirstChildElement("process_noise");
+		if (noiseElem) fusion.processNoise = string_cast<float32>(std::string(noiseElem->GetText()));
+
+		const tinyxml2::XMLElement* windowElem = fusionElem->FirstChildElement("alignment_window");
+		if (windowElem) fusion.alignmentWindow = string_cast<uint32>(std::string(windowElem->GetText()));
+
+		const tinyxml2::XMLElement* orientationsElem = fusionElem->FirstChildElement("solve_orientations");
+		if (orientationsElem) fusion.solveOrientations = string_cast<bool>(std::string(orientationsElem->GetText()));
+
+		orientationsElem = fusionElem->FirstChildElement("hierarchical_orientations");
+		if (orientationsElem) fusion.hierarchicalOri = string_cast<bool>(std::string(orientationsElem->GetText()));
+	}
+}
+
 void Config::loadLocalVRPNSkeletonsSettings(const tinyxml2::XMLElement* parentElement)
 {
 	const tinyxml2::XMLElement* localVRPNSkeletonElem = parentElement->FirstChildElement("vrpn_local_skeleton");
@@ -338,6 +417,15 @@ void Config::loadLocalVRPNSkeletonsSettings(const tinyxml2::XMLElement* parentEl
 		const tinyxml2::XMLElement* sendOriginalSkeletonsElem = localVRPNSkeletonElem->FirstChildElement("send_original_skeletons");
 		if (sendOriginalSkeletonsElem) localVRPNSkeletons[id].sendOriginalSkeletons = string_cast<bool>(sendOriginalSkeletonsElem->GetText());
 
+		const tinyxml2::XMLElement* predictionElem = localVRPNSkeletonElem->FirstChildElement("prediction");
+		if (predictionElem) localVRPNSkeletons[id].prediction = string_cast<bool>(predictionElem->GetText());
+
+		const tinyxml2::XMLElement* predictionHorizonElem = localVRPNSkeletonElem->FirstChildElement("prediction_horizon");
+		if (predictionHorizonElem) localVRPNSkeletons[id].predictionHorizon = string_cast<uint32>(std::string(predictionHorizonElem->GetText()));
+
+		const tinyxml2::XMLElement* predictionDampingElem = localVRPNSkeletonElem->FirstChildElement("prediction_damping");
+		if (predictionDampingElem) localVRPNSkeletons[id].predictionDamping = string_cast<float32>(std::string(predictionDampingElem->GetText()));
+
 		localVRPNSkeletonElem = localVRPNSkeletonElem->NextSiblingElement("vrpn_local_skeleton");
 	}
 }
@@ -369,6 +457,91 @@ void Config::loadRemoteVRPNSkeletonsSettings(const tinyxml2::XMLElement* parentE
 	}
 }
 
+void Config::loadRecordingSettings(const tinyxml2::XMLElement* parentElement)
+{
+	const tinyxml2::XMLElement* recordingElem = parentElement->FirstChildElement("recording");
+	if (recordingElem)
+	{
+		const tinyxml2::XMLElement* enabledElem = recordingElem->FirstChildElement("enabled");
+		if (enabledElem) recording.enabled = string_cast<bool>(std::string(enabledElem->GetText()));
+
+		const tinyxml2::XMLElement* pathElem = recordingElem->FirstChildElement("path");
+		if (pathElem) recording.path = std::string(pathElem->GetText());
+	}
+}
+
+void Config::loadReplaySettings(const tinyxml2::XMLElement* parentElement)
+{
+	const tinyxml2::XMLElement* replayElem = parentElement->FirstChildElement("replay");
+	if (replayElem)
+	{
+		const tinyxml2::XMLElement* enabledElem = replayElem->FirstChildElement("enabled");
+		if (enabledElem) replay.enabled = string_cast<bool>(std::string(enabledElem->GetText()));
+
+		const tinyxml2::XMLElement* pathElem = replayElem->FirstChildElement("path");
+		if (pathElem) replay.path = std::string(pathElem->GetText());
+
+		const tinyxml2::XMLElement* speedElem = replayElem->FirstChildElement("speed");
+		if (speedElem) replay.speed = string_cast<float32>(std::string(speedElem->GetText()));
+
+		const tinyxml2::XMLElement* startElem = replayElem->FirstChildElement("start");
+		if (startElem) replay.start = string_cast<uint32>(std::string(startElem->GetText()));
+
+		const tinyxml2::XMLElement* loopElem = replayElem->FirstChildElement("loop");
+		if (loopElem) replay.loop = string_cast<bool>(std::string(loopElem->GetText()));
+	}
+}
+
+void Config::loadCaptureThreadsSettings(const tinyxml2::XMLElement* parentElement)
+{
+	const tinyxml2::XMLElement* captureElem = parentElement->FirstChildElement("capture_threads");
+	if (captureElem)
+	{
+		const tinyxml2::XMLElement* priorityElem = captureElem->FirstChildElement("priority");
+		while (priorityElem)
+		{
+			if (priorityElem->Attribute("stream", "color"))
+				captureThreads.colorPriority = string_cast<int32>(std::string(priorityElem->GetText()));
+			else if (priorityElem->Attribute("stream", "depth"))
+				captureThreads.depthPriority = string_cast<int32>(std::string(priorityElem->GetText()));
+			else if (priorityElem->Attribute("stream", "skeleton"))
+				captureThreads.skeletonPriority = string_cast<int32>(std::string(priorityElem->GetText()));
+			priorityElem = priorityElem->NextSiblingElement("priority");
+		}
+
+		const tinyxml2::XMLElement* affinityElem = captureElem->FirstChildElement("affinity");
+		while (affinityElem)
+		{
+			if (affinityElem->Attribute("stream", "color"))
+				captureThreads.colorAffinity = string_cast<uint32>(std::string(affinityElem->GetText()));
+			else if (affinityElem->Attribute("stream", "depth"))
+				captureThreads.depthAffinity = string_cast<uint32>(std::string(affinityElem->GetText()));
+			else if (affinityElem->Attribute("stream", "skeleton"))
+				captureThreads.skeletonAffinity = string_cast<uint32>(std::string(affinityElem->GetText()));
+			affinityElem = affinityElem->NextSiblingElement("affinity");
+		}
+	}
+}
+
+void Config::loadJointSmoothingSettings(const tinyxml2::XMLElement* parentElement)
+{
+	const tinyxml2::XMLElement* smoothingElem = parentElement->FirstChildElement("joint_smoothing");
+	if (smoothingElem)
+	{
+		const tinyxml2::XMLElement* stageElem = smoothingElem->FirstChildElement("stage");
+		if (stageElem) jointSmoothing.stage = static_cast<SmoothingStage>(string_cast<uint32>(stageElem->GetText()));
+
+		const tinyxml2::XMLElement* cutoffElem = smoothingElem->FirstChildElement("min_cutoff");
+		if (cutoffElem) jointSmoothing.minCutoff = string_cast<float32>(std::string(cutoffElem->GetText()));
+
+		const tinyxml2::XMLElement* betaElem = smoothingElem->FirstChildElement("beta");
+		if (betaElem) jointSmoothing.beta = string_cast<float32>(std::string(betaElem->GetText()));
+
+		cutoffElem = smoothingElem->FirstChildElement("derivative_cutoff");
+		if (cutoffElem) jointSmoothing.derivativeCutoff = string_cast<float32>(std::string(cutoffElem->GetText()));
+	}
+}
+
 #ifdef _WIIMOTE_SUPPORT_
 void Config::loadLocalVRPNWiimotesSettings(const tinyxml2::XMLElement* parentElement)
 {
@@ -425,6 +598,10 @@ void Config::saveSystemSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XM
 	renderModeElem->InsertEndChild(xmlDocument->NewText(enum_cast<std::string>(system.renderMode).c_str()));
 	parentElement->InsertEndChild(renderModeElem);
 
+	tinyxml2::XMLElement* captureModeElem = xmlDocument->NewElement("capture_mode");
+	captureModeElem->InsertEndChild(xmlDocument->NewText(enum_cast<std::string>(system.captureMode).c_str()));
+	parentElement->InsertEndChild(captureModeElem);
+
 	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
 }
 
@@ -529,6 +706,16 @@ void Config::saveKinectSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XM
 			dataStreamElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(i->second.skeletonTracking).c_str()));
 			kinectElem->InsertEndChild(dataStreamElem);
 
+			dataStreamElem = xmlDocument->NewElement("enable_data_stream");
+			dataStreamElem->SetAttribute("type", "raw_depth");
+			dataStreamElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(i->second.rawDepth).c_str()));
+			kinectElem->InsertEndChild(dataStreamElem);
+
+			dataStreamElem = xmlDocument->NewElement("enable_data_stream");
+			dataStreamElem->SetAttribute("type", "player_masks");
+			dataStreamElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(i->second.playerMasks).c_str()));
+			kinectElem->InsertEndChild(dataStreamElem);
+
 			tinyxml2::XMLElement* modeElem = xmlDocument->NewElement("enable_mode");
 			modeElem->SetAttribute("type", "near");
 			modeElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(i->second.nearMode).c_str()));
@@ -584,6 +771,10 @@ void Config::saveKinectSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XM
 			angleElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(i->second.maxElevationAngle).c_str()));
 			kinectElem->InsertEndChild(angleElem);
 
+			tinyxml2::XMLElement* noiseElem = xmlDocument->NewElement("measurement_noise");
+			noiseElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(i->second.measurementNoise).c_str()));
+			kinectElem->InsertEndChild(noiseElem);
+
 			parentElement->InsertEndChild(kinectElem);
 		}
 	}
@@ -632,6 +823,45 @@ void Config::saveRoomSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLE
 	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
 }
 
+void Config::saveFusionSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
+{
+	parentElement->InsertEndChild(xmlDocument->NewComment(" SKELETON FUSION SETTINGS "));
+
+	tinyxml2::XMLElement* fusionElem = xmlDocument->NewElement("skeleton_fusion");
+
+	tinyxml2::XMLElement* gateElem = xmlDocument->NewElement("association_gate");
+	gateElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.associationGate).c_str()));
+	fusionElem->InsertEndChild(gateElem);
+
+	tinyxml2::XMLElement* timeoutElem = xmlDocument->NewElement("track_timeout");
+	timeoutElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.trackTimeout).c_str()));
+	fusionElem->InsertEndChild(timeoutElem);
+
+	timeoutElem = xmlDocument->NewElement("joint_timeout");
+	timeoutElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.jointTimeout).c_str()));
+	fusionElem->InsertEndChild(timeoutElem);
+
+	tinyxml2::XMLElement* noiseElem = xmlDocument->NewElement("process_noise");
+	noiseElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.processNoise).c_str()));
+	fusionElem->InsertEndChild(noiseElem);
+
+	tinyxml2::XMLElement* windowElem = xmlDocument->NewElement("alignment_window");
+	windowElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.alignmentWindow).c_str()));
+	fusionElem->InsertEndChild(windowElem);
+
+	tinyxml2::XMLElement* orientationsElem = xmlDocument->NewElement("solve_orientations");
+	orientationsElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.solveOrientations).c_str()));
+	fusionElem->InsertEndChild(orientationsElem);
+
+	orientationsElem = xmlDocument->NewElement("hierarchical_orientations");
+	orientationsElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(fusion.hierarchicalOri).c_str()));
+	fusionElem->InsertEndChild(orientationsElem);
+
+	parentElement->InsertEndChild(fusionElem);
+
+	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
+}
+
 void Config::saveLocalVRPNSkeletonsSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
 {
 	bool first = true;
@@ -660,6 +890,18 @@ void Config::saveLocalVRPNSkeletonsSettings(tinyxml2::XMLDocument* xmlDocument,
 			sendOriginalSkeletonsElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(localVRPNSkeletons[i].sendOriginalSkeletons).c_str()));
 			localVRPNSkeletonElem->InsertEndChild(sendOriginalSkeletonsElem);
 
+			tinyxml2::XMLElement* predictionElem = xmlDocument->NewElement("prediction");
+			predictionElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(localVRPNSkeletons[i].prediction).c_str()));
+			localVRPNSkeletonElem->InsertEndChild(predictionElem);
+
+			tinyxml2::XMLElement* predictionHorizonElem = xmlDocument->NewElement("prediction_horizon");
+			predictionHorizonElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(localVRPNSkeletons[i].predictionHorizon).c_str()));
+			localVRPNSkeletonElem->InsertEndChild(predictionHorizonElem);
+
+			tinyxml2::XMLElement* predictionDampingElem = xmlDocument->NewElement("prediction_damping");
+			predictionDampingElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(localVRPNSkeletons[i].predictionDamping).c_str()));
+			localVRPNSkeletonElem->InsertEndChild(predictionDampingElem);
+
 			parentElement->InsertEndChild(localVRPNSkeletonElem);
 		}
 	}
@@ -695,6 +937,124 @@ void Config::saveRemoteVRPNSkeletonsSettings(tinyxml2::XMLDocument* xmlDocument,
 	if (!first) parentElement->InsertEndChild(xmlDocument->NewComment(" "));
 }
 
+void Config::saveRecordingSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
+{
+	parentElement->InsertEndChild(xmlDocument->NewComment(" RECORDING SETTINGS "));
+
+	tinyxml2::XMLElement* recordingElem = xmlDocument->NewElement("recording");
+
+	tinyxml2::XMLElement* enabledElem = xmlDocument->NewElement("enabled");
+	enabledElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(recording.enabled).c_str()));
+	recordingElem->InsertEndChild(enabledElem);
+
+	tinyxml2::XMLElement* pathElem = xmlDocument->NewElement("path");
+	pathElem->InsertEndChild(xmlDocument->NewText(recording.path.c_str()));
+	recordingElem->InsertEndChild(pathElem);
+
+	parentElement->InsertEndChild(recordingElem);
+
+	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
+}
+
+void Config::saveReplaySettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
+{
+	parentElement->InsertEndChild(xmlDocument->NewComment(" REPLAY SETTINGS "));
+
+	tinyxml2::XMLElement* replayElem = xmlDocument->NewElement("replay");
+
+	tinyxml2::XMLElement* enabledElem = xmlDocument->NewElement("enabled");
+	enabledElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(replay.enabled).c_str()));
+	replayElem->InsertEndChild(enabledElem);
+
+	tinyxml2::XMLElement* pathElem = xmlDocument->NewElement("path");
+	pathElem->InsertEndChild(xmlDocument->NewText(replay.path.c_str()));
+	replayElem->InsertEndChild(pathElem);
+
+	tinyxml2::XMLElement* speedElem = xmlDocument->NewElement("speed");
+	speedElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(replay.speed).c_str()));
+	replayElem->InsertEndChild(speedElem);
+
+	tinyxml2::XMLElement* startElem = xmlDocument->NewElement("start");
+	startElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(replay.start).c_str()));
+	replayElem->InsertEndChild(startElem);
+
+	tinyxml2::XMLElement* loopElem = xmlDocument->NewElement("loop");
+	loopElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(replay.loop).c_str()));
+	replayElem->InsertEndChild(loopElem);
+
+	parentElement->InsertEndChild(replayElem);
+
+	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
+}
+
+void Config::saveCaptureThreadsSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
+{
+	parentElement->InsertEndChild(xmlDocument->NewComment(" CAPTURE THREADS SETTINGS "));
+
+	tinyxml2::XMLElement* captureElem = xmlDocument->NewElement("capture_threads");
+
+	tinyxml2::XMLElement* priorityElem = xmlDocument->NewElement("priority");
+	priorityElem->SetAttribute("stream", "color");
+	priorityElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(captureThreads.colorPriority).c_str()));
+	captureElem->InsertEndChild(priorityElem);
+
+	priorityElem = xmlDocument->NewElement("priority");
+	priorityElem->SetAttribute("stream", "depth");
+	priorityElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(captureThreads.depthPriority).c_str()));
+	captureElem->InsertEndChild(priorityElem);
+
+	priorityElem = xmlDocument->NewElement("priority");
+	priorityElem->SetAttribute("stream", "skeleton");
+	priorityElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(captureThreads.skeletonPriority).c_str()));
+	captureElem->InsertEndChild(priorityElem);
+
+	tinyxml2::XMLElement* affinityElem = xmlDocument->NewElement("affinity");
+	affinityElem->SetAttribute("stream", "color");
+	affinityElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(captureThreads.colorAffinity).c_str()));
+	captureElem->InsertEndChild(affinityElem);
+
+	affinityElem = xmlDocument->NewElement("affinity");
+	affinityElem->SetAttribute("stream", "depth");
+	affinityElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(captureThreads.depthAffinity).c_str()));
+	captureElem->InsertEndChild(affinityElem);
+
+	affinityElem = xmlDocument->NewElement("affinity");
+	affinityElem->SetAttribute("stream", "skeleton");
+	affinityElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(captureThreads.skeletonAffinity).c_str()));
+	captureElem->InsertEndChild(affinityElem);
+
+	parentElement->InsertEndChild(captureElem);
+
+	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
+}
+
+void Config::saveJointSmoothingSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
+{
+	parentElement->InsertEndChild(xmlDocument->NewComment(" JOINT SMOOTHING SETTINGS "));
+
+	tinyxml2::XMLElement* smoothingElem = xmlDocument->NewElement("joint_smoothing");
+
+	tinyxml2::XMLElement* stageElem = xmlDocument->NewElement("stage");
+	stageElem->InsertEndChild(xmlDocument->NewText(enum_cast<std::string>(jointSmoothing.stage).c_str()));
+	smoothingElem->InsertEndChild(stageElem);
+
+	tinyxml2::XMLElement* cutoffElem = xmlDocument->NewElement("min_cutoff");
+	cutoffElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(jointSmoothing.minCutoff).c_str()));
+	smoothingElem->InsertEndChild(cutoffElem);
+
+	tinyxml2::XMLElement* betaElem = xmlDocument->NewElement("beta");
+	betaElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(jointSmoothing.beta).c_str()));
+	smoothingElem->InsertEndChild(betaElem);
+
+	cutoffElem = xmlDocument->NewElement("derivative_cutoff");
+	cutoffElem->InsertEndChild(xmlDocument->NewText(basic_cast<std::string>(jointSmoothing.derivativeCutoff).c_str()));
+	smoothingElem->InsertEndChild(cutoffElem);
+
+	parentElement->InsertEndChild(smoothingElem);
+
+	parentElement->InsertEndChild(xmlDocument->NewComment(" "));
+}
+
 #ifdef _WIIMOTE_SUPPORT_
 void Config::saveLocalVRPNWiimotesSettings(tinyxml2::XMLDocument* xmlDocument, tinyxml2::XMLElement* parentElement)
 {
@@ -761,6 +1121,7 @@ Config::SystemSettings::SystemSettings()
 	configPath	= appDataPath + "/" + DEFAULT_CONFIG_PATH;
 	logPath		= appDataPath + "/" + DEFAULT_LOG_PATH;
 	renderMode	= DEFAULT_RENDER_LOOP_MODE;
+	captureMode	= DEFAULT_CAPTURE_MODE;
 	restartApp	= false;
 }
 
@@ -783,6 +1144,8 @@ Config::KinectSettings::KinectSettings()
 	rgbImage			=	DEFAULT_ENABLED_RGB_IMAGE;
 	depthMap			=	DEFAULT_ENABLED_DEPTH_MAP;
 	skeletonTracking	=	DEFAULT_ENABLED_SKELETON_TRACKING;
+	rawDepth			=	DEFAULT_ENABLED_RAW_DEPTH;
+	playerMasks			=	DEFAULT_ENABLED_PLAYER_MASKS;
 	nearMode			=	DEFAULT_ENABLED_NEAR_MODE;
 	seatedMode			=	DEFAULT_ENABLED_SEATED_MODE;
 	hierarchicalOri		=	DEFAULT_ENABLED_HIERARCHICAL_ORI;
@@ -794,6 +1157,7 @@ Config::KinectSettings::KinectSettings()
 	rotation.z			=	DEFAULT_KINECT_ROTATION_Z;
 	minElevationAngle	=	KINECT_MIN_TILT_ANGLE;
 	maxElevationAngle	=	KINECT_MAX_TILT_ANGLE;
+	measurementNoise	=	DEFAULT_KINECT_MEASUREMENT_NOISE;
 }
 
 Config::VirtualRoomSettings::VirtualRoomSettings()
@@ -806,6 +1170,17 @@ Config::VirtualRoomSettings::VirtualRoomSettings()
 	depth				=	DEFAULT_ROOM_DEPTH;
 }
 
+Config::FusionSettings::FusionSettings()
+{
+	associationGate		=	DEFAULT_FUSION_ASSOCIATION_GATE;
+	trackTimeout		=	DEFAULT_FUSION_TRACK_TIMEOUT;
+	jointTimeout		=	DEFAULT_FUSION_JOINT_TIMEOUT;
+	processNoise		=	DEFAULT_FUSION_PROCESS_NOISE;
+	alignmentWindow		=	DEFAULT_FUSION_ALIGNMENT_WINDOW;
+	solveOrientations	=	DEFAULT_FUSION_SOLVE_ORIENTATIONS;
+	hierarchicalOri		=	DEFAULT_FUSION_HIERARCHICAL_ORI;
+}
+
 Config::VRPNSkeletonSettings::VRPNSkeletonSettings()
 {
 	enabled					=	false;
@@ -813,6 +1188,9 @@ Config::VRPNSkeletonSettings::VRPNSkeletonSettings()
 	serverAddress			=	DEFAULT_VRPN_SERVER_ADDR;
 	sendOrientations		=	DEFAULT_VRPN_SEND_ORIENTATIONS;
 	sendOriginalSkeletons	=	true;
+	prediction				=	DEFAULT_VRPN_PREDICTION;
+	predictionHorizon		=	DEFAULT_VRPN_PREDICTION_HORIZON;
+	predictionDamping		=	DEFAULT_VRPN_PREDICTION_DAMPING;
 }
 
 #ifdef _WIIMOTE_SUPPORT_
@@ -824,6 +1202,39 @@ Config::VRPNWiimoteSettings::VRPNWiimoteSettings()
 }
 #endif
 
+Config::RecordingSettings::RecordingSettings()
+{
+	enabled				=	false;
+	path				=	DEFAULT_RECORDING_PATH;
+}
+
+Config::ReplaySettings::ReplaySettings()
+{
+	enabled				=	false;
+	path				=	DEFAULT_REPLAY_PATH;
+	speed				=	DEFAULT_REPLAY_SPEED;
+	start				=	DEFAULT_REPLAY_START;
+	loop				=	DEFAULT_REPLAY_LOOP;
+}
+
+Config::CaptureThreadsSettings::CaptureThreadsSettings()
+{
+	colorPriority		=	DEFAULT_CAPTURE_PRIORITY;
+	depthPriority		=	DEFAULT_CAPTURE_PRIORITY;
+	skeletonPriority	=	DEFAULT_SKELETON_CAPTURE_PRIORITY;
+	colorAffinity		=	DEFAULT_CAPTURE_AFFINITY;
+	depthAffinity		=	DEFAULT_CAPTURE_AFFINITY;
+	skeletonAffinity	=	DEFAULT_CAPTURE_AFFINITY;
+}
+
+Config::JointSmoothingSettings::JointSmoothingSettings()
+{
+	stage				=	DEFAULT_SMOOTHING_STAGE;
+	minCutoff			=	DEFAULT_SMOOTHING_MIN_CUTOFF;
+	beta				=	DEFAULT_SMOOTHING_BETA;
+	derivativeCutoff	=	DEFAULT_SMOOTHING_DERIVATIVE_CUTOFF;
+}
+
 Config::OtherSettings::OtherSettings()
 {
 	confidenceMargin			=	DEFAULT_CONFIDENCE_MARGIN;
@@ -0,0 +1,235 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Interprocess/CommandChannel.h"
+
+#include "Globals/Config.h"
+#include "Interprocess/SharedMemoryManager.h"
+#include "Tools/Clock.h"
+#include "Tools/Log.h"
+#include <cmath>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Interprocess;
+using namespace Tools;
+
+
+CommandChannel::CommandChannel()
+{
+	segmentID_ = "";
+	queue_ = 0;
+	state_ = 0;
+	event_ = 0;
+}
+
+CommandChannel::~CommandChannel()
+{
+	close();
+}
+
+bool CommandChannel::openEvent(const std::string& segmentID)
+{
+	std::string eventName = "MultiKinect_" + segmentID + "_slave";
+	event_ = CreateEventA(0, false, false, eventName.c_str());
+	if (!event_)
+	{
+		Log::write("[CommandChannel] openEvent()", "ERROR: Unable to open event " + eventName + ".");
+		return false;
+	}
+	return true;
+}
+
+bool CommandChannel::create(const std::string& segmentID)
+{
+	close();
+
+	queue_ = SharedMemoryManager::createSharedObject<SharedCommandQueue>(segmentID, "commandQueue");
+	state_ = SharedMemoryManager::createSharedObject<SharedSlaveState>(segmentID, "slaveState");
+	if (!queue_ || !state_)
+	{
+		Log::write("[CommandChannel] create()", "ERROR: Unable to create the command queue of " + segmentID + ".");
+		queue_ = 0;
+		state_ = 0;
+		return false;
+	}
+	if (!openEvent(segmentID))
+	{
+		queue_ = 0;
+		state_ = 0;
+		return false;
+	}
+
+	segmentID_ = segmentID;
+	return true;
+}
+
+bool CommandChannel::open(const std::string& segmentID)
+{
+	close();
+
+	queue_ = SharedMemoryManager::getSharedObject<SharedCommandQueue>(segmentID, "commandQueue");
+	state_ = SharedMemoryManager::getSharedObject<SharedSlaveState>(segmentID, "slaveState");
+	if (!queue_ || !state_)
+	{
+		Log::write("[CommandChannel] open()", "ERROR: There is no command queue in " + segmentID + ".");
+		queue_ = 0;
+		state_ = 0;
+		return false;
+	}
+	if (!openEvent(segmentID))
+	{
+		queue_ = 0;
+		state_ = 0;
+		return false;
+	}
+
+	segmentID_ = segmentID;
+	return true;
+}
+
+void CommandChannel::close()
+{
+	// The queue belongs to the segment, it goes away along with it
+	queue_ = 0;
+	state_ = 0;
+	if (event_)
+	{
+		CloseHandle(event_);
+		event_ = 0;
+	}
+	segmentID_ = "";
+}
+
+bool CommandChannel::isOpen() const
+{
+	return (queue_ != 0);
+}
+
+const std::string& CommandChannel::getSegmentID() const
+{
+	return segmentID_;
+}
+
+HANDLE CommandChannel::getEvent() const
+{
+	return event_;
+}
+
+uint32 CommandChannel::send(SharedCommand::CommandType type, int32 argument, int32 value)
+{
+	if (queue_)
+	{
+		uint32 ticket = queue_->push(type, argument, value);
+		if (!ticket) Log::write("[CommandChannel] send()", "ERROR: Command queue of " + segmentID_ + " is full.");
+		return ticket;
+	}
+	else
+	{
+		Log::write("[CommandChannel] send()", "ERROR: Channel not open.");
+		return 0;
+	}
+}
+
+bool CommandChannel::receive(SharedCommand& command)
+{
+	if (queue_) return queue_->pop(command);
+	else return false;
+}
+
+void CommandChannel::acknowledge(uint32 ticket, bool succeeded)
+{
+	if (queue_)
+	{
+		queue_->acknowledge(ticket, succeeded);
+		SetEvent(event_);
+	}
+}
+
+bool CommandChannel::isAcknowledged(uint32 ticket, bool* succeeded) const
+{
+	if (queue_) return queue_->isAcknowledged(ticket, succeeded);
+	else return false;
+}
+
+void CommandChannel::publishState(SharedSlaveState::State state, int32 streams, uint32 canvasWidth, uint32 canvasHeight)
+{
+	if (state_)
+	{
+		state_->streams = streams;
+		state_->canvasWidth = canvasWidth;
+		state_->canvasHeight = canvasHeight;
+		state_->stateTime = Clock::getTime();
+		MemoryBarrier();
+		InterlockedExchange(&state_->state, state);
+		SetEvent(event_);
+	}
+}
+
+void CommandChannel::resetState()
+{
+	if (state_) InterlockedExchange(&state_->state, SharedSlaveState::K_SLAVE_STARTING);
+}
+
+void CommandChannel::beat()
+{
+	if (state_) InterlockedIncrement(&state_->heartbeat);
+}
+
+SharedSlaveState::State CommandChannel::getState() const
+{
+	if (state_) return static_cast<SharedSlaveState::State>(state_->state);
+	else return SharedSlaveState::K_SLAVE_FAILED;
+}
+
+bool CommandChannel::getSlaveState(SharedSlaveState& state) const
+{
+	if (state_)
+	{
+		state.state = state_->state;
+		MemoryBarrier();
+		state.streams = state_->streams;
+		state.canvasWidth = state_->canvasWidth;
+		state.canvasHeight = state_->canvasHeight;
+		state.stateTime = state_->stateTime;
+		state.heartbeat = state_->heartbeat;
+		for (uint32 i = 0; i < KINECT_CAPTURE_STREAMS; i++) state.frames[i] = state_->frames[i];
+		return true;
+	}
+	else return false;
+}
+
+int32 CommandChannel::getConfiguredStreams(const std::string& deviceID)
+{
+	int32 streams = 0;
+	if (Config::kinect[deviceID].rgbImage)			streams |= SharedCommand::K_STREAM_COLOR;
+	if (Config::kinect[deviceID].depthMap)			streams |= SharedCommand::K_STREAM_DEPTH;
+	if (Config::kinect[deviceID].skeletonTracking)	streams |= SharedCommand::K_STREAM_SKELETON;
+	if (Config::kinect[deviceID].rawDepth)			streams |= SharedCommand::K_STREAM_RAW_DEPTH;
+	if (Config::kinect[deviceID].playerMasks)		streams |= SharedCommand::K_STREAM_PLAYER_MASKS;
+	return streams;
+}
+
+int32 CommandChannel::getConfiguredElevation(const std::string& deviceID)
+{
+	// The device tilt is the opposite of its configured rotation around X, as set from the elevation slider
+	return basic_cast<int32>(std::floor(-RAD2DEG32(Config::kinect[deviceID].rotation.x) + 0.5f));
+}
@@ -0,0 +1,86 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Interprocess/FrameNotifier.h"
+
+#include "Tools/Log.h"
+
+using namespace MultiKinect;
+using namespace Interprocess;
+using namespace Tools;
+
+
+FrameNotifier::FrameNotifier()
+{
+	segmentID_ = "";
+	event_ = 0;
+}
+
+FrameNotifier::~FrameNotifier()
+{
+	close();
+}
+
+bool FrameNotifier::open(const std::string& segmentID)
+{
+	close();
+
+	std::string eventName = "MultiKinect_" + segmentID + "_frames";
+	event_ = CreateEventA(0, false, false, eventName.c_str());
+	if (!event_)
+	{
+		Log::write("[FrameNotifier] open()", "ERROR: Unable to open event " + eventName + ".");
+		return false;
+	}
+
+	segmentID_ = segmentID;
+	return true;
+}
+
+void FrameNotifier::close()
+{
+	if (event_)
+	{
+		CloseHandle(event_);
+		event_ = 0;
+	}
+	segmentID_ = "";
+}
+
+bool FrameNotifier::isOpen() const
+{
+	return (event_ != 0);
+}
+
+const std::string& FrameNotifier::getSegmentID() const
+{
+	return segmentID_;
+}
+
+HANDLE FrameNotifier::getEvent() const
+{
+	return event_;
+}
+
+void FrameNotifier::signal()
+{
+	if (event_) SetEvent(event_);
+}
@@ -103,12 +103,19 @@ managed_shared_memory* SharedMemoryManager::openSegmentIfNeeded(const std::strin
 	}
 }
 
+void SharedMemoryManager::increaseGeneration(managed_shared_memory* segment)
+{
+	std::pair<LONG*, std::size_t> generation = segment->find<LONG>("generation");
+	if (generation.first) InterlockedIncrement(generation.first);
+}
+
 void SharedMemoryManager::createSharedSegment(const std::string& segmentID, uint32 segmentSize)
 {
 	if (initialized_)
 	{
 		shared_memory_object::remove(segmentID.c_str());
 		managed_shared_memory* segment = new managed_shared_memory(create_only, segmentID.c_str(), segmentSize);
+		segment->construct<LONG>("generation")(0);
 		nCreatedSegments_++;
 		createdSegments_.push_back(std::pair<std::string, managed_shared_memory*>(segmentID, segment));
 	}
@@ -134,3 +141,17 @@ void SharedMemoryManager::removeSharedSegment(const std::string& segmentID)
 	}
 	else Log::write("[SharedMemoryManager] removeSharedSegment()", "ERROR: SharedMemoryManager not initialized.");
 }
+
+volatile LONG* SharedMemoryManager::getSegmentGeneration(const std::string& segmentID)
+{
+	if (initialized_)
+	{
+		managed_shared_memory* segment = openSegmentIfNeeded(segmentID);
+		return segment->find<LONG>("generation").first;
+	}
+	else
+	{
+		Log::write("[SharedMemoryManager] getSegmentGeneration()", "ERROR: SharedMemoryManager not initialized.");
+		return 0;
+	}
+}
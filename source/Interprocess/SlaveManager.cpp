@@ -0,0 +1,483 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Interprocess/SlaveManager.h"
+
+#include "Globals/Config.h"
+#include "Interprocess/CommandChannel.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include "Interprocess/SharedImageBuffers.h"
+#include "Interprocess/SharedMemoryManager.h"
+#include "Kinect/KinectDevice.h"
+#include "Tools/Clock.h"
+#include "Tools/Log.h"
+#include <cstring>
+#include <Windows.h>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Interprocess;
+using namespace Kinect;
+using namespace Tools;
+
+
+bool SlaveManager::initialized_ = false;
+std::vector<SlaveManager::SlaveEntry> SlaveManager::slaves_;
+HANDLE SlaveManager::supervisorStopEvent_ = 0;
+HANDLE SlaveManager::supervisorThread_ = 0;
+
+void SlaveManager::initialize()
+{
+	if (!initialized_)
+	{
+		slaves_.clear();
+		initialized_ = true;
+	}
+	else Log::write("[SlaveManager] initialize()", "ERROR: SlaveManager already initialized.");
+}
+
+void SlaveManager::destroy()
+{
+	if (initialized_)
+	{
+		stopSupervisor();
+		for (uint32 i = 0; i < slaves_.size(); i++)
+		{
+			delete slaves_[i].commands;
+			if (slaves_[i].process) CloseHandle(slaves_[i].process);
+		}
+		slaves_.clear();
+		initialized_ = false;
+	}
+	else Log::write("[SlaveManager] destroy()", "ERROR: SlaveManager not initialized.");
+}
+
+bool SlaveManager::isInitialized()
+{
+	return initialized_;
+}
+
+void SlaveManager::addSlave(const std::string& deviceID, const std::string& segmentID)
+{
+	if (initialized_)
+	{
+		SlaveEntry entry;
+		entry.deviceID = deviceID;
+		entry.segmentID = segmentID;
+		entry.commands = new CommandChannel();
+		entry.commands->create(segmentID);
+		entry.process = 0;
+		entry.launchTime = 0;
+		entry.liveness = K_SLAVE_STARTING;
+		entry.lastHeartbeat = 0;
+		entry.heartbeatTime = 0;
+		entry.lastFrames = 0;
+		entry.framesTime = 0;
+		entry.aliveSince = 0;
+		entry.restartTime = 0;
+		entry.backoff = SLAVE_RESTART_BACKOFF;
+		slaves_.push_back(entry);
+	}
+	else Log::write("[SlaveManager] addSlave()", "ERROR: SlaveManager not initialized.");
+}
+
+uint32 SlaveManager::getNumberOfSlaves()
+{
+	return basic_cast<uint32>(slaves_.size());
+}
+
+std::string SlaveManager::getSegmentID(uint32 index)
+{
+	if (index < slaves_.size()) return slaves_[index].segmentID;
+	else return "";
+}
+
+bool SlaveManager::launchSlave(uint32 index)
+{
+	if (initialized_)
+	{
+		if (index < slaves_.size())
+		{
+			SlaveEntry& slave = slaves_[index];
+			if (slave.process)
+			{
+				CloseHandle(slave.process);
+				slave.process = 0;
+			}
+
+			// Unlike WinExec, CreateProcess does not wait for the slave to reach its message loop
+			std::string command = "MultiKinect.exe -LC\"" + Globals::LAST_CONFIGURATION + "\" -D" + slave.deviceID;
+			std::vector<char> commandLine(command.begin(), command.end());
+			commandLine.push_back(0);
+
+			STARTUPINFOA startupInfo;
+			std::memset(&startupInfo, 0, sizeof(startupInfo));
+			startupInfo.cb = sizeof(startupInfo);
+			PROCESS_INFORMATION processInfo;
+			slave.launchTime = Clock::getTime();
+			if (CreateProcessA(0, &commandLine[0], 0, 0, false, 0, 0, 0, &startupInfo, &processInfo))
+			{
+				CloseHandle(processInfo.hThread);
+				slave.process = processInfo.hProcess;
+				Log::write("[SlaveManager] launchSlave()", "Execute: " + command);
+				return true;
+			}
+			else
+			{
+				Log::write("[SlaveManager] launchSlave()", "ERROR: Unable to execute " + command + ".");
+				return false;
+			}
+		}
+		else return false;
+	}
+	else
+	{
+		Log::write("[SlaveManager] launchSlave()", "ERROR: SlaveManager not initialized.");
+		return false;
+	}
+}
+
+bool SlaveManager::startSlaves()
+{
+	if (initialized_)
+	{
+		// Every slave initializes its device at the same time, the supervisor tells when each one is ready
+		bool launched = true;
+		uint64 now = Clock::getTime();
+		for (uint32 i = 0; i < slaves_.size(); i++)
+		{
+			if (!launchSlave(i))
+			{
+				scheduleRestart(slaves_[i], now);
+				launched = false;
+			}
+		}
+		return launched;
+	}
+	else
+	{
+		Log::write("[SlaveManager] startSlaves()", "ERROR: SlaveManager not initialized.");
+		return false;
+	}
+}
+
+void SlaveManager::startSupervisor()
+{
+	if (initialized_)
+	{
+		if (!supervisorThread_ && !slaves_.empty())
+		{
+			supervisorStopEvent_ = CreateEvent(0, true, false, 0);
+			supervisorThread_ = CreateThread(0, 0, supervisorThread, 0, 0, 0);
+		}
+	}
+	else Log::write("[SlaveManager] startSupervisor()", "ERROR: SlaveManager not initialized.");
+}
+
+void SlaveManager::stopSupervisor()
+{
+	if (supervisorThread_)
+	{
+		SetEvent(supervisorStopEvent_);
+		WaitForSingleObject(supervisorThread_, INFINITE);
+		CloseHandle(supervisorThread_);
+		CloseHandle(supervisorStopEvent_);
+		supervisorThread_ = 0;
+		supervisorStopEvent_ = 0;
+	}
+}
+
+SlaveManager::SlaveLiveness SlaveManager::getLiveness(uint32 index)
+{
+	if (index < slaves_.size()) return static_cast<SlaveLiveness>(slaves_[index].liveness);
+	else return K_SLAVE_DEAD;
+}
+
+bool SlaveManager::isAlive(uint32 index)
+{
+	return getLiveness(index) == K_SLAVE_ALIVE;
+}
+
+std::string SlaveManager::getLivenessName(SlaveLiveness liveness)
+{
+	switch (liveness)
+	{
+	case K_SLAVE_ALIVE:		return "alive";
+	case K_SLAVE_STARTING:	return "starting";
+	case K_SLAVE_STALE:		return "stale";
+	case K_SLAVE_HUNG:		return "hung";
+	case K_SLAVE_DEAD:		return "dead";
+	default:				return "failed";
+	}
+}
+
+DWORD WINAPI SlaveManager::supervisorThread(LPVOID param)
+{
+	while (WaitForSingleObject(supervisorStopEvent_, SLAVE_WATCHDOG_PERIOD) == WAIT_TIMEOUT)
+	{
+		uint64 now = Clock::getTime();
+		for (uint32 i = 0; i < slaves_.size(); i++) superviseSlave(slaves_[i], i, now);
+	}
+	return 0;
+}
+
+void SlaveManager::superviseSlave(SlaveEntry& slave, uint32 index, uint64 now)
+{
+	// A slave whose device failed would fail again, it is left as it is
+	if (slave.liveness == K_SLAVE_FAILED) return;
+
+	if (!slave.process)
+	{
+		if (now >= slave.restartTime)
+		{
+			resetSlaveObjects(slave);
+			setLiveness(slave, K_SLAVE_STARTING);
+			if (!launchSlave(index)) scheduleRestart(slave, now);
+		}
+		return;
+	}
+
+	DWORD exitCode = 0;
+	if (GetExitCodeProcess(slave.process, &exitCode) && exitCode != STILL_ACTIVE)
+	{
+		setLiveness(slave, K_SLAVE_DEAD);
+		scheduleRestart(slave, now);
+		return;
+	}
+
+	SharedSlaveState state;
+	slave.commands->getSlaveState(state);
+	if (state.state == SharedSlaveState::K_SLAVE_FAILED)
+	{
+		if (slave.liveness == K_SLAVE_STARTING)
+		{
+			std::string elapsed = basic_cast<std::string>(basic_cast<uint32>(Clock::toMilliseconds(state.stateTime - slave.launchTime)));
+			Log::write("[SlaveManager] superviseSlave()", "ERROR: Slave " + slave.segmentID + " failed to start its device after " + elapsed + " ms.");
+		}
+		setLiveness(slave, K_SLAVE_FAILED);
+		return;
+	}
+	if (state.state == SharedSlaveState::K_SLAVE_STARTING)
+	{
+		if (now - slave.launchTime > Clock::fromMilliseconds(SLAVE_STARTUP_TIMEOUT))
+		{
+			TerminateProcess(slave.process, 1);
+			setLiveness(slave, K_SLAVE_HUNG);
+			scheduleRestart(slave, now);
+		}
+		return;
+	}
+
+	// Skeletons are what the fusion reads, the other streams only count when they are off
+	LONG frames = 0;
+	if (state.streams & SharedCommand::K_STREAM_SKELETON) frames = state.frames[KINECT_SKELETON_STREAM];
+	else for (uint32 i = 0; i < KINECT_CAPTURE_STREAMS; i++) frames += state.frames[i];
+
+	if (slave.liveness == K_SLAVE_STARTING)
+	{
+		std::string elapsed = basic_cast<std::string>(basic_cast<uint32>(Clock::toMilliseconds(state.stateTime - slave.launchTime)));
+		Log::write("[SlaveManager] superviseSlave()", "Slave " + slave.segmentID + " ready in " + elapsed + " ms.");
+		slave.lastHeartbeat = state.heartbeat;
+		slave.heartbeatTime = now;
+		slave.lastFrames = frames;
+		slave.framesTime = now;
+	}
+
+	if (state.heartbeat != slave.lastHeartbeat)
+	{
+		slave.lastHeartbeat = state.heartbeat;
+		slave.heartbeatTime = now;
+	}
+	else if (now - slave.heartbeatTime > Clock::fromMilliseconds(SLAVE_HANG_TIMEOUT))
+	{
+		TerminateProcess(slave.process, 1);
+		setLiveness(slave, K_SLAVE_HUNG);
+		scheduleRestart(slave, now);
+		return;
+	}
+
+	if (frames != slave.lastFrames)
+	{
+		slave.lastFrames = frames;
+		slave.framesTime = now;
+	}
+
+	bool fresh = !(state.streams & (SharedCommand::K_STREAM_COLOR | SharedCommand::K_STREAM_DEPTH | SharedCommand::K_STREAM_SKELETON)) ||
+		now - slave.framesTime <= Clock::fromMilliseconds(SLAVE_STALE_TIMEOUT);
+	if (fresh)
+	{
+		if (slave.liveness != K_SLAVE_ALIVE) slave.aliveSince = now;
+		else if (now - slave.aliveSince > Clock::fromMilliseconds(SLAVE_STABLE_TIME)) slave.backoff = SLAVE_RESTART_BACKOFF;
+		setLiveness(slave, K_SLAVE_ALIVE);
+	}
+	else setLiveness(slave, K_SLAVE_STALE);
+}
+
+void SlaveManager::setLiveness(SlaveEntry& slave, SlaveLiveness liveness)
+{
+	LONG previous = InterlockedExchange(&slave.liveness, liveness);
+	if (previous != liveness)
+	{
+		std::string message = "Slave " + slave.segmentID + " is " + getLivenessName(liveness) + ".";
+		if (liveness >= K_SLAVE_HUNG) message = "ERROR: " + message;
+		Log::write("[SlaveManager] setLiveness()", message);
+	}
+}
+
+void SlaveManager::resetSlaveObjects(SlaveEntry& slave)
+{
+	// The relaunched slave takes over the objects of the one that died, which readers here still point to
+	SharedFrameSlots<KinectDevice::SkeletonsFrame>* skeletonsSlots = SharedMemoryManager::getSharedObject< SharedFrameSlots<KinectDevice::SkeletonsFrame> >(slave.segmentID, "skeletonsSlots");
+	if (skeletonsSlots) skeletonsSlots->reset();
+
+	SharedImageBuffers<uint16>* rawDepthBuffers = SharedMemoryManager::getSharedObject< SharedImageBuffers<uint16> >(slave.segmentID, "rawDepthBuffers");
+	if (rawDepthBuffers) rawDepthBuffers->reset();
+
+	SharedImageBuffers<uint8, KinectDevice::PlayerMasksInfo>* playerMasksBuffers = SharedMemoryManager::getSharedObject< SharedImageBuffers<uint8, KinectDevice::PlayerMasksInfo> >(slave.segmentID, "playerMasksBuffers");
+	if (playerMasksBuffers) playerMasksBuffers->reset();
+
+	slave.commands->resetState();
+}
+
+void SlaveManager::scheduleRestart(SlaveEntry& slave, uint64 now)
+{
+	if (slave.process)
+	{
+		CloseHandle(slave.process);
+		slave.process = 0;
+	}
+
+	// Consecutive restarts back off so a slave crashing at startup does not hog the machine
+	slave.restartTime = now + Clock::fromMilliseconds(slave.backoff);
+	Log::write("[SlaveManager] scheduleRestart()", "Slave " + slave.segmentID + " relaunched in " + basic_cast<std::string>(slave.backoff) + " ms.");
+	slave.backoff = (slave.backoff*2 < SLAVE_RESTART_MAX_BACKOFF)?slave.backoff*2:SLAVE_RESTART_MAX_BACKOFF;
+}
+
+uint32 SlaveManager::sendCommand(uint32 index, SharedCommand::CommandType type, int32 argument, int32 value)
+{
+	if (initialized_)
+	{
+		if (index < slaves_.size()) return slaves_[index].commands->send(type, argument, value);
+		else return 0;
+	}
+	else
+	{
+		Log::write("[SlaveManager] sendCommand()", "ERROR: SlaveManager not initialized.");
+		return 0;
+	}
+}
+
+void SlaveManager::broadcastCommand(std::vector<uint32>& tickets, SharedCommand::CommandType type, int32 argument, int32 value)
+{
+	tickets.resize(slaves_.size());
+	for (uint32 i = 0; i < slaves_.size(); i++) tickets[i] = sendCommand(i, type, argument, value);
+}
+
+bool SlaveManager::waitAcknowledged(const std::vector<uint32>& tickets, uint32 timeout)
+{
+	// Tickets are indexed by slave, a zero ticket has nothing to wait for
+	uint64 deadline = Clock::getTime() + Clock::fromMilliseconds(timeout);
+	std::vector<HANDLE> events;
+	for (;;)
+	{
+		events.clear();
+		for (uint32 i = 0; i < tickets.size() && i < slaves_.size(); i++)
+			if (tickets[i] && !slaves_[i].commands->isAcknowledged(tickets[i])) events.push_back(slaves_[i].commands->getEvent());
+		if (events.empty()) return true;
+
+		uint64 now = Clock::getTime();
+		if (now >= deadline) return false;
+
+		// Any acknowledgement wakes the master up to check which slaves are still pending
+		uint32 remaining = basic_cast<uint32>(Clock::toMilliseconds(deadline - now)) + 1;
+		WaitForMultipleObjects(basic_cast<DWORD>(events.size()), &events[0], false, remaining);
+	}
+}
+
+void SlaveManager::sendConfiguration()
+{
+	if (initialized_)
+	{
+		// Every slave gets its whole configuration before waiting for any, tickets are indexed by command and then by slave
+		static const uint32 nCommands = 5;
+		static const char* commandNames[nCommands] = {"elevation angle", "near mode", "seated mode", "hierarchical orientations", "streams"};
+		std::vector<uint32> tickets[nCommands];
+		for (uint32 c = 0; c < nCommands; c++) tickets[c].resize(slaves_.size());
+		for (uint32 i = 0; i < slaves_.size(); i++)
+		{
+			const std::string& deviceID = slaves_[i].deviceID;
+			int32 streams = CommandChannel::getConfiguredStreams(deviceID);
+
+			tickets[0][i] = sendCommand(i, SharedCommand::K_COMMAND_SET_ELEVATION, 0, CommandChannel::getConfiguredElevation(deviceID));
+			tickets[1][i] = sendCommand(i, SharedCommand::K_COMMAND_SET_MODE, SharedCommand::K_MODE_NEAR, (Config::kinect[deviceID].nearMode)?1:0);
+			tickets[2][i] = sendCommand(i, SharedCommand::K_COMMAND_SET_MODE, SharedCommand::K_MODE_SEATED, (Config::kinect[deviceID].seatedMode)?1:0);
+			tickets[3][i] = sendCommand(i, SharedCommand::K_COMMAND_SET_MODE, SharedCommand::K_MODE_HIERARCHICAL_ORI, (Config::kinect[deviceID].hierarchicalOri)?1:0);
+			tickets[4][i] = sendCommand(i, SharedCommand::K_COMMAND_SET_STREAMS, 0, streams);
+		}
+
+		// A slave acknowledges its commands in order, so the last one queued to each slave covers the rest
+		std::vector<uint32> lastTickets(slaves_.size(), 0);
+		for (uint32 i = 0; i < slaves_.size(); i++)
+			for (uint32 c = 0; c < nCommands; c++) if (tickets[c][i]) lastTickets[i] = tickets[c][i];
+		waitAcknowledged(lastTickets, SLAVE_COMMAND_TIMEOUT);
+		for (uint32 i = 0; i < slaves_.size(); i++)
+		{
+			for (uint32 c = 0; c < nCommands; c++)
+			{
+				bool succeeded = false;
+				if (!tickets[c][i])
+				{
+					Log::write("[SlaveManager] sendConfiguration()", "ERROR: Command queue of slave " + slaves_[i].segmentID + " full, configuration not sent.");
+					break;
+				}
+				else if (!slaves_[i].commands->isAcknowledged(tickets[c][i], &succeeded))
+				{
+					Log::write("[SlaveManager] sendConfiguration()", "ERROR: Configuration of slave " + slaves_[i].segmentID + " not acknowledged after " + basic_cast<std::string>(SLAVE_COMMAND_TIMEOUT) + " ms.");
+					break;
+				}
+				else if (!succeeded) Log::write("[SlaveManager] sendConfiguration()", "ERROR: Slave " + slaves_[i].segmentID + " failed to apply its " + commandNames[c] + ".");
+			}
+		}
+	}
+	else Log::write("[SlaveManager] sendConfiguration()", "ERROR: SlaveManager not initialized.");
+}
+
+void SlaveManager::shutDownSlaves(uint32 timeout)
+{
+	if (initialized_)
+	{
+		// Slaves closing must not be mistaken for slaves crashing
+		stopSupervisor();
+
+		// Every slave gets the command before waiting for any, so they all close at once
+		std::vector<uint32> tickets;
+		broadcastCommand(tickets, SharedCommand::K_COMMAND_SHUTDOWN);
+		if (!waitAcknowledged(tickets, timeout))
+		{
+			for (uint32 i = 0; i < slaves_.size(); i++)
+			{
+				if (tickets[i] && !slaves_[i].commands->isAcknowledged(tickets[i]))
+					Log::write("[SlaveManager] shutDownSlaves()", "ERROR: Exit of slave process " + slaves_[i].segmentID + " timeout.");
+			}
+		}
+	}
+	else Log::write("[SlaveManager] shutDownSlaves()", "ERROR: SlaveManager not initialized.");
+}
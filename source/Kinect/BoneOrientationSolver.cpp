@@ -0,0 +1,383 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Kinect/BoneOrientationSolver.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define BONE_SOLVER_SSE
+#endif
+
+using namespace MultiKinect;
+using namespace Geom;
+using namespace Kinect;
+
+
+#ifdef BONE_SOLVER_SSE
+typedef __m128 Lanes;
+
+static inline Lanes splat(float32 value) { return _mm_set1_ps(value); }
+static inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+static inline Lanes squareRoot(Lanes a) { return _mm_sqrt_ps(a); }
+static inline Lanes maximum(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+static inline Lanes less(Lanes a, Lanes b) { return _mm_cmplt_ps(a, b); }
+static inline Lanes either(Lanes mask1, Lanes mask2) { return _mm_or_ps(mask1, mask2); }
+static inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline Lanes copySign(Lanes magnitude, Lanes sign)
+{
+	const Lanes signBit = _mm_set1_ps(-0.0f);
+	return _mm_or_ps(_mm_andnot_ps(signBit, magnitude), _mm_and_ps(signBit, sign));
+}
+static inline Lanes gather(const float32* values) { return _mm_loadu_ps(values); }
+static inline void scatter(Lanes a, float32* values) { _mm_storeu_ps(values, a); }
+static inline Lanes mask(const bool* values)
+{
+	return _mm_cmpneq_ps(_mm_setr_ps(values[0]?1.0f:0.0f, values[1]?1.0f:0.0f, values[2]?1.0f:0.0f, values[3]?1.0f:0.0f), _mm_setzero_ps());
+}
+#else
+struct Lanes
+{
+	float32 v[4];
+};
+
+static inline Lanes splat(float32 value) { Lanes r; for (uint32 k = 0; k < 4; k++) r.v[k] = value; return r; }
+static inline Lanes add(Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] += b.v[k]; return a; }
+static inline Lanes sub(Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] -= b.v[k]; return a; }
+static inline Lanes mul(Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] *= b.v[k]; return a; }
+static inline Lanes div(Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] /= b.v[k]; return a; }
+static inline Lanes squareRoot(Lanes a) { for (uint32 k = 0; k < 4; k++) a.v[k] = sqrtf(a.v[k]); return a; }
+static inline Lanes maximum(Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] = (a.v[k] > b.v[k])?a.v[k]:b.v[k]; return a; }
+static inline Lanes less(Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] = (a.v[k] < b.v[k])?1.0f:0.0f; return a; }
+static inline Lanes either(Lanes mask1, Lanes mask2) { for (uint32 k = 0; k < 4; k++) mask1.v[k] = (mask1.v[k] != 0.0f || mask2.v[k] != 0.0f)?1.0f:0.0f; return mask1; }
+static inline Lanes select(Lanes mask, Lanes a, Lanes b) { for (uint32 k = 0; k < 4; k++) a.v[k] = (mask.v[k] != 0.0f)?a.v[k]:b.v[k]; return a; }
+static inline Lanes copySign(Lanes magnitude, Lanes sign) { for (uint32 k = 0; k < 4; k++) magnitude.v[k] = (sign.v[k] < 0.0f)?-fabsf(magnitude.v[k]):fabsf(magnitude.v[k]); return magnitude; }
+static inline Lanes gather(const float32* values) { Lanes r; for (uint32 k = 0; k < 4; k++) r.v[k] = values[k]; return r; }
+static inline void scatter(Lanes a, float32* values) { for (uint32 k = 0; k < 4; k++) values[k] = a.v[k]; }
+static inline Lanes mask(const bool* values) { Lanes r; for (uint32 k = 0; k < 4; k++) r.v[k] = values[k]?1.0f:0.0f; return r; }
+#endif
+
+struct Vector3Lanes
+{
+	Lanes x, y, z;
+};
+
+struct QuaternionLanes
+{
+	Lanes w, x, y, z;
+};
+
+static inline Lanes dot(const Vector3Lanes& a, const Vector3Lanes& b)
+{
+	return add(add(mul(a.x, b.x), mul(a.y, b.y)), mul(a.z, b.z));
+}
+
+static inline Vector3Lanes cross(const Vector3Lanes& a, const Vector3Lanes& b)
+{
+	Vector3Lanes r;
+	r.x = sub(mul(a.y, b.z), mul(a.z, b.y));
+	r.y = sub(mul(a.z, b.x), mul(a.x, b.z));
+	r.z = sub(mul(a.x, b.y), mul(a.y, b.x));
+	return r;
+}
+
+static inline Vector3Lanes scale(const Vector3Lanes& a, Lanes s)
+{
+	Vector3Lanes r;
+	r.x = mul(a.x, s);
+	r.y = mul(a.y, s);
+	r.z = mul(a.z, s);
+	return r;
+}
+
+static inline Vector3Lanes difference(const Vector3Lanes& a, const Vector3Lanes& b)
+{
+	Vector3Lanes r;
+	r.x = sub(a.x, b.x);
+	r.y = sub(a.y, b.y);
+	r.z = sub(a.z, b.z);
+	return r;
+}
+
+static inline Vector3Lanes select(Lanes condition, const Vector3Lanes& a, const Vector3Lanes& b)
+{
+	Vector3Lanes r;
+	r.x = select(condition, a.x, b.x);
+	r.y = select(condition, a.y, b.y);
+	r.z = select(condition, a.z, b.z);
+	return r;
+}
+
+static inline QuaternionLanes select(Lanes condition, const QuaternionLanes& a, const QuaternionLanes& b)
+{
+	QuaternionLanes r;
+	r.w = select(condition, a.w, b.w);
+	r.x = select(condition, a.x, b.x);
+	r.y = select(condition, a.y, b.y);
+	r.z = select(condition, a.z, b.z);
+	return r;
+}
+
+static inline QuaternionLanes multiply(const QuaternionLanes& a, const QuaternionLanes& b)
+{
+	QuaternionLanes r;
+	r.w = sub(sub(sub(mul(a.w, b.w), mul(a.x, b.x)), mul(a.y, b.y)), mul(a.z, b.z));
+	r.x = add(add(mul(a.w, b.x), mul(a.x, b.w)), sub(mul(a.y, b.z), mul(a.z, b.y)));
+	r.y = add(add(mul(a.w, b.y), mul(a.y, b.w)), sub(mul(a.z, b.x), mul(a.x, b.z)));
+	r.z = add(add(mul(a.w, b.z), mul(a.z, b.w)), sub(mul(a.x, b.y), mul(a.y, b.x)));
+	return r;
+}
+
+static inline QuaternionLanes conjugate(QuaternionLanes q)
+{
+	const Lanes zero = splat(0.0f);
+	q.x = sub(zero, q.x);
+	q.y = sub(zero, q.y);
+	q.z = sub(zero, q.z);
+	return q;
+}
+
+static inline QuaternionLanes normalize(QuaternionLanes q)
+{
+	Lanes length = squareRoot(add(add(mul(q.w, q.w), mul(q.x, q.x)), add(mul(q.y, q.y), mul(q.z, q.z))));
+	Lanes inverse = div(splat(1.0f), maximum(length, splat(0.000001f)));
+	q.w = mul(q.w, inverse);
+	q.x = mul(q.x, inverse);
+	q.y = mul(q.y, inverse);
+	q.z = mul(q.z, inverse);
+	return q;
+}
+
+static inline Vector3Lanes rotate(const QuaternionLanes& q, const Vector3Lanes& v)
+{
+	// v + 2w(u x v) + 2u x (u x v), with u the vector part of q
+	Vector3Lanes u;
+	u.x = q.x;
+	u.y = q.y;
+	u.z = q.z;
+	Vector3Lanes t = scale(cross(u, v), splat(2.0f));
+	Vector3Lanes r = cross(u, t);
+	r.x = add(add(v.x, mul(q.w, t.x)), r.x);
+	r.y = add(add(v.y, mul(q.w, t.y)), r.y);
+	r.z = add(add(v.z, mul(q.w, t.z)), r.z);
+	return r;
+}
+
+static inline QuaternionLanes identity()
+{
+	QuaternionLanes q;
+	q.w = splat(1.0f);
+	q.x = q.y = q.z = splat(0.0f);
+	return q;
+}
+
+/*
+** Bones in KinectSkeleton::KinectJoint indices as {joint, parent}, parents
+** always listed before their children
+*/
+static const int32 bones[KINECT_SKELETON_JOINT_COUNT][2] =
+{
+	{12, -1},	// Hip center, the root
+	{10, 12},	// Spine
+	{2, 10},	// Shoulder center
+	{0, 2},		// Head
+	{1, 2},		// Shoulder left
+	{4, 1},		// Elbow left
+	{6, 4},		// Wrist left
+	{8, 6},		// Hand left
+	{3, 2},		// Shoulder right
+	{5, 3},		// Elbow right
+	{7, 5},		// Wrist right
+	{9, 7},		// Hand right
+	{11, 12},	// Hip left
+	{14, 11},	// Knee left
+	{16, 14},	// Ankle left
+	{18, 16},	// Foot left
+	{13, 12},	// Hip right
+	{15, 13},	// Knee right
+	{17, 15},	// Ankle right
+	{19, 17}	// Foot right
+};
+
+static const uint32 hipCenter = 12;
+static const uint32 spine = 10;
+static const uint32 hipLeft = 11;
+static const uint32 hipRight = 13;
+
+
+void BoneOrientationSolver::solve(const Point* joints, const bool* validity, uint32 nSkeletons, Quaternion* absolute, Quaternion* hierarchical)
+{
+	const Lanes epsilon = splat(0.000001f);
+
+	for (uint32 first = 0; first < nSkeletons; first += 4)
+	{
+		uint32 nLanes = (nSkeletons - first < 4)?nSkeletons - first:4;
+
+		// Transpose the batch so each lane holds one skeleton, missing lanes stay invalid
+		Vector3Lanes positions[KINECT_SKELETON_JOINT_COUNT];
+		Lanes valid[KINECT_SKELETON_JOINT_COUNT];
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			float32 x[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			float32 y[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			float32 z[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			bool v[4] = {false, false, false, false};
+			for (uint32 k = 0; k < nLanes; k++)
+			{
+				const Point& p = joints[(first + k)*KINECT_SKELETON_JOINT_COUNT + j];
+				x[k] = p.x;
+				y[k] = p.y;
+				z[k] = p.z;
+				v[k] = (validity)?validity[(first + k)*KINECT_SKELETON_JOINT_COUNT + j]:true;
+			}
+			positions[j].x = gather(x);
+			positions[j].y = gather(y);
+			positions[j].z = gather(z);
+			valid[j] = mask(v);
+		}
+
+		QuaternionLanes absolutes[KINECT_SKELETON_JOINT_COUNT];
+		QuaternionLanes hierarchicals[KINECT_SKELETON_JOINT_COUNT];
+		Vector3Lanes axesX[KINECT_SKELETON_JOINT_COUNT];
+		Vector3Lanes axesY[KINECT_SKELETON_JOINT_COUNT];
+
+		// Root frame, Y up the spine and X across the hips
+		{
+			Vector3Lanes up = difference(positions[spine], positions[hipCenter]);
+			Vector3Lanes across = difference(positions[hipRight], positions[hipLeft]);
+			Lanes upLength = dot(up, up);
+			Vector3Lanes axisY = scale(up, div(splat(1.0f), squareRoot(maximum(upLength, epsilon))));
+			Vector3Lanes axisX = difference(across, scale(axisY, dot(across, axisY)));
+			Lanes acrossLength = dot(axisX, axisX);
+			axisX = scale(axisX, div(splat(1.0f), squareRoot(maximum(acrossLength, epsilon))));
+			Vector3Lanes axisZ = cross(axisX, axisY);
+
+			// Rotation matrix with the axes as columns turned into a quaternion without branches
+			Lanes one = splat(1.0f);
+			Lanes zero = splat(0.0f);
+			Lanes half = splat(0.5f);
+			QuaternionLanes q;
+			q.w = mul(half, squareRoot(maximum(zero, add(add(one, axisX.x), add(axisY.y, axisZ.z)))));
+			q.x = mul(half, squareRoot(maximum(zero, sub(sub(add(one, axisX.x), axisY.y), axisZ.z))));
+			q.y = mul(half, squareRoot(maximum(zero, sub(add(sub(one, axisX.x), axisY.y), axisZ.z))));
+			q.z = mul(half, squareRoot(maximum(zero, add(sub(sub(one, axisX.x), axisY.y), axisZ.z))));
+			q.x = copySign(q.x, sub(axisY.z, axisZ.y));
+			q.y = copySign(q.y, sub(axisZ.x, axisX.z));
+			q.z = copySign(q.z, sub(axisX.y, axisY.x));
+			q = normalize(q);
+
+			Lanes degenerate = either(less(upLength, epsilon), less(acrossLength, epsilon));
+			Lanes rootValid = select(degenerate, zero, select(valid[hipCenter], select(valid[spine], select(valid[hipLeft], valid[hipRight], zero), zero), zero));
+			Vector3Lanes unitX = {one, zero, zero};
+			Vector3Lanes unitY = {zero, one, zero};
+
+			absolutes[hipCenter] = select(rootValid, q, identity());
+			hierarchicals[hipCenter] = absolutes[hipCenter];
+			axesX[hipCenter] = select(rootValid, axisX, unitX);
+			axesY[hipCenter] = select(rootValid, axisY, unitY);
+		}
+
+		// Every other bone turns its parent frame along the shortest arc onto its direction
+		for (uint32 b = 1; b < KINECT_SKELETON_JOINT_COUNT; b++)
+		{
+			uint32 joint = basic_cast<uint32>(bones[b][0]);
+			uint32 parent = basic_cast<uint32>(bones[b][1]);
+
+			Vector3Lanes bone = difference(positions[joint], positions[parent]);
+			Lanes boneLength = dot(bone, bone);
+			Vector3Lanes direction = scale(bone, div(splat(1.0f), squareRoot(maximum(boneLength, epsilon))));
+			const Vector3Lanes& parentY = axesY[parent];
+
+			QuaternionLanes arc;
+			Vector3Lanes axis = cross(parentY, direction);
+			arc.w = add(splat(1.0f), dot(parentY, direction));
+			arc.x = axis.x;
+			arc.y = axis.y;
+			arc.z = axis.z;
+
+			// A bone folded back onto its parent turns half a circle around the parent X axis
+			QuaternionLanes halfTurn;
+			halfTurn.w = splat(0.0f);
+			halfTurn.x = axesX[parent].x;
+			halfTurn.y = axesX[parent].y;
+			halfTurn.z = axesX[parent].z;
+			arc = normalize(select(less(arc.w, epsilon), halfTurn, arc));
+
+			Lanes boneValid = select(valid[joint], select(valid[parent], select(less(boneLength, epsilon), splat(0.0f), valid[joint]), splat(0.0f)), splat(0.0f));
+			arc = select(boneValid, arc, identity());
+
+			absolutes[joint] = normalize(multiply(arc, absolutes[parent]));
+			hierarchicals[joint] = normalize(multiply(multiply(conjugate(absolutes[parent]), arc), absolutes[parent]));
+			axesX[joint] = rotate(arc, axesX[parent]);
+			axesY[joint] = rotate(arc, parentY);
+		}
+
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			float32 w[4], x[4], y[4], z[4];
+			scatter(absolutes[j].w, w);
+			scatter(absolutes[j].x, x);
+			scatter(absolutes[j].y, y);
+			scatter(absolutes[j].z, z);
+			for (uint32 k = 0; k < nLanes; k++)
+				absolute[(first + k)*KINECT_SKELETON_JOINT_COUNT + j] = Quaternion(w[k], x[k], y[k], z[k]);
+
+			if (hierarchical)
+			{
+				scatter(hierarchicals[j].w, w);
+				scatter(hierarchicals[j].x, x);
+				scatter(hierarchicals[j].y, y);
+				scatter(hierarchicals[j].z, z);
+				for (uint32 k = 0; k < nLanes; k++)
+					hierarchical[(first + k)*KINECT_SKELETON_JOINT_COUNT + j] = Quaternion(w[k], x[k], y[k], z[k]);
+			}
+		}
+	}
+}
+
+void BoneOrientationSolver::toHierarchical(const Quaternion* absolute, Quaternion* hierarchical)
+{
+	hierarchical[hipCenter] = absolute[hipCenter];
+	for (uint32 b = 1; b < KINECT_SKELETON_JOINT_COUNT; b++)
+	{
+		uint32 joint = basic_cast<uint32>(bones[b][0]);
+		uint32 parent = basic_cast<uint32>(bones[b][1]);
+		hierarchical[joint] = absolute[parent].conjugated()*absolute[joint];
+	}
+}
+
+void BoneOrientationSolver::toAbsolute(const Quaternion* hierarchical, const bool* validity, Quaternion* absolute, bool* composed)
+{
+	// Parents come before their children, so every chain is composed from the root down
+	absolute[hipCenter] = hierarchical[hipCenter];
+	composed[hipCenter] = validity[hipCenter];
+	for (uint32 b = 1; b < KINECT_SKELETON_JOINT_COUNT; b++)
+	{
+		uint32 joint = basic_cast<uint32>(bones[b][0]);
+		uint32 parent = basic_cast<uint32>(bones[b][1]);
+		composed[joint] = validity[joint] && composed[parent];
+		absolute[joint] = (composed[joint])?absolute[parent]*hierarchical[joint]:hierarchical[joint];
+	}
+}
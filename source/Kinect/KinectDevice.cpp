@@ -22,14 +22,27 @@
 #include "Kinect/KinectDevice.h"
 
 #include "Globals/Definitions.h"
-#include "Globals/Vars.h"
+#include "Files/Filesystem.h"
 #include "Geom/Point.h"
 #include "Globals/Config.h"
+#include "Kinect/BoneOrientationSolver.h"
 #include "Kinect/KinectManager.h"
+#include "Kinect/KinectNuiSource.h"
+#include "Kinect/KinectRecorder.h"
+#include "Kinect/KinectRecording.h"
 #include "Kinect/KinectSkeleton.h"
+#include "Kinect/KinectSource.h"
+#include "Interprocess/FrameNotifier.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include "Interprocess/SharedImageBuffers.h"
 #include "Interprocess/SharedMemoryManager.h"
+#include "Interprocess/SharedSlaveState.h"
+#include "Tools/AllocationCounter.h"
 #include "Tools/Log.h"
-#include "Tools/Timer.h"
+#include "Tools/Clock.h"
+#include "Tools/ImageConversion.h"
+#include "Tools/JointOneEuroFilter.h"
+#include <cstring>
 
 using namespace MultiKinect;
 using namespace Geom;
@@ -39,46 +52,144 @@ using namespace Interprocess;
 using namespace Tools;
 
 
+// KinectSkeleton joint of every NUI_SKELETON_POSITION_INDEX
+static const KinectSkeleton::KinectJoint nuiJoints[KINECT_SKELETON_JOINT_COUNT] =
+{
+	KinectSkeleton::K_HIP_CENTER,
+	KinectSkeleton::K_SPINE,
+	KinectSkeleton::K_SHOULDER_CENTER,
+	KinectSkeleton::K_HEAD,
+	KinectSkeleton::K_SHOULDER_LEFT,
+	KinectSkeleton::K_ELBOW_LEFT,
+	KinectSkeleton::K_WRIST_LEFT,
+	KinectSkeleton::K_HAND_LEFT,
+	KinectSkeleton::K_SHOULDER_RIGHT,
+	KinectSkeleton::K_ELBOW_RIGHT,
+	KinectSkeleton::K_WRIST_RIGHT,
+	KinectSkeleton::K_HAND_RIGHT,
+	KinectSkeleton::K_HIP_LEFT,
+	KinectSkeleton::K_KNEE_LEFT,
+	KinectSkeleton::K_ANKLE_LEFT,
+	KinectSkeleton::K_FOOT_LEFT,
+	KinectSkeleton::K_HIP_RIGHT,
+	KinectSkeleton::K_KNEE_RIGHT,
+	KinectSkeleton::K_ANKLE_RIGHT,
+	KinectSkeleton::K_FOOT_RIGHT
+};
+
+
+KinectDevice::SkeletonsFrame::SkeletonsFrame()
+{
+	timestamp = 0;
+	publishTimestamp = 0;
+	nSkeletons = 0;
+	confidenceValue = 0.0f;
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++) trackingIDs[i] = 0;
+}
+
+KinectDevice::RawDepthFrame::RawDepthFrame()
+{
+	timestamp = 0;
+	frameNumber = 0;
+	width = 0;
+	height = 0;
+}
+
+KinectDevice::PlayerMasksInfo::PlayerMasksInfo()
+{
+	width = 0;
+	players = 0;
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+	{
+		playerIndices[i] = 0;
+		boxes[i].minX = boxes[i].minY = boxes[i].maxX = boxes[i].maxY = 0;
+	}
+}
+
+KinectDevice::PlayerMasksFrame::PlayerMasksFrame()
+{
+	timestamp = 0;
+	frameNumber = 0;
+	width = 0;
+	height = 0;
+	stride = 0;
+}
+
 KinectDevice::KinectDevice(uint32 index)
 {
-	instance_ = 0;
-	valid_ = SUCCEEDED(NuiCreateSensorByIndex(index, &instance_));
+	source_ = new KinectNuiSource(index);
+	valid_ = source_->isValid();
 	create();
 }
 
 KinectDevice::KinectDevice(const std::string& deviceID)
 {
-	instance_				=	0;
-	std::wstring wDeviceID	=	string_cast<std::wstring>(deviceID);
-
-	if (wDeviceID != L"")	valid_ = SUCCEEDED(NuiCreateSensorById(&wDeviceID[0], &instance_));
-	else					valid_ = false;
+	// The manager decides whether the device is a live sensor or a recording
+	source_ = KinectManager::createSource(deviceID);
+	valid_ = source_ && source_->isValid();
+	create();
+}
 
+KinectDevice::KinectDevice(KinectSource* source)
+{
+	// Takes over the caller's reference, like the sources created above
+	source_ = source;
+	valid_ = source_ && source_->isValid();
 	create();
 }
 
 KinectDevice::~KinectDevice()
 {
 	if (initialized_) shutDown();
-	if (valid_)
+	if (source_)
 	{
-		instance_->Release();
-		instance_ = 0;
+		source_->release();
+		source_ = 0;
 		valid_ = false;
 	}
+	DeleteCriticalSection(&playerMapLock_);
+	DeleteCriticalSection(&poseLock_);
 }
 
 void KinectDevice::create()
 {
 	initialized_ = colorStreamOpened_ = depthStreamOpened_ = skeletonEnabled_ = false;
+	canvasWidth_ = canvasHeight_ = 0;
 	depthFlags_ = skeletonFlags_ = 0;
-	colorStreamHandle_ = depthStreamHandle_ = 0;
 	colorFrameEvent_ = depthFrameEvent_ = skeletonFrameEvent_ = 0;
-	processStopEvent_ = processThread_ = 0;
+	processStopEvent_ = 0;
+	for (uint32 i = 0; i < K_CAPTURE_STREAMS; i++)
+	{
+		workers_[i].device = this;
+		workers_[i].stream = static_cast<CaptureStream>(i);
+		workers_[i].thread = 0;
+		workers_[i].fps = 0.0f;
+		workers_[i].latency = 0.0f;
+		workers_[i].allocating = false;
+	}
+	poseStream_ = K_SKELETON_CAPTURE;
+	recorder_ = 0;
 	colorFrame_ = 0;
 	depthFrame_ = 0;
+	depthColors_ = 0;
+	depthColorsDirty_ = true;
+	rawDepthBuffers_ = 0;
+	rawDepthPixels_ = 0;
+	depthPreviewRequests_ = 0;
+	depthPreviewSeen_ = 0;
+	depthPreviewTime_ = 0;
+	playerMasksBuffers_ = 0;
+	playerMasksPixels_ = 0;
 	nSkeletons_ = 0;
 	skeletons_ = 0;
+	smoothingFilter_ = 0;
+	InitializeCriticalSection(&playerMapLock_);
+	playerMapDirty_ = false;
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++) depthPlayerMap_[i] = -1;
+	confidenceValue_ = 0;
+	skeletonsSlots_ = 0;
+	frameNotifier_ = 0;
+	slaveState_ = 0;
 	elevationAngle_ = 0;
 	rotationX_ = 0;
 	rotationY_ = 0;
@@ -86,7 +197,44 @@ void KinectDevice::create()
 	translationX_ = 0;
 	translationY_ = 0;
 	translationZ_ = 0;
+	InitializeCriticalSection(&poseLock_);
 	hierarchicalOri_ = false;
+
+	// Settings are looked up by the device's own ID so several devices can share one process
+	id_ = getID();
+}
+
+void KinectDevice::startRecording(_NUI_IMAGE_RESOLUTION colorResolution, _NUI_IMAGE_RESOLUTION depthResolution)
+{
+	KinectRecording::FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::strncpy(header.deviceID, id_.c_str(), KinectRecording::K_RECORDING_ID_LENGTH - 1);
+	header.elevationAngle = elevationAngle_;
+
+	DWORD width, height;
+	if (colorStreamOpened_)
+	{
+		NuiImageResolutionToSize(colorResolution, width, height);
+		header.colorWidth = width;
+		header.colorHeight = height;
+		header.streams |= K_USE_COLOR;
+	}
+	if (depthStreamOpened_)
+	{
+		NuiImageResolutionToSize(depthResolution, width, height);
+		header.depthWidth = width;
+		header.depthHeight = height;
+		header.streams |= (source_->hasSkeletalEngine())?K_USE_DEPTH_AND_PLAYER:K_USE_DEPTH;
+	}
+	if (skeletonEnabled_) header.streams |= K_USE_SKELETON;
+
+	Filesystem::createDirectory(Config::recording.path);
+	recorder_ = new KinectRecorder(Config::recording.path + "/" + KinectManager::reformatDeviceID(id_) + ".mkrec", header);
+	if (!recorder_->isOpen())
+	{
+		delete recorder_;
+		recorder_ = 0;
+	}
 }
 
 void KinectDevice::obtainColorFrame()
@@ -96,35 +244,29 @@ void KinectDevice::obtainColorFrame()
 		if (!colorStreamOpened_) Log::write("[KinectDevice] obtainColorFrame()", "ERROR: Color stream not opened.");
 		else
 		{
-			NUI_IMAGE_FRAME* colorFrame = new NUI_IMAGE_FRAME;
-			if (SUCCEEDED(instance_->NuiImageStreamGetNextFrame(colorStreamHandle_, 200, colorFrame)))
+			KinectSource::ImageFrame colorFrame;
+			if (source_->lockImageFrame(KinectSource::K_COLOR_STREAM, 200, colorFrame))
 			{
-				NUI_LOCKED_RECT lockedRect;
-				colorFrame->pFrameTexture->LockRect(0, &lockedRect, 0, 0);
-				if(lockedRect.Pitch != 0)
+				if (recorder_) recorder_->record(KinectRecording::K_RECORD_COLOR, colorFrame.timestamp, colorFrame.data, colorFrame.size);
+				if(colorFrame.pitch != 0)
 				{
-					uint8* buffer = basic_cast<uint8*>(lockedRect.pBits);
-					for(uint32 y = 0; y < Config::canvas[Globals::INSTANCE_ID].height; y++)
+					// Smaller canvases average whole blocks of the stream instead of point sampling it
+					uint32 width = canvasWidth_;
+					uint32 height = canvasHeight_;
+					uint32 factorX = (colorFrame.pitch/4)/width;
+					uint32 factorY = (colorFrame.size/colorFrame.pitch)/height;
+					if (factorX && factorY)
 					{
-						for(uint32 x = 0; x < Config::canvas[Globals::INSTANCE_ID].width; x++)
+						uint32 sourceStride = colorFrame.pitch*factorY;
+						for(uint32 y = 0; y < height; y++)
 						{
-							uint32 stepX = (lockedRect.size/lockedRect.Pitch)/Config::canvas[Globals::INSTANCE_ID].height;
-							RGBQUAD* winRGB = reinterpret_cast<RGBQUAD*>(buffer) + x*stepX;
-							uint32 offset = (Config::canvas[Globals::INSTANCE_ID].width*y + x)*3;
-							colorFrame_[offset + 0] = winRGB->rgbRed;
-							colorFrame_[offset + 1] = winRGB->rgbGreen;
-							colorFrame_[offset + 2] = winRGB->rgbBlue;
+							ImageConversion::downscaleBGRAToRGB(colorFrame.data + sourceStride*y, colorFrame.pitch, factorX, factorY, colorFrame_ + width*y*3, width);
 						}
-
-						uint32 stepY = (lockedRect.Pitch/4)/Config::canvas[Globals::INSTANCE_ID].width;
-						buffer += lockedRect.Pitch*stepY;
 					}
 				}
-				colorFrame->pFrameTexture->UnlockRect(0);
-				instance_->NuiImageStreamReleaseFrame(colorStreamHandle_, colorFrame);
+				source_->releaseImageFrame(KinectSource::K_COLOR_STREAM);
 			}
 			else Log::write("[KinectDevice] obtainColorFrame()", "ERROR: Unable to get color frame.");
-			delete colorFrame;
 		}
 	}
 	else Log::write("[KinectDevice] obtainColorFrame()", "ERROR: Device not initialized.");
@@ -137,35 +279,32 @@ void KinectDevice::obtainDepthFrame()
 		if (!depthStreamOpened_) Log::write("[KinectDevice] obtainDepthFrame()", "ERROR: Depth stream not opened.");
 		else
 		{
-			NUI_IMAGE_FRAME* depthFrame = new NUI_IMAGE_FRAME;
-			if (SUCCEEDED(instance_->NuiImageStreamGetNextFrame(depthStreamHandle_, 200, depthFrame)))
+			KinectSource::ImageFrame depthFrame;
+			if (source_->lockImageFrame(KinectSource::K_DEPTH_STREAM, 200, depthFrame))
 			{
-				NUI_LOCKED_RECT lockedRect;
-				depthFrame->pFrameTexture->LockRect(0, &lockedRect, 0, 0);
-				if(lockedRect.Pitch != 0)
+				if (recorder_) recorder_->record(KinectRecording::K_RECORD_DEPTH, depthFrame.timestamp, depthFrame.data, depthFrame.size);
+				if(depthFrame.pitch != 0)
 				{
-					uint8* buffer = basic_cast<uint8*>(lockedRect.pBits);
-					uint16* bufferRun = reinterpret_cast<uint16*>(buffer);
-					for(uint32 y = 0; y < Config::canvas[Globals::INSTANCE_ID].height; y++)
+					if (refreshPlayerMap()) depthColorsDirty_ = true;
+					if (rawDepthBuffers_) publishRawDepth(depthFrame.data, depthFrame.pitch, depthFrame.timestamp);
+					if (playerMasksBuffers_) publishPlayerMasks(depthFrame.data, depthFrame.pitch, depthFrame.timestamp);
+
+					if (depthFrame_ && isDepthPreviewRequested())
 					{
-						for(uint32 x = 0; x < Config::canvas[Globals::INSTANCE_ID].width; x++)
-						{
-							Color rgbColor = depthToColor(*bufferRun, HasSkeletalEngine(instance_));
-							uint32 offset = (Config::canvas[Globals::INSTANCE_ID].width*y + x)*3;
-							depthFrame_[offset + 0] = basic_cast<uint8>(rgbColor.r*255.0f);
-							depthFrame_[offset + 1] = basic_cast<uint8>(rgbColor.g*255.0f);
-							depthFrame_[offset + 2] = basic_cast<uint8>(rgbColor.b*255.0f);
+						if (depthColorsDirty_) buildDepthColors(source_->hasSkeletalEngine());
 
-							bufferRun++;
+						uint32 width = canvasWidth_;
+						uint32 height = canvasHeight_;
+						for(uint32 y = 0; y < height; y++)
+						{
+							const uint16* row = reinterpret_cast<const uint16*>(depthFrame.data + depthFrame.pitch*y);
+							ImageConversion::colorizeDepthRow(row, depthColors_, depthFrame_ + width*y*3, width);
 						}
 					}
-
 				}
-				depthFrame->pFrameTexture->UnlockRect(0);
-				instance_->NuiImageStreamReleaseFrame(depthStreamHandle_, depthFrame);
+				source_->releaseImageFrame(KinectSource::K_DEPTH_STREAM);
 			}
 			else Log::write("[KinectDevice] obtainDepthFrame()", "ERROR: Unable to get depth frame.");
-			delete depthFrame;
 		}
 	}
 	else Log::write("[KinectDevice] obtainDepthFrame()", "ERROR: Device not initialized.");
@@ -177,17 +316,17 @@ void KinectDevice::obtainSkeletonsFrame()
 	{
 		if (skeletonEnabled_)
 		{
-			float32* confidenceValue = 0;
-			if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
+			float32 confidenceValue = 0.0f;
+			// Lives on the skeleton capture thread stack like the image frames, so capturing never touches the heap
+			KinectSource::SkeletonFrame sourceFrame;
+			NUI_SKELETON_FRAME* skeletonFrame = &(sourceFrame.data);
+			if(source_->getSkeletonFrame(200, sourceFrame))
 			{
-				std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
-				confidenceValue = SharedMemoryManager::getSharedObject<float32>(segmentID, "confidenceValue");
-				if (confidenceValue) *confidenceValue = 0.0f;
-			}
+				uint64 timestamp = sourceFrame.timestamp;
+				if (recorder_) recorder_->record(KinectRecording::K_RECORD_SKELETON, timestamp, reinterpret_cast<const uint8*>(skeletonFrame), sizeof(NUI_SKELETON_FRAME));
 
-			NUI_SKELETON_FRAME* skeletonFrame = new NUI_SKELETON_FRAME;
-			if(SUCCEEDED(instance_->NuiSkeletonGetNextFrame(200, skeletonFrame)))
-			{
+				// The depth thread copies the map under this lock when it changes
+				EnterCriticalSection(&playerMapLock_);
 				for(uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
 				{
 					skeletons_[i].clear();
@@ -196,8 +335,10 @@ void KinectDevice::obtainSkeletonsFrame()
 					{
 						if (skeletonMap_[i] == -1)
 						{
-							skeletonMap_[i] = *nSkeletons_;
-							(*nSkeletons_)++;
+							skeletonMap_[i] = nSkeletons_;
+							nSkeletons_++;
+							playerMapDirty_ = true;
+							if (smoothingFilter_) smoothingFilter_->reset(i);
 						}
 					}
 					else
@@ -207,37 +348,48 @@ void KinectDevice::obtainSkeletonsFrame()
 							for (uint32 j = 0; j < KINECT_SKELETON_COUNT; j++)
 								if (skeletonMap_[j] > skeletonMap_[i]) skeletonMap_[j]--;
 							skeletonMap_[i] = -1;
-							(*nSkeletons_)--;
+							nSkeletons_--;
+							playerMapDirty_ = true;
 						}
 					}
 				}
+				LeaveCriticalSection(&playerMapLock_);
 
-				if(*nSkeletons_)
+				if(nSkeletons_)
 				{
-					instance_->NuiTransformSmooth(skeletonFrame, 0);
+					if (smoothingFilter_) smoothSkeletons(*skeletonFrame, timestamp);
+
+					// Orientations of every tracked skeleton are solved in one batch from the smoothed positions
+					Point solverJoints[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+					bool solverValidity[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+					Quaternion absoluteOrientations[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+					Quaternion hierarchicalOrientations[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+					uint32 nSolved = 0;
+					uint32 solvedIndices[KINECT_SKELETON_COUNT];
+					bool hierarchicalOri = hierarchicalOri_;
+					for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+					{
+						if(skeletonFrame->SkeletonData[i].eTrackingState != NUI_SKELETON_TRACKED) continue;
+
+						for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+						{
+							uint32 index = nSolved*KINECT_SKELETON_JOINT_COUNT + nuiJoints[j];
+							solverJoints[index] = Point(
+								skeletonFrame->SkeletonData[i].SkeletonPositions[j].x,
+								skeletonFrame->SkeletonData[i].SkeletonPositions[j].y,
+								skeletonFrame->SkeletonData[i].SkeletonPositions[j].z);
+							solverValidity[index] = (skeletonFrame->SkeletonData[i].eSkeletonPositionTrackingState[j] != NUI_SKELETON_POSITION_NOT_TRACKED);
+						}
+						solvedIndices[i] = nSolved++;
+					}
+					BoneOrientationSolver::solve(solverJoints, solverValidity, nSolved, absoluteOrientations, (hierarchicalOri)?hierarchicalOrientations:0);
+
 					for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
 					{
 						if(skeletonFrame->SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED)
 						{
 							skeletons_[skeletonMap_[i]].setPlayerIndex(skeletonMap_[i] + 1);
 
-							NUI_SKELETON_BONE_ORIENTATION boneOrientations[KINECT_SKELETON_JOINT_COUNT];
-							std::vector<Quaternion> jointOrientations(KINECT_SKELETON_JOINT_COUNT, Quaternion());
-							NuiSkeletonCalculateBoneOrientations(&(skeletonFrame->SkeletonData[i]), boneOrientations);
-							for (uint32 b = 0; b < KINECT_SKELETON_JOINT_COUNT; b++)
-							{
-								Vector4 quat;
-								if (Config::kinect[Globals::INSTANCE_ID].hierarchicalOri)
-									quat = boneOrientations[b].hierarchicalRotation.rotationQuaternion;
-								else quat = boneOrientations[b].absoluteRotation.rotationQuaternion;
-
-								jointOrientations[b] = Quaternion(
-									basic_cast<float32>(quat.w),
-									basic_cast<float32>(quat.x),
-									basic_cast<float32>(quat.y),
-									basic_cast<float32>(quat.z));
-							}
-
 							for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
 							{
 								if (skeletonFrame->SkeletonData[i].eSkeletonPositionTrackingState[j] == NUI_SKELETON_POSITION_TRACKED)
@@ -246,56 +398,41 @@ void KinectDevice::obtainSkeletonsFrame()
 									float32 jointY = skeletonFrame->SkeletonData[i].SkeletonPositions[j].y;
 									float32 jointZ = skeletonFrame->SkeletonData[i].SkeletonPositions[j].z;
 
-									KinectSkeleton::KinectJoint joint;
-									switch (j)
-									{
-									case NUI_SKELETON_POSITION_HEAD: joint = KinectSkeleton::K_HEAD; break;
-									case NUI_SKELETON_POSITION_SHOULDER_LEFT: joint = KinectSkeleton::K_SHOULDER_LEFT; break;
-									case NUI_SKELETON_POSITION_SHOULDER_CENTER: joint = KinectSkeleton::K_SHOULDER_CENTER; break;
-									case NUI_SKELETON_POSITION_SHOULDER_RIGHT: joint = KinectSkeleton::K_SHOULDER_RIGHT; break;
-									case NUI_SKELETON_POSITION_ELBOW_LEFT: joint = KinectSkeleton::K_ELBOW_LEFT; break;
-									case NUI_SKELETON_POSITION_ELBOW_RIGHT: joint = KinectSkeleton::K_ELBOW_RIGHT; break;
-									case NUI_SKELETON_POSITION_WRIST_LEFT: joint = KinectSkeleton::K_WRIST_LEFT; break;
-									case NUI_SKELETON_POSITION_WRIST_RIGHT: joint = KinectSkeleton::K_WRIST_RIGHT; break;
-									case NUI_SKELETON_POSITION_HAND_LEFT: joint = KinectSkeleton::K_HAND_LEFT; break;
-									case NUI_SKELETON_POSITION_HAND_RIGHT: joint = KinectSkeleton::K_HAND_RIGHT; break;
-									case NUI_SKELETON_POSITION_SPINE: joint = KinectSkeleton::K_SPINE; break;
-									case NUI_SKELETON_POSITION_HIP_LEFT: joint = KinectSkeleton::K_HIP_LEFT; break;
-									case NUI_SKELETON_POSITION_HIP_CENTER: joint = KinectSkeleton::K_HIP_CENTER; break;
-									case NUI_SKELETON_POSITION_HIP_RIGHT: joint = KinectSkeleton::K_HIP_RIGHT; break;
-									case NUI_SKELETON_POSITION_KNEE_LEFT: joint = KinectSkeleton::K_KNEE_LEFT; break;
-									case NUI_SKELETON_POSITION_KNEE_RIGHT: joint = KinectSkeleton::K_KNEE_RIGHT; break;
-									case NUI_SKELETON_POSITION_ANKLE_LEFT: joint = KinectSkeleton::K_ANKLE_LEFT; break;
-									case NUI_SKELETON_POSITION_ANKLE_RIGHT: joint = KinectSkeleton::K_ANKLE_RIGHT; break;
-									case NUI_SKELETON_POSITION_FOOT_LEFT: joint = KinectSkeleton::K_FOOT_LEFT; break;
-									case NUI_SKELETON_POSITION_FOOT_RIGHT: joint = KinectSkeleton::K_FOOT_RIGHT; break;
-									default: joint = KinectSkeleton::K_NONE; break;
-									}
-
-									if (joint != KinectSkeleton::K_NONE)
-									{
-										Quaternion jointOrientation = jointOrientations[j];
-										if (!Config::kinect[Globals::INSTANCE_ID].hierarchicalOri)
-											jointOrientation = jointOrientation*Quaternion(0.0f, PI32, 0.0f);
-										skeletons_[skeletonMap_[i]].setJoint(
-											joint,
-											Point(jointX, jointY, jointZ),
-											jointOrientation);
-									}
+									KinectSkeleton::KinectJoint joint = nuiJoints[j];
+									uint32 index = solvedIndices[i]*KINECT_SKELETON_JOINT_COUNT + joint;
+									Quaternion jointOrientation;
+									if (hierarchicalOri) jointOrientation = hierarchicalOrientations[index];
+									else jointOrientation = absoluteOrientations[index]*Quaternion(0.0f, PI32, 0.0f);
+									skeletons_[skeletonMap_[i]].setJoint(
+										joint,
+										Point(jointX, jointY, jointZ),
+										jointOrientation);
 								}
 							}
 
 							// Update confidence value
-							if (confidenceValue) *confidenceValue += skeletons_[skeletonMap_[i]].getConfidenceValue();
+							confidenceValue += skeletons_[skeletonMap_[i]].getConfidenceValue();
 						}
 					}
 
 					// Normalize confidence value
-					if (confidenceValue) *confidenceValue /= *nSkeletons_;
+					confidenceValue /= nSkeletons_;
 				}
+
+				// Publish the whole frame at once so readers never see it half updated
+				SkeletonsFrame& frame = skeletonsSlots_->beginWrite();
+				frame.timestamp = timestamp;
+				frame.nSkeletons = nSkeletons_;
+				frame.confidenceValue = confidenceValue;
+				for (uint32 i = 0; i < nSkeletons_; i++) frame.skeletons[i] = skeletons_[i];
+				for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+					if (skeletonMap_[i] != -1) frame.trackingIDs[skeletonMap_[i]] = skeletonFrame->SkeletonData[i].dwTrackingID;
+				frame.publishTimestamp = Clock::getTime();
+				skeletonsSlots_->endWrite();
+				*confidenceValue_ = confidenceValue;
+				frameNotifier_->signal();
 			}
 			else Log::write("[KinectDevice] obtainSkeletonsFrame()", "ERROR: Unable to get skeletons.");
-			delete skeletonFrame;
 		}
 		else Log::write("[KinectDevice] obtainSkeletonsFrame()", "ERROR: Skeleton tracking is disabled.");
 	}
@@ -308,7 +445,7 @@ Color KinectDevice::depthToColor(uint16 depthValue, bool usesPlayer)
 	realDepth = 255 - 256*realDepth/4095;
 	uint16 playerIndex = 0;
 	if (usesPlayer) playerIndex = (depthValue&0x0007);
-	if (playerIndex && skeletonMap_[playerIndex - 1] != -1) playerIndex = skeletonMap_[playerIndex - 1] + 1;
+	if (playerIndex && depthPlayerMap_[playerIndex - 1] != -1) playerIndex = depthPlayerMap_[playerIndex - 1] + 1;
 	else playerIndex = 0x0007;
 
 	Color depthColor(0.0f, 0.0f, 0.0f);
@@ -319,6 +456,146 @@ Color KinectDevice::depthToColor(uint16 depthValue, bool usesPlayer)
 	return depthColor;
 }
 
+void KinectDevice::buildDepthColors(bool usesPlayer)
+{
+	// Depth colors only change with the player mapping, so every possible value is converted up front
+	for (uint32 value = 0; value < 65536; value++)
+	{
+		Color depthColor = depthToColor(basic_cast<uint16>(value), usesPlayer);
+		depthColors_[value] =
+			basic_cast<uint32>(basic_cast<uint8>(depthColor.r*255.0f)) |
+			(basic_cast<uint32>(basic_cast<uint8>(depthColor.g*255.0f)) << 8) |
+			(basic_cast<uint32>(basic_cast<uint8>(depthColor.b*255.0f)) << 16);
+	}
+	depthColorsDirty_ = false;
+}
+
+void KinectDevice::smoothSkeletons(NUI_SKELETON_FRAME& frame, uint64 timestamp)
+{
+	// The sensor keeps a user in the same skeleton index while tracked, so indices serve as filter slots
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+	{
+		if (frame.SkeletonData[i].eTrackingState != NUI_SKELETON_TRACKED) continue;
+
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			if (frame.SkeletonData[i].eSkeletonPositionTrackingState[j] != NUI_SKELETON_POSITION_NOT_TRACKED)
+			{
+				const Vector4& position = frame.SkeletonData[i].SkeletonPositions[j];
+				smoothingFilter_->set(i, j, Point(position.x, position.y, position.z));
+			}
+		}
+	}
+
+	smoothingFilter_->filter(timestamp);
+
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+	{
+		if (frame.SkeletonData[i].eTrackingState != NUI_SKELETON_TRACKED) continue;
+
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			if (frame.SkeletonData[i].eSkeletonPositionTrackingState[j] != NUI_SKELETON_POSITION_NOT_TRACKED && smoothingFilter_->isValid(i, j))
+			{
+				Point position = smoothingFilter_->getPosition(i, j);
+				frame.SkeletonData[i].SkeletonPositions[j].x = position.x;
+				frame.SkeletonData[i].SkeletonPositions[j].y = position.y;
+				frame.SkeletonData[i].SkeletonPositions[j].z = position.z;
+			}
+		}
+	}
+}
+
+bool KinectDevice::refreshPlayerMap()
+{
+	bool changed = false;
+	EnterCriticalSection(&playerMapLock_);
+	if (playerMapDirty_)
+	{
+		for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+			depthPlayerMap_[i] = (i < skeletonMap_.size())?skeletonMap_[i]:-1;
+		playerMapDirty_ = false;
+		changed = true;
+	}
+	LeaveCriticalSection(&playerMapLock_);
+
+	return changed;
+}
+
+void KinectDevice::publishRawDepth(const uint8* data, uint32 pitch, uint64 timestamp)
+{
+	uint32 width = rawDepthBuffers_->getWidth();
+	uint32 height = rawDepthBuffers_->getHeight();
+	uint32 rowSize = width*sizeof(uint16);
+
+	uint16* pixels = rawDepthBuffers_->beginWrite(rawDepthPixels_);
+	if (pitch == rowSize) std::memcpy(pixels, data, rowSize*height);
+	else
+	{
+		for (uint32 y = 0; y < height; y++) std::memcpy(pixels + width*y, data + pitch*y, rowSize);
+	}
+	rawDepthBuffers_->endWrite(timestamp);
+}
+
+bool KinectDevice::isDepthPreviewRequested()
+{
+	// Without the raw channel the colorized map is the only depth output, so it is always produced
+	if (!depthPreviewRequests_) return true;
+
+	LONG requests = *depthPreviewRequests_;
+	uint64 now = Clock::getTime();
+	if (requests != depthPreviewSeen_)
+	{
+		depthPreviewSeen_ = requests;
+		depthPreviewTime_ = now;
+	}
+
+	return depthPreviewTime_ != 0 && now - depthPreviewTime_ < Clock::fromMilliseconds(DEPTH_PREVIEW_TIMEOUT);
+}
+
+void KinectDevice::publishPlayerMasks(const uint8* data, uint32 pitch, uint64 timestamp)
+{
+	PlayerMasksInfo info;
+	info.width = canvasWidth_;
+	uint32 stride = playerMasksBuffers_->getWidth();
+	uint32 height = playerMasksBuffers_->getHeight()/KINECT_SKELETON_COUNT;
+	uint32 planeSize = stride*height;
+	uint32 minX[KINECT_SKELETON_COUNT];
+	uint32 maxX[KINECT_SKELETON_COUNT];
+
+	uint8* masks = playerMasksBuffers_->beginWrite(playerMasksPixels_);
+	for (uint32 y = 0; y < height; y++)
+	{
+		const uint16* row = reinterpret_cast<const uint16*>(data + pitch*y);
+		uint32 present = ImageConversion::extractPlayerMasksRow(row, info.width, masks + stride*y, planeSize, minX, maxX);
+		for (uint32 p = 0; p < KINECT_SKELETON_COUNT; p++)
+		{
+			if (!(present&(1 << p))) continue;
+
+			PlayerBox& box = info.boxes[p];
+			if (!(info.players&(1 << p)))
+			{
+				box.minX = basic_cast<uint16>(minX[p]);
+				box.maxX = basic_cast<uint16>(maxX[p]);
+				box.minY = basic_cast<uint16>(y);
+			}
+			else
+			{
+				if (minX[p] < box.minX) box.minX = basic_cast<uint16>(minX[p]);
+				if (maxX[p] > box.maxX) box.maxX = basic_cast<uint16>(maxX[p]);
+			}
+			box.maxY = basic_cast<uint16>(y);
+		}
+		info.players |= present;
+	}
+
+	for (uint32 p = 0; p < KINECT_SKELETON_COUNT; p++)
+	{
+		if (depthPlayerMap_[p] != -1) info.playerIndices[p] = basic_cast<uint32>(depthPlayerMap_[p] + 1);
+	}
+	playerMasksBuffers_->endWrite(timestamp, info);
+}
+
 bool KinectDevice::isValid()
 {
 	return valid_;
@@ -331,31 +608,15 @@ bool KinectDevice::isInitialized()
 
 KinectDevice::KinectStatusCode KinectDevice::getStatus()
 {
-	if (!instance_) return K_DEVICE_NOT_CONNECTED;
-
-	switch (instance_->NuiStatus())
-	{
-	case S_OK:
-		if (instance_->NuiInitialize(NUI_INITIALIZE_FLAG_USES_COLOR) != S_OK)
-			return K_DEVICE_IN_USE;
-		instance_->NuiShutdown();
-		return K_DEVICE_OK;
-	case S_NUI_INITIALIZING:			return K_DEVICE_INITIALIZING;
-	case E_NUI_NOTCONNECTED:			return K_DEVICE_NOT_CONNECTED;
-	case E_NUI_NOTGENUINE:				return K_DEVICE_NOT_VALID;
-	case E_NUI_NOTSUPPORTED:			return K_DEVICE_UNSUPPORTED;
-	case E_NUI_INSUFFICIENTBANDWIDTH:	return K_DEVICE_INSUFFICIENT_BANDWIDTH;
-	case E_NUI_NOTPOWERED:				return K_DEVICE_NOT_POWERED;
-	case E_NUI_NOTREADY:				return K_DEVICE_NOT_READY;
-	default:							return K_DEVICE_UNKNOWN;
-	}
+	if (!source_) return K_DEVICE_NOT_CONNECTED;
+	else return source_->getStatus();
 }
 
 std::string KinectDevice::getID()
 {
 	if (valid_)
 	{
-		std::string id = wstring_cast<std::string>(std::wstring(instance_->NuiUniqueId()));
+		std::string id = source_->getID();
 		if (id != "") return id;
 	}
 	
@@ -368,28 +629,34 @@ int32 KinectDevice::initialize(int32 flags, bool seatedMode, bool nearMode)
 	{
 		if (valid_)
 		{
-			HRESULT result = instance_->NuiInitialize(flags);
+			int32 result = source_->initialize(flags);
 			switch (result)
 			{
-			case E_NUI_SKELETAL_ENGINE_BUSY: return K_ERROR_SKELETON_IN_USE;
-			case E_NUI_DEVICE_IN_USE: return K_ERROR_DEVICE_IN_USE;
-			case S_OK:
+			case 0:
+				_NUI_IMAGE_RESOLUTION colorResolution, depthResolution;
+				colorResolution = depthResolution = NUI_IMAGE_RESOLUTION_INVALID;
+
+				// Capture threads only read these copies, a new canvas size takes a new initialization
+				canvasWidth_ = Config::canvas[id_].width;
+				canvasHeight_ = Config::canvas[id_].height;
+				reloadPose();
+
 				if (seatedMode) skeletonFlags_ = NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT;
 				else skeletonFlags_ = 0;
 				skeletonFrameEvent_ = CreateEvent(0, true, false, 0);
-				if (HasSkeletalEngine(instance_))
+				if (source_->hasSkeletalEngine())
 				{
-					skeletonEnabled_ = SUCCEEDED(instance_->NuiSkeletonTrackingEnable(skeletonFrameEvent_, skeletonFlags_));
+					skeletonEnabled_ = source_->enableSkeletonTracking(skeletonFrameEvent_, skeletonFlags_);
 					if (!skeletonEnabled_)
 					{
-						instance_->NuiShutdown();
+						source_->shutDown();
 						CloseHandle(skeletonFrameEvent_);
 						skeletonFrameEvent_ = 0;
 						return K_ERROR_SKELETON_TRACKING;
 					}
-					else KinectSkeleton::setResolution(Config::canvas[Globals::INSTANCE_ID].width, Config::canvas[Globals::INSTANCE_ID].height);
+					else KinectSkeleton::setResolution(Config::canvas[id_].width, Config::canvas[id_].height);
 				}
-				hierarchicalOri_ = Config::kinect[Globals::INSTANCE_ID].hierarchicalOri;
+				hierarchicalOri_ = Config::kinect[id_].hierarchicalOri;
 
 				initialized_ = true;
 
@@ -400,149 +667,215 @@ int32 KinectDevice::initialize(int32 flags, bool seatedMode, bool nearMode)
 				{
 					_NUI_IMAGE_TYPE type = NUI_IMAGE_TYPE_COLOR;
 					_NUI_IMAGE_RESOLUTION resolution = NUI_IMAGE_RESOLUTION_INVALID;
-					switch (Config::canvas[Globals::INSTANCE_ID].width)
+					switch (Config::canvas[id_].width)
 					{
 					case 80:
-						if (Config::canvas[Globals::INSTANCE_ID].height == 60)
+						if (Config::canvas[id_].height == 60)
 							resolution = NUI_IMAGE_RESOLUTION_640x480;
 						break;
 					case 320:
-						if (Config::canvas[Globals::INSTANCE_ID].height == 240)
+						if (Config::canvas[id_].height == 240)
 							resolution = NUI_IMAGE_RESOLUTION_640x480;
 						break;
 					case 640:
-						if (Config::canvas[Globals::INSTANCE_ID].height == 480)
+						if (Config::canvas[id_].height == 480)
 							resolution = NUI_IMAGE_RESOLUTION_640x480;
 						break;
 					default:
 						break;
 					}
-					colorStreamOpened_ = SUCCEEDED(instance_->NuiImageStreamOpen(type, resolution, 0, 3, colorFrameEvent_, &colorStreamHandle_));
+					colorStreamOpened_ = source_->openImageStream(KinectSource::K_COLOR_STREAM, type, resolution, colorFrameEvent_);
 					if (!colorStreamOpened_) Log::write("[KinectDevice] initialize()", "ERROR: Unable to open color stream.");
+					else colorResolution = resolution;
 				}
 
 				if (flags & (K_USE_DEPTH|K_USE_DEPTH_AND_PLAYER))
 				{
 					if (nearMode) depthFlags_ = NUI_IMAGE_STREAM_FLAG_ENABLE_NEAR_MODE;
 					else depthFlags_ = 0;
-					_NUI_IMAGE_TYPE type = HasSkeletalEngine(instance_)?NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX:NUI_IMAGE_TYPE_DEPTH;
+					_NUI_IMAGE_TYPE type = source_->hasSkeletalEngine()?NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX:NUI_IMAGE_TYPE_DEPTH;
 					_NUI_IMAGE_RESOLUTION resolution = NUI_IMAGE_RESOLUTION_INVALID;
-					switch (Config::canvas[Globals::INSTANCE_ID].width)
+					switch (Config::canvas[id_].width)
 					{
 					case 80:
-						if (Config::canvas[Globals::INSTANCE_ID].height == 60)
+						if (Config::canvas[id_].height == 60)
 							resolution = NUI_IMAGE_RESOLUTION_80x60;
 						break;
 					case 320:
-						if (Config::canvas[Globals::INSTANCE_ID].height == 240)
+						if (Config::canvas[id_].height == 240)
 							resolution = NUI_IMAGE_RESOLUTION_320x240;
 						break;
 					case 640:
-						if (Config::canvas[Globals::INSTANCE_ID].height == 480)
+						if (Config::canvas[id_].height == 480)
 							resolution = NUI_IMAGE_RESOLUTION_640x480;
 						break;
 					default:
 						break;
 					}
-					depthStreamOpened_ = SUCCEEDED(instance_->NuiImageStreamOpen(type, resolution, 0, 3, depthFrameEvent_, &depthStreamHandle_));
+					depthStreamOpened_ = source_->openImageStream(KinectSource::K_DEPTH_STREAM, type, resolution, depthFrameEvent_);
 					if (!depthStreamOpened_) Log::write("[KinectDevice] initialize()", "ERROR: Unable to open depth stream.");
-					else instance_->NuiImageStreamSetImageFrameFlags(depthStreamHandle_, depthFlags_);
+					else
+					{
+						source_->setImageStreamFlags(KinectSource::K_DEPTH_STREAM, depthFlags_);
+						depthResolution = resolution;
+					}
 				}
 
-				if (Config::kinect[Globals::INSTANCE_ID].rgbImage)
+				if (Config::kinect[id_].rgbImage)
 				{
 					if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 					{
-						std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
+						std::string segmentID = KinectManager::reformatDeviceID(id_);
 						uint32* pixels = SharedMemoryManager::createSharedObject<uint32>(segmentID, "colorPixels");
-						*pixels = Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width;
-						colorFrame_ = SharedMemoryManager::createSharedObject<uint8>(segmentID, "colorFrame", Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width*3);
+						*pixels = Config::canvas[id_].height*Config::canvas[id_].width;
+						colorFrame_ = SharedMemoryManager::createSharedObject<uint8>(segmentID, "colorFrame", Config::canvas[id_].height*Config::canvas[id_].width*3);
 					}
 					else
 					{
-						colorFrame_ = new uint8[Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width*3];
-						std::memset(colorFrame_, 255, Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width*3);
+						colorFrame_ = new uint8[Config::canvas[id_].height*Config::canvas[id_].width*3];
+						std::memset(colorFrame_, 255, Config::canvas[id_].height*Config::canvas[id_].width*3);
 					}
 				}
 				else colorFrame_ = 0;
-				if (Config::kinect[Globals::INSTANCE_ID].depthMap)
+				if (Config::kinect[id_].depthMap)
 				{
 					if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 					{
-						std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
+						std::string segmentID = KinectManager::reformatDeviceID(id_);
 						uint32* pixels = SharedMemoryManager::createSharedObject<uint32>(segmentID, "depthPixels");
-						*pixels = Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width;
-						depthFrame_ = SharedMemoryManager::createSharedObject<uint8>(segmentID, "depthFrame", Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width*3);
+						*pixels = Config::canvas[id_].height*Config::canvas[id_].width;
+						depthFrame_ = SharedMemoryManager::createSharedObject<uint8>(segmentID, "depthFrame", Config::canvas[id_].height*Config::canvas[id_].width*3);
 					}
 					else
 					{
-						depthFrame_ = new uint8[Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width*3];
-						std::memset(depthFrame_, 255, Config::canvas[Globals::INSTANCE_ID].height*Config::canvas[Globals::INSTANCE_ID].width*3);
+						depthFrame_ = new uint8[Config::canvas[id_].height*Config::canvas[id_].width*3];
+						std::memset(depthFrame_, 255, Config::canvas[id_].height*Config::canvas[id_].width*3);
 					}
 				}
 				else depthFrame_ = 0;
-				if (Config::kinect[Globals::INSTANCE_ID].skeletonTracking)
+				depthColors_ = (depthFrame_)?new uint32[65536]:0;
+				depthColorsDirty_ = true;
+				if (Config::kinect[id_].rawDepth && depthStreamOpened_)
+				{
+					// Two images, one being written while readers copy the other
+					uint32 nPixels = Config::canvas[id_].height*Config::canvas[id_].width;
+					if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
+					{
+						std::string segmentID = KinectManager::reformatDeviceID(id_);
+						rawDepthBuffers_ = SharedMemoryManager::createSharedObject< SharedImageBuffers<uint16> >(segmentID, "rawDepthBuffers");
+						rawDepthPixels_ = SharedMemoryManager::createSharedObject<uint16>(segmentID, "rawDepthPixels", nPixels*2);
+						depthPreviewRequests_ = SharedMemoryManager::createSharedObject<LONG>(segmentID, "depthPreviewRequests");
+						*depthPreviewRequests_ = 0;
+					}
+					else
+					{
+						rawDepthBuffers_ = new SharedImageBuffers<uint16>();
+						rawDepthPixels_ = new uint16[nPixels*2];
+						depthPreviewRequests_ = new LONG(0);
+					}
+					rawDepthBuffers_->setSize(Config::canvas[id_].width, Config::canvas[id_].height);
+				}
+				else
+				{
+					rawDepthBuffers_ = 0;
+					rawDepthPixels_ = 0;
+					depthPreviewRequests_ = 0;
+				}
+				depthPreviewSeen_ = 0;
+				depthPreviewTime_ = 0;
+				if (Config::kinect[id_].playerMasks && depthStreamOpened_)
+				{
+					if ((flags & K_USE_DEPTH_AND_PLAYER) && source_->hasSkeletalEngine())
+					{
+						// Masks rows are padded to whole 16 pixel words
+						uint32 stride = ((Config::canvas[id_].width + 15)/16)*2;
+						uint32 planesHeight = Config::canvas[id_].height*KINECT_SKELETON_COUNT;
+						if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
+						{
+							std::string segmentID = KinectManager::reformatDeviceID(id_);
+							playerMasksBuffers_ = SharedMemoryManager::createSharedObject< SharedImageBuffers<uint8, PlayerMasksInfo> >(segmentID, "playerMasksBuffers");
+							playerMasksPixels_ = SharedMemoryManager::createSharedObject<uint8>(segmentID, "playerMasksPixels", stride*planesHeight*2);
+						}
+						else
+						{
+							playerMasksBuffers_ = new SharedImageBuffers<uint8, PlayerMasksInfo>();
+							playerMasksPixels_ = new uint8[stride*planesHeight*2];
+						}
+						playerMasksBuffers_->setSize(stride, planesHeight);
+					}
+					else Log::write("[KinectDevice] initialize()", "ERROR: Player masks need the depth and player index stream.");
+				}
+				if (Config::kinect[id_].skeletonTracking)
 				{
 					if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 					{
-						std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
-						nSkeletons_ = SharedMemoryManager::createSharedObject<uint32>(segmentID, "nSkeletons");
-						*nSkeletons_ = 0;
-						skeletons_ = SharedMemoryManager::createSharedObject<KinectSkeleton>(segmentID, "skeletons", KINECT_SKELETON_COUNT);
-						skeletonMap_ = std::vector<int32>(KINECT_SKELETON_COUNT, -1);
-
-						float32* confidenceValue = SharedMemoryManager::createSharedObject<float32>(segmentID, "confidenceValue");
-						*confidenceValue = 0.0f;
+						std::string segmentID = KinectManager::reformatDeviceID(id_);
+						skeletonsSlots_ = SharedMemoryManager::createSharedObject< SharedFrameSlots<SkeletonsFrame> >(segmentID, "skeletonsSlots");
+						confidenceValue_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "confidenceValue");
+						*confidenceValue_ = 0.0f;
 					}
 					else
 					{
-						nSkeletons_ = new uint32(0);
-						skeletons_ = new KinectSkeleton[KINECT_SKELETON_COUNT];
-						skeletonMap_ = std::vector<int32>(KINECT_SKELETON_COUNT, -1);
+						skeletonsSlots_ = new SharedFrameSlots<SkeletonsFrame>();
+						confidenceValue_ = new float32(0.0f);
+					}
+					frameNotifier_ = new FrameNotifier();
+					frameNotifier_->open(KinectManager::reformatDeviceID(id_));
+					nSkeletons_ = 0;
+					skeletons_ = new KinectSkeleton[KINECT_SKELETON_COUNT];
+					skeletonMap_ = std::vector<int32>(KINECT_SKELETON_COUNT, -1);
+					if (Config::jointSmoothing.stage == Config::SMOOTHING_SENSORS)
+					{
+						smoothingFilter_ = new JointOneEuroFilter();
+						smoothingFilter_->setParameters(Config::jointSmoothing.minCutoff, Config::jointSmoothing.beta, Config::jointSmoothing.derivativeCutoff);
 					}
 				}
 				else
 				{
 					nSkeletons_ = 0;
 					skeletons_ = 0;
+					smoothingFilter_ = 0;
+					confidenceValue_ = 0;
+					skeletonsSlots_ = 0;
+					frameNotifier_ = 0;
 				}
 
-				LONG angle;
-				if (SUCCEEDED(instance_->NuiCameraElevationGetAngle(&angle)))
-					elevationAngle_ = basic_cast<int32>(angle);
+				int32 angle;
+				if (source_->getElevationAngle(angle)) elevationAngle_ = angle;
 
 				if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 				{
-					std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
+					std::string segmentID = KinectManager::reformatDeviceID(id_);
+					// Created by the master, a slave launched on its own has no watchdog to count frames for
+					slaveState_ = SharedMemoryManager::getSharedObject<SharedSlaveState>(segmentID, "slaveState");
 					rotationX_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "rotationX");
 					rotationY_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "rotationY");
 					rotationZ_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "rotationZ");
-					*rotationX_ = DEG2RAD32(basic_cast<float32>(-getElevationAngle()));
-					*rotationY_ = Config::kinect[Globals::INSTANCE_ID].rotation.y;
-					*rotationZ_ = Config::kinect[Globals::INSTANCE_ID].rotation.z;
 					translationX_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "translationX");
 					translationY_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "translationY");
 					translationZ_ = SharedMemoryManager::createSharedObject<float32>(segmentID, "translationZ");
-					*translationX_ = Config::kinect[Globals::INSTANCE_ID].translation.x;
-					*translationY_ = Config::kinect[Globals::INSTANCE_ID].translation.y;
-					*translationZ_ = Config::kinect[Globals::INSTANCE_ID].translation.z;
 				}
 				else
 				{
-					rotationX_ = new float32(DEG2RAD32(basic_cast<float32>(-getElevationAngle())));
-					rotationY_ = new float32(Config::kinect[Globals::INSTANCE_ID].rotation.y);
-					rotationZ_ = new float32(Config::kinect[Globals::INSTANCE_ID].rotation.z);
-					translationX_ = new float32(Config::kinect[Globals::INSTANCE_ID].translation.x);
-					translationY_ = new float32(Config::kinect[Globals::INSTANCE_ID].translation.y);
-					translationZ_ = new float32(Config::kinect[Globals::INSTANCE_ID].translation.z);
+					rotationX_ = new float32;
+					rotationY_ = new float32;
+					rotationZ_ = new float32;
+					translationX_ = new float32;
+					translationY_ = new float32;
+					translationZ_ = new float32;
 				}
+				updatePose();
+
+				if (Config::recording.enabled && !Config::replay.enabled)
+					startRecording(colorResolution, depthResolution);
 
+				playerMapDirty_ = true;
 				processStopEvent_ = CreateEvent(0, true, false, 0);
-				processThread_ = CreateThread(0, 0, processThread, this, 0, 0);
+				startCaptureWorkers();
 
 				return 0;
 			default:
-				return K_ERROR_UNKNOWN;
+				return result;
 			}
 		}
 		else return K_ERROR_INVALID_DEVICE;
@@ -557,17 +890,24 @@ void KinectDevice::shutDown()
 		if (processStopEvent_)
 		{
 			SetEvent(processStopEvent_);
-			if (processThread_)
+			for (uint32 i = 0; i < K_CAPTURE_STREAMS; i++)
 			{
-				WaitForSingleObject(processThread_, INFINITE);
-				CloseHandle(processThread_);
-				processThread_ = 0;
+				if (workers_[i].thread)
+				{
+					WaitForSingleObject(workers_[i].thread, INFINITE);
+					CloseHandle(workers_[i].thread);
+					workers_[i].thread = 0;
+				}
 			}
 			CloseHandle(processStopEvent_);
 			processStopEvent_ = 0;
 		}
 
-		instance_->NuiShutdown();
+		// Closing the recorder flushes the queued frames and writes the index
+		delete recorder_;
+		recorder_ = 0;
+
+		source_->shutDown();
 
 		if (colorFrameEvent_ && colorFrameEvent_ != INVALID_HANDLE_VALUE)
 			CloseHandle(colorFrameEvent_);
@@ -577,14 +917,13 @@ void KinectDevice::shutDown()
 			CloseHandle(skeletonFrameEvent_);
 
 		initialized_ = colorStreamOpened_ = depthStreamOpened_ = skeletonEnabled_ = false;
-		colorStreamHandle_ = depthStreamHandle_ = 0;
 		colorFrameEvent_ = depthFrameEvent_ = skeletonFrameEvent_ = 0;
-		processStopEvent_ = processThread_ = 0;
+		processStopEvent_ = 0;
 		if (colorFrame_)
 		{
 			if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 			{
-				std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
+				std::string segmentID = KinectManager::reformatDeviceID(id_);
 				SharedMemoryManager::removeSharedObject<uint32>(segmentID, "colorPixels");
 				SharedMemoryManager::removeSharedObject<uint8>(segmentID, "colorFrame");
 			}
@@ -594,35 +933,79 @@ void KinectDevice::shutDown()
 		{
 			if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 			{
-				std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
+				std::string segmentID = KinectManager::reformatDeviceID(id_);
 				SharedMemoryManager::removeSharedObject<uint32>(segmentID, "depthPixels");
 				SharedMemoryManager::removeSharedObject<uint8>(segmentID, "depthFrame");
 			}
 			else delete[] depthFrame_;
+			delete[] depthColors_;
+		}
+		if (rawDepthBuffers_)
+		{
+			if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
+			{
+				std::string segmentID = KinectManager::reformatDeviceID(id_);
+				SharedMemoryManager::removeSharedObject< SharedImageBuffers<uint16> >(segmentID, "rawDepthBuffers");
+				SharedMemoryManager::removeSharedObject<uint16>(segmentID, "rawDepthPixels");
+				SharedMemoryManager::removeSharedObject<LONG>(segmentID, "depthPreviewRequests");
+			}
+			else
+			{
+				delete rawDepthBuffers_;
+				delete[] rawDepthPixels_;
+				delete depthPreviewRequests_;
+			}
+		}
+		if (playerMasksBuffers_)
+		{
+			if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
+			{
+				std::string segmentID = KinectManager::reformatDeviceID(id_);
+				SharedMemoryManager::removeSharedObject< SharedImageBuffers<uint8, PlayerMasksInfo> >(segmentID, "playerMasksBuffers");
+				SharedMemoryManager::removeSharedObject<uint8>(segmentID, "playerMasksPixels");
+			}
+			else
+			{
+				delete playerMasksBuffers_;
+				delete[] playerMasksPixels_;
+			}
 		}
 		if (skeletons_)
 		{
 			if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 			{
-				std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
-				SharedMemoryManager::removeSharedObject<uint32>(segmentID, "nSkeletons");
-				SharedMemoryManager::removeSharedObject<KinectSkeleton>(segmentID, "skeletons");
+				std::string segmentID = KinectManager::reformatDeviceID(id_);
+				SharedMemoryManager::removeSharedObject< SharedFrameSlots<SkeletonsFrame> >(segmentID, "skeletonsSlots");
 				SharedMemoryManager::removeSharedObject<float32>(segmentID, "confidenceValue");
 			}
 			else
 			{
-				delete nSkeletons_;
-				delete[] skeletons_;
+				delete skeletonsSlots_;
+				delete confidenceValue_;
 			}
+			delete[] skeletons_;
+			delete smoothingFilter_;
+			delete frameNotifier_;
 		}
 		colorFrame_ = 0;
 		depthFrame_ = 0;
+		depthColors_ = 0;
+		rawDepthBuffers_ = 0;
+		rawDepthPixels_ = 0;
+		depthPreviewRequests_ = 0;
+		playerMasksBuffers_ = 0;
+		playerMasksPixels_ = 0;
 		nSkeletons_ = 0;
 		skeletons_ = 0;
+		smoothingFilter_ = 0;
+		confidenceValue_ = 0;
+		skeletonsSlots_ = 0;
+		frameNotifier_ = 0;
+		slaveState_ = 0;
 
 		if (Config::system.currentMode == Config::KINECT_SINGLE_DEVICE)
 		{
-			std::string segmentID = KinectManager::reformatDeviceID(Globals::INSTANCE_ID);
+			std::string segmentID = KinectManager::reformatDeviceID(id_);
 			SharedMemoryManager::removeSharedObject<float32>(segmentID, "rotationX");
 			SharedMemoryManager::removeSharedObject<float32>(segmentID, "rotationY");
 			SharedMemoryManager::removeSharedObject<float32>(segmentID, "rotationZ");
@@ -663,10 +1046,10 @@ void KinectDevice::setSeatedMode(bool seated)
 			skeletonFlags_ = newFlags;
 			if (skeletonEnabled_)
 			{
-				skeletonEnabled_ = SUCCEEDED(instance_->NuiSkeletonTrackingEnable(skeletonFrameEvent_, skeletonFlags_));
+				skeletonEnabled_ = source_->enableSkeletonTracking(skeletonFrameEvent_, skeletonFlags_);
 				if (!skeletonEnabled_)
 				{
-					instance_->NuiShutdown();
+					source_->shutDown();
 					CloseHandle(skeletonFrameEvent_);
 					skeletonFrameEvent_ = 0;
 					Log::write("[KinectDevice] setSeatedMode()", "ERROR: Unable to enable skeleton tracking.");
@@ -683,6 +1066,15 @@ void KinectDevice::setHierarchicalOri(bool hierarchical)
 	else Log::write("[KinectDevice] setHierarchicalOri()", "ERROR: Device not initialized.");
 }
 
+void KinectDevice::reloadPose()
+{
+	// Taken from the configuration here only, so capture threads never read it while it is edited
+	EnterCriticalSection(&poseLock_);
+	rotation_ = Config::kinect[id_].rotation;
+	translation_ = Config::kinect[id_].translation;
+	LeaveCriticalSection(&poseLock_);
+}
+
 void KinectDevice::setNearMode(bool nearMode)
 {
 	if (initialized_)
@@ -695,7 +1087,7 @@ void KinectDevice::setNearMode(bool nearMode)
 		if (newFlags != depthFlags_)
 		{
 			depthFlags_ = newFlags;
-			if (depthStreamOpened_) instance_->NuiImageStreamSetImageFrameFlags(depthStreamHandle_, depthFlags_);
+			if (depthStreamOpened_) source_->setImageStreamFlags(KinectSource::K_DEPTH_STREAM, depthFlags_);
 		}
 	}
 	else Log::write("[KinectDevice] setNearMode()", "ERROR: Device not initialized.");
@@ -713,7 +1105,11 @@ uint8* KinectDevice::getColorFrame()
 
 uint8* KinectDevice::getDepthFrame()
 {
-	if (initialized_) return depthFrame_;
+	if (initialized_)
+	{
+		requestDepthPreview();
+		return depthFrame_;
+	}
 	else
 	{
 		Log::write("[KinectDevice] getDepthFrame()", "ERROR: Device not initialized.");
@@ -721,9 +1117,60 @@ uint8* KinectDevice::getDepthFrame()
 	}
 }
 
+void KinectDevice::requestDepthPreview()
+{
+	if (depthPreviewRequests_) InterlockedIncrement(depthPreviewRequests_);
+}
+
+bool KinectDevice::getRawDepthFrame(RawDepthFrame& frame)
+{
+	if (initialized_) return readRawDepthFrame(rawDepthBuffers_, rawDepthPixels_, frame);
+	else
+	{
+		Log::write("[KinectDevice] getRawDepthFrame()", "ERROR: Device not initialized.");
+		return false;
+	}
+}
+
+bool KinectDevice::getPlayerMasksFrame(PlayerMasksFrame& frame)
+{
+	if (initialized_) return readPlayerMasksFrame(playerMasksBuffers_, playerMasksPixels_, frame);
+	else
+	{
+		Log::write("[KinectDevice] getPlayerMasksFrame()", "ERROR: Device not initialized.");
+		return false;
+	}
+}
+
+bool KinectDevice::readRawDepthFrame(const SharedImageBuffers<uint16>* buffers, const uint16* pixels, RawDepthFrame& frame)
+{
+	if (!buffers || !pixels || !buffers->getPixelCount()) return false;
+
+	// The frame keeps its storage between reads, so it only reallocates when the resolution changes
+	frame.pixels.resize(buffers->getPixelCount());
+	if (!buffers->read(pixels, &frame.pixels[0], frame.timestamp, frame.frameNumber)) return false;
+
+	frame.width = buffers->getWidth();
+	frame.height = buffers->getHeight();
+	return true;
+}
+
+bool KinectDevice::readPlayerMasksFrame(const SharedImageBuffers<uint8, PlayerMasksInfo>* buffers, const uint8* pixels, PlayerMasksFrame& frame)
+{
+	if (!buffers || !pixels || !buffers->getPixelCount()) return false;
+
+	frame.masks.resize(buffers->getPixelCount());
+	if (!buffers->read(pixels, &frame.masks[0], frame.timestamp, frame.frameNumber, &frame.info)) return false;
+
+	frame.width = frame.info.width;
+	frame.height = buffers->getHeight()/KINECT_SKELETON_COUNT;
+	frame.stride = buffers->getWidth();
+	return true;
+}
+
 uint32 KinectDevice::getNumberOfSkeletons()
 {
-	if (initialized_) return (nSkeletons_)?*nSkeletons_:0;
+	if (initialized_) return nSkeletons_;
 	else
 	{
 		Log::write("[KinectDevice] getNumberOfSkeletons()", "ERROR: Device not initialized.");
@@ -741,6 +1188,41 @@ KinectSkeleton* KinectDevice::getSkeletons()
 	}
 }
 
+bool KinectDevice::getSkeletonsFrame(SkeletonsFrame& frame)
+{
+	if (initialized_) return (skeletonsSlots_)?skeletonsSlots_->read(frame):false;
+	else
+	{
+		Log::write("[KinectDevice] getSkeletonsFrame()", "ERROR: Device not initialized.");
+		return false;
+	}
+}
+
+const SharedFrameSlots<KinectDevice::SkeletonsFrame>* KinectDevice::getSkeletonsSlots()
+{
+	return skeletonsSlots_;
+}
+
+float32 KinectDevice::getConfidenceValue()
+{
+	if (initialized_) return (confidenceValue_)?*confidenceValue_:0.0f;
+	else
+	{
+		Log::write("[KinectDevice] getConfidenceValue()", "ERROR: Device not initialized.");
+		return 0.0f;
+	}
+}
+
+uint32 KinectDevice::getSkeletonsFrameID()
+{
+	if (initialized_) return (skeletonsSlots_)?skeletonsSlots_->getPublished():0;
+	else
+	{
+		Log::write("[KinectDevice] getSkeletonsFrameID()", "ERROR: Device not initialized.");
+		return 0;
+	}
+}
+
 bool KinectDevice::getRotation(float32& rotationX, float32& rotationY, float32& rotationZ)
 {
 	if (initialized_)
@@ -791,7 +1273,7 @@ int32 KinectDevice::getElevationAngle()
 
 int32 KinectDevice::getMinElevationAngle()
 {
-	if (initialized_)	return Config::kinect[Globals::INSTANCE_ID].minElevationAngle;
+	if (initialized_)	return Config::kinect[id_].minElevationAngle;
 	else Log::write("[KinectDevice] getMinElevationAngle()", "ERROR: Device not initialized.");
 
 	return 0;
@@ -799,7 +1281,7 @@ int32 KinectDevice::getMinElevationAngle()
 
 int32 KinectDevice::getMaxElevationAngle()
 {
-	if (initialized_)	return Config::kinect[Globals::INSTANCE_ID].maxElevationAngle;
+	if (initialized_)	return Config::kinect[id_].maxElevationAngle;
 	else Log::write("[KinectDevice] getMaxElevationAngle()", "ERROR: Device not initialized.");
 
 	return 0;
@@ -807,37 +1289,39 @@ int32 KinectDevice::getMaxElevationAngle()
 
 void KinectDevice::recomputeElevationAngleLimits()
 {
-	LONG angle;
-	if (SUCCEEDED(instance_->NuiCameraElevationGetAngle(&angle)))
-		elevationAngle_ = basic_cast<int32>(angle);
-	if (SUCCEEDED(instance_->NuiCameraElevationSetAngle(KINECT_MIN_TILT_ANGLE)))
+	if (!valid_) return;
+
+	int32 angle;
+	if (source_->getElevationAngle(angle))
+		elevationAngle_ = angle;
+	if (source_->setElevationAngle(KINECT_MIN_TILT_ANGLE))
 	{
-		if (SUCCEEDED(instance_->NuiCameraElevationGetAngle(&angle)))
+		if (source_->getElevationAngle(angle))
 		{
-			Config::kinect[Globals::INSTANCE_ID].minElevationAngle = basic_cast<int32>(angle);
-			Config::kinect[Globals::INSTANCE_ID].maxElevationAngle = Config::kinect[Globals::INSTANCE_ID].minElevationAngle + KINECT_MAX_TILT_ANGLE - KINECT_MIN_TILT_ANGLE;
+			Config::kinect[id_].minElevationAngle = angle;
+			Config::kinect[id_].maxElevationAngle = Config::kinect[id_].minElevationAngle + KINECT_MAX_TILT_ANGLE - KINECT_MIN_TILT_ANGLE;
 		}
 	}
-	if (SUCCEEDED(instance_->NuiCameraElevationSetAngle(Config::kinect[Globals::INSTANCE_ID].maxElevationAngle)))
+	if (source_->setElevationAngle(Config::kinect[id_].maxElevationAngle))
 	{
-		if (SUCCEEDED(instance_->NuiCameraElevationGetAngle(&angle)))
+		if (source_->getElevationAngle(angle))
 		{
-			Config::kinect[Globals::INSTANCE_ID].maxElevationAngle = basic_cast<int32>(angle);
-			Config::kinect[Globals::INSTANCE_ID].minElevationAngle = Config::kinect[Globals::INSTANCE_ID].maxElevationAngle - KINECT_MAX_TILT_ANGLE + KINECT_MIN_TILT_ANGLE;
+			Config::kinect[id_].maxElevationAngle = angle;
+			Config::kinect[id_].minElevationAngle = Config::kinect[id_].maxElevationAngle - KINECT_MAX_TILT_ANGLE + KINECT_MIN_TILT_ANGLE;
 		}
 	}
-	if (SUCCEEDED(instance_->NuiCameraElevationSetAngle(Config::kinect[Globals::INSTANCE_ID].minElevationAngle)))
-		if (SUCCEEDED(instance_->NuiCameraElevationGetAngle(&angle)))
-			Config::kinect[Globals::INSTANCE_ID].minElevationAngle = basic_cast<int32>(angle);
-	instance_->NuiCameraElevationSetAngle(elevationAngle_);
+	if (source_->setElevationAngle(Config::kinect[id_].minElevationAngle))
+		if (source_->getElevationAngle(angle))
+			Config::kinect[id_].minElevationAngle = angle;
+	source_->setElevationAngle(elevationAngle_);
 }
 
 void KinectDevice::setElevationAngle(int32 angle)
 {
 	if (initialized_)
 	{
-		angle = std::max(std::min(angle, Config::kinect[Globals::INSTANCE_ID].maxElevationAngle), Config::kinect[Globals::INSTANCE_ID].minElevationAngle);
-		if (SUCCEEDED(instance_->NuiCameraElevationSetAngle(basic_cast<LONG>(angle))))
+		angle = std::max(std::min(angle, Config::kinect[id_].maxElevationAngle), Config::kinect[id_].minElevationAngle);
+		if (source_->setElevationAngle(angle))
 			elevationAngle_ = angle;
 		else Log::write("[KinectDevice] setElevationAngle()", "ERROR: Unable to set elevation angle.");
 	}
@@ -848,10 +1332,20 @@ float32 KinectDevice::getFPS()
 {
 	if (initialized_)
 	{
-		if (depthStreamOpened_) return depthFPS_;
-		if (skeletonEnabled_) return skeletonFPS_;
-		return colorFPS_;
+		if (depthStreamOpened_) return workers_[K_DEPTH_CAPTURE].fps;
+		if (skeletonEnabled_) return workers_[K_SKELETON_CAPTURE].fps;
+		return workers_[K_COLOR_CAPTURE].fps;
+	}
+	else
+	{
+		Log::write("[KinectDevice] getFPS()", "ERROR: Device not initialized.");
+		return 0.0f;
 	}
+}
+
+float32 KinectDevice::getFPS(CaptureStream stream)
+{
+	if (initialized_ && stream < K_CAPTURE_STREAMS) return workers_[stream].fps;
 	else
 	{
 		Log::write("[KinectDevice] getFPS()", "ERROR: Device not initialized.");
@@ -859,90 +1353,153 @@ float32 KinectDevice::getFPS()
 	}
 }
 
-DWORD WINAPI KinectDevice::processThread(LPVOID param)
+float32 KinectDevice::getLatency(CaptureStream stream)
 {
-	KinectDevice* pThis = reinterpret_cast<KinectDevice*>(param);
-	pThis->processThread();
+	if (initialized_ && stream < K_CAPTURE_STREAMS) return workers_[stream].latency;
+	else
+	{
+		Log::write("[KinectDevice] getLatency()", "ERROR: Device not initialized.");
+		return 0.0f;
+	}
+}
 
-	return 0;
+bool KinectDevice::hasCaptureAllocations(CaptureStream stream)
+{
+	if (initialized_ && stream < K_CAPTURE_STREAMS) return workers_[stream].allocating;
+	else
+	{
+		Log::write("[KinectDevice] hasCaptureAllocations()", "ERROR: Device not initialized.");
+		return false;
+	}
+}
+
+float32 KinectDevice::getSmoothingLatency()
+{
+	if (initialized_) return (smoothingFilter_)?smoothingFilter_->getLatency():0.0f;
+	else
+	{
+		Log::write("[KinectDevice] getSmoothingLatency()", "ERROR: Device not initialized.");
+		return 0.0f;
+	}
 }
 
-void KinectDevice::processThread()
+void KinectDevice::updatePose()
 {
-	const uint32 nEvents = 4;
-	HANDLE events[nEvents] = {processStopEvent_, colorFrameEvent_, depthFrameEvent_, skeletonFrameEvent_};
+	EnterCriticalSection(&poseLock_);
+	Vector rotation = rotation_;
+	Vector translation = translation_;
+	LeaveCriticalSection(&poseLock_);
+
+	if (rotationX_) *rotationX_ = DEG2RAD32(basic_cast<float32>(-getElevationAngle()));
+	if (rotationY_) *rotationY_ = rotation.y;
+	if (rotationZ_) *rotationZ_ = rotation.z;
+	if (translationX_) *translationX_ = translation.x;
+	if (translationY_) *translationY_ = translation.y;
+	if (translationZ_) *translationZ_ = translation.z;
+}
 
-	uint32 colorFrames = 0;
-	uint32 depthFrames = 0;
-	uint32 skeletonFrames = 0;
-	colorFPS_ = 0.0f;
-	depthFPS_ = 0.0f;
-	skeletonFPS_ = 0.0f;
-	Timer::startCount("colorFramerate");
-	Timer::startCount("depthFramerate");
-	Timer::startCount("skeletonFramerate");
+void KinectDevice::startCaptureWorkers()
+{
+	bool enabled[K_CAPTURE_STREAMS] = {colorStreamOpened_, depthStreamOpened_, skeletonEnabled_};
+	int32 priorities[K_CAPTURE_STREAMS] = {Config::captureThreads.colorPriority, Config::captureThreads.depthPriority, Config::captureThreads.skeletonPriority};
+	uint32 affinities[K_CAPTURE_STREAMS] = {Config::captureThreads.colorAffinity, Config::captureThreads.depthAffinity, Config::captureThreads.skeletonAffinity};
 
-	bool exit = false;
-	while (!exit)
+	AllocationCounter::install();
+
+	// The pose is refreshed by one worker only, preferring the stream that runs most often
+	poseStream_ = skeletonEnabled_?K_SKELETON_CAPTURE:(depthStreamOpened_?K_DEPTH_CAPTURE:K_COLOR_CAPTURE);
+
+	for (uint32 i = 0; i < K_CAPTURE_STREAMS; i++)
 	{
-		uint32 eventIndex = WaitForMultipleObjects(nEvents, events, false, 100);
-		switch (eventIndex)
+		workers_[i].fps = 0.0f;
+		workers_[i].latency = 0.0f;
+		workers_[i].allocating = false;
+		if (!enabled[i]) continue;
+
+		// Created suspended so the priority and affinity apply before the first frame
+		workers_[i].thread = CreateThread(0, 0, captureThread, &workers_[i], CREATE_SUSPENDED, 0);
+		if (!workers_[i].thread)
 		{
-		case WAIT_TIMEOUT:
-			break;
-		case WAIT_OBJECT_0:
-			exit = true;
-			break;
-		case WAIT_OBJECT_0 + 1:
-			obtainColorFrame();
-			colorFrames++;
-			break;
-		case WAIT_OBJECT_0 + 2:
-			obtainDepthFrame();
-			depthFrames++;
-			break;
-		case WAIT_OBJECT_0 + 3:
-			obtainSkeletonsFrame();
-			skeletonFrames++;
-			break;
-		default:
-			break;
+			Log::write("[KinectDevice] startCaptureWorkers()", "ERROR: Unable to create capture thread.");
+			continue;
 		}
 
-		if (rotationX_) *rotationX_ = DEG2RAD32(basic_cast<float32>(-getElevationAngle()));
-		if (rotationY_) *rotationY_ = Config::kinect[Globals::INSTANCE_ID].rotation.y;
-		if (rotationZ_) *rotationZ_ = Config::kinect[Globals::INSTANCE_ID].rotation.z;
-		if (translationX_) *translationX_ = Config::kinect[Globals::INSTANCE_ID].translation.x;
-		if (translationY_) *translationY_ = Config::kinect[Globals::INSTANCE_ID].translation.y;
-		if (translationZ_) *translationZ_ = Config::kinect[Globals::INSTANCE_ID].translation.z;
+		if (!SetThreadPriority(workers_[i].thread, priorities[i]))
+			Log::write("[KinectDevice] startCaptureWorkers()", "ERROR: Unable to set capture thread priority.");
+		if (affinities[i] && !SetThreadAffinityMask(workers_[i].thread, affinities[i]))
+			Log::write("[KinectDevice] startCaptureWorkers()", "ERROR: Unable to set capture thread affinity.");
+		ResumeThread(workers_[i].thread);
+	}
+}
+
+DWORD WINAPI KinectDevice::captureThread(LPVOID param)
+{
+	CaptureWorker* worker = reinterpret_cast<CaptureWorker*>(param);
+	worker->device->captureThread(*worker);
+
+	return 0;
+}
+
+void KinectDevice::captureThread(CaptureWorker& worker)
+{
+	HANDLE frameEvent = skeletonFrameEvent_;
+	if (worker.stream == K_COLOR_CAPTURE) frameEvent = colorFrameEvent_;
+	else if (worker.stream == K_DEPTH_CAPTURE) frameEvent = depthFrameEvent_;
+
+	const uint32 nEvents = 2;
+	HANDLE events[nEvents] = {processStopEvent_, frameEvent};
 
-		if (depthFrames)
+	uint32 frames = 0;
+	uint32 capturedFrames = 0;
+	uint64 latencies = 0;
+	uint64 countStart = Clock::getTime();
+	const uint64 second = Clock::fromMilliseconds(1000);
+
+	bool exit = false;
+	while (!exit)
+	{
+		uint32 eventIndex = WaitForMultipleObjects(nEvents, events, false, 100);
+		if (eventIndex == WAIT_OBJECT_0) exit = true;
+		else if (eventIndex == WAIT_OBJECT_0 + 1)
 		{
-			if (Timer::getCountTime("depthFramerate") >= 1000)
+			// With a thread per stream the wake up follows the event closely, so latency is measured from it
+			uint64 signaled = Clock::getTime();
+			uint32 allocations = AllocationCounter::getCount();
+			switch (worker.stream)
 			{
-				depthFPS_ = basic_cast<float32>(depthFrames)*1000.0f/basic_cast<float32>(Timer::resetCount("depthFramerate"));
-				depthFrames = 0;
+			case K_COLOR_CAPTURE:
+				obtainColorFrame();
+				break;
+			case K_DEPTH_CAPTURE:
+				obtainDepthFrame();
+				break;
+			default:
+				obtainSkeletonsFrame();
+				break;
 			}
-		}
-		else if (skeletonFrames)
-		{
-			if (Timer::getCountTime("skeletonFramerate") >= 1000)
+			latencies += Clock::getTime() - signaled;
+			frames++;
+			if (slaveState_) InterlockedIncrement(&slaveState_->frames[worker.stream]);
+
+			// Once warmed up, debug builds check capturing a frame leaves the heap alone
+			if (capturedFrames < CAPTURE_WARMUP_FRAMES) capturedFrames++;
+			else if (AllocationCounter::getCount() != allocations && !worker.allocating)
 			{
-				skeletonFPS_ = basic_cast<float32>(skeletonFrames)*1000.0f/basic_cast<float32>(Timer::resetCount("skeletonFramerate"));
-				skeletonFrames = 0;
+				Log::write("[KinectDevice] captureThread()", "ERROR: Heap allocation in the steady state capture path.");
+				worker.allocating = true;
 			}
 		}
-		else if (colorFrames)
+
+		if (worker.stream == poseStream_) updatePose();
+
+		uint64 now = Clock::getTime();
+		if (now - countStart >= second)
 		{
-			if (Timer::getCountTime("colorFramerate") >= 1000)
-			{
-				colorFPS_ = basic_cast<float32>(colorFrames)*1000.0f/basic_cast<float32>(Timer::resetCount("colorFramerate"));
-				colorFrames = 0;
-			}
+			worker.fps = basic_cast<float32>(frames)/Clock::toSeconds(now - countStart);
+			worker.latency = (frames)?basic_cast<float32>(Clock::toMilliseconds(latencies/frames)):0.0f;
+			countStart = now;
+			frames = 0;
+			latencies = 0;
 		}
 	}
-
-	Timer::endCount("colorFramerate");
-	Timer::endCount("depthFramerate");
-	Timer::endCount("skeletonFramerate");
 }
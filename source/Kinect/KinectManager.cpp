@@ -21,25 +21,73 @@
 
 #include "Kinect/KinectManager.h"
 
+#include "Files/Filesystem.h"
+#include "Globals/Config.h"
 #include "Kinect/KinectDevice.h"
+#include "Kinect/KinectNuiSource.h"
+#include "Kinect/KinectRecording.h"
+#include "Kinect/KinectRecordingReader.h"
+#include "Kinect/KinectReplaySource.h"
 #include "Tools/Log.h"
 #include <Windows.h>
 #include <NuiApi.h>
 
 
-bool						KinectManager::initialized_	= false;
-uint32						KinectManager::nDevices_	= 0;
-std::vector<std::string>	KinectManager::devicesIDs_;
+bool									KinectManager::initialized_	= false;
+uint32									KinectManager::nDevices_	= 0;
+std::vector<KinectManager::DeviceEntry>	KinectManager::devices_;
 
 
+void KinectManager::initializeReplay()
+{
+	nDevices_ = 0;
+	devices_.clear();
+
+	std::vector<std::string> files = Filesystem::listFiles(Config::replay.path, "mkrec");
+	for (uint32 i = 0; i < files.size(); i++)
+	{
+		KinectRecording::FileHeader header;
+		if (KinectRecordingReader::readHeader(files[i], header))
+		{
+			std::string deviceID = std::string(header.deviceID);
+			if (!isValidDeviceID(deviceID))
+			{
+				DeviceEntry entry;
+				entry.deviceID = deviceID;
+				entry.segmentID = reformatDeviceID(entry.deviceID);
+				entry.replayFile = files[i];
+				entry.connected = 1;
+				nDevices_++;
+				devices_.push_back(entry);
+			}
+			else Log::write("[KinectManager] initializeReplay()", "ERROR: Device " + deviceID + " already recorded, ignoring " + files[i] + ".");
+		}
+	}
+
+	Log::write("[KinectManager] initialize():");
+	if (nDevices_ > 0)
+	{
+		Log::write("        Replayed devices");
+		for (uint32 i = 0; i < nDevices_; i++)
+			Log::write("                ID: " + basic_cast<std::string>(i) + " (" + devices_[i].deviceID + ")", devices_[i].replayFile);
+	}
+	else Log::write("        Replayed devices", 0);
+}
+
 void KinectManager::initialize()
 {
-	if (!initialized_)
+	if (!initialized_ && Config::replay.enabled)
+	{
+		// isValidDeviceID() is used while the registry is filled, so mark it initialized first
+		initialized_ = true;
+		initializeReplay();
+	}
+	else if (!initialized_)
 	{
 		NuiSetDeviceStatusCallback(&deviceStatusCallback, 0);
 
 		nDevices_ = 0;
-		devicesIDs_.clear();
+		devices_.clear();
 
 		int32 connectedDevices;
 		if(FAILED(NuiGetSensorCount(&connectedDevices))) connectedDevices = 0;
@@ -48,14 +96,20 @@ void KinectManager::initialize()
 		std::vector<std::string> connectedDevicesStatus;
 		for (int32 i = 0; i < connectedDevices; i++)
 		{
-			KinectDevice deviceAux = KinectDevice(i);
+			KinectDevice deviceAux(i);
 			connectedDevicesIDs.push_back(deviceAux.getID());
 			switch (deviceAux.getStatus())
 			{
 			case KinectDevice::K_DEVICE_OK:
-				nDevices_++;
-				devicesIDs_.push_back(deviceAux.getID());
-				connectedDevicesStatus.push_back("OK");
+				{
+					DeviceEntry entry;
+					entry.deviceID = deviceAux.getID();
+					entry.segmentID = reformatDeviceID(entry.deviceID);
+					entry.connected = 1;
+					nDevices_++;
+					devices_.push_back(entry);
+					connectedDevicesStatus.push_back("OK");
+				}
 				break;
 			case KinectDevice::K_DEVICE_IN_USE:
 				connectedDevicesStatus.push_back("In use");
@@ -101,7 +155,7 @@ void KinectManager::initialize()
 			{
 				Log::write("        Available devices");
 				for (uint32 i = 0; i < nDevices_; i++)
-					Log::write("                ID: " + basic_cast<std::string>(i) + " (" + devicesIDs_[i] + ")");
+					Log::write("                ID: " + basic_cast<std::string>(i) + " (" + devices_[i].deviceID + ")");
 			}
 			else Log::write("        Available devices", 0);
 		}
@@ -117,7 +171,7 @@ void KinectManager::destroy()
 	if (initialized_)
 	{
 		nDevices_ = 0;
-		devicesIDs_.clear();
+		devices_.clear();
 		initialized_ = false;
 	}
 	else Log::write("[KinectManager] destroy()", "ERROR: KinectManager not initialized.");
@@ -142,7 +196,7 @@ KinectDevice* KinectManager::getDevicePointer(uint32 index)
 {
 	if (initialized_)
 	{
-		if (index < nDevices_) return new KinectDevice(devicesIDs_[index]);
+		if (index < nDevices_) return new KinectDevice(devices_[index].deviceID);
 		else return 0;
 	}
 	else
@@ -166,31 +220,41 @@ KinectDevice* KinectManager::getDevicePointer(const std::string& deviceID)
 	}
 }
 
-KinectDevice KinectManager::getDeviceObject(uint32 index)
+std::string KinectManager::getDeviceID(uint32 index)
 {
 	if (initialized_)
 	{
-		if (index < nDevices_) return KinectDevice(devicesIDs_[index]);
-		else return KinectDevice(-1);
+		if (index < nDevices_) return devices_[index].deviceID;
+		else return "";
 	}
 	else
 	{
-		Log::write("[KinectManager] getDeviceObject()", "ERROR: KinectManager not initialized.");
-		return KinectDevice(-1);
+		Log::write("[KinectManager] getDeviceID()", "ERROR: KinectManager not initialized.");
+		return "";
 	}
 }
 
-KinectDevice KinectManager::getDeviceObject(const std::string& deviceID)
+std::string KinectManager::getSegmentID(uint32 index)
 {
 	if (initialized_)
 	{
-		if (isValidDeviceID(deviceID)) return KinectDevice(deviceID);
-		else return KinectDevice(-1);
+		if (index < nDevices_) return devices_[index].segmentID;
+		else return "";
 	}
 	else
 	{
-		Log::write("[KinectManager] getDeviceObject()", "ERROR: KinectManager not initialized.");
-		return KinectDevice(-1);
+		Log::write("[KinectManager] getSegmentID()", "ERROR: KinectManager not initialized.");
+		return "";
+	}
+}
+
+bool KinectManager::isDeviceConnected(uint32 index)
+{
+	if (initialized_) return (index < nDevices_)?(devices_[index].connected != 0):false;
+	else
+	{
+		Log::write("[KinectManager] isDeviceConnected()", "ERROR: KinectManager not initialized.");
+		return false;
 	}
 }
 
@@ -200,7 +264,7 @@ bool KinectManager::isValidDeviceID(const std::string& deviceID)
 	{
 		bool found = false;
 		for (uint32 i = 0; i < nDevices_ && !found; i++)
-			if (devicesIDs_[i] == deviceID)
+			if (devices_[i].deviceID == deviceID)
 				found = true;
 		return found;
 	}
@@ -222,7 +286,39 @@ std::string KinectManager::reformatDeviceID(const std::string& deviceID)
 	return result;
 }
 
+KinectSource* KinectManager::createSource(const std::string& deviceID)
+{
+	if (Config::replay.enabled)
+	{
+		for (uint32 i = 0; i < nDevices_; i++)
+			if (devices_[i].deviceID == deviceID)
+				return new KinectReplaySource(devices_[i].replayFile);
+		return 0;
+	}
+	else return new KinectNuiSource(deviceID);
+}
+
 void CALLBACK KinectManager::deviceStatusCallback(HRESULT hrStatus, const OLECHAR* instanceName, const OLECHAR* uniqueDeviceName, void* pUserData)
 {
-	Log::write("[KinectManager] deviceStatusCallback()", "Called!");
+	if (!initialized_) return;
+
+	std::string instanceID = (instanceName)?wstring_cast<std::string>(std::wstring(instanceName)):"";
+	std::string uniqueID = (uniqueDeviceName)?wstring_cast<std::string>(std::wstring(uniqueDeviceName)):"";
+	LONG connected = (SUCCEEDED(hrStatus))?1:0;
+
+	// Only the connection state changes here, the registry layout stays fixed after initialize()
+	bool found = false;
+	for (uint32 i = 0; i < nDevices_ && !found; i++)
+	{
+		if (devices_[i].deviceID == instanceID || devices_[i].deviceID == uniqueID)
+		{
+			InterlockedExchange(&devices_[i].connected, connected);
+			found = true;
+
+			std::string message = "Device " + devices_[i].deviceID + ((connected)?" connected.":" disconnected.");
+			Log::write("[KinectManager] deviceStatusCallback()", message);
+		}
+	}
+
+	if (!found) Log::write("[KinectManager] deviceStatusCallback()", "Status changed on unregistered device " + instanceID + ".");
 }
@@ -0,0 +1,191 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Kinect/KinectNuiSource.h"
+
+#include "Tools/Clock.h"
+
+using namespace MultiKinect;
+using namespace Kinect;
+using namespace Tools;
+
+
+KinectNuiSource::KinectNuiSource(uint32 index)
+{
+	create();
+	if (FAILED(NuiCreateSensorByIndex(index, &instance_))) instance_ = 0;
+}
+
+KinectNuiSource::KinectNuiSource(const std::string& deviceID)
+{
+	create();
+	std::wstring wDeviceID = string_cast<std::wstring>(deviceID);
+	if (wDeviceID == L"" || FAILED(NuiCreateSensorById(&wDeviceID[0], &instance_))) instance_ = 0;
+}
+
+KinectNuiSource::~KinectNuiSource()
+{
+	if (instance_)
+	{
+		instance_->Release();
+		instance_ = 0;
+	}
+}
+
+void KinectNuiSource::create()
+{
+	instance_ = 0;
+	for (uint32 i = 0; i < 2; i++)
+	{
+		streamHandles_[i] = 0;
+		lockedFrames_[i] = false;
+	}
+}
+
+bool KinectNuiSource::isValid()
+{
+	return instance_ != 0;
+}
+
+std::string KinectNuiSource::getID()
+{
+	if (instance_) return wstring_cast<std::string>(std::wstring(instance_->NuiUniqueId()));
+	else return "";
+}
+
+KinectDevice::KinectStatusCode KinectNuiSource::getStatus()
+{
+	if (!instance_) return KinectDevice::K_DEVICE_NOT_CONNECTED;
+
+	// Opening the sensor to find out whether someone else holds it took a whole
+	// NuiInitialize per device and raced with slaves starting at the same time,
+	// so a sensor in use is only reported when it is initialized
+	switch (instance_->NuiStatus())
+	{
+	case S_OK:							return KinectDevice::K_DEVICE_OK;
+	case S_NUI_INITIALIZING:			return KinectDevice::K_DEVICE_INITIALIZING;
+	case E_NUI_NOTCONNECTED:			return KinectDevice::K_DEVICE_NOT_CONNECTED;
+	case E_NUI_NOTGENUINE:				return KinectDevice::K_DEVICE_NOT_VALID;
+	case E_NUI_NOTSUPPORTED:			return KinectDevice::K_DEVICE_UNSUPPORTED;
+	case E_NUI_INSUFFICIENTBANDWIDTH:	return KinectDevice::K_DEVICE_INSUFFICIENT_BANDWIDTH;
+	case E_NUI_NOTPOWERED:				return KinectDevice::K_DEVICE_NOT_POWERED;
+	case E_NUI_NOTREADY:				return KinectDevice::K_DEVICE_NOT_READY;
+	default:							return KinectDevice::K_DEVICE_UNKNOWN;
+	}
+}
+
+int32 KinectNuiSource::initialize(int32 flags)
+{
+	if (!instance_) return KinectDevice::K_ERROR_INVALID_DEVICE;
+
+	switch (instance_->NuiInitialize(flags))
+	{
+	case S_OK:							return 0;
+	case E_NUI_SKELETAL_ENGINE_BUSY:	return KinectDevice::K_ERROR_SKELETON_IN_USE;
+	case E_NUI_DEVICE_IN_USE:			return KinectDevice::K_ERROR_DEVICE_IN_USE;
+	default:							return KinectDevice::K_ERROR_UNKNOWN;
+	}
+}
+
+void KinectNuiSource::shutDown()
+{
+	if (instance_)
+	{
+		for (uint32 i = 0; i < 2; i++)
+		{
+			if (lockedFrames_[i]) releaseImageFrame(basic_cast<ImageStream>(i));
+			streamHandles_[i] = 0;
+		}
+		instance_->NuiShutdown();
+	}
+}
+
+bool KinectNuiSource::hasSkeletalEngine()
+{
+	return instance_ && HasSkeletalEngine(instance_);
+}
+
+bool KinectNuiSource::enableSkeletonTracking(HANDLE frameEvent, int32 flags)
+{
+	return instance_ && SUCCEEDED(instance_->NuiSkeletonTrackingEnable(frameEvent, flags));
+}
+
+bool KinectNuiSource::openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent)
+{
+	return instance_ && SUCCEEDED(instance_->NuiImageStreamOpen(type, resolution, 0, 3, frameEvent, &streamHandles_[stream]));
+}
+
+void KinectNuiSource::setImageStreamFlags(ImageStream stream, int32 flags)
+{
+	if (instance_ && streamHandles_[stream]) instance_->NuiImageStreamSetImageFrameFlags(streamHandles_[stream], flags);
+}
+
+bool KinectNuiSource::lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame)
+{
+	if (!instance_ || !streamHandles_[stream] || lockedFrames_[stream]) return false;
+
+	if (FAILED(instance_->NuiImageStreamGetNextFrame(streamHandles_[stream], timeout, &imageFrames_[stream])))
+		return false;
+
+	// Sensor timestamps start at each sensor initialization, so stamp with the session clock instead
+	frame.timestamp = Clock::getTime();
+
+	NUI_LOCKED_RECT lockedRect;
+	imageFrames_[stream].pFrameTexture->LockRect(0, &lockedRect, 0, 0);
+	frame.pitch = basic_cast<uint32>(lockedRect.Pitch);
+	frame.size = basic_cast<uint32>(lockedRect.size);
+	frame.data = basic_cast<const uint8*>(lockedRect.pBits);
+	lockedFrames_[stream] = true;
+
+	return true;
+}
+
+void KinectNuiSource::releaseImageFrame(ImageStream stream)
+{
+	if (lockedFrames_[stream])
+	{
+		imageFrames_[stream].pFrameTexture->UnlockRect(0);
+		instance_->NuiImageStreamReleaseFrame(streamHandles_[stream], &imageFrames_[stream]);
+		lockedFrames_[stream] = false;
+	}
+}
+
+bool KinectNuiSource::getSkeletonFrame(uint32 timeout, SkeletonFrame& frame)
+{
+	if (!instance_ || FAILED(instance_->NuiSkeletonGetNextFrame(timeout, &frame.data))) return false;
+
+	frame.timestamp = Clock::getTime();
+	return true;
+}
+
+bool KinectNuiSource::getElevationAngle(int32& angle)
+{
+	LONG value;
+	if (!instance_ || FAILED(instance_->NuiCameraElevationGetAngle(&value))) return false;
+
+	angle = basic_cast<int32>(value);
+	return true;
+}
+
+bool KinectNuiSource::setElevationAngle(int32 angle)
+{
+	return instance_ && SUCCEEDED(instance_->NuiCameraElevationSetAngle(basic_cast<LONG>(angle)));
+}
@@ -0,0 +1,238 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Kinect/KinectRecorder.h"
+
+#include "Kinect/KinectDevice.h"
+#include "Tools/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <NuiApi.h>
+
+using namespace MultiKinect;
+using namespace Kinect;
+
+
+static bool compareIndexEntries(const KinectRecording::IndexEntry& a, const KinectRecording::IndexEntry& b)
+{
+	return a.timestamp < b.timestamp;
+}
+
+KinectRecorder::KinectRecorder(const std::string& filename, const KinectRecording::FileHeader& header)
+{
+	filename_ = filename;
+	header_ = header;
+	header_.magic = KinectRecording::K_RECORDING_MAGIC;
+	header_.version = KinectRecording::K_RECORDING_VERSION;
+	header_.indexOffset = 0;
+	header_.indexCount = 0;
+	fileOffset_ = 0;
+	pendingHead_ = pendingCount_ = 0;
+	droppedRecords_ = 0;
+	buffers_ = 0;
+	pendingEvent_ = writerStopEvent_ = writerThread_ = 0;
+	InitializeCriticalSection(&queueLock_);
+
+	// Every buffer is allocated here, recording a frame only moves pointers between lists
+	bufferSizes_[KinectRecording::K_RECORD_COLOR - 1] = (header_.streams & KinectDevice::K_USE_COLOR)?header_.colorWidth*header_.colorHeight*4:0;
+	bufferSizes_[KinectRecording::K_RECORD_DEPTH - 1] = (header_.streams & (KinectDevice::K_USE_DEPTH|KinectDevice::K_USE_DEPTH_AND_PLAYER))?header_.depthWidth*header_.depthHeight*2:0;
+	bufferSizes_[KinectRecording::K_RECORD_SKELETON - 1] = (header_.streams & KinectDevice::K_USE_SKELETON)?sizeof(NUI_SKELETON_FRAME):0;
+
+	uint32 totalSize = 0;
+	for (uint32 t = 0; t < RECORD_TYPES; t++) totalSize += bufferSizes_[t]*RECORDING_BUFFER_SLOTS;
+	if (totalSize) buffers_ = new uint8[totalSize];
+
+	uint8* buffer = buffers_;
+	for (uint32 t = 0; t < RECORD_TYPES; t++)
+	{
+		freeBuffers_[t].reserve(RECORDING_BUFFER_SLOTS);
+		if (bufferSizes_[t])
+		{
+			for (uint32 i = 0; i < RECORDING_BUFFER_SLOTS; i++)
+			{
+				freeBuffers_[t].push_back(buffer);
+				buffer += bufferSizes_[t];
+			}
+		}
+	}
+	index_.reserve(4096);
+
+	file_ = CreateFileA(filename_.c_str(), GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file_ != INVALID_HANDLE_VALUE && writeData(&header_, sizeof(header_)))
+	{
+		pendingEvent_ = CreateEvent(0, false, false, 0);
+		writerStopEvent_ = CreateEvent(0, true, false, 0);
+		writerThread_ = CreateThread(0, 0, writerThread, this, 0, 0);
+	}
+	else
+	{
+		if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+		Log::write("[KinectRecorder] KinectRecorder()", "ERROR: Unable to create " + filename_ + ".");
+	}
+}
+
+KinectRecorder::~KinectRecorder()
+{
+	if (isOpen())
+	{
+		SetEvent(writerStopEvent_);
+		WaitForSingleObject(writerThread_, INFINITE);
+		CloseHandle(writerThread_);
+		CloseHandle(writerStopEvent_);
+		CloseHandle(pendingEvent_);
+
+		// Append the index and point the header at it, only then is the recording complete
+		std::stable_sort(index_.begin(), index_.end(), compareIndexEntries);
+		header_.indexOffset = fileOffset_;
+		header_.indexCount = basic_cast<uint32>(index_.size());
+		bool indexed = index_.empty() || writeData(&index_[0], basic_cast<uint32>(index_.size()*sizeof(KinectRecording::IndexEntry)));
+
+		LARGE_INTEGER start;
+		start.QuadPart = 0;
+		if (indexed && SetFilePointerEx(file_, start, 0, FILE_BEGIN)) indexed = writeData(&header_, sizeof(header_));
+		if (!indexed) Log::write("[KinectRecorder] ~KinectRecorder()", "ERROR: Unable to write the index of " + filename_ + ".");
+		CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+
+		Log::write("[KinectRecorder] ~KinectRecorder()", filename_ + ": " + basic_cast<std::string>(header_.indexCount) + " records, " + basic_cast<std::string>(getDroppedRecords()) + " dropped.");
+	}
+
+	delete[] buffers_;
+	DeleteCriticalSection(&queueLock_);
+}
+
+bool KinectRecorder::popRecord(PendingRecord& record)
+{
+	bool popped = false;
+
+	EnterCriticalSection(&queueLock_);
+	if (pendingCount_)
+	{
+		record = pendingRecords_[pendingHead_];
+		pendingHead_ = (pendingHead_ + 1)%PENDING_RECORDS;
+		pendingCount_--;
+		popped = true;
+	}
+	LeaveCriticalSection(&queueLock_);
+
+	return popped;
+}
+
+bool KinectRecorder::writeData(const void* data, uint32 size)
+{
+	DWORD written = 0;
+	if (!WriteFile(file_, data, size, &written, 0) || written != size) return false;
+
+	fileOffset_ += size;
+	return true;
+}
+
+void KinectRecorder::writeRecord(const PendingRecord& record)
+{
+	KinectRecording::IndexEntry entry;
+	entry.timestamp = record.header.timestamp;
+	entry.offset = fileOffset_;
+	entry.type = record.header.type;
+	entry.size = record.header.size;
+
+	if (writeData(&record.header, sizeof(record.header)) && writeData(record.data, record.header.size))
+		index_.push_back(entry);
+	else InterlockedIncrement(&droppedRecords_);
+}
+
+bool KinectRecorder::isOpen()
+{
+	return file_ != INVALID_HANDLE_VALUE;
+}
+
+bool KinectRecorder::record(KinectRecording::RecordType type, uint64 timestamp, const uint8* data, uint32 size)
+{
+	if (!isOpen() || type < KinectRecording::K_RECORD_COLOR || type > KinectRecording::K_RECORD_SKELETON) return false;
+
+	uint32 t = type - 1;
+	uint8* buffer = 0;
+	if (size <= bufferSizes_[t])
+	{
+		EnterCriticalSection(&queueLock_);
+		if (!freeBuffers_[t].empty())
+		{
+			buffer = freeBuffers_[t].back();
+			freeBuffers_[t].pop_back();
+		}
+		LeaveCriticalSection(&queueLock_);
+	}
+
+	if (!buffer)
+	{
+		InterlockedIncrement(&droppedRecords_);
+		return false;
+	}
+
+	std::memcpy(buffer, data, size);
+
+	EnterCriticalSection(&queueLock_);
+	PendingRecord& pending = pendingRecords_[(pendingHead_ + pendingCount_)%PENDING_RECORDS];
+	pending.header.type = type;
+	pending.header.size = size;
+	pending.header.timestamp = timestamp;
+	pending.data = buffer;
+	pendingCount_++;
+	LeaveCriticalSection(&queueLock_);
+
+	SetEvent(pendingEvent_);
+	return true;
+}
+
+uint32 KinectRecorder::getDroppedRecords()
+{
+	return basic_cast<uint32>(droppedRecords_);
+}
+
+DWORD WINAPI KinectRecorder::writerThread(LPVOID param)
+{
+	KinectRecorder* pThis = reinterpret_cast<KinectRecorder*>(param);
+	pThis->writerThread();
+
+	return 0;
+}
+
+void KinectRecorder::writerThread()
+{
+	HANDLE events[2] = {writerStopEvent_, pendingEvent_};
+
+	bool exit = false;
+	while (!exit)
+	{
+		if (WaitForMultipleObjects(2, events, false, INFINITE) == WAIT_OBJECT_0) exit = true;
+
+		// Drain on stop too, so frames queued before shutdown still reach the file
+		PendingRecord record;
+		while (popRecord(record))
+		{
+			writeRecord(record);
+
+			EnterCriticalSection(&queueLock_);
+			freeBuffers_[record.header.type - 1].push_back(record.data);
+			LeaveCriticalSection(&queueLock_);
+		}
+	}
+}
@@ -0,0 +1,226 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Kinect/KinectRecordingReader.h"
+
+#include "Globals/Definitions.h"
+#include "Tools/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace MultiKinect;
+using namespace Kinect;
+
+
+static bool compareIndexEntries(const KinectRecording::IndexEntry& a, const KinectRecording::IndexEntry& b)
+{
+	return a.timestamp < b.timestamp;
+}
+
+KinectRecordingReader::KinectRecordingReader()
+{
+	file_ = INVALID_HANDLE_VALUE;
+	mapping_ = 0;
+	fileSize_ = 0;
+	view_ = 0;
+	viewOffset_ = viewSize_ = 0;
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	granularity_ = systemInfo.dwAllocationGranularity;
+}
+
+KinectRecordingReader::~KinectRecordingReader()
+{
+	close();
+}
+
+const uint8* KinectRecordingReader::map(uint64 offset, uint64 size)
+{
+	if (offset + size > fileSize_) return 0;
+	if (view_ && offset >= viewOffset_ && offset + size <= viewOffset_ + viewSize_) return view_ + (offset - viewOffset_);
+
+	if (view_) UnmapViewOfFile(view_);
+	view_ = 0;
+
+	// Views must start at the allocation granularity, map a large window to amortize remapping
+	viewOffset_ = offset - offset%granularity_;
+	viewSize_ = std::max<uint64>(RECORDING_VIEW_SIZE, offset + size - viewOffset_);
+	viewSize_ = std::min<uint64>(viewSize_, fileSize_ - viewOffset_);
+	view_ = basic_cast<const uint8*>(MapViewOfFile(mapping_, FILE_MAP_READ, basic_cast<DWORD>(viewOffset_ >> 32), basic_cast<DWORD>(viewOffset_ & 0xFFFFFFFF), basic_cast<size_t>(viewSize_)));
+	if (!view_)
+	{
+		viewOffset_ = viewSize_ = 0;
+		return 0;
+	}
+
+	return view_ + (offset - viewOffset_);
+}
+
+bool KinectRecordingReader::readIndex()
+{
+	uint64 indexSize = basic_cast<uint64>(header_.indexCount)*sizeof(KinectRecording::IndexEntry);
+	if (!header_.indexOffset || header_.indexOffset + indexSize > fileSize_) return false;
+
+	index_.resize(header_.indexCount);
+	if (header_.indexCount)
+	{
+		const uint8* entries = map(header_.indexOffset, indexSize);
+		if (!entries) return false;
+		std::memcpy(&index_[0], entries, basic_cast<size_t>(indexSize));
+	}
+
+	return true;
+}
+
+void KinectRecordingReader::buildIndex()
+{
+	index_.clear();
+
+	// Walk the records until the end of the data or the first truncated one
+	uint64 offset = sizeof(KinectRecording::FileHeader);
+	uint64 end = (header_.indexOffset)?header_.indexOffset:fileSize_;
+	while (offset + sizeof(KinectRecording::RecordHeader) <= end)
+	{
+		const uint8* data = map(offset, sizeof(KinectRecording::RecordHeader));
+		if (!data) break;
+
+		KinectRecording::RecordHeader record;
+		std::memcpy(&record, data, sizeof(record));
+		if (offset + sizeof(record) + record.size > end) break;
+
+		KinectRecording::IndexEntry entry;
+		entry.timestamp = record.timestamp;
+		entry.offset = offset;
+		entry.type = record.type;
+		entry.size = record.size;
+		index_.push_back(entry);
+
+		offset += sizeof(record) + record.size;
+	}
+
+	std::stable_sort(index_.begin(), index_.end(), compareIndexEntries);
+}
+
+bool KinectRecordingReader::open(const std::string& filename)
+{
+	close();
+
+	file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file_ == INVALID_HANDLE_VALUE)
+	{
+		Log::write("[KinectRecordingReader] open()", "ERROR: Unable to open " + filename + ".");
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file_, &fileSize)) fileSize_ = basic_cast<uint64>(fileSize.QuadPart);
+	if (fileSize_ >= sizeof(KinectRecording::FileHeader))
+		mapping_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+
+	const uint8* header = (mapping_)?map(0, sizeof(KinectRecording::FileHeader)):0;
+	if (!header)
+	{
+		Log::write("[KinectRecordingReader] open()", "ERROR: Unable to map " + filename + ".");
+		close();
+		return false;
+	}
+
+	std::memcpy(&header_, header, sizeof(header_));
+	if (header_.magic != KinectRecording::K_RECORDING_MAGIC || header_.version != KinectRecording::K_RECORDING_VERSION)
+	{
+		Log::write("[KinectRecordingReader] open()", "ERROR: " + filename + " is not a valid recording.");
+		close();
+		return false;
+	}
+
+	if (!readIndex())
+	{
+		Log::write("[KinectRecordingReader] open()", filename + " has no index, scanning its records.");
+		buildIndex();
+	}
+
+	return true;
+}
+
+void KinectRecordingReader::close()
+{
+	if (view_) UnmapViewOfFile(view_);
+	if (mapping_) CloseHandle(mapping_);
+	if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+
+	file_ = INVALID_HANDLE_VALUE;
+	mapping_ = 0;
+	fileSize_ = 0;
+	view_ = 0;
+	viewOffset_ = viewSize_ = 0;
+	index_.clear();
+}
+
+bool KinectRecordingReader::isOpen()
+{
+	return file_ != INVALID_HANDLE_VALUE;
+}
+
+const KinectRecording::FileHeader& KinectRecordingReader::getHeader()
+{
+	return header_;
+}
+
+uint32 KinectRecordingReader::getNumberOfRecords()
+{
+	return basic_cast<uint32>(index_.size());
+}
+
+const KinectRecording::IndexEntry& KinectRecordingReader::getEntry(uint32 index)
+{
+	return index_[index];
+}
+
+const uint8* KinectRecordingReader::getPayload(uint32 index)
+{
+	if (index >= index_.size()) return 0;
+	return map(index_[index].offset + sizeof(KinectRecording::RecordHeader), index_[index].size);
+}
+
+uint32 KinectRecordingReader::seek(uint64 timestamp)
+{
+	KinectRecording::IndexEntry key;
+	key.timestamp = timestamp;
+	return basic_cast<uint32>(std::lower_bound(index_.begin(), index_.end(), key, compareIndexEntries) - index_.begin());
+}
+
+bool KinectRecordingReader::readHeader(const std::string& filename, KinectRecording::FileHeader& header)
+{
+	std::ifstream file(filename.c_str(), std::ios::in|std::ios::binary);
+	if (!file.is_open()) return false;
+
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+	if (header.magic != KinectRecording::K_RECORDING_MAGIC || header.version != KinectRecording::K_RECORDING_VERSION)
+	{
+		Log::write("[KinectRecordingReader] readHeader()", "ERROR: " + filename + " is not a valid recording.");
+		return false;
+	}
+	header.deviceID[KinectRecording::K_RECORDING_ID_LENGTH - 1] = 0;
+
+	return true;
+}
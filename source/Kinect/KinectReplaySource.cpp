@@ -0,0 +1,403 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Kinect/KinectReplaySource.h"
+
+#include "Globals/Config.h"
+#include "Tools/Clock.h"
+#include "Tools/Log.h"
+#include <cstring>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Tools;
+
+
+volatile LONGLONG	KinectReplaySource::replayOrigin_	= KinectReplaySource::UNSET_ORIGIN;
+volatile LONG		KinectReplaySource::activeSources_	= 0;
+
+
+KinectReplaySource::KinectReplaySource(const std::string& filename)
+{
+	filename_ = filename;
+	valid_ = KinectRecordingReader::readHeader(filename_, header_);
+	initialized_ = false;
+	InitializeCriticalSection(&framesLock_);
+	for (uint32 i = 0; i < 2; i++)
+	{
+		InitializeCriticalSection(&imageLocks_[i]);
+		streamEvents_[i] = 0;
+		streamsOpened_[i] = false;
+		imageTimestamps_[i] = 0;
+		imageReady_[i] = false;
+		lockedFrames_[i] = false;
+	}
+	skeletonEvent_ = 0;
+	skeletonEnabled_ = false;
+	skeletonReady_ = false;
+	consumedEvent_ = replayStopEvent_ = replayThread_ = 0;
+}
+
+KinectReplaySource::~KinectReplaySource()
+{
+	if (initialized_) shutDown();
+	DeleteCriticalSection(&framesLock_);
+	for (uint32 i = 0; i < 2; i++) DeleteCriticalSection(&imageLocks_[i]);
+}
+
+bool KinectReplaySource::isPending(uint32 type)
+{
+	bool pending = false;
+	switch (type)
+	{
+	case KinectRecording::K_RECORD_COLOR:
+	case KinectRecording::K_RECORD_DEPTH:
+		{
+			ImageStream stream = (type == KinectRecording::K_RECORD_COLOR)?K_COLOR_STREAM:K_DEPTH_STREAM;
+			EnterCriticalSection(&imageLocks_[stream]);
+			pending = streamsOpened_[stream] && imageReady_[stream];
+			LeaveCriticalSection(&imageLocks_[stream]);
+		}
+		break;
+	case KinectRecording::K_RECORD_SKELETON:
+		EnterCriticalSection(&framesLock_);
+		pending = skeletonEnabled_ && skeletonReady_;
+		LeaveCriticalSection(&framesLock_);
+		break;
+	default:
+		break;
+	}
+
+	return pending;
+}
+
+void KinectReplaySource::deliver(uint32 type, const uint8* data, uint32 size, uint64 timestamp)
+{
+	HANDLE frameEvent = 0;
+
+	// Each image stream has its own lock, so a frame held by one capture thread does not stall the others
+	switch (type)
+	{
+	case KinectRecording::K_RECORD_COLOR:
+	case KinectRecording::K_RECORD_DEPTH:
+		{
+			ImageStream stream = (type == KinectRecording::K_RECORD_COLOR)?K_COLOR_STREAM:K_DEPTH_STREAM;
+			EnterCriticalSection(&imageLocks_[stream]);
+			if (streamsOpened_[stream] && size == imageBuffers_[stream].size())
+			{
+				std::memcpy(&imageBuffers_[stream][0], data, size);
+				imageTimestamps_[stream] = timestamp;
+				imageReady_[stream] = true;
+				frameEvent = streamEvents_[stream];
+			}
+			LeaveCriticalSection(&imageLocks_[stream]);
+		}
+		break;
+	case KinectRecording::K_RECORD_SKELETON:
+		EnterCriticalSection(&framesLock_);
+		if (skeletonEnabled_ && size == sizeof(NUI_SKELETON_FRAME))
+		{
+			std::memcpy(&skeletonFrame_.data, data, size);
+			skeletonFrame_.timestamp = timestamp;
+			skeletonReady_ = true;
+			frameEvent = skeletonEvent_;
+		}
+		LeaveCriticalSection(&framesLock_);
+		break;
+	default:
+		break;
+	}
+
+	if (frameEvent) SetEvent(frameEvent);
+}
+
+bool KinectReplaySource::isValid()
+{
+	return valid_;
+}
+
+std::string KinectReplaySource::getID()
+{
+	if (valid_) return std::string(header_.deviceID);
+	else return "";
+}
+
+KinectDevice::KinectStatusCode KinectReplaySource::getStatus()
+{
+	if (!valid_) return KinectDevice::K_DEVICE_NOT_VALID;
+	if (initialized_) return KinectDevice::K_DEVICE_IN_USE;
+	return KinectDevice::K_DEVICE_OK;
+}
+
+int32 KinectReplaySource::initialize(int32 flags)
+{
+	if (!valid_) return KinectDevice::K_ERROR_INVALID_DEVICE;
+	if (initialized_) return KinectDevice::K_ERROR_DEVICE_IN_USE;
+
+	if (!reader_.open(filename_)) return KinectDevice::K_ERROR_INVALID_DEVICE;
+
+	initialized_ = true;
+
+	consumedEvent_ = CreateEvent(0, false, false, 0);
+	replayStopEvent_ = CreateEvent(0, true, false, 0);
+	replayThread_ = CreateThread(0, 0, replayThread, this, 0, 0);
+
+	return 0;
+}
+
+void KinectReplaySource::shutDown()
+{
+	if (initialized_)
+	{
+		SetEvent(replayStopEvent_);
+		WaitForSingleObject(replayThread_, INFINITE);
+		CloseHandle(replayThread_);
+		CloseHandle(replayStopEvent_);
+		CloseHandle(consumedEvent_);
+		consumedEvent_ = replayStopEvent_ = replayThread_ = 0;
+		reader_.close();
+
+		for (uint32 i = 0; i < 2; i++)
+		{
+			EnterCriticalSection(&imageLocks_[i]);
+			streamEvents_[i] = 0;
+			streamsOpened_[i] = false;
+			imageReady_[i] = false;
+			LeaveCriticalSection(&imageLocks_[i]);
+		}
+
+		EnterCriticalSection(&framesLock_);
+		skeletonEvent_ = 0;
+		skeletonEnabled_ = false;
+		skeletonReady_ = false;
+		LeaveCriticalSection(&framesLock_);
+
+		initialized_ = false;
+	}
+}
+
+bool KinectReplaySource::hasSkeletalEngine()
+{
+	return valid_ && (header_.streams & KinectDevice::K_USE_SKELETON);
+}
+
+bool KinectReplaySource::enableSkeletonTracking(HANDLE frameEvent, int32 flags)
+{
+	if (!initialized_ || !hasSkeletalEngine()) return false;
+
+	// Seated mode is baked into the recording, so the flags are accepted as they come
+	EnterCriticalSection(&framesLock_);
+	skeletonEvent_ = frameEvent;
+	skeletonEnabled_ = true;
+	LeaveCriticalSection(&framesLock_);
+
+	return true;
+}
+
+bool KinectReplaySource::openImageStream(ImageStream stream, _NUI_IMAGE_TYPE type, _NUI_IMAGE_RESOLUTION resolution, HANDLE frameEvent)
+{
+	if (!initialized_) return false;
+
+	uint32 width, height, bytesPerPixel;
+	if (stream == K_COLOR_STREAM)
+	{
+		if (!(header_.streams & KinectDevice::K_USE_COLOR)) return false;
+		width = header_.colorWidth;
+		height = header_.colorHeight;
+		bytesPerPixel = 4;
+	}
+	else
+	{
+		if (!(header_.streams & (KinectDevice::K_USE_DEPTH|KinectDevice::K_USE_DEPTH_AND_PLAYER))) return false;
+		width = header_.depthWidth;
+		height = header_.depthHeight;
+		bytesPerPixel = 2;
+	}
+
+	DWORD requestedWidth, requestedHeight;
+	NuiImageResolutionToSize(resolution, requestedWidth, requestedHeight);
+	if (requestedWidth != width || requestedHeight != height)
+	{
+		Log::write("[KinectReplaySource] openImageStream()", "ERROR: Requested resolution does not match the recording.");
+		return false;
+	}
+
+	EnterCriticalSection(&imageLocks_[stream]);
+	imageBuffers_[stream].assign(width*height*bytesPerPixel, 0);
+	streamEvents_[stream] = frameEvent;
+	streamsOpened_[stream] = true;
+	imageReady_[stream] = false;
+	LeaveCriticalSection(&imageLocks_[stream]);
+
+	return true;
+}
+
+void KinectReplaySource::setImageStreamFlags(ImageStream stream, int32 flags)
+{
+	// Near mode is baked into the recording
+}
+
+bool KinectReplaySource::lockImageFrame(ImageStream stream, uint32 timeout, ImageFrame& frame)
+{
+	if (!streamsOpened_[stream] || lockedFrames_[stream]) return false;
+	if (WaitForSingleObject(streamEvents_[stream], timeout) != WAIT_OBJECT_0) return false;
+
+	// The lock is held until releaseImageFrame() so the replay thread cannot overwrite the buffer in use
+	EnterCriticalSection(&imageLocks_[stream]);
+	if (!imageReady_[stream])
+	{
+		LeaveCriticalSection(&imageLocks_[stream]);
+		return false;
+	}
+
+	ResetEvent(streamEvents_[stream]);
+	uint32 bytesPerPixel = (stream == K_COLOR_STREAM)?4:2;
+	uint32 width = (stream == K_COLOR_STREAM)?header_.colorWidth:header_.depthWidth;
+	frame.timestamp = imageTimestamps_[stream];
+	frame.pitch = width*bytesPerPixel;
+	frame.size = basic_cast<uint32>(imageBuffers_[stream].size());
+	frame.data = &imageBuffers_[stream][0];
+	lockedFrames_[stream] = true;
+
+	return true;
+}
+
+void KinectReplaySource::releaseImageFrame(ImageStream stream)
+{
+	if (lockedFrames_[stream])
+	{
+		imageReady_[stream] = false;
+		lockedFrames_[stream] = false;
+		LeaveCriticalSection(&imageLocks_[stream]);
+		SetEvent(consumedEvent_);
+	}
+}
+
+bool KinectReplaySource::getSkeletonFrame(uint32 timeout, SkeletonFrame& frame)
+{
+	if (!skeletonEnabled_) return false;
+	if (WaitForSingleObject(skeletonEvent_, timeout) != WAIT_OBJECT_0) return false;
+
+	bool ready;
+	EnterCriticalSection(&framesLock_);
+	ready = skeletonReady_;
+	if (ready)
+	{
+		ResetEvent(skeletonEvent_);
+		frame = skeletonFrame_;
+		skeletonReady_ = false;
+	}
+	LeaveCriticalSection(&framesLock_);
+	if (ready) SetEvent(consumedEvent_);
+
+	return ready;
+}
+
+bool KinectReplaySource::getElevationAngle(int32& angle)
+{
+	if (!valid_) return false;
+
+	angle = header_.elevationAngle;
+	return true;
+}
+
+bool KinectReplaySource::setElevationAngle(int32 angle)
+{
+	return false;
+}
+
+DWORD WINAPI KinectReplaySource::replayThread(LPVOID param)
+{
+	KinectReplaySource* pThis = reinterpret_cast<KinectReplaySource*>(param);
+	pThis->replayThread();
+
+	return 0;
+}
+
+void KinectReplaySource::replayThread()
+{
+	// Speed 0 replays as fast as the device consumes frames, timestamps then advance at recorded pace
+	bool paced = Config::replay.speed > 0.0f;
+	float64 speed = (paced)?basic_cast<float64>(Config::replay.speed):1.0;
+	HANDLE events[2] = {replayStopEvent_, consumedEvent_};
+
+	uint32 nRecords = reader_.getNumberOfRecords();
+	uint32 firstRecord = (nRecords)?reader_.seek(reader_.getEntry(0).timestamp + Clock::fromMilliseconds(Config::replay.start)):0;
+	if (firstRecord >= nRecords)
+	{
+		Log::write("[KinectReplaySource] replayThread()", "ERROR: Nothing to replay in " + filename_ + ".");
+		return;
+	}
+
+	uint64 firstTimestamp = reader_.getEntry(firstRecord).timestamp;
+	uint64 lastTimestamp = reader_.getEntry(nRecords - 1).timestamp;
+	uint64 loopOffset = 0;
+
+	// The first source to start anchors the recorded session to the current time
+	int64 origin = basic_cast<int64>(Clock::getTime()) - basic_cast<int64>(basic_cast<float64>(firstTimestamp)/speed);
+	InterlockedCompareExchange64(&replayOrigin_, origin, UNSET_ORIGIN);
+	InterlockedIncrement(&activeSources_);
+
+	uint32 current = firstRecord;
+	bool exit = false;
+	while (!exit)
+	{
+		if (current >= nRecords)
+		{
+			if (!Config::replay.loop) break;
+			current = firstRecord;
+			loopOffset += lastTimestamp - firstTimestamp + Clock::fromMilliseconds(33);
+		}
+
+		const KinectRecording::IndexEntry& record = reader_.getEntry(current++);
+		int64 mappedTime = replayOrigin_ + basic_cast<int64>(basic_cast<float64>(record.timestamp + loopOffset)/speed);
+		uint64 timestamp = (mappedTime > 0)?basic_cast<uint64>(mappedTime):0;
+
+		if (paced)
+		{
+			uint64 now = Clock::getTime();
+			if (timestamp > now)
+			{
+				DWORD wait = basic_cast<DWORD>(Clock::toMilliseconds(timestamp - now));
+				if (WaitForSingleObject(replayStopEvent_, wait) == WAIT_OBJECT_0) exit = true;
+			}
+		}
+		else
+		{
+			while (!exit && isPending(record.type))
+				if (WaitForMultipleObjects(2, events, false, 100) == WAIT_OBJECT_0) exit = true;
+		}
+
+		if (!exit)
+		{
+			const uint8* payload = reader_.getPayload(current - 1);
+			if (payload) deliver(record.type, payload, record.size, timestamp);
+		}
+		if (WaitForSingleObject(replayStopEvent_, 0) == WAIT_OBJECT_0) exit = true;
+	}
+
+	if (!exit) Log::write("[KinectReplaySource] replayThread()", "Finished replaying " + filename_ + ".");
+
+	// Let the next replay session anchor itself again
+	if (InterlockedDecrement(&activeSources_) == 0)
+		InterlockedCompareExchange64(&replayOrigin_, UNSET_ORIGIN, replayOrigin_);
+}
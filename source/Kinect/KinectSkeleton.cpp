@@ -26,7 +26,7 @@
 #include "Geom/Matrix3x3.h"
 #include "Globals/Config.h"
 #include "Globals/Definitions.h"
-#include "Tools/Timer.h"
+#include "Tools/Clock.h"
 
 
 _NUI_IMAGE_RESOLUTION KinectSkeleton::resolution_ = NUI_IMAGE_RESOLUTION_INVALID;
@@ -40,7 +40,7 @@ KinectSkeleton::KinectSkeleton()
 	std::memset(validJoints_, 0, sizeof(bool)*KINECT_SKELETON_JOINT_COUNT);
 	std::memset(lastValidJoints_, 0, sizeof(bool)*KINECT_SKELETON_JOINT_COUNT);
 	confidenceValue_ = -1.0f;
-	std::memset(lastJointsTimestamps_, 0, sizeof(float32)*KINECT_SKELETON_JOINT_COUNT);
+	std::memset(lastJointsTimestamps_, 0, sizeof(uint64)*KINECT_SKELETON_JOINT_COUNT);
 }
 
 KinectSkeleton::~KinectSkeleton()
@@ -121,7 +121,7 @@ bool KinectSkeleton::getJointValidity(KinectJoint joint) const
 float32 KinectSkeleton::getJointWeight(KinectJoint joint) const
 {
 	if (validJoints_[joint])
-		return (basic_cast<float32>(basic_cast<float64>(Timer::getCountTime("executionStart"))*0.001) - lastJointsTimestamps_[joint]);
+		return Clock::toSeconds(Clock::getTime() - lastJointsTimestamps_[joint]);
 	else return 0.0f;
 }
 
@@ -163,11 +163,11 @@ std::vector<bool> KinectSkeleton::getJointsValidity() const
 
 std::vector<float32> KinectSkeleton::getJointsWeights() const
 {
-	float32 currentTimestamp = basic_cast<float32>(basic_cast<float64>(Timer::getCountTime("executionStart"))*0.001);
+	uint64 currentTimestamp = Clock::getTime();
 	std::vector<float32> result(KINECT_SKELETON_JOINT_COUNT);
 	for (uint32 i = 0; i < KINECT_SKELETON_JOINT_COUNT; i++)
 	{
-		if (validJoints_[i]) result[i] = currentTimestamp - lastJointsTimestamps_[i];
+		if (validJoints_[i]) result[i] = Clock::toSeconds(currentTimestamp - lastJointsTimestamps_[i]);
 		else result[i] = 0.0f;
 	}
 
@@ -248,7 +248,7 @@ void KinectSkeleton::setJoint(KinectJoint joint, const Point& point, const Quate
 	validJoints_[joint] = true;
 	if (!lastValidJoints_[joint])
 	{
-		lastJointsTimestamps_[joint] = basic_cast<float32>(basic_cast<float64>(Timer::getCountTime("executionStart"))*0.001);
+		lastJointsTimestamps_[joint] = Clock::getTime();
 		lastValidJoints_[joint] = true;
 	}
 }
@@ -257,10 +257,11 @@ float32 KinectSkeleton::getConfidenceValue()
 {
 	if (confidenceValue_ == -1.0f)
 	{
+		// Same weights as getJointsWeights(), summed in place since this runs for every captured frame
+		uint64 currentTimestamp = Clock::getTime();
 		confidenceValue_ = 0.0f;
-		std::vector<float32> jointWeights = getJointsWeights();
 		for (uint32 i = 0; i < KINECT_SKELETON_JOINT_COUNT; i++)
-			confidenceValue_ += jointWeights[i];
+			if (validJoints_[i]) confidenceValue_ += Clock::toSeconds(currentTimestamp - lastJointsTimestamps_[i]);
 		confidenceValue_ /= KINECT_SKELETON_JOINT_COUNT;
 	}
 	return confidenceValue_;
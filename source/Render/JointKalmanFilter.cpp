@@ -0,0 +1,140 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Render/JointKalmanFilter.h"
+
+#include "Tools/Clock.h"
+#include <cstring>
+
+using namespace MultiKinect;
+using namespace Geom;
+using namespace Render;
+using namespace Tools;
+
+
+JointKalmanFilter::JointKalmanFilter()
+{
+	std::memset(position_, 0, sizeof(position_));
+	std::memset(velocity_, 0, sizeof(velocity_));
+	std::memset(p00_, 0, sizeof(p00_));
+	std::memset(p01_, 0, sizeof(p01_));
+	std::memset(p11_, 0, sizeof(p11_));
+	std::memset(lastMeasurement_, 0, sizeof(lastMeasurement_));
+	std::memset(validCells_, 0, sizeof(validCells_));
+	lastTime_ = 0;
+}
+
+JointKalmanFilter::~JointKalmanFilter()
+{
+}
+
+void JointKalmanFilter::reset(uint32 slot)
+{
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		validCells_[slot*KINECT_SKELETON_JOINT_COUNT + j] = false;
+}
+
+void JointKalmanFilter::predict(uint64 time, float32 processNoise)
+{
+	// Nothing to predict before the first measurement seeds the time
+	if (lastTime_ == 0 || time <= lastTime_) return;
+
+	float32 dt = Clock::toSeconds(time - lastTime_);
+	float32 q = processNoise*processNoise;
+	float32 q00 = 0.25f*q*dt*dt*dt*dt;
+	float32 q01 = 0.5f*q*dt*dt*dt;
+	float32 q11 = q*dt*dt;
+	lastTime_ = time;
+
+	// Invalid cells are predicted too, they are overwritten on their first measurement
+	for (uint32 a = 0; a < 3; a++)
+	{
+		float32* position = position_[a];
+		const float32* velocity = velocity_[a];
+		for (uint32 c = 0; c < N_CELLS; c++) position[c] += velocity[c]*dt;
+	}
+
+	for (uint32 c = 0; c < N_CELLS; c++)
+	{
+		p00_[c] += dt*(2.0f*p01_[c] + dt*p11_[c]) + q00;
+		p01_[c] += dt*p11_[c] + q01;
+		p11_[c] += q11;
+	}
+}
+
+void JointKalmanFilter::update(uint32 slot, uint32 joint, const Point& measurement, float32 measurementNoise, uint64 time)
+{
+	uint32 c = slot*KINECT_SKELETON_JOINT_COUNT + joint;
+	float32 r = measurementNoise*measurementNoise;
+
+	if (!validCells_[c])
+	{
+		for (uint32 a = 0; a < 3; a++)
+		{
+			position_[a][c] = measurement[a];
+			velocity_[a][c] = 0.0f;
+		}
+		p00_[c] = r;
+		p01_[c] = 0.0f;
+		p11_[c] = 1.0f;
+		validCells_[c] = true;
+	}
+	else
+	{
+		float32 s = p00_[c] + r;
+		float32 k0 = p00_[c]/s;
+		float32 k1 = p01_[c]/s;
+		for (uint32 a = 0; a < 3; a++)
+		{
+			float32 innovation = measurement[a] - position_[a][c];
+			position_[a][c] += k0*innovation;
+			velocity_[a][c] += k1*innovation;
+		}
+		p11_[c] -= k1*p01_[c];
+		p01_[c] -= k0*p01_[c];
+		p00_[c] -= k0*p00_[c];
+	}
+
+	lastMeasurement_[c] = time;
+	if (lastTime_ == 0) lastTime_ = time;
+}
+
+bool JointKalmanFilter::isValid(uint32 slot, uint32 joint) const
+{
+	return validCells_[slot*KINECT_SKELETON_JOINT_COUNT + joint];
+}
+
+Point JointKalmanFilter::getPosition(uint32 slot, uint32 joint) const
+{
+	uint32 c = slot*KINECT_SKELETON_JOINT_COUNT + joint;
+	return Point(position_[0][c], position_[1][c], position_[2][c]);
+}
+
+Vector JointKalmanFilter::getVelocity(uint32 slot, uint32 joint) const
+{
+	uint32 c = slot*KINECT_SKELETON_JOINT_COUNT + joint;
+	return Vector(velocity_[0][c], velocity_[1][c], velocity_[2][c]);
+}
+
+uint64 JointKalmanFilter::getLastMeasurement(uint32 slot, uint32 joint) const
+{
+	return lastMeasurement_[slot*KINECT_SKELETON_JOINT_COUNT + joint];
+}
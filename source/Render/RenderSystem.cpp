@@ -21,16 +21,20 @@
 
 #include "Render/RenderSystem.h"
 
+#include "Globals/Config.h"
 #include "Geom/Matrix4x4.h"
 #include "Render/RenderSystemLocal.h"
+#include "Render/RenderSystemMulti.h"
 #include "Render/RenderSystemRemote.h"
 #include "Render/RenderSystemInterprocess.h"
 #include "Kinect/KinectDevice.h"
+#include "Kinect/KinectManager.h"
 #include "Kinect/KinectSkeleton.h"
 #include "Tools/Log.h"
 
 using namespace MultiKinect;
 using namespace Geom;
+using namespace Interprocess;
 using namespace Kinect;
 using namespace Render;
 using namespace Tools;
@@ -53,6 +57,9 @@ void RenderSystem::initialize(RenderSystemMode mode, KinectDevice* device)
 		case RS_REMOTE_DEVICE:
 			instance_ = new RenderSystemRemote();
 			break;
+		case RS_MULTI_DEVICE:
+			instance_ = new RenderSystemMulti();
+			break;
 		default:
 			break;
 		}
@@ -120,31 +127,55 @@ uint8* RenderSystem::getKinectDepthFrame(int32 deviceIdx)
 	}
 }
 
-KinectSkeleton* RenderSystem::getKinectSkeleton(uint32 i, int32 deviceIdx)
+bool RenderSystem::getKinectRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx)
+{
+	if (instance_) return instance_->getKRawDepthFrame(frame, deviceIdx);
+	else
+	{
+		Log::write("[RenderSystem] getKinectRawDepthFrame()", "ERROR: RenderSystem not initialized.");
+		return false;
+	}
+}
+
+bool RenderSystem::getKinectPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx)
+{
+	if (instance_) return instance_->getKPlayerMasksFrame(frame, deviceIdx);
+	else
+	{
+		Log::write("[RenderSystem] getKinectPlayerMasksFrame()", "ERROR: RenderSystem not initialized.");
+		return false;
+	}
+}
+
+bool RenderSystem::getKinectSkeleton(KinectSkeleton& skeleton, uint32 i, int32 deviceIdx)
 {
 	if (instance_)
 	{
 		uint32 nSkeletons = 0;
-		KinectSkeleton* skeletons = 0;
+		KinectSkeleton skeletons[KINECT_SKELETON_COUNT];
 		instance_->getKSkeletons(nSkeletons, skeletons, deviceIdx);
-		if (i >= nSkeletons) return 0;
-		return &skeletons[i];
+		if (i >= nSkeletons) return false;
+		else
+		{
+			skeleton = skeletons[i];
+			return true;
+		}
 	}
 	else
 	{
 		Log::write("[RenderSystem] getKinectSkeleton()", "ERROR: RenderSystem not initialized.");
-		return 0;
+		return false;
 	}
 }
 
-void RenderSystem::getKinectSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx)
+bool RenderSystem::getKinectSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
 {
-	if (instance_) instance_->getKSkeletons(nSkeletons, skeletons, deviceIdx);
+	if (instance_) return instance_->getKSkeletons(nSkeletons, skeletons, deviceIdx);
 	else
 	{
 		nSkeletons = 0;
-		skeletons = 0;
 		Log::write("[RenderSystem] getKinectSkeletons()", "ERROR: RenderSystem not initialized.");
+		return false;
 	}
 }
 
@@ -191,6 +222,26 @@ void RenderSystem::getTransformedKinectSkeletons(uint32& nSkeletons, KinectSkele
 	}
 }
 
+bool RenderSystem::getFusedKinectFrame(SkeletonFusion::FusedFrame& frame)
+{
+	if (instance_) return instance_->getFusedKFrame(frame);
+	else
+	{
+		Log::write("[RenderSystem] getFusedKinectFrame()", "ERROR: RenderSystem not initialized.");
+		return false;
+	}
+}
+
+uint32 RenderSystem::getKinectFrameID(int32 deviceIdx)
+{
+	if (instance_) return instance_->getKFrameID(deviceIdx);
+	else
+	{
+		Log::write("[RenderSystem] getKinectFrameID()", "ERROR: RenderSystem not initialized.");
+		return 0;
+	}
+}
+
 float32 RenderSystem::getKinectFPS()
 {
 	if (instance_)
@@ -222,7 +273,256 @@ bool RenderSystem::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
 
 void RenderSystem::getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
 {
-	KinectSkeleton* originalSkeletons;
-	getKSkeletons(nSkeletons, originalSkeletons, deviceIdx);
-	for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = originalSkeletons[i];
+	getKSkeletons(nSkeletons, skeletons, deviceIdx);
+}
+
+void RenderSystem::getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	getTransformedKSkeletons(nSkeletons, skeletons, deviceIdx);
+}
+
+bool RenderSystem::getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx)
+{
+	return false;
+}
+
+bool RenderSystem::getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx)
+{
+	return false;
+}
+
+uint32 RenderSystem::getKFrameID(int32 deviceIdx)
+{
+	return 0;
+}
+
+bool RenderSystem::getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+{
+	return false;
+}
+
+bool RenderSystem::isKDeviceLive(int32 deviceIdx)
+{
+	return true;
+}
+
+float32 RenderSystem::getKMeasurementNoise(int32 deviceIdx)
+{
+	return Config::kinect[KinectManager::getDeviceID(deviceIdx)].measurementNoise;
+}
+
+bool RenderSystem::isKHierarchicalOri(int32 deviceIdx)
+{
+	return Config::kinect[KinectManager::getDeviceID(deviceIdx)].hierarchicalOri;
+}
+
+bool RenderSystem::getFusedKFrame(SkeletonFusion::FusedFrame& frame)
+{
+	return false;
+}
+
+bool RenderSystem::initializeDevice(KinectDevice* device)
+{
+	std::string deviceID = device->getID();
+
+	int32 flags = 0;
+	bool depth = Config::kinect[deviceID].depthMap || Config::kinect[deviceID].rawDepth || Config::kinect[deviceID].playerMasks;
+	if (Config::kinect[deviceID].rgbImage) flags = flags|KinectDevice::K_USE_COLOR;
+	if (Config::kinect[deviceID].skeletonTracking)
+	{
+		if (depth) flags = flags|KinectDevice::K_USE_DEPTH_AND_PLAYER|KinectDevice::K_USE_SKELETON;
+		else flags = flags|KinectDevice::K_USE_SKELETON;
+	}
+	else if (depth) flags = flags|KinectDevice::K_USE_DEPTH;
+
+	if (flags != 0)
+	{
+		uint32 initializeAttempts = 1;
+		int32 result = device->initialize(flags, Config::kinect[deviceID].seatedMode, Config::kinect[deviceID].nearMode);
+		while (result != 0 && (initializeAttempts <= 1 || (result == KinectDevice::K_ERROR_DEVICE_ALREADY_INITIALIZED && initializeAttempts <= 2)))
+		{
+			initializeAttempts++;
+			std::string message = "";
+			switch (result)
+			{
+			case KinectDevice::K_ERROR_SKELETON_IN_USE:
+				message = "ERROR: Unable to initialize RenderSystem. Skeleton is in use on device " + device->getID() + ".";
+				Log::write("[RenderSystem] initialize()", message);
+				break;
+			case KinectDevice::K_ERROR_SKELETON_TRACKING:
+				message = "ERROR: Unable to enable skeleton tracking on device " + device->getID() + ".";
+				Log::write("[RenderSystem] initialize()", message);
+				break;
+			case KinectDevice::K_ERROR_DEVICE_IN_USE:
+				message = "ERROR: Unable to initialize RenderSystem. Device " + device->getID() + " is in use.";
+				Log::write("[RenderSystem] initialize()", message);
+				break;
+			case KinectDevice::K_ERROR_INVALID_DEVICE:
+				message = "ERROR: Unable to initialize RenderSystem. Device " + device->getID() + " is not a valid device.";
+				Log::write("[RenderSystem] initialize()", message);
+				break;
+			case KinectDevice::K_ERROR_DEVICE_ALREADY_INITIALIZED:
+				message = "ERROR: Unable to initialize RenderSystem. Device " + device->getID() + " is already initialized. Trying to reinitialize...";
+				Log::write("[RenderSystem] initialize()", message);
+				device->shutDown();
+				result = device->initialize(flags, Config::kinect[deviceID].seatedMode, Config::kinect[deviceID].nearMode);
+				break;
+			case KinectDevice::K_ERROR_UNKNOWN:
+				message = "ERROR: Unable to initialize RenderSystem. Device " + device->getID() + " has produced an unknown error.";
+				Log::write("[RenderSystem] initialize()", message);
+				break;
+			default:
+				Log::write("[RenderSystem] initialize()", "ERROR: Unable to initialize RenderSystem. Unknown error.");
+				break;
+			}
+		}
+	}
+
+	if (device->isInitialized())
+	{
+		std::string message = "Initialized with Device " + device->getID() + ".";
+		Log::write("[RenderSystem] initialize()", message);
+		return true;
+	}
+	else return false;
+}
+
+bool RenderSystem::readSkeletonsFrameAt(const SharedFrameSlots<KinectDevice::SkeletonsFrame>* slots, uint64 timestamp, KinectDevice::SkeletonsFrame& frame)
+{
+	if (!slots) return false;
+
+	// Walk back by frame number from the latest one when the walk starts, so frames published meanwhile cannot shift it
+	KinectDevice::SkeletonsFrame after, before;
+	bool hasAfter = false;
+	uint32 newest = slots->getPublished();
+	uint32 historySize = slots->getHistorySize();
+	for (uint32 age = 0; age < historySize && age < newest; age++)
+	{
+		// A slot already reused by a newer frame ends the history
+		if (!slots->readNumber(before, newest - age)) break;
+		if (before.timestamp <= timestamp)
+		{
+			if (hasAfter) interpolateSkeletonsFrames(before, after, timestamp, frame);
+			else frame = before;
+			return true;
+		}
+
+		after = before;
+		hasAfter = true;
+	}
+
+	// The history does not reach that far back, use the oldest frame left
+	if (hasAfter) frame = after;
+	return hasAfter;
+}
+
+void RenderSystem::transformSkeletons(const KinectDevice::SkeletonsFrame& frame, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	std::string deviceID = KinectManager::getDeviceID(deviceIdx);
+	nSkeletons = frame.nSkeletons;
+	const KinectSkeleton* originalSkeletons = frame.skeletons;
+	Matrix4x4 kMatrix;
+	getKMatrix(kMatrix, deviceIdx);
+	float32 psi, theta, phi;
+	kMatrix.getEulerAngles(psi, theta, phi);
+	Quaternion kQuaternion(phi, theta, psi);
+	for (uint32 i = 0; i < nSkeletons; i++)
+	{
+		skeletons[i] = originalSkeletons[i];
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			if (skeletons[i].getJointValidity(joint))
+			{
+				if (Config::kinect[deviceID].hierarchicalOri && joint != KinectSkeleton::K_HIP_CENTER)
+				{
+					skeletons[i].setJoint(
+						joint,
+						kMatrix*skeletons[i].getJointPosition(joint),
+						skeletons[i].getJointOrientationQuaternion(joint));
+				}
+				else
+				{
+					skeletons[i].setJoint(
+						joint,
+						kMatrix*skeletons[i].getJointPosition(joint),
+						kQuaternion*skeletons[i].getJointOrientationQuaternion(joint));
+				}
+			}
+		}
+	}
+}
+
+void RenderSystem::interpolateSkeletonsFrames(const KinectDevice::SkeletonsFrame& frame1, const KinectDevice::SkeletonsFrame& frame2, uint64 timestamp, KinectDevice::SkeletonsFrame& frame)
+{
+	float32 t = 0.0f;
+	if (frame2.timestamp > frame1.timestamp)
+		t = basic_cast<float32>(timestamp - frame1.timestamp)/basic_cast<float32>(frame2.timestamp - frame1.timestamp);
+	bool nearFrame2 = (t >= 0.5f);
+
+	frame.timestamp = timestamp;
+	frame.confidenceValue = frame1.confidenceValue + t*(frame2.confidenceValue - frame1.confidenceValue);
+	frame.nSkeletons = 0;
+
+	// Skeletons are paired by tracking ID since the frame slots are compacted
+	bool paired[KINECT_SKELETON_COUNT] = {false};
+	for (uint32 i = 0; i < frame2.nSkeletons; i++)
+	{
+		int32 match = -1;
+		for (uint32 k = 0; k < frame1.nSkeletons && match == -1; k++)
+			if (frame1.trackingIDs[k] == frame2.trackingIDs[i]) match = basic_cast<int32>(k);
+
+		if (match == -1)
+		{
+			if (nearFrame2)
+			{
+				frame.skeletons[frame.nSkeletons] = frame2.skeletons[i];
+				frame.trackingIDs[frame.nSkeletons] = frame2.trackingIDs[i];
+				frame.nSkeletons++;
+			}
+			continue;
+		}
+
+		paired[match] = true;
+		const KinectSkeleton& skeleton1 = frame1.skeletons[match];
+		const KinectSkeleton& skeleton2 = frame2.skeletons[i];
+		KinectSkeleton& skeleton = frame.skeletons[frame.nSkeletons];
+		skeleton.clear();
+		skeleton.setPlayerIndex(skeleton2.getPlayerIndex());
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			bool valid1 = skeleton1.getJointValidity(joint);
+			bool valid2 = skeleton2.getJointValidity(joint);
+			if (valid1 && valid2)
+			{
+				Point position1 = skeleton1.getJointPosition(joint);
+				skeleton.setJoint(
+					joint,
+					position1 + (skeleton2.getJointPosition(joint) - position1)*t,
+					Quaternion::spherical_linear_interp(
+						skeleton1.getJointOrientationQuaternion(joint),
+						skeleton2.getJointOrientationQuaternion(joint),
+						t));
+			}
+			else if (valid2 && nearFrame2)
+				skeleton.setJoint(joint, skeleton2.getJointPosition(joint), skeleton2.getJointOrientationQuaternion(joint));
+			else if (valid1 && !nearFrame2)
+				skeleton.setJoint(joint, skeleton1.getJointPosition(joint), skeleton1.getJointOrientationQuaternion(joint));
+		}
+		frame.trackingIDs[frame.nSkeletons] = frame2.trackingIDs[i];
+		frame.nSkeletons++;
+	}
+
+	// Users that left the view between both frames
+	if (!nearFrame2)
+	{
+		for (uint32 k = 0; k < frame1.nSkeletons; k++)
+		{
+			if (paired[k]) continue;
+			frame.skeletons[frame.nSkeletons] = frame1.skeletons[k];
+			frame.trackingIDs[frame.nSkeletons] = frame1.trackingIDs[k];
+			frame.nSkeletons++;
+		}
+	}
 }
@@ -23,7 +23,10 @@
 
 #include "Globals/Config.h"
 #include "Geom/Matrix4x4.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include "Interprocess/SharedImageBuffers.h"
 #include "Interprocess/SharedMemoryManager.h"
+#include "Interprocess/SlaveManager.h"
 #include "Kinect/KinectDevice.h"
 #include "Kinect/KinectManager.h"
 #include "Kinect/KinectSkeleton.h"
@@ -37,9 +40,32 @@ using namespace Render;
 using namespace Tools;
 
 
+RenderSystemInterprocess::SegmentChannels::SegmentChannels(const std::string& segmentID)
+{
+	colorFrame.bind(segmentID, "colorFrame");
+	depthFrame.bind(segmentID, "depthFrame");
+	rawDepthBuffers.bind(segmentID, "rawDepthBuffers");
+	rawDepthPixels.bind(segmentID, "rawDepthPixels");
+	depthPreviewRequests.bind(segmentID, "depthPreviewRequests");
+	playerMasksBuffers.bind(segmentID, "playerMasksBuffers");
+	playerMasksPixels.bind(segmentID, "playerMasksPixels");
+	skeletonsSlots.bind(segmentID, "skeletonsSlots");
+	confidenceValue.bind(segmentID, "confidenceValue");
+	rotationX.bind(segmentID, "rotationX");
+	rotationY.bind(segmentID, "rotationY");
+	rotationZ.bind(segmentID, "rotationZ");
+	translationX.bind(segmentID, "translationX");
+	translationY.bind(segmentID, "translationY");
+	translationZ.bind(segmentID, "translationZ");
+}
+
 RenderSystemInterprocess::RenderSystemInterprocess() : RenderSystem()
 {
-	currentSharedSegment_ = "";
+	currentDevice_ = -1;
+
+	uint32 nDevices = KinectManager::getNumberOfDevices();
+	for (uint32 i = 0; i < nDevices; i++) channels_.push_back(SegmentChannels(KinectManager::getSegmentID(i)));
+
 	Log::write("[RenderSystem] initialize()", "Interprocess initialized");
 }
 
@@ -50,117 +76,97 @@ RenderSystemInterprocess::~RenderSystemInterprocess()
 void RenderSystemInterprocess::searchBestSharedSegment()
 {
 	float32* confidenceValue = 0;
-	if (currentSharedSegment_ != "")
-		confidenceValue = SharedMemoryManager::getSharedObject<float32>(currentSharedSegment_, "confidenceValue");
+	if (currentDevice_ != -1 && KinectManager::isDeviceConnected(currentDevice_) && isKDeviceLive(currentDevice_))
+		confidenceValue = channels_[currentDevice_].confidenceValue.get();
+	else currentDevice_ = -1;
 
-	uint32 nDevices = KinectManager::getNumberOfDevices();
-	if (nDevices)
+	uint32 nDevices = basic_cast<uint32>(channels_.size());
+	float32 confidenceMax = -1.0f;
+	if (confidenceValue) confidenceMax = *confidenceValue + Config::other.confidenceMargin;
+	for (uint32 i = 0; i < nDevices; i++)
 	{
-		float32 confidenceMax = -1.0f;
-		if (confidenceValue) confidenceMax = *confidenceValue + Config::other.confidenceMargin;
-		for (uint32 i = 0; i < nDevices; i++)
+		if (!KinectManager::isDeviceConnected(i) || !isKDeviceLive(basic_cast<int32>(i))) continue;
+
+		confidenceValue = channels_[i].confidenceValue.get();
+		if (confidenceValue && *confidenceValue > confidenceMax)
 		{
-			std::string deviceID = KinectManager::getDeviceObject(i).getID();
-			std::string segmentID = KinectManager::reformatDeviceID(deviceID);
-			confidenceValue = SharedMemoryManager::getSharedObject<float32>(segmentID, "confidenceValue");
-			if (confidenceValue && *confidenceValue > confidenceMax)
-			{
-				currentSharedSegment_ = segmentID;
-				confidenceMax = *confidenceValue;
-			}
+			currentDevice_ = i;
+			confidenceMax = *confidenceValue;
 		}
 	}
-	else currentSharedSegment_ = "";
 }
 
-uint8* RenderSystemInterprocess::getKColorFrame(int32 deviceIdx)
+RenderSystemInterprocess::SegmentChannels* RenderSystemInterprocess::getChannels(int32 deviceIdx)
 {
-	std::string segmentID = "";
-
 	if (deviceIdx == -1)
 	{
 		searchBestSharedSegment();
-		segmentID = currentSharedSegment_;
-	}
-	else
-	{
-		std::string deviceID = KinectManager::getDeviceObject(deviceIdx).getID();
-		segmentID = KinectManager::reformatDeviceID(deviceID);
+		deviceIdx = currentDevice_;
 	}
 
-	if (segmentID != "") return SharedMemoryManager::getSharedObject<uint8>(segmentID, "colorFrame");
+	if (deviceIdx >= 0 && deviceIdx < basic_cast<int32>(channels_.size())) return &channels_[deviceIdx];
 	else return 0;
 }
 
+bool RenderSystemInterprocess::readSkeletonsFrame(SegmentChannels* channels, KinectDevice::SkeletonsFrame& frame)
+{
+	SharedFrameSlots<KinectDevice::SkeletonsFrame>* slots = 0;
+	if (channels) slots = channels->skeletonsSlots.get();
+
+	// A copy only counts if the slots were not removed while it was made
+	return slots && slots->read(frame) && channels->skeletonsSlots.isCurrent();
+}
+
+uint8* RenderSystemInterprocess::getKColorFrame(int32 deviceIdx)
+{
+	SegmentChannels* channels = getChannels(deviceIdx);
+	return (channels)?channels->colorFrame.get():0;
+}
+
 uint8* RenderSystemInterprocess::getKDepthFrame(int32 deviceIdx)
 {
-	std::string segmentID = "";
+	SegmentChannels* channels = getChannels(deviceIdx);
+	if (!channels) return 0;
 
-	if (deviceIdx == -1)
-	{
-		searchBestSharedSegment();
-		segmentID = currentSharedSegment_;
-	}
-	else
-	{
-		std::string deviceID = KinectManager::getDeviceObject(deviceIdx).getID();
-		segmentID = KinectManager::reformatDeviceID(deviceID);
-	}
+	// Slaves publishing raw depth only colorize it while someone is looking
+	LONG* depthPreviewRequests = channels->depthPreviewRequests.get();
+	if (depthPreviewRequests) InterlockedIncrement(depthPreviewRequests);
 
-	if (segmentID != "") return SharedMemoryManager::getSharedObject<uint8>(segmentID, "depthFrame");
-	else return 0;
+	return channels->depthFrame.get();
 }
 
-void RenderSystemInterprocess::getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx)
+bool RenderSystemInterprocess::getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx)
 {
-	std::string segmentID = "";
+	SegmentChannels* channels = getChannels(deviceIdx);
+	if (!channels) return false;
 
-	if (deviceIdx == -1)
-	{
-		searchBestSharedSegment();
-		segmentID = currentSharedSegment_;
-	}
-	else
-	{
-		std::string deviceID = KinectManager::getDeviceObject(deviceIdx).getID();
-		segmentID = KinectManager::reformatDeviceID(deviceID);
-	}
+	return KinectDevice::readRawDepthFrame(channels->rawDepthBuffers.get(), channels->rawDepthPixels.get(), frame) &&
+		channels->rawDepthBuffers.isCurrent() && channels->rawDepthPixels.isCurrent();
+}
 
-	if (segmentID != "")
-	{
-		uint32* aux = SharedMemoryManager::getSharedObject<uint32>(segmentID, "nSkeletons");
-		if (aux)
-		{
-			nSkeletons = *aux;
-			skeletons = SharedMemoryManager::getSharedObject<KinectSkeleton>(segmentID, "skeletons");
-		}
-		else
-		{
-			nSkeletons = 0;
-			skeletons = 0;
-		}
-	}
-	else
-	{
-		nSkeletons = 0;
-		skeletons = 0;
-	}
+bool RenderSystemInterprocess::getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx)
+{
+	SegmentChannels* channels = getChannels(deviceIdx);
+	if (!channels) return false;
+
+	return KinectDevice::readPlayerMasksFrame(channels->playerMasksBuffers.get(), channels->playerMasksPixels.get(), frame) &&
+		channels->playerMasksBuffers.isCurrent() && channels->playerMasksPixels.isCurrent();
 }
 
-bool RenderSystemInterprocess::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
+bool RenderSystemInterprocess::getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
 {
-	std::string segmentID = "";
+	KinectDevice::SkeletonsFrame frame;
+	nSkeletons = 0;
+	if (!readSkeletonsFrame(getChannels(deviceIdx), frame)) return false;
 
-	if (deviceIdx == -1)
-	{
-		searchBestSharedSegment();
-		segmentID = currentSharedSegment_;
-	}
-	else
-	{
-		std::string deviceID = KinectManager::getDeviceObject(deviceIdx).getID();
-		segmentID = KinectManager::reformatDeviceID(deviceID);
-	}
+	nSkeletons = frame.nSkeletons;
+	for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = frame.skeletons[i];
+	return true;
+}
+
+bool RenderSystemInterprocess::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
+{
+	SegmentChannels* channels = getChannels(deviceIdx);
 
 	float32* rotationX = 0;
 	float32* rotationY = 0;
@@ -169,14 +175,14 @@ bool RenderSystemInterprocess::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceI
 	float32* translationY = 0;
 	float32* translationZ = 0;
 
-	if (segmentID != "")
+	if (channels)
 	{
-		rotationX = SharedMemoryManager::getSharedObject<float32>(segmentID, "rotationX");
-		rotationY = SharedMemoryManager::getSharedObject<float32>(segmentID, "rotationY");
-		rotationZ = SharedMemoryManager::getSharedObject<float32>(segmentID, "rotationZ");
-		translationX = SharedMemoryManager::getSharedObject<float32>(segmentID, "translationX");
-		translationY = SharedMemoryManager::getSharedObject<float32>(segmentID, "translationY");
-		translationZ = SharedMemoryManager::getSharedObject<float32>(segmentID, "translationZ");
+		rotationX = channels->rotationX.get();
+		rotationY = channels->rotationY.get();
+		rotationZ = channels->rotationZ.get();
+		translationX = channels->translationX.get();
+		translationY = channels->translationY.get();
+		translationZ = channels->translationZ.get();
 	}
 
 	if (rotationX && rotationY && rotationZ && translationX && translationY && translationZ)
@@ -199,128 +205,63 @@ void RenderSystemInterprocess::getTransformedKSkeletons(uint32& nSkeletons, Kine
 {
 	if (deviceIdx == -1)
 	{
-		uint32 totalSkeletons = 0;
-		std::vector< std::vector<KinectSkeleton> > skeletonCandidates(KINECT_SKELETON_COUNT);
-		uint32 nKinects = KinectManager::getNumberOfDevices();
-		for (uint32 i = 0; i < nKinects; i++)
-		{
-			std::string deviceID = KinectManager::getDeviceObject(i).getID();
-			std::string segmentID = KinectManager::reformatDeviceID(deviceID);
-			uint32* aux = SharedMemoryManager::getSharedObject<uint32>(segmentID, "nSkeletons");
-			if (aux)
-			{
-				uint32 nSkeletonsAux = *aux;
-				if (nSkeletonsAux > totalSkeletons) totalSkeletons = nSkeletonsAux;
-				KinectSkeleton* skeletonsAux = SharedMemoryManager::getSharedObject<KinectSkeleton>(segmentID, "skeletons");
-				Matrix4x4 kMatrix;
-				getKMatrix(kMatrix, i);
-				float32 psi, theta, phi;
-				kMatrix.getEulerAngles(psi, theta, phi);
-				Quaternion kQuaternion(phi, theta, psi);
-				for (uint32 j = 0; j < nSkeletonsAux; j++)
-				{
-					uint32 s = basic_cast<uint32>(skeletonCandidates[j].size());
-					skeletonCandidates[j].push_back(skeletonsAux[j]);
-					for (uint32 k = 0; k < KINECT_SKELETON_JOINT_COUNT; k++)
-					{
-						KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(k);
-						if (skeletonCandidates[j][s].getJointValidity(joint))
-						{
-							if (Config::kinect[deviceID].hierarchicalOri && joint != KinectSkeleton::K_HIP_CENTER)
-							{
-								skeletonCandidates[j][s].setJoint(
-									joint,
-									kMatrix*skeletonCandidates[j][s].getJointPosition(joint),
-									skeletonCandidates[j][s].getJointOrientationQuaternion(joint));
-							}
-							else
-							{
-								skeletonCandidates[j][s].setJoint(
-									joint,
-									kMatrix*skeletonCandidates[j][s].getJointPosition(joint),
-									kQuaternion*skeletonCandidates[j][s].getJointOrientationQuaternion(joint));
-							}
-						}
-					}
-				}
-			}
-		}
-
-		nSkeletons = totalSkeletons;
-		for (uint32 i = 0; i < nSkeletons; i++)
-		{
-			KinectSkeleton combinedSkeleton;
-			combinedSkeleton.setPlayerIndex(i + 1);
-			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
-			{
-				KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
-				float32 jointWeight = 0.0f;
-				Point jointPosition;
-				Quaternion jointOrientation;
-				uint32 nJointCandidates = basic_cast<uint32>(skeletonCandidates[i].size());
-
-				for (uint32 k = 0; k < nJointCandidates; k++)
-				{
-					if (skeletonCandidates[i][k].getJointValidity(joint))
-					{
-						float32 weight = skeletonCandidates[i][k].getJointWeight(joint)*(1.0f + skeletonCandidates[i][k].getConfidenceValue());
-						jointWeight += weight;
-						jointPosition += weight*skeletonCandidates[i][k].getJointPosition(joint);
-						jointOrientation += weight*skeletonCandidates[i][k].getJointOrientationQuaternion(joint);
-					}
-				}
-				if (jointWeight)
-				{
-					combinedSkeleton.setJoint(
-						joint,
-						jointPosition/jointWeight,
-						jointOrientation/jointWeight);
-				}
-			}
-			skeletons[i] = combinedSkeleton;
-		}
-
+		SkeletonFusion::FusedFrame fusedFrame;
+		getFusedKFrame(fusedFrame);
+		nSkeletons = fusedFrame.nSkeletons;
+		for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = fusedFrame.skeletons[i];
 	}
 	else
 	{
-		std::string deviceID = KinectManager::getDeviceObject(deviceIdx).getID();
-		std::string segmentID = KinectManager::reformatDeviceID(deviceID);
-		uint32* aux = SharedMemoryManager::getSharedObject<uint32>(segmentID, "nSkeletons");
-		if (aux)
-		{
-			nSkeletons = *aux;
-			KinectSkeleton* originalSkeletons = SharedMemoryManager::getSharedObject<KinectSkeleton>(segmentID, "skeletons");
-			Matrix4x4 kMatrix;
-			getKMatrix(kMatrix, deviceIdx);
-			float32 psi, theta, phi;
-			kMatrix.getEulerAngles(psi, theta, phi);
-			Quaternion kQuaternion(phi, theta, psi);
-			for (uint32 i = 0; i < nSkeletons; i++)
-			{
-				skeletons[i] = originalSkeletons[i];
-				for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
-				{
-					KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
-					if (skeletons[i].getJointValidity(joint))
-					{
-						if (Config::kinect[deviceID].hierarchicalOri && joint != KinectSkeleton::K_HIP_CENTER)
-						{
-							skeletons[i].setJoint(
-								joint,
-								kMatrix*skeletons[i].getJointPosition(joint),
-								skeletons[i].getJointOrientationQuaternion(joint));
-						}
-						else
-						{
-							skeletons[i].setJoint(
-								joint,
-								kMatrix*skeletons[i].getJointPosition(joint),
-								kQuaternion*skeletons[i].getJointOrientationQuaternion(joint));
-						}
-					}
-				}
-			}
-		}
+		KinectDevice::SkeletonsFrame frame;
+		if (readSkeletonsFrame(getChannels(deviceIdx), frame)) transformSkeletons(frame, nSkeletons, skeletons, deviceIdx);
 		else nSkeletons = 0;
 	}
 }
+
+void RenderSystemInterprocess::getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	if (deviceIdx == -1) getTransformedKSkeletons(nSkeletons, skeletons, deviceIdx);
+	else
+	{
+		KinectDevice::SkeletonsFrame frame;
+		SegmentChannels* channels = getChannels(deviceIdx);
+		if (channels && readSkeletonsFrameAt(channels->skeletonsSlots.get(), timestamp, frame) && channels->skeletonsSlots.isCurrent())
+			transformSkeletons(frame, nSkeletons, skeletons, deviceIdx);
+		else nSkeletons = 0;
+	}
+}
+
+uint32 RenderSystemInterprocess::getKFrameID(int32 deviceIdx)
+{
+	SegmentChannels* channels = getChannels(deviceIdx);
+
+	SharedFrameSlots<KinectDevice::SkeletonsFrame>* slots = 0;
+	if (channels) slots = channels->skeletonsSlots.get();
+
+	return (slots)?slots->getPublished():0;
+}
+
+bool RenderSystemInterprocess::getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+{
+	SegmentChannels* channels = getChannels(deviceIdx);
+
+	SharedFrameSlots<KinectDevice::SkeletonsFrame>* slots = 0;
+	if (channels) slots = channels->skeletonsSlots.get();
+
+	return slots && slots->readField(&KinectDevice::SkeletonsFrame::timestamp, timestamp) && channels->skeletonsSlots.isCurrent();
+}
+
+bool RenderSystemInterprocess::isKDeviceLive(int32 deviceIdx)
+{
+	// Slaves are added in device order, a segment without a slave is not supervised
+	if (deviceIdx == -1) deviceIdx = currentDevice_;
+	if (deviceIdx < 0 || !SlaveManager::isInitialized() || deviceIdx >= basic_cast<int32>(SlaveManager::getNumberOfSlaves())) return true;
+	else return SlaveManager::isAlive(basic_cast<uint32>(deviceIdx));
+}
+
+bool RenderSystemInterprocess::getFusedKFrame(SkeletonFusion::FusedFrame& frame)
+{
+	fusion_.update(this, KinectManager::getNumberOfDevices());
+	fusion_.getFrame(frame);
+	return true;
+}
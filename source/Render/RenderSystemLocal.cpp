@@ -21,8 +21,6 @@
 
 #include "Render/RenderSystemLocal.h"
 
-#include "Globals/Config.h"
-#include "Globals/Vars.h"
 #include "Geom/Matrix4x4.h"
 #include "Kinect/KinectDevice.h"
 #include "Kinect/KinectSkeleton.h"
@@ -37,64 +35,7 @@ using namespace Tools;
 RenderSystemLocal::RenderSystemLocal(KinectDevice* device) : RenderSystem()
 {
 	device_ = device;
-
-	int32 flags = 0;
-	if (Config::kinect[Globals::INSTANCE_ID].rgbImage) flags = flags|KinectDevice::K_USE_COLOR;
-	if (Config::kinect[Globals::INSTANCE_ID].skeletonTracking)
-	{
-		if (Config::kinect[Globals::INSTANCE_ID].depthMap) flags = flags|KinectDevice::K_USE_DEPTH_AND_PLAYER|KinectDevice::K_USE_SKELETON;
-		else flags = flags|KinectDevice::K_USE_SKELETON;
-	}
-	else if (Config::kinect[Globals::INSTANCE_ID].depthMap) flags = flags|KinectDevice::K_USE_DEPTH;
-
-	if (flags != 0)
-	{
-		uint32 initializeAttempts = 1;
-		int32 result = device_->initialize(flags, Config::kinect[Globals::INSTANCE_ID].seatedMode, Config::kinect[Globals::INSTANCE_ID].nearMode);
-		while (result != 0 && (initializeAttempts <= 1 || (result == KinectDevice::K_ERROR_DEVICE_ALREADY_INITIALIZED && initializeAttempts <= 2)))
-		{
-			initializeAttempts++;
-			std::string message = "";
-			switch (result)
-			{
-			case KinectDevice::K_ERROR_SKELETON_IN_USE:
-				message = "ERROR: Unable to initialize RenderSystem. Skeleton is in use on device " + device_->getID() + ".";
-				Log::write("[RenderSystem] initialize()", message);
-				break;
-			case KinectDevice::K_ERROR_SKELETON_TRACKING:
-				message = "ERROR: Unable to enable skeleton tracking on device " + device_->getID() + ".";
-				Log::write("[RenderSystem] initialize()", message);
-				break;
-			case KinectDevice::K_ERROR_DEVICE_IN_USE:
-				message = "ERROR: Unable to initialize RenderSystem. Device " + device_->getID() + " is in use.";
-				Log::write("[RenderSystem] initialize()", message);
-				break;
-			case KinectDevice::K_ERROR_INVALID_DEVICE:
-				message = "ERROR: Unable to initialize RenderSystem. Device " + device_->getID() + " is not a valid device.";
-				Log::write("[RenderSystem] initialize()", message);
-				break;
-			case KinectDevice::K_ERROR_DEVICE_ALREADY_INITIALIZED:
-				message = "ERROR: Unable to initialize RenderSystem. Device " + device_->getID() + " is already initialized. Trying to reinitialize...";
-				Log::write("[RenderSystem] initialize()", message);
-				device_->shutDown();
-				result = device_->initialize(flags, Config::kinect[Globals::INSTANCE_ID].seatedMode, Config::kinect[Globals::INSTANCE_ID].nearMode);
-				break;
-			case KinectDevice::K_ERROR_UNKNOWN:
-				message = "ERROR: Unable to initialize RenderSystem. Device " + device_->getID() + " has produced an unknown error.";
-				Log::write("[RenderSystem] initialize()", message);
-				break;
-			default:
-				Log::write("[RenderSystem] initialize()", "ERROR: Unable to initialize RenderSystem. Unknown error.");
-				break;
-			}
-		}
-	}
-
-	if (device_->isInitialized())
-	{
-		std::string message = "Initialized with Device " + device_->getID() + ".";
-		Log::write("[RenderSystem] initialize()", message);
-	}
+	initializeDevice(device_);
 }
 
 RenderSystemLocal::~RenderSystemLocal()
@@ -117,10 +58,25 @@ uint8* RenderSystemLocal::getKDepthFrame(int32 deviceIdx)
 	return device_->getDepthFrame();
 }
 
-void RenderSystemLocal::getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx)
+bool RenderSystemLocal::getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx)
 {
-	nSkeletons = device_->getNumberOfSkeletons();
-	skeletons = device_->getSkeletons();
+	return device_->getRawDepthFrame(frame);
+}
+
+bool RenderSystemLocal::getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx)
+{
+	return device_->getPlayerMasksFrame(frame);
+}
+
+bool RenderSystemLocal::getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	KinectDevice::SkeletonsFrame frame;
+	nSkeletons = 0;
+	if (!device_->getSkeletonsFrame(frame)) return false;
+
+	nSkeletons = frame.nSkeletons;
+	for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = frame.skeletons[i];
+	return true;
 }
 
 bool RenderSystemLocal::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
@@ -145,8 +101,15 @@ bool RenderSystemLocal::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
 
 void RenderSystemLocal::getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
 {
-	nSkeletons = device_->getNumberOfSkeletons();
-	KinectSkeleton* originalSkeletons = device_->getSkeletons();
+	KinectDevice::SkeletonsFrame frame;
+	if (!device_->getSkeletonsFrame(frame))
+	{
+		nSkeletons = 0;
+		return;
+	}
+
+	nSkeletons = frame.nSkeletons;
+	KinectSkeleton* originalSkeletons = frame.skeletons;
 	Matrix4x4 kMatrix;
 	getKMatrix(kMatrix, deviceIdx);
 	for (uint32 i = 0; i < nSkeletons; i++)
@@ -168,3 +131,8 @@ void RenderSystemLocal::getTransformedKSkeletons(uint32& nSkeletons, KinectSkele
 		}
 	}
 }
+
+uint32 RenderSystemLocal::getKFrameID(int32 deviceIdx)
+{
+	return device_->getSkeletonsFrameID();
+}
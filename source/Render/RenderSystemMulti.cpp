@@ -0,0 +1,203 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Render/RenderSystemMulti.h"
+
+#include "Globals/Config.h"
+#include "Geom/Matrix4x4.h"
+#include "Interprocess/SharedFrameSlots.h"
+#include "Kinect/KinectDevice.h"
+#include "Kinect/KinectManager.h"
+#include "Kinect/KinectSkeleton.h"
+#include "Tools/Log.h"
+
+using namespace MultiKinect;
+using namespace Geom;
+using namespace Interprocess;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+RenderSystemMulti::RenderSystemMulti() : RenderSystem()
+{
+	currentDevice_ = -1;
+
+	uint32 nDevices = KinectManager::getNumberOfDevices();
+	for (uint32 i = 0; i < nDevices; i++)
+	{
+		KinectDevice* device = KinectManager::getDevicePointer(i);
+		if (device) initializeDevice(device);
+		devices_.push_back(device);
+	}
+
+	Log::write("[RenderSystem] initialize()", "Multi device initialized");
+}
+
+RenderSystemMulti::~RenderSystemMulti()
+{
+	uint32 nDevices = basic_cast<uint32>(devices_.size());
+	for (uint32 i = 0; i < nDevices; i++) delete devices_[i];
+}
+
+void RenderSystemMulti::searchBestDevice()
+{
+	float32 confidenceMax = -1.0f;
+	if (currentDevice_ != -1 && KinectManager::isDeviceConnected(currentDevice_) && devices_[currentDevice_] && devices_[currentDevice_]->isInitialized())
+		confidenceMax = devices_[currentDevice_]->getConfidenceValue() + Config::other.confidenceMargin;
+	else currentDevice_ = -1;
+
+	uint32 nDevices = basic_cast<uint32>(devices_.size());
+	for (uint32 i = 0; i < nDevices; i++)
+	{
+		if (!KinectManager::isDeviceConnected(i) || !devices_[i] || !devices_[i]->isInitialized()) continue;
+
+		float32 confidenceValue = devices_[i]->getConfidenceValue();
+		if (confidenceValue > confidenceMax)
+		{
+			currentDevice_ = i;
+			confidenceMax = confidenceValue;
+		}
+	}
+}
+
+int32 RenderSystemMulti::getDeviceIndex(int32 deviceIdx)
+{
+	if (deviceIdx == -1)
+	{
+		searchBestDevice();
+		deviceIdx = currentDevice_;
+	}
+
+	if (deviceIdx >= 0 && deviceIdx < basic_cast<int32>(devices_.size()) && devices_[deviceIdx] && devices_[deviceIdx]->isInitialized())
+		return deviceIdx;
+	else return -1;
+}
+
+uint8* RenderSystemMulti::getKColorFrame(int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	return (idx != -1)?devices_[idx]->getColorFrame():0;
+}
+
+uint8* RenderSystemMulti::getKDepthFrame(int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	return (idx != -1)?devices_[idx]->getDepthFrame():0;
+}
+
+bool RenderSystemMulti::getKRawDepthFrame(KinectDevice::RawDepthFrame& frame, int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	return (idx != -1)?devices_[idx]->getRawDepthFrame(frame):false;
+}
+
+bool RenderSystemMulti::getKPlayerMasksFrame(KinectDevice::PlayerMasksFrame& frame, int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	return (idx != -1)?devices_[idx]->getPlayerMasksFrame(frame):false;
+}
+
+bool RenderSystemMulti::getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	KinectDevice::SkeletonsFrame frame;
+	nSkeletons = 0;
+	if (idx == -1 || !devices_[idx]->getSkeletonsFrame(frame)) return false;
+
+	nSkeletons = frame.nSkeletons;
+	for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = frame.skeletons[i];
+	return true;
+}
+
+bool RenderSystemMulti::getKMatrix(Matrix4x4& kinectMatrix, int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+
+	float32 rotationX, rotationY, rotationZ;
+	float32 translationX, translationY, translationZ;
+	if (idx != -1 &&
+		devices_[idx]->getRotation(rotationX, rotationY, rotationZ) &&
+		devices_[idx]->getTranslation(translationX, translationY, translationZ))
+	{
+		Matrix4x4 mRotationX = Matrix4x4().setRotation(rotationX, Matrix4x4::X_AXIS);
+		Matrix4x4 mRotationY = Matrix4x4().setRotation(rotationY, Matrix4x4::Y_AXIS);
+		Matrix4x4 mRotationZ = Matrix4x4().setRotation(rotationZ, Matrix4x4::Z_AXIS);
+		Matrix4x4 mTranslation = Matrix4x4().setTranslation(Vector(translationX, translationY, translationZ));
+		kinectMatrix = mTranslation*mRotationZ*mRotationY*mRotationX;
+		return true;
+	}
+	else
+	{
+		kinectMatrix.setIdentity();
+		return false;
+	}
+}
+
+void RenderSystemMulti::getTransformedKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	if (deviceIdx == -1)
+	{
+		SkeletonFusion::FusedFrame fusedFrame;
+		getFusedKFrame(fusedFrame);
+		nSkeletons = fusedFrame.nSkeletons;
+		for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = fusedFrame.skeletons[i];
+	}
+	else
+	{
+		int32 idx = getDeviceIndex(deviceIdx);
+		KinectDevice::SkeletonsFrame frame;
+		if (idx != -1 && devices_[idx]->getSkeletonsFrame(frame)) transformSkeletons(frame, nSkeletons, skeletons, idx);
+		else nSkeletons = 0;
+	}
+}
+
+void RenderSystemMulti::getTransformedKSkeletonsAt(uint64 timestamp, uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
+{
+	if (deviceIdx == -1) getTransformedKSkeletons(nSkeletons, skeletons, deviceIdx);
+	else
+	{
+		int32 idx = getDeviceIndex(deviceIdx);
+		KinectDevice::SkeletonsFrame frame;
+		if (idx != -1 && readSkeletonsFrameAt(devices_[idx]->getSkeletonsSlots(), timestamp, frame)) transformSkeletons(frame, nSkeletons, skeletons, idx);
+		else nSkeletons = 0;
+	}
+}
+
+uint32 RenderSystemMulti::getKFrameID(int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	return (idx != -1)?devices_[idx]->getSkeletonsFrameID():0;
+}
+
+bool RenderSystemMulti::getKFrameTimestamp(uint64& timestamp, int32 deviceIdx)
+{
+	int32 idx = getDeviceIndex(deviceIdx);
+	const SharedFrameSlots<KinectDevice::SkeletonsFrame>* slots = (idx != -1)?devices_[idx]->getSkeletonsSlots():0;
+	return (slots)?slots->readField(&KinectDevice::SkeletonsFrame::timestamp, timestamp):false;
+}
+
+bool RenderSystemMulti::getFusedKFrame(SkeletonFusion::FusedFrame& frame)
+{
+	fusion_.update(this, basic_cast<uint32>(devices_.size()));
+	fusion_.getFrame(frame);
+	return true;
+}
@@ -54,8 +54,11 @@ uint8* RenderSystemRemote::getKDepthFrame(int32 deviceIdx)
 	return 0;
 }
 
-void RenderSystemRemote::getKSkeletons(uint32& nSkeletons, KinectSkeleton*& skeletons, int32 deviceIdx)
+bool RenderSystemRemote::getKSkeletons(uint32& nSkeletons, KinectSkeleton* skeletons, int32 deviceIdx)
 {
 	nSkeletons = vrpnClient_->getNumberOfSkeletons();
-	skeletons = vrpnClient_->getSkeletons();
+	KinectSkeleton* remoteSkeletons = vrpnClient_->getSkeletons();
+	if (!remoteSkeletons) nSkeletons = 0;
+	for (uint32 i = 0; i < nSkeletons; i++) skeletons[i] = remoteSkeletons[i];
+	return remoteSkeletons != 0;
 }
@@ -0,0 +1,541 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Render/SkeletonFusion.h"
+
+#include "Globals/Config.h"
+#include "Kinect/BoneOrientationSolver.h"
+#include "Render/RenderSystem.h"
+#include "Tools/AssignmentSolver.h"
+#include "Tools/Clock.h"
+#include <cmath>
+
+using namespace MultiKinect;
+using namespace Globals;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+// Absolute orientations are turned like the ones each sensor reports
+static const Quaternion facing(0.0f, PI32, 0.0f);
+
+SkeletonFusion::FusedFrame::FusedFrame()
+{
+	frameID			= 0;
+	timestamp		= 0;
+	fusedTimestamp	= 0;
+	nSkeletons		= 0;
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++) trackIDs[i] = 0;
+}
+
+SkeletonFusion::SkeletonFusion()
+{
+	InitializeCriticalSection(&updateLock_);
+	InitializeCriticalSection(&frameLock_);
+	currentFrame_ = &frames_[0];
+	lastCaptureTime_ = 0;
+	nextTrackID_ = 1;
+}
+
+SkeletonFusion::~SkeletonFusion()
+{
+	DeleteCriticalSection(&frameLock_);
+	DeleteCriticalSection(&updateLock_);
+}
+
+bool SkeletonFusion::hasNewData(RenderSystem* source, uint32 nDevices)
+{
+	bool newData = false;
+	if (lastFrameIDs_.size() != nDevices)
+	{
+		lastFrameIDs_ = std::vector<uint32>(nDevices, 0);
+		captureTimes_ = std::vector<uint64>(nDevices, 0);
+		fusedTimes_ = std::vector<uint64>(nDevices, 0);
+		newData = true;
+	}
+
+	for (uint32 i = 0; i < nDevices; i++)
+	{
+		uint32 frameID = source->getKFrameID(basic_cast<int32>(i));
+		if (frameID != lastFrameIDs_[i])
+		{
+			lastFrameIDs_[i] = frameID;
+			newData = true;
+		}
+	}
+
+	return newData;
+}
+
+bool SkeletonFusion::align(RenderSystem* source, uint32 nDevices, uint64& captureTime)
+{
+	uint64 newest = 0;
+	for (uint32 i = 0; i < nDevices; i++)
+	{
+		// A stale or dead slave would freeze its last skeletons into the fused frame
+		if (!source->isKDeviceLive(basic_cast<int32>(i)) || !source->getKFrameTimestamp(captureTimes_[i], basic_cast<int32>(i))) captureTimes_[i] = 0;
+		if (captureTimes_[i] > newest) newest = captureTimes_[i];
+	}
+
+	// Sensors lagging behind the alignment window are left out instead of
+	// holding the others back. Any sensor with a frame not fused yet makes
+	// the estimate move on to the newest capture.
+	bool newFrames = false;
+	captureTime = newest;
+	for (uint32 i = 0; i < nDevices; i++)
+	{
+		if (captureTimes_[i] == 0 || newest - captureTimes_[i] > Clock::fromMilliseconds(Config::fusion.alignmentWindow)) captureTimes_[i] = 0;
+		else if (captureTimes_[i] > fusedTimes_[i]) newFrames = true;
+	}
+
+	return newFrames;
+}
+
+float32 SkeletonFusion::distance(const KinectSkeleton& skeleton1, const KinectSkeleton& skeleton2)
+{
+	float32 totalDistance = 0.0f;
+	uint32 nJoints = 0;
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+		if (skeleton1.getJointValidity(joint) && skeleton2.getJointValidity(joint))
+		{
+			totalDistance += skeleton1.getJointPosition(joint).distance(skeleton2.getJointPosition(joint));
+			nJoints++;
+		}
+	}
+
+	return (nJoints)?totalDistance/basic_cast<float32>(nJoints):-1.0f;
+}
+
+void SkeletonFusion::associate(const KinectSkeleton* skeletons, uint32 nSkeletons, float32 noise, bool hierarchical, uint64 time)
+{
+	const float32 gatedCost = 1000000.0f;
+
+	// Match this device's skeletons against every live track in room coordinates
+	uint32 nTracks = basic_cast<uint32>(tracks_.size());
+	std::vector<float32> costs(nTracks*nSkeletons, gatedCost);
+	for (uint32 t = 0; t < nTracks; t++)
+	{
+		for (uint32 k = 0; k < nSkeletons; k++)
+		{
+			float32 cost = distance(tracks_[t].reference, skeletons[k]);
+			if (cost >= 0.0f && cost <= Config::fusion.associationGate) costs[t*nSkeletons + k] = cost;
+		}
+	}
+
+	std::vector<int32> assignment;
+	AssignmentSolver::solve(costs, nTracks, nSkeletons, assignment);
+
+	std::vector<bool> assigned(nSkeletons, false);
+	for (uint32 t = 0; t < nTracks; t++)
+	{
+		int32 k = assignment[t];
+		if (k != -1 && costs[t*nSkeletons + k] < gatedCost)
+		{
+			tracks_[t].candidates.push_back(skeletons[k]);
+			tracks_[t].candidatesNoise.push_back(noise);
+			tracks_[t].candidatesHierarchical.push_back(hierarchical);
+			assigned[k] = true;
+		}
+	}
+
+	// Unmatched skeletons start new tracks, reusing the slot of the stalest track if needed
+	for (uint32 k = 0; k < nSkeletons; k++)
+	{
+		if (assigned[k]) continue;
+
+		bool usedSlots[KINECT_SKELETON_COUNT] = {false};
+		int32 stalestTrack = -1;
+		for (uint32 t = 0; t < tracks_.size(); t++)
+		{
+			usedSlots[tracks_[t].slot] = true;
+			if (tracks_[t].candidates.empty() && tracks_[t].lastSeen < time &&
+				(stalestTrack == -1 || tracks_[t].lastSeen < tracks_[stalestTrack].lastSeen))
+				stalestTrack = basic_cast<int32>(t);
+		}
+
+		int32 slot = -1;
+		for (uint32 s = 0; s < KINECT_SKELETON_COUNT && slot == -1; s++)
+			if (!usedSlots[s]) slot = basic_cast<int32>(s);
+		if (slot == -1 && stalestTrack != -1)
+		{
+			slot = basic_cast<int32>(tracks_[stalestTrack].slot);
+			tracks_.erase(tracks_.begin() + stalestTrack);
+		}
+
+		if (slot != -1)
+		{
+			Track track;
+			track.id = nextTrackID_++;
+			track.slot = basic_cast<uint32>(slot);
+			track.lastSeen = time;
+			track.lastEstimate = 0;
+			track.reference = skeletons[k];
+			track.candidates.push_back(skeletons[k]);
+			track.candidatesNoise.push_back(noise);
+			track.candidatesHierarchical.push_back(hierarchical);
+			track.nCorrected = 0;
+			tracks_.push_back(track);
+			filter_.reset(track.slot);
+			smoothing_.reset(track.slot);
+		}
+	}
+}
+
+void SkeletonFusion::correct(Track& track, uint64 time)
+{
+	// Only the candidates of the sensor being fused are new to the filters
+	uint32 nCandidates = basic_cast<uint32>(track.candidates.size());
+	for (uint32 k = track.nCorrected; k < nCandidates; k++)
+	{
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			if (track.candidates[k].getJointValidity(joint))
+				filter_.update(track.slot, j, track.candidates[k].getJointPosition(joint), track.candidatesNoise[k], time);
+		}
+	}
+
+	track.nCorrected = nCandidates;
+	track.lastSeen = time;
+}
+
+void SkeletonFusion::averageOrientations(Track& track)
+{
+	float32 orientationWeights[KINECT_SKELETON_JOINT_COUNT];
+	Quaternion jointOrientations[KINECT_SKELETON_JOINT_COUNT];
+	Quaternion firstOrientations[KINECT_SKELETON_JOINT_COUNT];
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++) orientationWeights[j] = 0.0f;
+
+	uint32 nCandidates = basic_cast<uint32>(track.candidates.size());
+	for (uint32 k = 0; k < nCandidates; k++)
+	{
+		Quaternion orientations[KINECT_SKELETON_JOINT_COUNT];
+		bool validity[KINECT_SKELETON_JOINT_COUNT];
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			validity[j] = track.candidates[k].getJointValidity(joint);
+			orientations[j] = track.candidates[k].getJointOrientationQuaternion(joint);
+		}
+
+		// Hierarchical sensors are averaged in absolute orientations too, only joints chained up to the hip center can be
+		if (track.candidatesHierarchical[k])
+		{
+			Quaternion hierarchical[KINECT_SKELETON_JOINT_COUNT];
+			bool composed[KINECT_SKELETON_JOINT_COUNT];
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++) hierarchical[j] = orientations[j];
+			BoneOrientationSolver::toAbsolute(hierarchical, validity, orientations, composed);
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			{
+				orientations[j] = orientations[j]*facing;
+				validity[j] = composed[j];
+			}
+		}
+
+		float32 noise = track.candidatesNoise[k];
+		float32 weight = 1.0f/(noise*noise);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			if (!validity[j]) continue;
+
+			// q and -q are the same rotation, so sum every candidate on the hemisphere of the first one
+			Quaternion orientation = orientations[j];
+			if (!orientationWeights[j]) firstOrientations[j] = orientation;
+			else if (orientation.dot(firstOrientations[j]) < 0.0f) orientation = -orientation;
+
+			orientationWeights[j] += weight;
+			jointOrientations[j] += weight*orientation;
+		}
+	}
+
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		if (orientationWeights[j] && jointOrientations[j].length_squared() > 0.0f) track.orientations[j] = jointOrientations[j].normalized();
+}
+
+KinectSkeleton SkeletonFusion::estimate(const Track& track, uint64 time)
+{
+	KinectSkeleton skeleton;
+	skeleton.setPlayerIndex(track.slot + 1);
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		if (filter_.isValid(track.slot, j) && time - filter_.getLastMeasurement(track.slot, j) <= Clock::fromMilliseconds(Config::fusion.jointTimeout))
+		{
+			skeleton.setJoint(
+				basic_cast<KinectSkeleton::KinectJoint>(j),
+				filter_.getPosition(track.slot, j),
+				track.orientations[j]);
+		}
+	}
+
+	return skeleton;
+}
+
+void SkeletonFusion::solveOrientations(uint64 time)
+{
+	// Slots bound the number of tracks, so the whole batch fits on the stack
+	Point joints[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	bool validity[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	Quaternion orientations[KINECT_SKELETON_COUNT*KINECT_SKELETON_JOINT_COUNT];
+	uint32 nTracks = basic_cast<uint32>(tracks_.size());
+	for (uint32 t = 0; t < nTracks; t++)
+	{
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			uint32 index = t*KINECT_SKELETON_JOINT_COUNT + j;
+			validity[index] = filter_.isValid(tracks_[t].slot, j) && time - filter_.getLastMeasurement(tracks_[t].slot, j) <= Clock::fromMilliseconds(Config::fusion.jointTimeout);
+			if (validity[index]) joints[index] = filter_.getPosition(tracks_[t].slot, j);
+		}
+	}
+
+	BoneOrientationSolver::solve(joints, validity, nTracks, orientations);
+
+	for (uint32 t = 0; t < nTracks; t++)
+	{
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			tracks_[t].orientations[j] = orientations[t*KINECT_SKELETON_JOINT_COUNT + j]*facing;
+	}
+}
+
+void SkeletonFusion::makeHierarchical(const Track& track, KinectSkeleton& skeleton)
+{
+	// Tracks keep every orientation, so each joint has its parent even when the parent joint timed out
+	Quaternion absolute[KINECT_SKELETON_JOINT_COUNT];
+	Quaternion hierarchical[KINECT_SKELETON_JOINT_COUNT];
+	Quaternion unturn = facing.conjugated();
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++) absolute[j] = track.orientations[j]*unturn;
+	BoneOrientationSolver::toHierarchical(absolute, hierarchical);
+
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+		if (skeleton.getJointValidity(joint)) skeleton.setJoint(joint, skeleton.getJointPosition(joint), hierarchical[j]);
+	}
+}
+
+void SkeletonFusion::differentiate(Track& track, uint64 time)
+{
+	const float32 smoothing = 0.3f;
+
+	if (track.lastEstimate != 0 && time > track.lastEstimate)
+	{
+		float32 dt = Clock::toSeconds(time - track.lastEstimate);
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			Vector velocity = filter_.getVelocity(track.slot, j);
+			track.accelerations[j] += smoothing*((velocity - track.lastVelocities[j])/dt - track.accelerations[j]);
+
+			if (track.orientations[j].length_squared() > 0.0f && track.lastOrientations[j].length_squared() > 0.0f)
+			{
+				Quaternion delta = track.orientations[j].normalized()*track.lastOrientations[j].normalized().inverse();
+				if (delta.real() < 0.0f) delta = -delta;
+				Vector axis = delta.imaginary();
+				float32 sinHalfAngle = axis.length();
+				Vector angularVelocity = axis*(2.0f/dt);
+				if (sinHalfAngle > 0.000001f) angularVelocity = axis*(2.0f*atan2f(sinHalfAngle, delta.real())/(sinHalfAngle*dt));
+				track.angularVelocities[j] += smoothing*(angularVelocity - track.angularVelocities[j]);
+			}
+		}
+	}
+
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		track.lastVelocities[j] = filter_.getVelocity(track.slot, j);
+		track.lastOrientations[j] = track.orientations[j];
+	}
+	track.lastEstimate = time;
+}
+
+void SkeletonFusion::fuse(RenderSystem* source, uint32 nDevices, uint64 captureTime, FusedFrame& frame)
+{
+	for (uint32 t = 0; t < tracks_.size(); t++)
+	{
+		tracks_[t].candidates.clear();
+		tracks_[t].candidatesNoise.clear();
+		tracks_[t].candidatesHierarchical.clear();
+		tracks_[t].nCorrected = 0;
+	}
+
+	// Sensors with a new frame are fused oldest capture first
+	std::vector<uint32> order;
+	for (uint32 i = 0; i < nDevices; i++)
+	{
+		if (captureTimes_[i] == 0 || captureTimes_[i] <= fusedTimes_[i]) continue;
+
+		std::vector<uint32>::iterator position = order.begin();
+		while (position != order.end() && captureTimes_[*position] <= captureTimes_[i]) position++;
+		order.insert(position, i);
+	}
+
+	// Each new frame updates the filters once, at its own capture time, so
+	// the estimate ends at the newest capture instead of waiting for the
+	// slowest sensor. A frame older than the estimate, from a sensor that
+	// published late, is taken as current.
+	uint64 time = lastCaptureTime_;
+	KinectSkeleton deviceSkeletons[KINECT_SKELETON_COUNT];
+	for (uint32 k = 0; k < order.size(); k++)
+	{
+		uint32 i = order[k];
+		if (captureTimes_[i] > time) time = captureTimes_[i];
+		filter_.predict(time, Config::fusion.processNoise);
+		for (uint32 t = 0; t < tracks_.size(); t++) tracks_[t].reference = estimate(tracks_[t], time);
+
+		uint32 nDeviceSkeletons = 0;
+		source->getTransformedKSkeletonsAt(captureTimes_[i], nDeviceSkeletons, deviceSkeletons, basic_cast<int32>(i));
+		associate(deviceSkeletons, nDeviceSkeletons, source->getKMeasurementNoise(basic_cast<int32>(i)), source->isKHierarchicalOri(basic_cast<int32>(i)), time);
+		for (uint32 t = 0; t < tracks_.size(); t++)
+			if (tracks_[t].nCorrected < tracks_[t].candidates.size()) correct(tracks_[t], time);
+		fusedTimes_[i] = captureTimes_[i];
+	}
+
+	frame.timestamp = time;
+	frame.nSkeletons = 0;
+	for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
+	{
+		frame.skeletons[i] = KinectSkeleton();
+		frame.trackIDs[i] = 0;
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			frame.velocities[i][j] = Vector();
+			frame.accelerations[i][j] = Vector();
+			frame.angularVelocities[i][j] = Vector();
+		}
+	}
+
+	std::vector<Track>::iterator it = tracks_.begin();
+	while (it != tracks_.end())
+	{
+		if (!it->candidates.empty()) averageOrientations(*it);
+		else if (time - it->lastSeen > Clock::fromMilliseconds(Config::fusion.trackTimeout))
+		{
+			it = tracks_.erase(it);
+			continue;
+		}
+		it++;
+	}
+	if (Config::fusion.solveOrientations) solveOrientations(time);
+
+	// Tracks are packed in slot order, and a track keeps its slot for its whole life so the order stays stable
+	Track* slotTracks[KINECT_SKELETON_COUNT];
+	for (uint32 s = 0; s < KINECT_SKELETON_COUNT; s++) slotTracks[s] = 0;
+	for (it = tracks_.begin(); it != tracks_.end(); it++) slotTracks[it->slot] = &(*it);
+
+	uint32 slots[KINECT_SKELETON_COUNT];
+	for (uint32 s = 0; s < KINECT_SKELETON_COUNT; s++)
+	{
+		Track* track = slotTracks[s];
+		if (!track) continue;
+
+		uint32 i = frame.nSkeletons++;
+		slots[i] = s;
+		differentiate(*track, time);
+		frame.skeletons[i] = estimate(*track, time);
+		if (Config::fusion.hierarchicalOri) makeHierarchical(*track, frame.skeletons[i]);
+		frame.trackIDs[i] = track->id;
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			frame.velocities[i][j] = filter_.getVelocity(s, j);
+			frame.accelerations[i][j] = track->accelerations[j];
+			frame.angularVelocities[i][j] = track->angularVelocities[j];
+		}
+	}
+
+	if (Config::jointSmoothing.stage == Config::SMOOTHING_FUSION) smooth(frame, slots, time);
+}
+
+void SkeletonFusion::smooth(FusedFrame& frame, const uint32* slots, uint64 time)
+{
+	// The smoothing filters belong to the track slots, not to the packed entries
+	smoothing_.setParameters(Config::jointSmoothing.minCutoff, Config::jointSmoothing.beta, Config::jointSmoothing.derivativeCutoff);
+
+	for (uint32 i = 0; i < frame.nSkeletons; i++)
+	{
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			if (frame.skeletons[i].getJointValidity(joint)) smoothing_.set(slots[i], j, frame.skeletons[i].getJointPosition(joint));
+		}
+	}
+
+	smoothing_.filter(time);
+
+	for (uint32 i = 0; i < frame.nSkeletons; i++)
+	{
+		for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+		{
+			KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+			if (frame.skeletons[i].getJointValidity(joint) && smoothing_.isValid(slots[i], j))
+				frame.skeletons[i].setJoint(joint, smoothing_.getPosition(slots[i], j), frame.skeletons[i].getJointOrientationQuaternion(joint));
+		}
+	}
+}
+
+bool SkeletonFusion::update(RenderSystem* source, uint32 nDevices)
+{
+	EnterCriticalSection(&updateLock_);
+
+	uint64 captureTime = 0;
+	bool updated = hasNewData(source, nDevices) && align(source, nDevices, captureTime);
+	if (updated)
+	{
+		// Fuse into the frame no reader is looking at, then publish it
+		FusedFrame* nextFrame = (currentFrame_ == &frames_[0])?&frames_[1]:&frames_[0];
+		fuse(source, nDevices, captureTime, *nextFrame);
+		nextFrame->frameID = currentFrame_->frameID + 1;
+		nextFrame->fusedTimestamp = Clock::getTime();
+		lastCaptureTime_ = captureTime;
+
+		EnterCriticalSection(&frameLock_);
+		currentFrame_ = nextFrame;
+		LeaveCriticalSection(&frameLock_);
+	}
+
+	LeaveCriticalSection(&updateLock_);
+
+	return updated;
+}
+
+void SkeletonFusion::getFrame(FusedFrame& frame)
+{
+	EnterCriticalSection(&frameLock_);
+	frame = *currentFrame_;
+	LeaveCriticalSection(&frameLock_);
+}
+
+float32 SkeletonFusion::getSmoothingLatency()
+{
+	EnterCriticalSection(&updateLock_);
+	float32 latency = (Config::jointSmoothing.stage == Config::SMOOTHING_FUSION)?smoothing_.getLatency():0.0f;
+	LeaveCriticalSection(&updateLock_);
+
+	return latency;
+}
+
+uint64 SkeletonFusion::getFrameID()
+{
+	EnterCriticalSection(&frameLock_);
+	uint64 frameID = currentFrame_->frameID;
+	LeaveCriticalSection(&frameLock_);
+
+	return frameID;
+}
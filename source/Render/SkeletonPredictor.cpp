@@ -0,0 +1,215 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Render/SkeletonPredictor.h"
+
+#include "Tools/Clock.h"
+#include "Tools/Log.h"
+#include <cmath>
+
+using namespace MultiKinect;
+using namespace Geom;
+using namespace Kinect;
+using namespace Render;
+using namespace Tools;
+
+
+// Slot of a track in a fused frame, -1 when the frame does not hold it
+static int32 findTrack(const SkeletonFusion::FusedFrame& frame, uint32 trackID)
+{
+	for (uint32 i = 0; i < frame.nSkeletons; i++)
+		if (frame.trackIDs[i] == trackID) return basic_cast<int32>(i);
+	return -1;
+}
+
+SkeletonPredictor::HorizonError::HorizonError(uint32 milliseconds)
+{
+	horizon				= milliseconds;
+	predictedErrorSum	= 0.0;
+	heldErrorSum		= 0.0;
+	nSamples			= 0;
+}
+
+SkeletonPredictor::SkeletonPredictor(const std::string& name)
+{
+	name_ = name;
+	hasPending_ = false;
+	pendingTime_ = 0;
+	pendingHorizon_ = 0;
+	pendingTrackID_ = 0;
+	errorSum_ = 0.0;
+	horizonSum_ = 0.0;
+	nSamples_ = 0;
+	lastReport_ = 0;
+}
+
+SkeletonPredictor::~SkeletonPredictor()
+{
+}
+
+void SkeletonPredictor::evaluate(const SkeletonFusion::FusedFrame& frame, uint32 slot)
+{
+	if (!hasPending_ || frame.timestamp < pendingTime_) return;
+	hasPending_ = false;
+	if (frame.trackIDs[slot] != pendingTrackID_) return;
+
+	// Compare the pending prediction with the first estimate at or after its target time
+	float32 error = 0.0f;
+	uint32 nJoints = 0;
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+		if (pending_.getJointValidity(joint) && frame.skeletons[slot].getJointValidity(joint))
+		{
+			error += pending_.getJointPosition(joint).distance(frame.skeletons[slot].getJointPosition(joint));
+			nJoints++;
+		}
+	}
+
+	if (nJoints)
+	{
+		errorSum_ += basic_cast<float64>(error/basic_cast<float32>(nJoints));
+		horizonSum_ += Clock::toMilliseconds(pendingHorizon_);
+		nSamples_++;
+	}
+}
+
+KinectSkeleton SkeletonPredictor::predict(const SkeletonFusion::FusedFrame& frame, uint32 slot, uint64 time, uint32 maxHorizon, float32 damping)
+{
+	evaluate(frame, slot);
+
+	uint64 horizon = (time > frame.timestamp)?time - frame.timestamp:0;
+	if (horizon > Clock::fromMilliseconds(maxHorizon)) horizon = Clock::fromMilliseconds(maxHorizon);
+
+	KinectSkeleton skeleton = extrapolate(frame, slot, Clock::toSeconds(horizon), damping);
+
+	if (!hasPending_ && horizon > 0)
+	{
+		hasPending_ = true;
+		pendingTime_ = frame.timestamp + horizon;
+		pendingTrackID_ = frame.trackIDs[slot];
+		pendingHorizon_ = horizon;
+		pending_ = skeleton;
+	}
+
+	if (time - lastReport_ >= Clock::fromMilliseconds(10000))
+	{
+		if (nSamples_)
+		{
+			std::string message = name_ + ": mean horizon " + basic_cast<std::string>(horizonSum_/nSamples_) +
+				" ms, mean error " + basic_cast<std::string>(errorSum_*1000.0/nSamples_) +
+				" mm (" + basic_cast<std::string>(nSamples_) + " samples)";
+			Log::write("[SkeletonPredictor] predict()", message);
+		}
+		errorSum_ = 0.0;
+		horizonSum_ = 0.0;
+		nSamples_ = 0;
+		lastReport_ = time;
+	}
+
+	return skeleton;
+}
+
+KinectSkeleton SkeletonPredictor::extrapolate(const SkeletonFusion::FusedFrame& frame, uint32 slot, float32 horizon, float32 damping)
+{
+	KinectSkeleton skeleton = frame.skeletons[slot];
+	if (horizon <= 0.0f) return skeleton;
+
+	// Velocities decay exponentially along the horizon
+	float32 effectiveHorizon = (damping > 0.0f)?(1.0f - expf(-damping*horizon))/damping:horizon;
+
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+		if (skeleton.getJointValidity(joint))
+		{
+			Point position = skeleton.getJointPosition(joint) +
+				frame.velocities[slot][j]*effectiveHorizon +
+				frame.accelerations[slot][j]*(0.5f*effectiveHorizon*effectiveHorizon);
+
+			Quaternion orientation = skeleton.getJointOrientationQuaternion(joint);
+			Vector angularVelocity = frame.angularVelocities[slot][j];
+			float32 angularSpeed = angularVelocity.length();
+			if (angularSpeed > 0.000001f)
+				orientation = Quaternion::from_angle_axis(angularSpeed*effectiveHorizon, angularVelocity/angularSpeed)*orientation;
+
+			skeleton.setJoint(joint, position, orientation);
+		}
+	}
+
+	return skeleton;
+}
+
+void SkeletonPredictor::evaluateHistory(const std::deque<SkeletonFusion::FusedFrame>& frames, uint32 index, float32 damping, std::vector<HorizonError>& errors)
+{
+	if (index >= frames.size()) return;
+	const SkeletonFusion::FusedFrame& frame = frames[index];
+
+	for (uint32 i = 0; i < frame.nSkeletons; i++)
+	{
+		if (!frame.trackIDs[i]) continue;
+
+		for (uint32 h = 0; h < errors.size(); h++)
+		{
+			// Later estimates of the same track, interpolated to the target time, stand in for the truth
+			uint64 horizon = Clock::fromMilliseconds(errors[h].horizon);
+			uint64 target = frame.timestamp + horizon;
+			uint32 after = index + 1;
+			while (after < frames.size() && frames[after].timestamp < target) after++;
+			if (after >= frames.size()) continue;
+
+			const SkeletonFusion::FusedFrame& frame1 = frames[after - 1];
+			const SkeletonFusion::FusedFrame& frame2 = frames[after];
+			int32 slot1 = findTrack(frame1, frame.trackIDs[i]);
+			int32 slot2 = findTrack(frame2, frame.trackIDs[i]);
+			if (slot1 == -1 || slot2 == -1) continue;
+			float32 t = 1.0f;
+			if (frame2.timestamp > frame1.timestamp)
+				t = basic_cast<float32>(target - frame1.timestamp)/basic_cast<float32>(frame2.timestamp - frame1.timestamp);
+
+			KinectSkeleton predicted = extrapolate(frame, i, Clock::toSeconds(horizon), damping);
+			float32 predictedError = 0.0f;
+			float32 heldError = 0.0f;
+			uint32 nJoints = 0;
+			for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+			{
+				KinectSkeleton::KinectJoint joint = basic_cast<KinectSkeleton::KinectJoint>(j);
+				if (predicted.getJointValidity(joint) &&
+					frame1.skeletons[slot1].getJointValidity(joint) &&
+					frame2.skeletons[slot2].getJointValidity(joint))
+				{
+					Point position1 = frame1.skeletons[slot1].getJointPosition(joint);
+					Point truth = position1 + (frame2.skeletons[slot2].getJointPosition(joint) - position1)*t;
+					predictedError += predicted.getJointPosition(joint).distance(truth);
+					heldError += frame.skeletons[i].getJointPosition(joint).distance(truth);
+					nJoints++;
+				}
+			}
+
+			if (nJoints)
+			{
+				errors[h].predictedErrorSum += basic_cast<float64>(predictedError/basic_cast<float32>(nJoints));
+				errors[h].heldErrorSum += basic_cast<float64>(heldError/basic_cast<float32>(nJoints));
+				errors[h].nSamples++;
+			}
+		}
+	}
+}
@@ -0,0 +1,82 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tools/AllocationCounter.h"
+
+#ifndef _NDEBUG_
+#include <Windows.h>
+#include <crtdbg.h>
+#endif
+
+
+bool AllocationCounter::installed_ = false;
+
+#ifndef _NDEBUG_
+static __declspec(thread) uint32	threadAllocations = 0;
+static _CRT_ALLOC_HOOK				previousHook = 0;
+
+static int __cdecl countAllocation(int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* filename, int lineNumber)
+{
+	// Blocks owned by the CRT itself are not counted
+	if ((allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) && blockType != _CRT_BLOCK) threadAllocations++;
+
+	if (previousHook) return previousHook(allocType, userData, size, blockType, requestNumber, filename, lineNumber);
+	return TRUE;
+}
+#endif
+
+
+void AllocationCounter::install()
+{
+#ifndef _NDEBUG_
+	if (!installed_)
+	{
+		previousHook = _CrtSetAllocHook(countAllocation);
+		installed_ = true;
+	}
+#endif
+}
+
+void AllocationCounter::uninstall()
+{
+#ifndef _NDEBUG_
+	if (installed_)
+	{
+		_CrtSetAllocHook(previousHook);
+		previousHook = 0;
+		installed_ = false;
+	}
+#endif
+}
+
+bool AllocationCounter::isEnabled()
+{
+	return installed_;
+}
+
+uint32 AllocationCounter::getCount()
+{
+#ifndef _NDEBUG_
+	return threadAllocations;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,102 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tools/AssignmentSolver.h"
+
+#include <limits>
+
+using namespace MultiKinect;
+using namespace Tools;
+
+
+float32 AssignmentSolver::solve(const std::vector<float32>& costs, uint32 nRows, uint32 nCols, std::vector<int32>& assignment)
+{
+	assignment = std::vector<int32>(nRows, -1);
+	if (nRows == 0 || nCols == 0) return 0.0f;
+
+	// Square the problem with zero cost dummy rows/columns
+	uint32 n = (nRows > nCols)?nRows:nCols;
+	const float64 infinity = std::numeric_limits<float64>::max();
+
+	std::vector<float64> u(n + 1, 0.0), v(n + 1, 0.0);
+	std::vector<uint32> p(n + 1, 0), way(n + 1, 0);
+	for (uint32 i = 1; i <= n; i++)
+	{
+		p[0] = i;
+		uint32 j0 = 0;
+		std::vector<float64> minv(n + 1, infinity);
+		std::vector<bool> used(n + 1, false);
+		do
+		{
+			used[j0] = true;
+			uint32 i0 = p[j0];
+			uint32 j1 = 0;
+			float64 delta = infinity;
+			for (uint32 j = 1; j <= n; j++)
+			{
+				if (!used[j])
+				{
+					float64 cost = (i0 <= nRows && j <= nCols)?basic_cast<float64>(costs[(i0 - 1)*nCols + (j - 1)]):0.0;
+					float64 current = cost - u[i0] - v[j];
+					if (current < minv[j])
+					{
+						minv[j] = current;
+						way[j] = j0;
+					}
+					if (minv[j] < delta)
+					{
+						delta = minv[j];
+						j1 = j;
+					}
+				}
+			}
+			for (uint32 j = 0; j <= n; j++)
+			{
+				if (used[j])
+				{
+					u[p[j]] += delta;
+					v[j] -= delta;
+				}
+				else minv[j] -= delta;
+			}
+			j0 = j1;
+		} while (p[j0] != 0);
+
+		do
+		{
+			uint32 j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		} while (j0);
+	}
+
+	float32 totalCost = 0.0f;
+	for (uint32 j = 1; j <= nCols; j++)
+	{
+		if (p[j] != 0 && p[j] <= nRows)
+		{
+			assignment[p[j] - 1] = basic_cast<int32>(j - 1);
+			totalCost += costs[(p[j] - 1)*nCols + (j - 1)];
+		}
+	}
+
+	return totalCost;
+}
@@ -0,0 +1,84 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tools/Clock.h"
+
+#include <Windows.h>
+
+using namespace MultiKinect;
+using namespace Tools;
+
+
+int64 Clock::frequency_ = 0;
+int64 Clock::epoch_ = 0;
+
+int64 Clock::getTicks()
+{
+	if (!frequency_)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		frequency_ = frequency.QuadPart;
+	}
+
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart;
+}
+
+void Clock::initialize()
+{
+	epoch_ = getTicks();
+}
+
+void Clock::setEpoch(int64 epoch)
+{
+	epoch_ = epoch;
+}
+
+int64 Clock::getEpoch()
+{
+	return epoch_;
+}
+
+uint64 Clock::getTime()
+{
+	int64 ticks = getTicks() - epoch_;
+	if (ticks < 0) return 0;
+
+	// Split the conversion so the multiplication cannot overflow on long sessions
+	return basic_cast<uint64>((ticks/frequency_)*1000000000 + ((ticks%frequency_)*1000000000)/frequency_);
+}
+
+uint64 Clock::fromMilliseconds(uint64 milliseconds)
+{
+	return milliseconds*1000000;
+}
+
+float64 Clock::toMilliseconds(uint64 nanoseconds)
+{
+	return basic_cast<float64>(nanoseconds)*0.000001;
+}
+
+float32 Clock::toSeconds(uint64 nanoseconds)
+{
+	return basic_cast<float32>(basic_cast<float64>(nanoseconds)*0.000000001);
+}
@@ -0,0 +1,234 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tools/ImageConversion.h"
+
+#include <cstring>
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+using namespace MultiKinect;
+using namespace Tools;
+
+
+int32 ImageConversion::ssse3_ = -1;
+
+static uint32 lowestBit(uint32 bits)
+{
+	uint32 index = 0;
+	while (!(bits&1))
+	{
+		bits >>= 1;
+		index++;
+	}
+	return index;
+}
+
+static uint32 highestBit(uint32 bits)
+{
+	uint32 index = 0;
+	while (bits >>= 1) index++;
+	return index;
+}
+
+bool ImageConversion::hasSSSE3()
+{
+	if (ssse3_ < 0)
+	{
+		int32 info[4];
+		__cpuid(info, 1);
+		ssse3_ = (info[2] & (1 << 9)) ? 1 : 0;
+	}
+	return ssse3_ == 1;
+}
+
+void ImageConversion::convertBGRAToRGB(const uint8* bgra, uint8* rgb, uint32 width)
+{
+	uint32 x = 0;
+	if (hasSSSE3())
+	{
+		// Each shuffle packs four pixels into the low twelve bytes, three of which are merged per store
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i* source = reinterpret_cast<const __m128i*>(bgra + x*4);
+			__m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128(source + 0), mask);
+			__m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128(source + 1), mask);
+			__m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128(source + 2), mask);
+			__m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128(source + 3), mask);
+
+			__m128i* target = reinterpret_cast<__m128i*>(rgb + x*3);
+			_mm_storeu_si128(target + 0, _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+			_mm_storeu_si128(target + 1, _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+			_mm_storeu_si128(target + 2, _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+		}
+	}
+
+	for (; x < width; x++)
+	{
+		rgb[x*3 + 0] = bgra[x*4 + 2];
+		rgb[x*3 + 1] = bgra[x*4 + 1];
+		rgb[x*3 + 2] = bgra[x*4 + 0];
+	}
+}
+
+void ImageConversion::downscaleBGRAToRGB(const uint8* bgra, uint32 pitch, uint32 factorX, uint32 factorY, uint8* rgb, uint32 width)
+{
+	if (factorX == 1 && factorY == 1)
+	{
+		convertBGRAToRGB(bgra, rgb, width);
+		return;
+	}
+
+	uint32 x = 0;
+	if (factorX == 2 && factorY == 2 && hasSSSE3())
+	{
+		// Averages rows first, then even and odd pixels, giving four output pixels per iteration
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i* top = reinterpret_cast<const __m128i*>(bgra + x*8);
+			const __m128i* bottom = reinterpret_cast<const __m128i*>(bgra + pitch + x*8);
+			__m128 v0 = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(top + 0), _mm_loadu_si128(bottom + 0)));
+			__m128 v1 = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(top + 1), _mm_loadu_si128(bottom + 1)));
+			__m128i even = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i odd = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+			__m128i packed = _mm_shuffle_epi8(_mm_avg_epu8(even, odd), mask);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(rgb + x*3), packed);
+			int32 last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+			std::memcpy(rgb + x*3 + 8, &last, sizeof(last));
+		}
+	}
+
+	// Box filter over each factorX by factorY block of source pixels
+	uint32 area = factorX*factorY;
+	for (; x < width; x++)
+	{
+		uint32 blue = area/2;
+		uint32 green = area/2;
+		uint32 red = area/2;
+		for (uint32 y = 0; y < factorY; y++)
+		{
+			const uint8* pixel = bgra + pitch*y + x*factorX*4;
+			for (uint32 i = 0; i < factorX; i++, pixel += 4)
+			{
+				blue += pixel[0];
+				green += pixel[1];
+				red += pixel[2];
+			}
+		}
+		rgb[x*3 + 0] = basic_cast<uint8>(red/area);
+		rgb[x*3 + 1] = basic_cast<uint8>(green/area);
+		rgb[x*3 + 2] = basic_cast<uint8>(blue/area);
+	}
+}
+
+void ImageConversion::colorizeDepthRow(const uint16* depth, const uint32* colors, uint8* rgb, uint32 width)
+{
+	// Table lookups are gathers, so four pixels are looked up at a time and packed into three word stores
+	uint32 x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		uint32 c0 = colors[depth[x + 0]];
+		uint32 c1 = colors[depth[x + 1]];
+		uint32 c2 = colors[depth[x + 2]];
+		uint32 c3 = colors[depth[x + 3]];
+
+		// Stored word by word, a single twelve byte copy of a stack array stalls on store forwarding
+		uint32 word0 = c0 | (c1 << 24);
+		uint32 word1 = (c1 >> 8) | (c2 << 16);
+		uint32 word2 = (c2 >> 16) | (c3 << 8);
+		std::memcpy(rgb + x*3 + 0, &word0, sizeof(word0));
+		std::memcpy(rgb + x*3 + 4, &word1, sizeof(word1));
+		std::memcpy(rgb + x*3 + 8, &word2, sizeof(word2));
+	}
+
+	for (; x < width; x++)
+	{
+		uint32 c = colors[depth[x]];
+		rgb[x*3 + 0] = basic_cast<uint8>(c);
+		rgb[x*3 + 1] = basic_cast<uint8>(c >> 8);
+		rgb[x*3 + 2] = basic_cast<uint8>(c >> 16);
+	}
+}
+
+uint32 ImageConversion::extractPlayerMasksRow(const uint16* depth, uint32 width, uint8* masks, uint32 planeSize, uint32* minX, uint32* maxX)
+{
+	// Bit k of mask byte b is pixel 8*b + k. Planes are written in full, so absent players come out cleared
+	uint32 present = 0;
+	uint32 lastX[KINECT_SKELETON_COUNT];
+	uint32 lastBits[KINECT_SKELETON_COUNT];
+
+	uint32 x = 0;
+	const __m128i playerBits = _mm_set1_epi16(0x0007);
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 16 <= width; x += 16)
+	{
+		// Player indices fit in a byte, so sixteen pixels are compared at once per player
+		__m128i low = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + x)), playerBits);
+		__m128i high = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + x + 8)), playerBits);
+		__m128i players = _mm_packs_epi16(low, high);
+		bool empty = _mm_movemask_epi8(_mm_cmpeq_epi8(players, zero)) == 0xFFFF;
+
+		for (uint32 p = 0; p < KINECT_SKELETON_COUNT; p++)
+		{
+			uint32 bits = 0;
+			if (!empty) bits = basic_cast<uint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(players, _mm_set1_epi8(basic_cast<int8>(p + 1)))));
+
+			uint16 word = basic_cast<uint16>(bits);
+			std::memcpy(masks + planeSize*p + x/8, &word, sizeof(word));
+			if (bits)
+			{
+				if (!(present&(1 << p))) minX[p] = x + lowestBit(bits);
+				present |= 1 << p;
+				lastX[p] = x;
+				lastBits[p] = bits;
+			}
+		}
+	}
+
+	for (; x < width; x += 8)
+	{
+		uint32 count = (width - x < 8)?width - x:8;
+		for (uint32 p = 0; p < KINECT_SKELETON_COUNT; p++)
+		{
+			uint32 bits = 0;
+			for (uint32 i = 0; i < count; i++)
+				if ((depth[x + i]&0x0007) == p + 1) bits |= 1 << i;
+
+			masks[planeSize*p + x/8] = basic_cast<uint8>(bits);
+			if (bits)
+			{
+				if (!(present&(1 << p))) minX[p] = x + lowestBit(bits);
+				present |= 1 << p;
+				lastX[p] = x;
+				lastBits[p] = bits;
+			}
+		}
+	}
+
+	for (uint32 p = 0; p < KINECT_SKELETON_COUNT; p++)
+		if (present&(1 << p)) maxX[p] = lastX[p] + highestBit(lastBits[p]);
+
+	return present;
+}
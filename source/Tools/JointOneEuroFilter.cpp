@@ -0,0 +1,194 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tools/JointOneEuroFilter.h"
+
+#include "Tools/Clock.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define ONE_EURO_SSE
+#endif
+
+using namespace MultiKinect;
+using namespace Geom;
+using namespace Tools;
+
+
+JointOneEuroFilter::JointOneEuroFilter()
+{
+	std::memset(position_, 0, sizeof(position_));
+	std::memset(velocity_, 0, sizeof(velocity_));
+	std::memset(measurement_, 0, sizeof(measurement_));
+	std::memset(dt_, 0, sizeof(dt_));
+	std::memset(updating_, 0, sizeof(updating_));
+	std::memset(lag_, 0, sizeof(lag_));
+	std::memset(lastMeasurement_, 0, sizeof(lastMeasurement_));
+	std::memset(measuredCells_, 0, sizeof(measuredCells_));
+	std::memset(validCells_, 0, sizeof(validCells_));
+	minCutoff_ = 1.0f;
+	beta_ = 0.0f;
+	derivativeCutoff_ = 1.0f;
+	latency_ = 0.0f;
+}
+
+JointOneEuroFilter::~JointOneEuroFilter()
+{
+}
+
+void JointOneEuroFilter::setParameters(float32 minCutoff, float32 beta, float32 derivativeCutoff)
+{
+	minCutoff_ = minCutoff;
+	beta_ = beta;
+	derivativeCutoff_ = derivativeCutoff;
+}
+
+void JointOneEuroFilter::reset(uint32 slot)
+{
+	for (uint32 j = 0; j < KINECT_SKELETON_JOINT_COUNT; j++)
+	{
+		validCells_[slot*KINECT_SKELETON_JOINT_COUNT + j] = false;
+		measuredCells_[slot*KINECT_SKELETON_JOINT_COUNT + j] = false;
+	}
+}
+
+void JointOneEuroFilter::set(uint32 slot, uint32 joint, const Point& measurement)
+{
+	uint32 c = slot*KINECT_SKELETON_JOINT_COUNT + joint;
+	measurement_[0][c] = measurement.x;
+	measurement_[1][c] = measurement.y;
+	measurement_[2][c] = measurement.z;
+	measuredCells_[c] = true;
+}
+
+void JointOneEuroFilter::filter(uint64 time)
+{
+	// Cells seen for the first time start at their measurement, unmeasured cells are left as they are
+	uint32 nUpdating = 0;
+	for (uint32 c = 0; c < N_CELLS; c++)
+	{
+		bool updating = measuredCells_[c] && validCells_[c] && time > lastMeasurement_[c];
+		updating_[c] = (updating)?1.0f:0.0f;
+		dt_[c] = (updating)?Clock::toSeconds(time - lastMeasurement_[c]):1.0f;
+		if (updating) nUpdating++;
+
+		if (measuredCells_[c] && !validCells_[c])
+		{
+			for (uint32 a = 0; a < 3; a++)
+			{
+				position_[a][c] = measurement_[a][c];
+				velocity_[a][c] = 0.0f;
+			}
+			validCells_[c] = true;
+		}
+		if (measuredCells_[c]) lastMeasurement_[c] = time;
+		measuredCells_[c] = false;
+	}
+
+	const float32 twoPi = 2.0f*PI32;
+	const float32 derivativeTau = 1.0f/(twoPi*derivativeCutoff_);
+
+#ifdef ONE_EURO_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minCutoff = _mm_set1_ps(minCutoff_);
+	const __m128 beta = _mm_set1_ps(beta_);
+	const __m128 tauD = _mm_set1_ps(derivativeTau);
+	const __m128 invTwoPi = _mm_set1_ps(1.0f/twoPi);
+	for (uint32 c = 0; c < N_CELLS; c += 4)
+	{
+		__m128 dt = _mm_loadu_ps(dt_ + c);
+		__m128 updating = _mm_loadu_ps(updating_ + c);
+		__m128 alphaD = _mm_div_ps(dt, _mm_add_ps(dt, tauD));
+
+		__m128 speed = _mm_setzero_ps();
+		__m128 velocity[3];
+		for (uint32 a = 0; a < 3; a++)
+		{
+			__m128 rate = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(measurement_[a] + c), _mm_loadu_ps(position_[a] + c)), dt);
+			__m128 v = _mm_loadu_ps(velocity_[a] + c);
+			velocity[a] = _mm_add_ps(v, _mm_mul_ps(alphaD, _mm_sub_ps(rate, v)));
+			speed = _mm_add_ps(speed, _mm_mul_ps(velocity[a], velocity[a]));
+		}
+
+		__m128 cutoff = _mm_add_ps(minCutoff, _mm_mul_ps(beta, _mm_sqrt_ps(speed)));
+		__m128 tau = _mm_div_ps(invTwoPi, cutoff);
+		__m128 alpha = _mm_mul_ps(updating, _mm_div_ps(dt, _mm_add_ps(dt, tau)));
+		for (uint32 a = 0; a < 3; a++)
+		{
+			__m128 p = _mm_loadu_ps(position_[a] + c);
+			__m128 v = _mm_loadu_ps(velocity_[a] + c);
+			_mm_storeu_ps(position_[a] + c, _mm_add_ps(p, _mm_mul_ps(alpha, _mm_sub_ps(_mm_loadu_ps(measurement_[a] + c), p))));
+			_mm_storeu_ps(velocity_[a] + c, _mm_add_ps(v, _mm_mul_ps(updating, _mm_sub_ps(velocity[a], v))));
+		}
+
+		// A first order low pass trails a steady movement by its time constant
+		_mm_storeu_ps(lag_ + c, _mm_mul_ps(updating, tau));
+	}
+#else
+	for (uint32 c = 0; c < N_CELLS; c++)
+	{
+		float32 dt = dt_[c];
+		float32 alphaD = dt/(dt + derivativeTau);
+
+		float32 speed = 0.0f;
+		float32 velocity[3];
+		for (uint32 a = 0; a < 3; a++)
+		{
+			float32 rate = (measurement_[a][c] - position_[a][c])/dt;
+			velocity[a] = velocity_[a][c] + alphaD*(rate - velocity_[a][c]);
+			speed += velocity[a]*velocity[a];
+		}
+
+		float32 tau = 1.0f/(twoPi*(minCutoff_ + beta_*sqrtf(speed)));
+		float32 alpha = updating_[c]*dt/(dt + tau);
+		for (uint32 a = 0; a < 3; a++)
+		{
+			position_[a][c] += alpha*(measurement_[a][c] - position_[a][c]);
+			velocity_[a][c] += updating_[c]*(velocity[a] - velocity_[a][c]);
+		}
+
+		// A first order low pass trails a steady movement by its time constant
+		lag_[c] = updating_[c]*tau;
+	}
+#endif
+
+	float32 lag = 0.0f;
+	for (uint32 c = 0; c < N_CELLS; c++) lag += lag_[c];
+	if (nUpdating) latency_ = 1000.0f*lag/basic_cast<float32>(nUpdating);
+}
+
+bool JointOneEuroFilter::isValid(uint32 slot, uint32 joint) const
+{
+	return validCells_[slot*KINECT_SKELETON_JOINT_COUNT + joint];
+}
+
+Point JointOneEuroFilter::getPosition(uint32 slot, uint32 joint) const
+{
+	uint32 c = slot*KINECT_SKELETON_JOINT_COUNT + joint;
+	return Point(position_[0][c], position_[1][c], position_[2][c]);
+}
+
+float32 JointOneEuroFilter::getLatency() const
+{
+	return latency_;
+}
@@ -27,6 +27,7 @@
 bool			Log::initialized_ = false;
 std::string		Log::logFilename_ = "";
 std::fstream	Log::logFile_;
+CRITICAL_SECTION	Log::lock_;
 
 
 void Log::initialize(const std::string& logID)
@@ -36,13 +37,13 @@ void Log::initialize(const std::string& logID)
 		if (logID != "")	logFilename_ = Config::system.logPath + "/MultiKinect_Log_" + logID + ".txt";
 		else				logFilename_ = Config::system.logPath + "/MultiKinect_Log.txt";
 
+		// The file stays open until destroy(), capture threads only append and flush
+		InitializeCriticalSection(&lock_);
 		logFile_.open(logFilename_, std::fstream::out);
 
 		std::string text = Timer::getCountStrHMS("executionStart") + " -> Application started.\n";
 		logFile_.write(text.c_str(), text.length());
-
-		logFile_.close();
-		logFile_.clear();
+		logFile_.flush();
 
 		initialized_ = true;
 	}
@@ -53,13 +54,12 @@ void Log::destroy()
 {
 	if (initialized_)
 	{
-		logFile_.open(logFilename_, std::fstream::out|std::fstream::app);
-
 		std::string text = Timer::getCountStrHMS("executionStart") + " -> Application exited.\n";
 		logFile_.write(text.c_str(), text.length());
 
 		logFile_.close();
 		logFile_.clear();
+		DeleteCriticalSection(&lock_);
 
 		initialized_ = false;
 	}
@@ -85,14 +85,13 @@ void Log::write(std::string message)
 {
 	if (initialized_)
 	{
-		logFile_.open(logFilename_, std::fstream::out|std::fstream::app);
-
 		std::stringstream stream;
 		stream << Timer::getCountStrHMS("executionStart") << " -> " << message << std::endl;
-		logFile_.write(stream.str().c_str(), stream.str().length());
 
-		logFile_.close();
-		logFile_.clear();
+		EnterCriticalSection(&lock_);
+		logFile_.write(stream.str().c_str(), stream.str().length());
+		logFile_.flush();
+		LeaveCriticalSection(&lock_);
 	}
 	else std::cout << "[Log] write(): ERROR: Log not initialized." << std::endl;
 }
@@ -101,12 +100,10 @@ void Log::wrap(uint32 lines)
 {
 	if (initialized_)
 	{
-		logFile_.open(logFilename_, std::fstream::out|std::fstream::app);
-
+		EnterCriticalSection(&lock_);
 		for (uint32 i = 0; i < lines; i++) logFile_.write("\n", 1);
-
-		logFile_.close();
-		logFile_.clear();
+		logFile_.flush();
+		LeaveCriticalSection(&lock_);
 	}
 	else std::cout << "[Log] wrap(): ERROR: Log not initialized." << std::endl;
 }
@@ -115,21 +112,18 @@ std::string Log::getLog()
 {
 	if (initialized_)
 	{
-		logFile_.open(logFilename_, std::fstream::in);
+		std::fstream logFile(logFilename_, std::fstream::in);
 
-		logFile_.seekg(0, std::fstream::end);
-		uint32 length = basic_cast<uint32>(logFile_.tellg());
-		logFile_.seekg(0, std::fstream::beg);
+		logFile.seekg(0, std::fstream::end);
+		uint32 length = basic_cast<uint32>(logFile.tellg());
+		logFile.seekg(0, std::fstream::beg);
 
 		char* buffer = new char[length];
-		logFile_.read(buffer, length);
+		logFile.read(buffer, length);
 		buffer[length - 1] = 0;
 		std::string result(buffer);
 		delete[] buffer;
 
-		logFile_.close();
-		logFile_.clear();
-
 		return result;
 	}
 	else
@@ -0,0 +1,57 @@
+/*
+	MultiKinect: Skeleton tracking based on multiple Microsoft Kinect cameras
+	Copyright (C) 2012-2013  Miguel Angel Vico Moya
+
+	This file is part of MultiKinect.
+
+	MultiKinect is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "VRPN/VRPNDeviceStatus.h"
+
+#include "Interprocess/SlaveManager.h"
+#include "Tools/Log.h"
+
+using namespace MultiKinect;
+using namespace Interprocess;
+using namespace Tools;
+using namespace VRPN;
+
+
+VRPNDeviceStatus::VRPNDeviceStatus(const std::string& name, vrpn_Connection* c) : vrpn_Analog(name.c_str(), c)
+{
+	num_channel = basic_cast<vrpn_int32>(SlaveManager::getNumberOfSlaves());
+	if (num_channel > vrpn_CHANNEL_MAX) num_channel = vrpn_CHANNEL_MAX;
+	for (vrpn_int32 i = 0; i < num_channel; i++)
+	{
+		channel[i] = SlaveManager::K_SLAVE_STARTING;
+		last[i] = SlaveManager::K_SLAVE_STARTING;
+	}
+
+	std::string message = "Status of " + basic_cast<std::string>(num_channel) + " devices initialized on " + name;
+	Log::write("[VRPNDeviceStatus] VRPNDeviceStatus()", message);
+}
+
+VRPNDeviceStatus::~VRPNDeviceStatus()
+{}
+
+void VRPNDeviceStatus::mainloop()
+{
+	server_mainloop();
+
+	for (vrpn_int32 i = 0; i < num_channel; i++) channel[i] = SlaveManager::getLiveness(basic_cast<uint32>(i));
+	vrpn_gettimeofday(&timestamp, 0);
+	report_changes();
+}
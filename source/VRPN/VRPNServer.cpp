@@ -23,13 +23,19 @@
 
 #include "Globals/Definitions.h"
 #include "Globals/Config.h"
+#include "Interprocess/FrameNotifier.h"
+#include "Interprocess/SlaveManager.h"
+#include "Kinect/KinectManager.h"
 #include "Tools/Log.h"
 #include "Tools/Timer.h"
+#include "VRPN/VRPNDeviceStatus.h"
 #include "VRPN/VRPNSkeletonTracker.h"
 #include "VRPN/VRPNWiimote.h"
 #include <sstream>
 
 using namespace MultiKinect;
+using namespace Interprocess;
+using namespace Kinect;
 using namespace Tools;
 using namespace VRPN;
 
@@ -37,11 +43,13 @@ using namespace VRPN;
 bool VRPNServer::initialized_ = false;
 vrpn_Connection_IP* VRPNServer::conn_ = 0;
 VRPNSkeletonTracker* VRPNServer::trackers_[KINECT_SKELETON_COUNT];
+VRPNDeviceStatus* VRPNServer::deviceStatus_ = 0;
 
 #ifdef _WIIMOTE_SUPPORT_
 VRPNWiimote* VRPNServer::wiimotes_[WIIMOTE_COUNT];
 #endif
 
+std::vector<FrameNotifier*> VRPNServer::frameNotifiers_;
 HANDLE VRPNServer::processStopEvent_ = 0;
 HANDLE VRPNServer::processThread_ = 0;
 float VRPNServer::vrpnFPS_ = 0.0f;
@@ -58,6 +66,11 @@ void VRPNServer::initialize()
 			else trackers_[i] = 0;
 		}
 
+		// Clients of a master can tell which devices are left out of the fusion
+		if (SlaveManager::isInitialized() && SlaveManager::getNumberOfSlaves())
+			deviceStatus_ = new VRPNDeviceStatus(VRPN_STATUS_ADDRESS, conn_);
+		else deviceStatus_ = 0;
+
 #ifdef _WIIMOTE_SUPPORT_
 		for (uint32 i = 0; i < WIIMOTE_COUNT; i++)
 		{
@@ -67,6 +80,14 @@ void VRPNServer::initialize()
 		}
 #endif
 
+		// Every known device wakes the server up when it publishes, whichever process captures it
+		for (uint32 i = 0; i < KinectManager::getNumberOfDevices(); i++)
+		{
+			FrameNotifier* notifier = new FrameNotifier();
+			if (notifier->open(KinectManager::getSegmentID(i))) frameNotifiers_.push_back(notifier);
+			else delete notifier;
+		}
+
 		processStopEvent_ = CreateEvent(0, true, false, 0);
 		processThread_ = CreateThread(0, 0, processThread, 0, 0, 0);
 		initialized_ = true;
@@ -91,11 +112,17 @@ void VRPNServer::destroy()
 			processStopEvent_ = 0;
 		}
 
+		for (uint32 i = 0; i < frameNotifiers_.size(); i++) delete frameNotifiers_[i];
+		frameNotifiers_.clear();
+
 #ifdef _WIIMOTE_SUPPORT_
 		for (uint32 i = 0; i < WIIMOTE_COUNT; i++)
 			if (wiimotes_[i]) delete wiimotes_[i];
 #endif
 
+		delete deviceStatus_;
+		deviceStatus_ = 0;
+
 		for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
 			if (trackers_[i]) delete trackers_[i];
 		delete conn_;
@@ -122,8 +149,17 @@ DWORD WINAPI VRPNServer::processThread(LPVOID param)
 
 void VRPNServer::processThread()
 {
-	const uint32 nEvents = 1;
-	HANDLE events[nEvents] = {processStopEvent_};
+	// Trackers are only fed when some device has a new frame, the timeout keeps connections serviced meanwhile
+	std::vector<HANDLE> events(1, processStopEvent_);
+	for (uint32 i = 0; i < frameNotifiers_.size(); i++) events.push_back(frameNotifiers_[i]->getEvent());
+	uint32 nEvents = basic_cast<uint32>(events.size());
+	uint32 timeout = VRPN_IDLE_TIMEOUT;
+
+#ifdef _WIIMOTE_SUPPORT_
+	// Wiimotes are not notified, they still need to be polled often
+	for (uint32 i = 0; i < WIIMOTE_COUNT; i++)
+		if (wiimotes_[i]) timeout = 10;
+#endif
 
 	uint32 vrpnFrames = 0;
 	vrpnFPS_ = 0.0f;
@@ -132,7 +168,7 @@ void VRPNServer::processThread()
 	bool exit = false;
 	while(!exit)
 	{
-		uint32 eventIndex = WaitForMultipleObjects(nEvents, events, false, 10);
+		uint32 eventIndex = WaitForMultipleObjects(nEvents, &events[0], false, timeout);
 		switch (eventIndex)
 		{
 		case WAIT_TIMEOUT:
@@ -146,6 +182,7 @@ void VRPNServer::processThread()
 
 		for (uint32 i = 0; i < KINECT_SKELETON_COUNT; i++)
 			if (trackers_[i]) trackers_[i]->mainloop();
+		if (deviceStatus_) deviceStatus_->mainloop();
 
 #ifdef _WIIMOTE_SUPPORT_
 		for (uint32 i = 0; i < WIIMOTE_COUNT; i++)
@@ -26,6 +26,9 @@
 #include "Kinect/KinectManager.h"
 #include "Kinect/KinectSkeleton.h"
 #include "Render/RenderSystem.h"
+#include "Render/SkeletonFusion.h"
+#include "Render/SkeletonPredictor.h"
+#include "Tools/Clock.h"
 #include "Tools/Log.h"
 #include <vector>
 
@@ -39,12 +42,17 @@ using namespace VRPN;
 
 
 VRPNSkeletonTracker::VRPNSkeletonTracker(const std::string& name, vrpn_Connection* c) : vrpn_Tracker(name.c_str(), c)
-{}
+{
+	predictor_ = 0;
+	lastFrameNumber_ = 0;
+}
 
 void VRPNSkeletonTracker::init(uint32 skeletonID, uint32 kinectID, const std::string& name)
 {
 	skeletonID_ = skeletonID;
 	kinectID_ = kinectID;
+	predictor_ = 0;
+	lastFrameNumber_ = 0;
 
 	std::string trackerStr;
 	if (kinectID_ > -1)
@@ -54,6 +62,7 @@ void VRPNSkeletonTracker::init(uint32 skeletonID, uint32 kinectID, const std::st
 	else
 	{
 		trackerStr = "Tracker " + basic_cast<std::string>(skeletonID);
+		if (Config::localVRPNSkeletons[skeletonID_].prediction) predictor_ = new SkeletonPredictor(trackerStr);
 	}
 
 	std::string message = trackerStr + " initialized on " + name;
@@ -84,6 +93,8 @@ VRPNSkeletonTracker::~VRPNSkeletonTracker()
 		delete subtrackers_[i];
 	}
 	subtrackers_.clear();
+
+	if (predictor_) delete predictor_;
 }
 
 void VRPNSkeletonTracker::mainloop()
@@ -93,8 +104,42 @@ void VRPNSkeletonTracker::mainloop()
 
 	vrpn_Tracker::timestamp = _timestamp;
 
+	// Any device waking the server up runs every tracker, so each one only sends when its own source has a new frame
 	KinectSkeleton skeleton;
-	if (RenderSystem::isInitialized() && RenderSystem::getTransformedKinectSkeleton(skeleton, skeletonID_, kinectID_))
+	bool validSkeleton = false;
+	uint64 frameNumber = lastFrameNumber_;
+	if (RenderSystem::isInitialized())
+	{
+		SkeletonFusion::FusedFrame fusedFrame;
+		if (kinectID_ == -1 && RenderSystem::getFusedKinectFrame(fusedFrame))
+		{
+			frameNumber = fusedFrame.frameID;
+			if (frameNumber != lastFrameNumber_ && skeletonID_ < fusedFrame.nSkeletons)
+			{
+				// Extrapolate the combined skeleton to the send time when prediction is enabled
+				if (predictor_)
+				{
+					skeleton = predictor_->predict(
+						fusedFrame,
+						skeletonID_,
+						Clock::getTime(),
+						Config::localVRPNSkeletons[skeletonID_].predictionHorizon,
+						Config::localVRPNSkeletons[skeletonID_].predictionDamping);
+				}
+				else skeleton = fusedFrame.skeletons[skeletonID_];
+				validSkeleton = true;
+			}
+		}
+		else
+		{
+			// Read before the skeleton, so a frame published in between is sent again rather than missed
+			frameNumber = RenderSystem::getKinectFrameID(kinectID_);
+			if (frameNumber != lastFrameNumber_) validSkeleton = RenderSystem::getTransformedKinectSkeleton(skeleton, skeletonID_, kinectID_);
+		}
+	}
+	lastFrameNumber_ = frameNumber;
+
+	if (validSkeleton)
 	{
 		std::vector<Point> jointsPositions = skeleton.getJointsPositions();
 		std::vector<Quaternion> jointsOrientations = skeleton.getJointsOrientationsQuaternions();